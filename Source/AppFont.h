@@ -1,6 +1,8 @@
 #pragma once
 
 #include <juce_gui_basics/juce_gui_basics.h>
+#include <map>
+#include <utility>
 
 namespace SquareBeats {
 
@@ -44,26 +46,132 @@ public:
     static constexpr float tinySize = 10.0f;
     static constexpr float microSize = 9.0f;
     
+    /**
+     * Fonts created so far, shared by the components that use them
+     * Components hold it as a juce::SharedResourcePointer<AppFont::Cache>
+     * member, so one cache serves every open editor in the process and is
+     * freed with the last component, before JUCE shuts down or the plugin
+     * unloads. Message thread only.
+     */
+    class Cache
+    {
+    public:
+        juce::Font get(float size, bool bold)
+        {
+            const auto key = std::make_pair(size, bold);
+            auto it = fonts.find(key);
+            if (it == fonts.end())
+                it = fonts.emplace(key, createFont(size, bold)).first;
+            return it->second;
+        }
+    
+    private:
+        std::map<std::pair<float, bool>, juce::Font> fonts;
+    };
+    
     /**
      * Get the application font at the specified size.
+     * Each size and style is created once per cache; the copies returned
+     * share its resolved typeface, so calling this from paint() costs no
+     * font lookup, lock or allocation.
+     * @param cache The calling component's font cache
      * @param size Font size in points
      * @param bold Whether to use bold style
      * @return juce::Font configured with platform-appropriate modern font
      */
-    static juce::Font getFont(float size, bool bold = false)
+    static juce::Font getFont(Cache& cache, float size, bool bold = false)
+    {
+        return cache.get(size, bold);
+    }
+    
+    // Convenience methods for common font configurations
+    static juce::Font title(Cache& cache)       { return getFont(cache, titleSize, true); }
+    static juce::Font label(Cache& cache)       { return getFont(cache, labelSize); }
+    static juce::Font smallLabel(Cache& cache)  { return getFont(cache, smallLabelSize, true); }
+    static juce::Font tiny(Cache& cache)        { return getFont(cache, tinySize); }
+    static juce::Font micro(Cache& cache)       { return getFont(cache, microSize); }
+
+private:
+    static juce::Font createFont(float size, bool bold)
     {
         if (bold)
             return juce::Font(juce::FontOptions(getPlatformFont(), size, juce::Font::plain).withStyle("Bold"));
         else
             return juce::Font(juce::FontOptions(getPlatformFont(), size, juce::Font::plain));
     }
+};
+
+//==============================================================================
+/**
+ * Text laid out once and redrawn from its glyphs
+ * 
+ * draw() and drawFitted() lay text out exactly as Graphics::drawText() and
+ * Graphics::drawFittedText() do, but keep the glyph arrangement and only
+ * lay the text out again when the text, font, area or justification change.
+ * Keep one per piece of text a component paints; the current colour is
+ * applied when drawing, so colour changes need no new layout.
+ */
+class CachedText
+{
+public:
+    /**
+     * Draw a single line of text, like Graphics::drawText()
+     */
+    void draw(juce::Graphics& g, const juce::String& text, const juce::Font& font,
+              juce::Rectangle<float> area, juce::Justification justification, bool useEllipses = false)
+    {
+        if (needsLayout(text, font, area, justification, false, useEllipses ? 1 : 0))
+        {
+            glyphs.clear();
+            glyphs.addCurtailedLineOfText(font, text, 0.0f, 0.0f, area.getWidth(), useEllipses);
+            glyphs.justifyGlyphs(0, glyphs.getNumGlyphs(), area.getX(), area.getY(),
+                                 area.getWidth(), area.getHeight(), justification);
+        }
+        glyphs.draw(g);
+    }
     
-    // Convenience methods for common font configurations
-    static juce::Font title()       { return getFont(titleSize, true); }
-    static juce::Font label()       { return getFont(labelSize); }
-    static juce::Font smallLabel()  { return getFont(smallLabelSize, true); }
-    static juce::Font tiny()        { return getFont(tinySize); }
-    static juce::Font micro()       { return getFont(microSize); }
+    /**
+     * Draw text squashed or wrapped to fit an area, like Graphics::drawFittedText()
+     */
+    void drawFitted(juce::Graphics& g, const juce::String& text, const juce::Font& font,
+                    juce::Rectangle<int> area, juce::Justification justification, int maximumNumberOfLines)
+    {
+        if (needsLayout(text, font, area.toFloat(), justification, true, maximumNumberOfLines))
+        {
+            glyphs.clear();
+            glyphs.addFittedText(font, text, static_cast<float>(area.getX()), static_cast<float>(area.getY()),
+                                 static_cast<float>(area.getWidth()), static_cast<float>(area.getHeight()),
+                                 justification, maximumNumberOfLines);
+        }
+        glyphs.draw(g);
+    }
+
+private:
+    juce::GlyphArrangement glyphs;
+    juce::String laidOutText;
+    juce::Font laidOutFont { juce::FontOptions() };
+    juce::Rectangle<float> laidOutArea;
+    juce::Justification laidOutJustification { juce::Justification::centred };
+    bool laidOutFitted = false;
+    int laidOutOption = 0;  // Maximum lines for fitted text, ellipses (1) or not (0) for a single line
+    bool isLaidOut = false;
+    
+    bool needsLayout(const juce::String& text, const juce::Font& font, juce::Rectangle<float> area,
+                     juce::Justification justification, bool fitted, int option)
+    {
+        if (isLaidOut && text == laidOutText && font == laidOutFont && area == laidOutArea
+            && justification == laidOutJustification && fitted == laidOutFitted && option == laidOutOption)
+            return false;
+        
+        laidOutText = text;
+        laidOutFont = font;
+        laidOutArea = area;
+        laidOutJustification = justification;
+        laidOutFitted = fitted;
+        laidOutOption = option;
+        isLaidOut = true;
+        return true;
+    }
 };
 
 } // namespace SquareBeats
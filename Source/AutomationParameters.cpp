@@ -0,0 +1,202 @@
+#include "AutomationParameters.h"
+#include <cmath>
+
+namespace SquareBeats {
+
+//==============================================================================
+AutomationParameters::AutomationParameters(juce::AudioProcessor& processor)
+{
+    const PlayModeConfig defaultPlayMode;
+    const ColorChannelConfig defaultColor;
+    const juce::StringArray quantizeChoices { "1/32", "1/16", "1/8", "1/4", "1/2", "1 Bar" };
+    
+    // Room for every parameter up front: the audio thread walks this list
+    blockParameters.reserve(2 + 3 * MAX_COLOR_CHANNELS);
+    
+    addBlockParameter(processor,
+                      std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "probability", 1 }, "Probability",
+                                                                  0.0f, 1.0f, defaultPlayMode.probability),
+                      AutomationChange::PROBABILITY, 0);
+    addBlockParameter(processor,
+                      std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "stepJumpSize", 1 }, "Step Jump",
+                                                                  0.0f, 1.0f, defaultPlayMode.stepJumpSize),
+                      AutomationChange::STEP_JUMP_SIZE, 0);
+    
+    juce::StringArray loopLengthChoices;
+    for (int index = 0; index < NUM_LOOP_LENGTH_CHOICES; ++index)
+    {
+        const double bars = getLoopLengthChoice(index);
+        if (bars < 1.0)
+        {
+            const int steps = juce::roundToInt(bars * 16.0);
+            loopLengthChoices.add(steps == 1 ? "1 Step" : juce::String(steps) + " Steps");
+        }
+        else
+        {
+            const int wholeBars = juce::roundToInt(bars);
+            loopLengthChoices.add(wholeBars == 1 ? "1 Bar" : juce::String(wholeBars) + " Bars");
+        }
+    }
+    
+    auto loopLengthParameter = std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "loopLength", 1 }, "Loop Length",
+                                                                            loopLengthChoices, findLoopLengthChoice(1.0));
+    loopLength = loopLengthParameter.get();
+    lastLoopLengthHostValue = getPlainValue(*loopLength);
+    lastLoopLengthModelValue = lastLoopLengthHostValue;
+    processor.addParameter(loopLengthParameter.release());
+    
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId)
+    {
+        const juce::String id = "color" + juce::String(colorId + 1);
+        const juce::String name = "Color " + juce::String(colorId + 1) + " ";
+        
+        addBlockParameter(processor,
+                          std::make_unique<juce::AudioParameterInt>(juce::ParameterID { id + "HighNote", 1 }, name + "High Note",
+                                                                    0, 127, defaultColor.highNote),
+                          AutomationChange::HIGH_NOTE, colorId);
+        addBlockParameter(processor,
+                          std::make_unique<juce::AudioParameterInt>(juce::ParameterID { id + "LowNote", 1 }, name + "Low Note",
+                                                                    0, 127, defaultColor.lowNote),
+                          AutomationChange::LOW_NOTE, colorId);
+        addBlockParameter(processor,
+                          std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { id + "Quantize", 1 }, name + "Quantize",
+                                                                       quantizeChoices, static_cast<int>(defaultColor.quantize)),
+                          AutomationChange::QUANTIZE, colorId);
+    }
+}
+
+void AutomationParameters::addBlockParameter(juce::AudioProcessor& processor, std::unique_ptr<juce::RangedAudioParameter> parameter,
+                                             AutomationChange::Target target, int colorId)
+{
+    // Nothing counts as a change until the host or the model moves away from the default
+    const float value = getPlainValue(*parameter);
+    blockParameters.push_back({ parameter.get(), target, colorId, value, value, value });
+    processor.addParameter(parameter.release());
+}
+
+//==============================================================================
+void AutomationParameters::readBlock(PlaybackEngine& engine)
+{
+    for (auto& blockParameter : blockParameters)
+    {
+        const float value = getPlainValue(*blockParameter.parameter);
+        if (value == blockParameter.lastRead)
+            continue;
+        
+        blockParameter.lastRead = value;
+        
+        AutomationChange change;
+        change.target = blockParameter.target;
+        change.colorId = blockParameter.colorId;
+        change.value = value;
+        change.sampleOffset = 0;
+        engine.addAutomationChange(change);
+    }
+}
+
+void AutomationParameters::syncWithModel(PatternModel& model)
+{
+    bool modelChanged = false;
+    
+    for (auto& blockParameter : blockParameters)
+    {
+        const float hostValue = getPlainValue(*blockParameter.parameter);
+        
+        if (hostValue != blockParameter.lastHostValue)
+        {
+            // The host moved it: the host wins over an edit made since the last sync
+            AutomationChange change;
+            change.target = blockParameter.target;
+            change.colorId = blockParameter.colorId;
+            change.value = hostValue;
+            model.applyAutomation(change);
+            modelChanged = true;
+            
+            blockParameter.lastHostValue = hostValue;
+            blockParameter.lastModelValue = getModelValue(model, blockParameter.target, blockParameter.colorId);
+            continue;
+        }
+        
+        const float modelValue = getModelValue(model, blockParameter.target, blockParameter.colorId);
+        if (modelValue != blockParameter.lastModelValue)
+        {
+            sendToHost(*blockParameter.parameter, modelValue);
+            blockParameter.lastModelValue = modelValue;
+            blockParameter.lastHostValue = getPlainValue(*blockParameter.parameter);
+        }
+    }
+    
+    // One announcement for all of them: PatternSync sends what changed and the editor refreshes
+    if (modelChanged)
+        model.sendChangeMessage();
+    
+    const float hostLoopLength = getPlainValue(*loopLength);
+    if (hostLoopLength != lastLoopLengthHostValue)
+    {
+        model.setLoopLength(getLoopLengthChoice(juce::roundToInt(hostLoopLength)));
+        lastLoopLengthHostValue = hostLoopLength;
+        lastLoopLengthModelValue = static_cast<float>(findLoopLengthChoice(model.getLoopLength()));
+        return;
+    }
+    
+    const float modelLoopLength = static_cast<float>(findLoopLengthChoice(model.getLoopLength()));
+    if (modelLoopLength != lastLoopLengthModelValue)
+    {
+        sendToHost(*loopLength, modelLoopLength);
+        lastLoopLengthModelValue = modelLoopLength;
+        lastLoopLengthHostValue = getPlainValue(*loopLength);
+    }
+}
+
+//==============================================================================
+double AutomationParameters::getLoopLengthChoice(int index)
+{
+    // 1-15 steps (1/16 bar each), 1-8 bars, then 16, 32 and 64 bars
+    index = juce::jlimit(0, NUM_LOOP_LENGTH_CHOICES - 1, index);
+    if (index < 15)
+        return (index + 1) / 16.0;
+    if (index < 23)
+        return static_cast<double>(index - 14);
+    return 16.0 * (1 << (index - 23));
+}
+
+int AutomationParameters::findLoopLengthChoice(double loopLengthBars)
+{
+    int nearest = 0;
+    for (int index = 1; index < NUM_LOOP_LENGTH_CHOICES; ++index)
+    {
+        if (std::abs(getLoopLengthChoice(index) - loopLengthBars) < std::abs(getLoopLengthChoice(nearest) - loopLengthBars))
+            nearest = index;
+    }
+    return nearest;
+}
+
+//==============================================================================
+float AutomationParameters::getModelValue(const PatternModel& model, AutomationChange::Target target, int colorId)
+{
+    const ColorChannelConfig& config = model.getColorConfig(colorId);
+    
+    switch (target)
+    {
+        case AutomationChange::PROBABILITY:    return model.getPlayModeConfig().probability;
+        case AutomationChange::STEP_JUMP_SIZE: return model.getPlayModeConfig().stepJumpSize;
+        case AutomationChange::HIGH_NOTE:      return static_cast<float>(config.highNote);
+        case AutomationChange::LOW_NOTE:       return static_cast<float>(config.lowNote);
+        case AutomationChange::QUANTIZE:       return static_cast<float>(config.quantize);
+    }
+    return 0.0f;
+}
+
+float AutomationParameters::getPlainValue(const juce::RangedAudioParameter& parameter)
+{
+    return parameter.convertFrom0to1(parameter.getValue());
+}
+
+void AutomationParameters::sendToHost(juce::RangedAudioParameter& parameter, float value)
+{
+    parameter.beginChangeGesture();
+    parameter.setValueNotifyingHost(parameter.convertTo0to1(value));
+    parameter.endChangeGesture();
+}
+
+} // namespace SquareBeats
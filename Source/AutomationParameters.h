@@ -0,0 +1,98 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "DataStructures.h"
+#include "PatternCommand.h"
+#include "PatternModel.h"
+#include "PlaybackEngine.h"
+#include <vector>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * AutomationParameters exposes playback settings to the host as parameters
+ *
+ * The pattern model stays the source of truth for the editor and saved state;
+ * the parameters mirror it. Host changes reach playback on two paths:
+ * - Play mode probability and step jump size, and each color's high note, low
+ *   note and quantize, are read by the audio thread once per block (one atomic
+ *   load each). Changed values go to the engine as automation changes, which
+ *   it applies to its own pattern copy at their sample, splitting the block.
+ * - The loop length changes how the whole pattern is timed, so it is only
+ *   read on the message thread, written to the live model and staged to the
+ *   engine through PatternSync like an edit in the editor.
+ *
+ * The message thread also mirrors each host change into the live model, and
+ * sends edits made in the editor (or loaded with a preset, slot or state) to
+ * the host, so both sides end up with the same values.
+ */
+class AutomationParameters
+{
+public:
+    /**
+     * Create the parameters and add them to the processor (from its constructor)
+     */
+    explicit AutomationParameters(juce::AudioProcessor& processor);
+    
+    /**
+     * Hand the engine the per-block settings the host changed since the last block
+     * (audio thread, before the engine's processBlock())
+     * JUCE's plugin wrappers deliver one value per parameter per block, so changes
+     * are posted at the block start.
+     */
+    void readBlock(PlaybackEngine& engine);
+    
+    /**
+     * Write host changes to the live model and model edits to the host (message thread, from a timer)
+     */
+    void syncWithModel(PatternModel& model);
+    
+    /**
+     * Loop lengths the loop length parameter chooses from, as offered by the loop length menu
+     */
+    static double getLoopLengthChoice(int index);
+    static int findLoopLengthChoice(double loopLengthBars);
+    static constexpr int NUM_LOOP_LENGTH_CHOICES = 26;
+
+private:
+    // One parameter the audio thread reads per block
+    struct BlockParameter
+    {
+        juce::RangedAudioParameter* parameter;
+        AutomationChange::Target target;
+        int colorId;
+        float lastRead;        // Audio thread
+        float lastHostValue;   // Message thread: parameter value when last synced
+        float lastModelValue;  // Message thread: model value when last synced
+    };
+    
+    void addBlockParameter(juce::AudioProcessor& processor, std::unique_ptr<juce::RangedAudioParameter> parameter,
+                           AutomationChange::Target target, int colorId);
+    
+    /**
+     * Setting's current value in the model, in the parameter's units
+     */
+    static float getModelValue(const PatternModel& model, AutomationChange::Target target, int colorId);
+    
+    /**
+     * Parameter's current value in its own units (a single atomic load)
+     */
+    static float getPlainValue(const juce::RangedAudioParameter& parameter);
+    
+    /**
+     * Set a parameter from the model, as a complete gesture so hosts record it
+     */
+    static void sendToHost(juce::RangedAudioParameter& parameter, float value);
+    
+    //==============================================================================
+    std::vector<BlockParameter> blockParameters;
+    
+    juce::AudioParameterChoice* loopLength = nullptr;
+    float lastLoopLengthHostValue = 0.0f;
+    float lastLoopLengthModelValue = 0.0f;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AutomationParameters)
+};
+
+} // namespace SquareBeats
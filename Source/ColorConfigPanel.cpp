@@ -1,5 +1,6 @@
 #include "ColorConfigPanel.h"
 #include "AppFont.h"
+#include "GrooveImporter.h"
 
 namespace SquareBeats {
 
@@ -32,9 +33,9 @@ void ColorConfigPanel::paint(juce::Graphics& g)
 void ColorConfigPanel::resized()
 {
     auto bounds = getLocalBounds().reduced(8);
-    int rowHeight = 30;
+    int rowHeight = 26;
     int labelWidth = 80;
-    int spacing = 5;
+    int spacing = 4;
     int tabHeight = 32;
     
     // Tab buttons at the top
@@ -83,6 +84,38 @@ void ColorConfigPanel::resized()
     
     bounds.removeFromTop(spacing);
     
+    // Voices row (polyphony and steal policy)
+    auto voicesRow = bounds.removeFromTop(rowHeight);
+    voicesLabel.setBounds(voicesRow.removeFromLeft(labelWidth));
+    voicesRow.removeFromLeft(spacing);
+    polyphonyCombo.setBounds(voicesRow.removeFromLeft(voicesRow.getWidth() / 3));
+    voicesRow.removeFromLeft(spacing);
+    stealPolicyCombo.setBounds(voicesRow);
+    
+    bounds.removeFromTop(spacing);
+    
+    // Pitch-bend row (bend range and control rate)
+    auto bendRow = bounds.removeFromTop(rowHeight);
+    pitchBendLabel.setBounds(bendRow.removeFromLeft(labelWidth));
+    bendRow.removeFromLeft(spacing);
+    pitchBendRangeCombo.setBounds(bendRow.removeFromLeft(bendRow.getWidth() / 2));
+    bendRow.removeFromLeft(spacing);
+    pitchBendRateCombo.setBounds(bendRow);
+    
+    bounds.removeFromTop(spacing);
+    
+    // Groove row (swing, then template load and clear)
+    auto grooveRow = bounds.removeFromTop(rowHeight);
+    grooveLabel.setBounds(grooveRow.removeFromLeft(labelWidth));
+    grooveRow.removeFromLeft(spacing);
+    clearGrooveButton.setBounds(grooveRow.removeFromRight(50));
+    grooveRow.removeFromRight(spacing);
+    loadGrooveButton.setBounds(grooveRow.removeFromRight(70));
+    grooveRow.removeFromRight(spacing);
+    swingSlider.setBounds(grooveRow);
+    
+    bounds.removeFromTop(spacing);
+    
     // Pitch sequencer length row (always visible)
     auto pitchLenRow = bounds.removeFromTop(rowHeight);
     pitchSeqLengthLabel.setBounds(pitchLenRow.removeFromLeft(labelWidth));
@@ -97,17 +130,17 @@ void ColorConfigPanel::resized()
     mainLoopRow.removeFromLeft(spacing);
     mainLoopLengthCombo.setBounds(mainLoopRow);
     
-    bounds.removeFromTop(spacing * 2);  // Extra spacing before clear button
+    bounds.removeFromTop(spacing);
     
     // Clear button at the bottom (context-sensitive)
-    auto clearButtonBounds = bounds.removeFromTop(36);
+    auto clearButtonBounds = bounds.removeFromTop(28);
     clearButton.setBounds(clearButtonBounds);
 }
 
 //==============================================================================
 void ColorConfigPanel::setColorChannel(int colorChannelId)
 {
-    if (colorChannelId >= 0 && colorChannelId < 4)
+    if (colorChannelId >= 0 && colorChannelId < patternModel.getNumColorChannels())
     {
         currentColorChannel = colorChannelId;
         refreshFromModel();
@@ -145,6 +178,19 @@ void ColorConfigPanel::refreshFromModel()
     // Update MIDI channel combo
     midiChannelCombo.setSelectedId(config.midiChannel, juce::dontSendNotification);
     
+    // Update polyphony and steal policy
+    polyphonyCombo.setSelectedId(juce::jlimit(1, MAX_VOICES_PER_COLOR, config.polyphony), juce::dontSendNotification);
+    stealPolicyCombo.setSelectedId(static_cast<int>(config.stealPolicy) + 1, juce::dontSendNotification);
+    
+    // Update pitch-bend range and rate (rate only matters with a bend range)
+    pitchBendRangeCombo.setSelectedId(config.pitchBendRange + 1, juce::dontSendNotification);
+    pitchBendRateCombo.setSelectedId(config.pitchBendRateHz, juce::dontSendNotification);
+    pitchBendRateCombo.setEnabled(config.pitchBendRange > 0);
+    
+    // Update swing and groove template
+    swingSlider.setValue(config.groove.getSwing() * 100.0, juce::dontSendNotification);
+    clearGrooveButton.setEnabled(config.groove.getNumTemplateSteps() > 0);
+    
     // Update pitch sequencer length
     if (config.pitchSeqLoopLengthBars <= 0)
     {
@@ -213,7 +259,7 @@ void ColorConfigPanel::setupComponents()
     // Quantization label and combo
     quantizationLabel.setText("Quantization:", juce::dontSendNotification);
     quantizationLabel.setColour(juce::Label::textColourId, juce::Colours::white);
-    quantizationLabel.setFont(AppFont::label());
+    quantizationLabel.setFont(AppFont::label(*fonts));
     addAndMakeVisible(quantizationLabel);
     
     quantizationCombo.addItem("1/32", 1);
@@ -229,7 +275,7 @@ void ColorConfigPanel::setupComponents()
     // High note label, slider, and value
     highNoteLabel.setText("High Note:", juce::dontSendNotification);
     highNoteLabel.setColour(juce::Label::textColourId, juce::Colours::white);
-    highNoteLabel.setFont(AppFont::label());
+    highNoteLabel.setFont(AppFont::label(*fonts));
     addAndMakeVisible(highNoteLabel);
     
     highNoteSlider.setRange(0, 127, 1);
@@ -242,13 +288,13 @@ void ColorConfigPanel::setupComponents()
     highNoteValue.setText("C6", juce::dontSendNotification);
     highNoteValue.setColour(juce::Label::textColourId, juce::Colours::white);
     highNoteValue.setJustificationType(juce::Justification::centred);
-    highNoteValue.setFont(AppFont::label());
+    highNoteValue.setFont(AppFont::label(*fonts));
     addAndMakeVisible(highNoteValue);
     
     // Low note label, slider, and value
     lowNoteLabel.setText("Low Note:", juce::dontSendNotification);
     lowNoteLabel.setColour(juce::Label::textColourId, juce::Colours::white);
-    lowNoteLabel.setFont(AppFont::label());
+    lowNoteLabel.setFont(AppFont::label(*fonts));
     addAndMakeVisible(lowNoteLabel);
     
     lowNoteSlider.setRange(0, 127, 1);
@@ -261,13 +307,13 @@ void ColorConfigPanel::setupComponents()
     lowNoteValue.setText("C3", juce::dontSendNotification);
     lowNoteValue.setColour(juce::Label::textColourId, juce::Colours::white);
     lowNoteValue.setJustificationType(juce::Justification::centred);
-    lowNoteValue.setFont(AppFont::label());
+    lowNoteValue.setFont(AppFont::label(*fonts));
     addAndMakeVisible(lowNoteValue);
     
     // MIDI channel label and combo
     midiChannelLabel.setText("MIDI Channel:", juce::dontSendNotification);
     midiChannelLabel.setColour(juce::Label::textColourId, juce::Colours::white);
-    midiChannelLabel.setFont(AppFont::label());
+    midiChannelLabel.setFont(AppFont::label(*fonts));
     addAndMakeVisible(midiChannelLabel);
     
     for (int i = 1; i <= 16; ++i)
@@ -278,10 +324,83 @@ void ColorConfigPanel::setupComponents()
     midiChannelCombo.onChange = [this]() { onMidiChannelChanged(); };
     addAndMakeVisible(midiChannelCombo);
     
+    // Voices: polyphony (1 = mono) and which voice to steal when all are busy
+    voicesLabel.setText("Voices:", juce::dontSendNotification);
+    voicesLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    voicesLabel.setFont(AppFont::label(*fonts));
+    addAndMakeVisible(voicesLabel);
+    
+    for (int i = 1; i <= MAX_VOICES_PER_COLOR; ++i)
+    {
+        polyphonyCombo.addItem(i == 1 ? "Mono" : juce::String(i), i);
+    }
+    polyphonyCombo.setSelectedId(1); // Default to monophonic
+    polyphonyCombo.onChange = [this]() { onPolyphonyChanged(); };
+    addAndMakeVisible(polyphonyCombo);
+    
+    stealPolicyCombo.addItem("Steal Oldest", STEAL_OLDEST + 1);
+    stealPolicyCombo.addItem("Steal Quietest", STEAL_LOWEST_VELOCITY + 1);
+    stealPolicyCombo.addItem("Steal Same Pitch", STEAL_SAME_PITCH + 1);
+    stealPolicyCombo.setSelectedId(STEAL_OLDEST + 1);
+    stealPolicyCombo.onChange = [this]() { onStealPolicyChanged(); };
+    addAndMakeVisible(stealPolicyCombo);
+    
+    // Pitch bend: send the pitch sequencer as pitch-bend (range must match the synth's)
+    pitchBendLabel.setText("Pitch Bend:", juce::dontSendNotification);
+    pitchBendLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    pitchBendLabel.setFont(AppFont::label(*fonts));
+    addAndMakeVisible(pitchBendLabel);
+    
+    pitchBendRangeCombo.addItem("Off (Notes)", 1);
+    for (int range : { 1, 2, 3, 7, 12, 24, MAX_PITCH_BEND_RANGE })
+    {
+        pitchBendRangeCombo.addItem(juce::String::charToString(0x00B1) + juce::String(range) + " st", range + 1);
+    }
+    pitchBendRangeCombo.setSelectedId(1); // Default to note numbers
+    pitchBendRangeCombo.onChange = [this]() { onPitchBendRangeChanged(); };
+    addAndMakeVisible(pitchBendRangeCombo);
+    
+    for (int rateHz : { 100, DEFAULT_PITCH_BEND_RATE_HZ, 500, 1000, MAX_PITCH_BEND_RATE_HZ })
+    {
+        pitchBendRateCombo.addItem(juce::String(rateHz) + " Hz", rateHz);
+    }
+    pitchBendRateCombo.setSelectedId(DEFAULT_PITCH_BEND_RATE_HZ);
+    pitchBendRateCombo.onChange = [this]() { onPitchBendRateChanged(); };
+    addAndMakeVisible(pitchBendRateCombo);
+    
+    // Groove: swing delays every second grid step; a template comes from a MIDI file
+    grooveLabel.setText("Swing:", juce::dontSendNotification);
+    grooveLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    grooveLabel.setFont(AppFont::label(*fonts));
+    addAndMakeVisible(grooveLabel);
+    
+    swingSlider.setRange(0, 100, 1);
+    swingSlider.setValue(0); // Default straight
+    swingSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    swingSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    swingSlider.setTextValueSuffix("%");
+    swingSlider.setPopupDisplayEnabled(true, false, this);
+    swingSlider.onValueChange = [this]() { onSwingChanged(); };
+    addAndMakeVisible(swingSlider);
+    
+    loadGrooveButton.setButtonText("Groove...");
+    loadGrooveButton.setTooltip("Take timing and velocity offsets from a MIDI file");
+    loadGrooveButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff3a3a3a));
+    loadGrooveButton.setColour(juce::TextButton::textColourOffId, juce::Colours::white);
+    loadGrooveButton.onClick = [this]() { onLoadGrooveClicked(); };
+    addAndMakeVisible(loadGrooveButton);
+    
+    clearGrooveButton.setButtonText("Off");
+    clearGrooveButton.setTooltip("Remove the groove template");
+    clearGrooveButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff3a3a3a));
+    clearGrooveButton.setColour(juce::TextButton::textColourOffId, juce::Colours::white);
+    clearGrooveButton.onClick = [this]() { onClearGrooveClicked(); };
+    addAndMakeVisible(clearGrooveButton);
+    
     // Pitch sequencer length
     pitchSeqLengthLabel.setText("Pitch Length:", juce::dontSendNotification);
     pitchSeqLengthLabel.setColour(juce::Label::textColourId, juce::Colours::white);
-    pitchSeqLengthLabel.setFont(AppFont::label());
+    pitchSeqLengthLabel.setFont(AppFont::label(*fonts));
     addAndMakeVisible(pitchSeqLengthLabel);
     
     pitchSeqLengthCombo.addItem("Global", 1);  // ID 1 = use global loop length
@@ -298,7 +417,7 @@ void ColorConfigPanel::setupComponents()
     // Options match global loop length: 1-15 steps, 1-8 bars, 16/32/64 bars
     mainLoopLengthLabel.setText("Loop Length:", juce::dontSendNotification);
     mainLoopLengthLabel.setColour(juce::Label::textColourId, juce::Colours::white);
-    mainLoopLengthLabel.setFont(AppFont::label());
+    mainLoopLengthLabel.setFont(AppFont::label(*fonts));
     addAndMakeVisible(mainLoopLengthLabel);
     
     int itemId = 1;
@@ -397,9 +516,7 @@ void ColorConfigPanel::onClearClicked()
     if (pitchSeq.editingPitch)
     {
         // Clear pitch sequencer for current color
-        auto& config = patternModel.getColorConfig(currentColorChannel);
-        config.pitchWaveform.clear();
-        patternModel.setColorConfig(currentColorChannel, config);
+        patternModel.setPitchWaveform(currentColorChannel, nullptr);
     }
     else
     {
@@ -457,6 +574,89 @@ void ColorConfigPanel::onMidiChannelChanged()
     patternModel.setColorConfig(currentColorChannel, config);
 }
 
+void ColorConfigPanel::onPolyphonyChanged()
+{
+    auto& config = patternModel.getColorConfig(currentColorChannel);
+    config.polyphony = polyphonyCombo.getSelectedId();
+    
+    patternModel.setColorConfig(currentColorChannel, config);
+}
+
+void ColorConfigPanel::onStealPolicyChanged()
+{
+    auto& config = patternModel.getColorConfig(currentColorChannel);
+    config.stealPolicy = static_cast<VoiceStealPolicy>(stealPolicyCombo.getSelectedId() - 1);
+    
+    patternModel.setColorConfig(currentColorChannel, config);
+}
+
+void ColorConfigPanel::onPitchBendRangeChanged()
+{
+    auto& config = patternModel.getColorConfig(currentColorChannel);
+    config.pitchBendRange = pitchBendRangeCombo.getSelectedId() - 1;
+    
+    patternModel.setColorConfig(currentColorChannel, config);
+    pitchBendRateCombo.setEnabled(config.pitchBendRange > 0);
+}
+
+void ColorConfigPanel::onPitchBendRateChanged()
+{
+    auto& config = patternModel.getColorConfig(currentColorChannel);
+    config.pitchBendRateHz = pitchBendRateCombo.getSelectedId();
+    
+    patternModel.setColorConfig(currentColorChannel, config);
+}
+
+void ColorConfigPanel::onSwingChanged()
+{
+    auto& config = patternModel.getColorConfig(currentColorChannel);
+    config.groove.setSwing(static_cast<float>(swingSlider.getValue() / 100.0));
+    
+    patternModel.setColorConfig(currentColorChannel, config);
+}
+
+void ColorConfigPanel::onLoadGrooveClicked()
+{
+    grooveChooser = std::make_unique<juce::FileChooser>("Load Groove From MIDI File",
+                                                        juce::File::getSpecialLocation(juce::File::userHomeDirectory),
+                                                        "*.mid;*.midi");
+    
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    grooveChooser->launchAsync(flags, [this, colorId = currentColorChannel](const juce::FileChooser& chooser)
+    {
+        juce::File file = chooser.getResult();
+        if (file == juce::File())
+            return;
+        
+        // Measured on the grid of the color's quantize setting at the time of loading
+        auto& config = patternModel.getColorConfig(colorId);
+        std::vector<Groove::Step> steps;
+        if (!GrooveImporter::loadTemplate(file, config.quantize, steps))
+        {
+            juce::AlertWindow::showMessageBoxAsync(
+                juce::AlertWindow::WarningIcon,
+                "Load Failed",
+                "No groove could be read from '" + file.getFileName() + "'",
+                "OK"
+            );
+            return;
+        }
+        
+        config.groove.setTemplate(steps);
+        patternModel.setColorConfig(colorId, config);
+        refreshFromModel();
+    });
+}
+
+void ColorConfigPanel::onClearGrooveClicked()
+{
+    auto& config = patternModel.getColorConfig(currentColorChannel);
+    config.groove.clearTemplate();
+    
+    patternModel.setColorConfig(currentColorChannel, config);
+    clearGrooveButton.setEnabled(false);
+}
+
 void ColorConfigPanel::onPitchSeqLengthChanged()
 {
     auto& config = patternModel.getColorConfig(currentColorChannel);
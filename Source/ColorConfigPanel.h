@@ -2,6 +2,7 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "PatternModel.h"
+#include "AppFont.h"
 
 namespace SquareBeats {
 
@@ -85,7 +86,7 @@ public:
  * ColorConfigPanel - Configuration panel for a color channel
  * 
  * Tab-based panel with two modes:
- * - SQUARES tab: Quantization, High/Low note, MIDI channel
+ * - SQUARES tab: Quantization, High/Low note, MIDI channel, voices, groove
  * - PITCH tab: Pitch sequencer editing mode
  */
 class ColorConfigPanel : public juce::Component
@@ -94,7 +95,7 @@ public:
     //==============================================================================
     ColorConfigPanel(PatternModel& model);
     ~ColorConfigPanel() override;
-
+    
     //==============================================================================
     void paint(juce::Graphics& g) override;
     void resized() override;
@@ -125,6 +126,7 @@ public:
 private:
     PatternModel& patternModel;
     int currentColorChannel;
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
     
     // Custom look and feel for tab buttons
     TabButtonLookAndFeel tabButtonLookAndFeel;
@@ -148,6 +150,23 @@ private:
     juce::Label midiChannelLabel;
     juce::ComboBox midiChannelCombo;
     
+    // Polyphony and voice steal policy
+    juce::Label voicesLabel;
+    juce::ComboBox polyphonyCombo;
+    juce::ComboBox stealPolicyCombo;
+    
+    // Pitch-bend output range and control rate
+    juce::Label pitchBendLabel;
+    juce::ComboBox pitchBendRangeCombo;
+    juce::ComboBox pitchBendRateCombo;
+    
+    // Swing and groove template (loaded from a MIDI file)
+    juce::Label grooveLabel;
+    juce::Slider swingSlider;
+    juce::TextButton loadGrooveButton;
+    juce::TextButton clearGrooveButton;
+    std::unique_ptr<juce::FileChooser> grooveChooser;
+    
     // Pitch sequencer controls (always visible)
     juce::Label pitchSeqLengthLabel;
     juce::ComboBox pitchSeqLengthCombo;
@@ -204,6 +223,41 @@ private:
      */
     void onMidiChannelChanged();
     
+    /**
+     * Handle polyphony combo box change
+     */
+    void onPolyphonyChanged();
+    
+    /**
+     * Handle steal policy combo box change
+     */
+    void onStealPolicyChanged();
+    
+    /**
+     * Handle pitch-bend range combo box change
+     */
+    void onPitchBendRangeChanged();
+    
+    /**
+     * Handle pitch-bend rate combo box change
+     */
+    void onPitchBendRateChanged();
+    
+    /**
+     * Handle swing slider change
+     */
+    void onSwingChanged();
+    
+    /**
+     * Choose a MIDI file and take the color's groove template from it
+     */
+    void onLoadGrooveClicked();
+    
+    /**
+     * Remove the color's groove template (swing stays)
+     */
+    void onClearGrooveClicked();
+    
     /**
      * Handle pitch sequencer length change
      */
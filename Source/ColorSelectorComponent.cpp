@@ -22,7 +22,7 @@ void ColorSelectorComponent::paint(juce::Graphics& g)
     g.fillAll(juce::Colour(0xff2a2a2a));
     
     // Draw each color button
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < patternModel.getNumColorChannels(); ++i)
     {
         auto buttonBounds = getColorButtonBounds(i);
         const auto& colorConfig = patternModel.getColorConfig(i);
@@ -81,7 +81,7 @@ void ColorSelectorComponent::mouseDown(const juce::MouseEvent& event)
 {
     int clickedButton = findColorButtonAt(event.getPosition());
     
-    if (clickedButton >= 0 && clickedButton < 4)
+    if (clickedButton >= 0)
     {
         setSelectedColorChannel(clickedButton);
         
@@ -95,7 +95,7 @@ void ColorSelectorComponent::mouseDown(const juce::MouseEvent& event)
 //==============================================================================
 void ColorSelectorComponent::setSelectedColorChannel(int colorChannelId)
 {
-    if (colorChannelId >= 0 && colorChannelId < 4 && colorChannelId != selectedColorChannel)
+    if (colorChannelId >= 0 && colorChannelId < patternModel.getNumColorChannels() && colorChannelId != selectedColorChannel)
     {
         selectedColorChannel = colorChannelId;
         repaint();
@@ -116,19 +116,25 @@ void ColorSelectorComponent::removeListener(Listener* listener)
 juce::Rectangle<int> ColorSelectorComponent::getColorButtonBounds(int colorChannelId) const
 {
     auto bounds = getLocalBounds();
-    int buttonWidth = bounds.getWidth() / 4;
+    
+    // One row up to BUTTONS_PER_ROW channels, then wrap into additional rows
+    int numChannels = patternModel.getNumColorChannels();
+    int columns = juce::jmin(numChannels, BUTTONS_PER_ROW);
+    int rows = (numChannels + BUTTONS_PER_ROW - 1) / BUTTONS_PER_ROW;
+    int buttonWidth = bounds.getWidth() / juce::jmax(1, columns);
+    int buttonHeight = bounds.getHeight() / juce::jmax(1, rows);
     
     return juce::Rectangle<int>(
-        colorChannelId * buttonWidth,
-        0,
+        (colorChannelId % BUTTONS_PER_ROW) * buttonWidth,
+        (colorChannelId / BUTTONS_PER_ROW) * buttonHeight,
         buttonWidth,
-        bounds.getHeight()
+        buttonHeight
     );
 }
 
 int ColorSelectorComponent::findColorButtonAt(juce::Point<int> position) const
 {
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < patternModel.getNumColorChannels(); ++i)
     {
         if (getColorButtonBounds(i).contains(position))
         {
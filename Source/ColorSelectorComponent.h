@@ -10,7 +10,8 @@ namespace SquareBeats {
 /**
  * ColorSelectorComponent - UI for selecting the active color channel
  * 
- * Displays 4 color buttons representing the available color channels.
+ * Displays one color button per color channel in use, wrapping into a
+ * second row when there are more than BUTTONS_PER_ROW channels.
  * Highlights the currently selected color and notifies listeners when
  * the selection changes.
  */
@@ -64,6 +65,8 @@ public:
     void setVisualFeedbackState(VisualFeedbackState* state) { visualFeedback = state; }
 
 private:
+    static constexpr int BUTTONS_PER_ROW = 8;
+    
     PatternModel& patternModel;
     int selectedColorChannel;
     juce::ListenerList<Listener> listeners;
@@ -76,7 +79,7 @@ private:
     
     /**
      * Find which color button was clicked at the given position
-     * @return Color channel ID (0-3) or -1 if no button was clicked
+     * @return Color channel ID or -1 if no button was clicked
      */
     int findColorButtonAt(juce::Point<int> position) const;
     
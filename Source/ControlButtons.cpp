@@ -28,7 +28,7 @@ void ControlButtons::resized()
 //==============================================================================
 void ControlButtons::setSelectedColorChannel(int colorChannelId)
 {
-    if (colorChannelId >= 0 && colorChannelId < 4)
+    if (colorChannelId >= 0 && colorChannelId < MAX_COLOR_CHANNELS)
     {
         selectedColorChannel = colorChannelId;
     }
@@ -78,4 +78,48 @@ inline int mapHeightToVelocity(float normalizedHeight)
     return std::clamp(velocity, 1, 127);
 }
 
+/**
+ * Map MIDI velocity to square height (inverse of mapHeightToVelocity())
+ * @param velocity MIDI velocity (1-127)
+ * @return Normalized vertical height (0.0 to 1.0)
+ */
+inline float mapVelocityToHeight(int velocity)
+{
+    return static_cast<float>(std::clamp(velocity, 1, 127) - 1) / 126.0f;
+}
+
+/**
+ * Map MIDI note to vertical position (inverse of mapVerticalPositionToNote() without an offset)
+ * @param note MIDI note number (0-127)
+ * @param highNote MIDI note at top of sequencing plane (0-127)
+ * @param lowNote MIDI note at bottom of sequencing plane (0-127)
+ * @return Normalized vertical position (0.0 = top, 1.0 = bottom); notes outside the range land on its nearest edge
+ */
+inline float mapNoteToVerticalPosition(int note, int highNote, int lowNote)
+{
+    if (highNote == lowNote)
+        return 0.5f;
+    
+    float normalizedY = static_cast<float>(note - highNote) / static_cast<float>(lowNote - highNote);
+    return std::clamp(normalizedY, 0.0f, 1.0f);
+}
+
+/**
+ * Vertical extent of a square that plays a velocity at a vertical position
+ * The square is centred on the position with the height for the velocity, made
+ * shorter near the top or bottom so its centre (the pitch) stays put.
+ * @param normalizedY Normalized vertical position of the square's centre
+ * @param velocity MIDI velocity (1-127)
+ * @param minSize Smallest square height
+ * @param topEdge Receives the square's top edge
+ * @param height Receives the square's height
+ */
+inline void mapVelocityAroundPosition(float normalizedY, int velocity, float minSize, float& topEdge, float& height)
+{
+    // Leave room for the smallest square at the edges
+    const float centreY = std::clamp(normalizedY, minSize * 0.5f, 1.0f - minSize * 0.5f);
+    height = std::clamp(mapVelocityToHeight(velocity), minSize, 2.0f * std::min(centreY, 1.0f - centreY));
+    topEdge = centreY - height * 0.5f;
+}
+
 } // namespace SquareBeats
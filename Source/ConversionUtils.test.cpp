@@ -226,6 +226,35 @@ void testMapHeightToVelocity()
     std::cout << "✓ mapHeightToVelocity() test passed\n";
 }
 
+void testMapNoteToVerticalPosition()
+{
+    std::cout << "Testing mapNoteToVerticalPosition()...\n";
+    
+    // Range ends map to the plane's top and bottom
+    assert(approxEqual(mapNoteToVerticalPosition(84, 84, 48), 0.0f));
+    assert(approxEqual(mapNoteToVerticalPosition(48, 84, 48), 1.0f));
+    
+    // Every note in the range maps back to itself
+    for (int note = 48; note <= 84; ++note)
+        assert(mapVerticalPositionToNote(mapNoteToVerticalPosition(note, 84, 48), 84, 48, 0.0f) == note);
+    
+    // Notes outside the range land on its nearest edge
+    assert(approxEqual(mapNoteToVerticalPosition(100, 84, 48), 0.0f));
+    assert(approxEqual(mapNoteToVerticalPosition(20, 84, 48), 1.0f));
+    
+    // A single-note range puts every note in the middle
+    assert(approxEqual(mapNoteToVerticalPosition(60, 60, 60), 0.5f));
+    
+    // Heights are the inverse of the velocity mapping, shortened near the edges
+    float topEdge, height;
+    mapVelocityAroundPosition(0.5f, 64, 0.01f, topEdge, height);
+    assert(mapHeightToVelocity(height) == 64 && approxEqual(topEdge + height * 0.5f, 0.5f));
+    mapVelocityAroundPosition(0.1f, 127, 0.01f, topEdge, height);
+    assert(approxEqual(height, 0.2f) && approxEqual(topEdge, 0.0f));
+    
+    std::cout << "✓ mapNoteToVerticalPosition() test passed\n";
+}
+
 void testMIDIMappingEdgeCases()
 {
     std::cout << "Testing MIDI mapping edge cases...\n";
@@ -268,6 +297,7 @@ int main()
         testTimeConversionRoundTrip();
         testMapVerticalPositionToNote();
         testMapHeightToVelocity();
+        testMapNoteToVerticalPosition();
         testMIDIMappingEdgeCases();
         
         std::cout << "\n✓ All ConversionUtils tests passed!\n";
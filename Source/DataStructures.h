@@ -2,10 +2,52 @@
 
 #include <juce_graphics/juce_graphics.h>
 #include <vector>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <initializer_list>
 #include <cstdint>
 
 namespace SquareBeats {
 
+//==============================================================================
+/**
+ * Color channel count limits
+ * One color channel per MIDI channel at most. Per-channel storage is sized to
+ * MAX_COLOR_CHANNELS; the number actually in use is PatternModel::getNumColorChannels().
+ */
+constexpr int MAX_COLOR_CHANNELS = 16;
+constexpr int DEFAULT_COLOR_CHANNELS = 4;
+
+/**
+ * Upper bound on simultaneous notes per color channel (voice pool capacity)
+ */
+constexpr int MAX_VOICES_PER_COLOR = 16;
+
+//==============================================================================
+/**
+ * Pitch-bend output limits
+ * A color with a pitch-bend range sends its pitch sequencer as MIDI pitch-bend
+ * at its control rate while notes are held, instead of shifting note numbers.
+ */
+constexpr int MAX_PITCH_BEND_RANGE = 48;          // Semitones each way (MPE-style synths)
+constexpr int MIN_PITCH_BEND_RATE_HZ = 10;
+constexpr int MAX_PITCH_BEND_RATE_HZ = 2000;
+constexpr int DEFAULT_PITCH_BEND_RATE_HZ = 250;
+
+//==============================================================================
+/**
+ * Which sounding voice a color channel gives up when a new note arrives and
+ * all of its voices are busy. A new note whose pitch is already sounding on
+ * the channel always retriggers that voice instead of stealing another.
+ */
+enum VoiceStealPolicy {
+    STEAL_OLDEST = 0,        // Voice that started first
+    STEAL_LOWEST_VELOCITY,   // Quietest voice (oldest on ties)
+    STEAL_SAME_PITCH,        // Voice closest in pitch to the new note (oldest on ties)
+    NUM_STEAL_POLICIES
+};
+
 //==============================================================================
 /**
  * Time signature configuration
@@ -215,6 +257,473 @@ struct ScaleConfig {
     }
 };
 
+//==============================================================================
+/**
+ * Precomputed snapping table for one scale
+ * Maps every MIDI note (0-127) to ScaleConfig::snapToScale() of that note, so
+ * note-on time snapping is a single array read.
+ */
+struct ScaleNoteTable {
+    std::array<uint8_t, 128> snappedNotes;
+    
+    ScaleNoteTable() {
+        for (int note = 0; note < 128; ++note) {
+            snappedNotes[note] = static_cast<uint8_t>(note);
+        }
+    }
+    
+    explicit ScaleNoteTable(const ScaleConfig& scale) {
+        for (int note = 0; note < 128; ++note) {
+            snappedNotes[note] = static_cast<uint8_t>(scale.snapToScale(note));
+        }
+    }
+    
+    /**
+     * Snap a MIDI note to the scale
+     * @param midiNote Input MIDI note (clamped to 0-127)
+     * @return Snapped MIDI note (0-127)
+     */
+    int snap(int midiNote) const {
+        return snappedNotes[static_cast<size_t>(juce::jlimit(0, 127, midiNote))];
+    }
+};
+
+//==============================================================================
+/**
+ * One breakpoint of a pitch envelope
+ */
+struct PitchBreakpoint {
+    int index;      // Position on the envelope grid (0 to resolution - 1)
+    float value;    // Pitch offset in semitones
+};
+
+//==============================================================================
+/**
+ * Sparse pitch sequencer curve
+ *
+ * The curve is defined on a grid of `resolution` evenly spaced points across
+ * the pitch loop, but only breakpoints are stored: grid points between two
+ * breakpoints lie on the straight line joining them. Memory, state size and
+ * evaluation cost follow the number of breakpoints rather than the resolution,
+ * so long pitch loops can use fine grids. Envelopes are immutable once built;
+ * edits return a new envelope.
+ */
+class PitchEnvelope {
+public:
+    using Breakpoints = std::vector<PitchBreakpoint>;
+    
+    static constexpr int MAX_RESOLUTION = 1 << 20;
+    
+    PitchEnvelope() = default;
+    
+    /**
+     * Build an envelope from breakpoints in any order
+     * Indices are clamped to the grid (the last of duplicate indices wins), the
+     * first and last grid points always get a breakpoint (holding the nearest
+     * value) and breakpoints inside flat runs are dropped.
+     */
+    PitchEnvelope(int gridResolution, Breakpoints breakpoints)
+        : resolution(juce::jlimit(0, MAX_RESOLUTION, gridResolution))
+    {
+        if (resolution == 0 || breakpoints.empty()) {
+            resolution = 0;
+            return;
+        }
+        
+        for (auto& point : breakpoints) {
+            point.index = juce::jlimit(0, resolution - 1, point.index);
+            if (std::isnan(point.value) || std::isinf(point.value)) {
+                point.value = 0.0f;
+            }
+        }
+        std::stable_sort(breakpoints.begin(), breakpoints.end(),
+            [](const PitchBreakpoint& a, const PitchBreakpoint& b) { return a.index < b.index; });
+        
+        points.reserve(breakpoints.size() + 2);
+        if (breakpoints.front().index != 0) {
+            points.push_back({ 0, breakpoints.front().value });
+        }
+        for (const auto& point : breakpoints) {
+            if (!points.empty() && points.back().index == point.index) {
+                points.back().value = point.value;
+            } else {
+                points.push_back(point);
+            }
+        }
+        if (points.back().index != resolution - 1) {
+            points.push_back({ resolution - 1, points.back().value });
+        }
+        
+        // Interior breakpoints of flat runs are implied by their neighbours
+        size_t kept = 1;
+        for (size_t i = 1; i < points.size(); ++i) {
+            bool isLast = (i + 1 == points.size());
+            if (!isLast && points[kept - 1].value == points[i].value && points[i].value == points[i + 1].value) {
+                continue;
+            }
+            points[kept++] = points[i];
+        }
+        points.resize(kept);
+    }
+    
+    /**
+     * Lossless conversion from evenly spaced samples
+     * Every sample is reproduced exactly by getSample() and toSamples().
+     */
+    static PitchEnvelope fromSamples(const std::vector<float>& samples) {
+        Breakpoints breakpoints;
+        breakpoints.reserve(samples.size());
+        for (size_t i = 0; i < samples.size(); ++i) {
+            breakpoints.push_back({ static_cast<int>(i), samples[i] });
+        }
+        return PitchEnvelope(static_cast<int>(samples.size()), std::move(breakpoints));
+    }
+    
+    /**
+     * Flat (all-zero) envelope with two breakpoints
+     */
+    static PitchEnvelope flat(int gridResolution) {
+        return PitchEnvelope(gridResolution, { { 0, 0.0f } });
+    }
+    
+    int getResolution() const { return resolution; }
+    const Breakpoints& getBreakpoints() const { return points; }
+    bool empty() const { return resolution == 0; }
+    
+    bool isFlat() const {
+        return std::all_of(points.begin(), points.end(), [](const PitchBreakpoint& p) { return p.value == 0.0f; });
+    }
+    
+    /**
+     * Value at a grid point
+     */
+    float getSample(int index) const {
+        return evaluate(static_cast<double>(index));
+    }
+    
+    /**
+     * Get pitch offset at normalized position (0.0 to 1.0), wrapping outside it
+     * Linear interpolation between breakpoints; O(log n) in the number of breakpoints.
+     */
+    float getValueAt(double normalizedPosition) const {
+        if (resolution == 0) {
+            return 0.0f;
+        }
+        normalizedPosition = normalizedPosition - std::floor(normalizedPosition);
+        return evaluate(normalizedPosition * (resolution - 1));
+    }
+    
+    /**
+     * Expand to one value per grid point
+     */
+    std::vector<float> toSamples() const {
+        std::vector<float> samples;
+        samples.reserve(static_cast<size_t>(resolution));
+        for (size_t i = 0; i < points.size(); ++i) {
+            samples.push_back(points[i].value);
+            if (i + 1 < points.size()) {
+                for (int index = points[i].index + 1; index < points[i + 1].index; ++index) {
+                    samples.push_back(interpolate(points[i], points[i + 1], index));
+                }
+            }
+        }
+        return samples;
+    }
+    
+    //==============================================================================
+    /**
+     * Copy with the grid points from startIndex to endIndex set to a straight
+     * line between the two values; every other grid point keeps its value
+     */
+    PitchEnvelope withRamp(int startIndex, float startValue, int endIndex, float endValue) const {
+        if (resolution == 0) {
+            return PitchEnvelope();
+        }
+        if (startIndex > endIndex) {
+            std::swap(startIndex, endIndex);
+            std::swap(startValue, endValue);
+        }
+        startIndex = juce::jlimit(0, resolution - 1, startIndex);
+        endIndex = juce::jlimit(0, resolution - 1, endIndex);
+        
+        Breakpoints edited;
+        edited.reserve(points.size() + 4);
+        
+        // Pin the grid points either side of the ramp so their segments keep their shape
+        auto before = std::lower_bound(points.begin(), points.end(), startIndex,
+            [](const PitchBreakpoint& p, int index) { return p.index < index; });
+        auto after = std::upper_bound(points.begin(), points.end(), endIndex,
+            [](int index, const PitchBreakpoint& p) { return index < p.index; });
+        
+        edited.insert(edited.end(), points.begin(), before);
+        if (startIndex > 0) {
+            edited.push_back({ startIndex - 1, getSample(startIndex - 1) });
+        }
+        edited.push_back({ startIndex, startValue });
+        edited.push_back({ endIndex, endValue });
+        if (endIndex < resolution - 1) {
+            edited.push_back({ endIndex + 1, getSample(endIndex + 1) });
+        }
+        edited.insert(edited.end(), after, points.end());
+        
+        return PitchEnvelope(resolution, std::move(edited));
+    }
+    
+    /**
+     * Copy on a grid of at least minimumResolution points
+     * The grid is refined by a whole factor so every existing breakpoint stays on
+     * a grid point and the curve's shape is unchanged.
+     */
+    PitchEnvelope withResolution(int minimumResolution) const {
+        if (resolution < 2 || minimumResolution <= resolution) {
+            return *this;
+        }
+        int steps = resolution - 1;
+        int factor = (juce::jlimit(resolution, MAX_RESOLUTION, minimumResolution) - 1 + steps - 1) / steps;
+        factor = std::max(1, std::min(factor, (MAX_RESOLUTION - 1) / steps));
+        
+        Breakpoints scaled = points;
+        for (auto& point : scaled) {
+            point.index *= factor;
+        }
+        return PitchEnvelope(steps * factor + 1, std::move(scaled));
+    }
+
+private:
+    int resolution = 0;
+    Breakpoints points;   // Sorted by index; first and last grid points always present
+    
+    static float interpolate(const PitchBreakpoint& a, const PitchBreakpoint& b, double gridPosition) {
+        if (a.value == b.value) {
+            return a.value;
+        }
+        float t = static_cast<float>((gridPosition - a.index) / (b.index - a.index));
+        return a.value * (1.0f - t) + b.value * t;
+    }
+    
+    float evaluate(double gridPosition) const {
+        if (points.empty()) {
+            return 0.0f;
+        }
+        
+        // First breakpoint after the position; the segment starts one before it
+        auto next = std::upper_bound(points.begin(), points.end(), gridPosition,
+            [](double position, const PitchBreakpoint& p) { return position < p.index; });
+        if (next == points.begin()) {
+            return points.front().value;
+        }
+        if (next == points.end()) {
+            return points.back().value;
+        }
+        return interpolate(*(next - 1), *next, gridPosition);
+    }
+};
+
+//==============================================================================
+/**
+ * Pitch sequencer waveform: a PitchEnvelope of pitch offsets (semitones)
+ * across the pitch loop, held in an immutable, reference-counted buffer
+ *
+ * A published envelope is never modified. Edits build a new envelope and swap
+ * it in with publish(), so copying a config only shares the envelope. Each
+ * waveform is read and written by the thread that owns its model (the audio
+ * thread for the engine's playback copy): get() and the value accessors are
+ * plain reads that never lock or touch the reference count. getEnvelope() and
+ * publish() use atomic shared_ptr operations and are for the message thread.
+ */
+class PitchWaveform {
+public:
+    using Samples = std::vector<float>;
+    using EnvelopePtr = std::shared_ptr<const PitchEnvelope>;
+    
+    static constexpr int DEFAULT_RESOLUTION = 256;
+    
+    PitchWaveform() = default;
+    PitchWaveform(const PitchWaveform& other) = default;
+    explicit PitchWaveform(EnvelopePtr newEnvelope) : envelope(std::move(newEnvelope)) {}
+    
+    PitchWaveform& operator=(const PitchWaveform& other) = default;
+    
+    PitchWaveform& operator=(PitchEnvelope newEnvelope) {
+        publish(std::make_shared<const PitchEnvelope>(std::move(newEnvelope)));
+        return *this;
+    }
+    
+    /**
+     * Replace with evenly spaced samples (converted losslessly to breakpoints)
+     */
+    PitchWaveform& operator=(const Samples& values) {
+        return *this = PitchEnvelope::fromSamples(values);
+    }
+    
+    PitchWaveform& operator=(std::initializer_list<float> values) {
+        return *this = Samples(values);
+    }
+    
+    /**
+     * All-zero waveform; every flat waveform of DEFAULT_RESOLUTION shares one envelope
+     */
+    static PitchWaveform flat(int size) {
+        if (size == DEFAULT_RESOLUTION) {
+            static const EnvelopePtr defaultFlat = std::make_shared<const PitchEnvelope>(PitchEnvelope::flat(DEFAULT_RESOLUTION));
+            return PitchWaveform(defaultFlat);
+        }
+        return PitchWaveform(std::make_shared<const PitchEnvelope>(PitchEnvelope::flat(size)));
+    }
+    
+    /**
+     * Current envelope (null when cleared), for the thread that owns the waveform
+     * Non-atomic and leaves the reference count alone, so the audio thread can call it.
+     */
+    const PitchEnvelope* get() const { return envelope.get(); }
+    
+    /**
+     * Shared reference to the current envelope (null when cleared); message thread only
+     */
+    EnvelopePtr getEnvelope() const { return std::atomic_load(&envelope); }
+    
+    /**
+     * Swap in a new envelope atomically; holders of the old one keep it. Message thread only
+     */
+    void publish(EnvelopePtr newEnvelope) { std::atomic_store(&envelope, std::move(newEnvelope)); }
+    
+    void clear() { publish(nullptr); }
+    
+    bool empty() const { return size() == 0; }
+    
+    /**
+     * Grid resolution (number of evenly spaced values across the loop)
+     */
+    int size() const {
+        const PitchEnvelope* current = get();
+        return current != nullptr ? current->getResolution() : 0;
+    }
+    
+    float operator[](int index) const {
+        const PitchEnvelope* current = get();
+        return current != nullptr ? current->getSample(index) : 0.0f;
+    }
+    
+    /**
+     * Get pitch offset at normalized position (0.0 to 1.0)
+     * Uses linear interpolation between breakpoints
+     */
+    float getValueAt(double normalizedPosition) const {
+        const PitchEnvelope* current = get();
+        return current != nullptr ? current->getValueAt(normalizedPosition) : 0.0f;
+    }
+
+private:
+    EnvelopePtr envelope;
+};
+
+//==============================================================================
+/**
+ * Groove for one color channel: swing plus an optional template of per-step
+ * timing and velocity offsets (for example taken from a MIDI file)
+ *
+ * Timing offsets are in grid steps of the color's quantize setting, so a
+ * groove keeps its feel when the quantize setting changes. Setting the swing
+ * or the template folds both into one table of per-step offsets; playback
+ * looks up one entry per note, with or without a groove.
+ */
+class Groove {
+public:
+    static constexpr int MAX_STEPS = 32;       // Longest template
+    static constexpr float MAX_OFFSET = 0.5f;  // Largest timing offset either way, in grid steps
+    
+    struct Step {
+        float timing = 0.0f;  // Grid steps (-MAX_OFFSET to MAX_OFFSET, positive = late)
+        int velocity = 0;     // Added to the note's velocity
+    };
+    
+    Groove() { fold(); }
+    
+    /**
+     * Swing (0 = straight, 1 = every second step delayed by MAX_OFFSET)
+     */
+    float getSwing() const { return swing; }
+    void setSwing(float amount) {
+        swing = juce::jlimit(0.0f, 1.0f, amount);
+        fold();
+    }
+    
+    /**
+     * Template steps, repeating from the loop start (none when cleared)
+     */
+    int getNumTemplateSteps() const { return numTemplateSteps; }
+    const Step& getTemplateStep(int index) const { return templateSteps[static_cast<size_t>(index)]; }
+    
+    /**
+     * Replace the template (cut at MAX_STEPS, offsets clamped)
+     */
+    void setTemplate(const std::vector<Step>& steps) {
+        numTemplateSteps = std::min(static_cast<int>(steps.size()), MAX_STEPS);
+        for (int i = 0; i < numTemplateSteps; ++i) {
+            const Step& step = steps[static_cast<size_t>(i)];
+            templateSteps[static_cast<size_t>(i)] = { juce::jlimit(-MAX_OFFSET, MAX_OFFSET, step.timing),
+                                                      juce::jlimit(-127, 127, step.velocity) };
+        }
+        fold();
+    }
+    
+    void clearTemplate() { setTemplate({}); }
+    
+    bool isStraight() const { return swing == 0.0f && numTemplateSteps == 0; }
+    
+    /**
+     * Offsets for a note on the given grid step, counted from the loop start
+     */
+    const Step& getStep(int64_t gridStep) const {
+        return folded[static_cast<size_t>(gridStep % numFoldedSteps)];
+    }
+    
+    bool operator==(const Groove& other) const {
+        if (swing != other.swing || numTemplateSteps != other.numTemplateSteps) {
+            return false;
+        }
+        for (int i = 0; i < numTemplateSteps; ++i) {
+            const Step& a = templateSteps[static_cast<size_t>(i)];
+            const Step& b = other.templateSteps[static_cast<size_t>(i)];
+            if (a.timing != b.timing || a.velocity != b.velocity) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    bool operator!=(const Groove& other) const { return !(*this == other); }
+
+private:
+    /**
+     * Combine swing and template into the per-step table
+     * Swing repeats every two steps, so an odd-length template is folded twice over.
+     */
+    void fold() {
+        numFoldedSteps = std::max(numTemplateSteps, 1);
+        if (swing > 0.0f && numFoldedSteps % 2 != 0) {
+            numFoldedSteps *= 2;
+        }
+        
+        for (int i = 0; i < numFoldedSteps; ++i) {
+            Step step = numTemplateSteps > 0 ? templateSteps[static_cast<size_t>(i % numTemplateSteps)] : Step();
+            if (i % 2 != 0) {
+                step.timing += swing * MAX_OFFSET;
+            }
+            step.timing = juce::jlimit(-MAX_OFFSET, MAX_OFFSET, step.timing);
+            folded[static_cast<size_t>(i)] = step;
+        }
+    }
+    
+    float swing = 0.0f;
+    int numTemplateSteps = 0;
+    std::array<Step, MAX_STEPS> templateSteps {};
+    
+    // Swing and template combined, read by the audio thread
+    int numFoldedSteps = 1;
+    std::array<Step, 2 * MAX_STEPS> folded {};
+};
+
 //==============================================================================
 /**
  * Color channel configuration
@@ -226,9 +735,14 @@ struct ColorChannelConfig {
     int lowNote;               // MIDI note number (0-127) for bottom of sequencing plane
     QuantizationValue quantize; // Quantization setting
     juce::Colour displayColor; // UI rendering color
-    std::vector<float> pitchWaveform; // Per-color pitch sequencer waveform (semitones)
+    PitchWaveform pitchWaveform; // Per-color pitch sequencer waveform (semitones, shared and immutable)
     int pitchSeqLoopLengthBars; // Per-color pitch sequencer loop length (0 = use global, 1-64 = bars)
     double mainLoopLengthBars;  // Per-color main sequencer loop length (0 = use global, >0 = override)
+    int polyphony;              // Simultaneous notes (1 = monophonic, up to MAX_VOICES_PER_COLOR)
+    VoiceStealPolicy stealPolicy; // Voice to steal when all voices are busy
+    int pitchBendRange;         // 0 = pitch sequencer shifts note numbers; 1-48 = pitch-bend range in semitones
+    int pitchBendRateHz;        // Pitch-bend control rate while notes are held
+    Groove groove;              // Swing and groove template applied to this color's notes
     
     ColorChannelConfig()
         : midiChannel(1)
@@ -238,6 +752,10 @@ struct ColorChannelConfig {
         , displayColor(juce::Colours::red)
         , pitchSeqLoopLengthBars(0)  // 0 = use global loop length
         , mainLoopLengthBars(0.0)  // 0 = use global loop length
+        , polyphony(1)
+        , stealPolicy(STEAL_OLDEST)
+        , pitchBendRange(0)  // Off: pitch offsets are rounded into note numbers
+        , pitchBendRateHz(DEFAULT_PITCH_BEND_RATE_HZ)
     {}
     
     /**
@@ -245,21 +763,7 @@ struct ColorChannelConfig {
      * Uses linear interpolation between samples
      */
     float getPitchOffsetAt(double normalizedPosition) const {
-        if (pitchWaveform.empty()) {
-            return 0.0f;
-        }
-        
-        // Wrap position to [0, 1)
-        normalizedPosition = normalizedPosition - std::floor(normalizedPosition);
-        
-        // Map to waveform index
-        double indexFloat = normalizedPosition * (pitchWaveform.size() - 1);
-        int index0 = static_cast<int>(std::floor(indexFloat));
-        int index1 = std::min(index0 + 1, static_cast<int>(pitchWaveform.size() - 1));
-        
-        // Linear interpolation
-        float t = static_cast<float>(indexFloat - index0);
-        return pitchWaveform[index0] * (1.0f - t) + pitchWaveform[index1] * t;
+        return pitchWaveform.getValueAt(normalizedPosition);
     }
 };
 
@@ -336,6 +840,30 @@ struct PlayModeConfig {
     }
 };
 
+//==============================================================================
+/**
+ * Boundary at which a pattern switch scheduled during playback takes effect
+ */
+enum SwitchQuantize {
+    SWITCH_IMMEDIATE = 0,  // Start of the next audio block
+    SWITCH_NEXT_BEAT,      // Next beat of the time signature
+    SWITCH_NEXT_BAR,       // Next bar line
+    SWITCH_NEXT_LOOP,      // Next start of the main loop
+    NUM_SWITCH_QUANTIZE
+};
+
+//==============================================================================
+/**
+ * What incoming MIDI notes do (notes in the slot launch range always launch slots)
+ */
+enum LiveInputMode {
+    LIVE_INPUT_OFF = 0,     // Ignored
+    LIVE_INPUT_TRANSPOSE,   // Transpose every color by the note's distance from middle C (60)
+    LIVE_INPUT_SCALE_ROOT,  // Move the scale's root (and a scale sequence with it) to the note's key
+    LIVE_INPUT_RECORD,      // Add the notes played as squares of the selected color (while playing)
+    NUM_LIVE_INPUT_MODES
+};
+
 //==============================================================================
 /**
  * A single segment in the scale sequence
@@ -370,12 +898,15 @@ struct ScaleSequencerConfig {
     std::vector<ScaleSequenceSegment> segments; // The sequence of scale changes
     
     static constexpr int MAX_SEGMENTS = 16;    // Maximum number of segments allowed
+    static constexpr int MAX_SEGMENT_BARS = 16; // Maximum length of one segment in bars
+    static constexpr int MAX_TOTAL_BARS = MAX_SEGMENTS * MAX_SEGMENT_BARS;
     
     ScaleSequencerConfig()
         : enabled(false)
     {
         // Start with one default segment
         segments.push_back(ScaleSequenceSegment(ROOT_C, SCALE_MAJOR, 4));
+        rebuildLookup();
     }
     
     /**
@@ -389,6 +920,24 @@ struct ScaleSequencerConfig {
         return total;
     }
     
+    /**
+     * Rebuild the bar lookup tables from segments
+     * Must be called after any edit to segments; lookups read only the tables.
+     */
+    void rebuildLookup() {
+        lookupTotalBars = 0;
+        int numSegments = std::min(static_cast<int>(segments.size()), MAX_SEGMENTS);
+        
+        for (int i = 0; i < numSegments; ++i) {
+            segmentNoteTables[static_cast<size_t>(i)] = ScaleNoteTable(segments[static_cast<size_t>(i)].toScaleConfig());
+            
+            int bars = std::min(segments[static_cast<size_t>(i)].lengthBars, MAX_TOTAL_BARS - lookupTotalBars);
+            for (int bar = 0; bar < bars; ++bar) {
+                barToSegment[static_cast<size_t>(lookupTotalBars++)] = static_cast<uint8_t>(i);
+            }
+        }
+    }
+    
     /**
      * Get the scale config at a given position in bars (wraps around)
      * @param positionBars Position in bars from start
@@ -399,26 +948,15 @@ struct ScaleSequencerConfig {
             return ScaleConfig();  // Default C Chromatic
         }
         
-        int totalBars = getTotalLengthBars();
-        if (totalBars <= 0) {
-            return segments[0].toScaleConfig();
-        }
-        
-        // Wrap position to sequence length
-        double wrappedPos = std::fmod(positionBars, static_cast<double>(totalBars));
-        if (wrappedPos < 0) wrappedPos += totalBars;
-        
-        // Find which segment we're in
-        double accumulated = 0.0;
-        for (const auto& seg : segments) {
-            accumulated += seg.lengthBars;
-            if (wrappedPos < accumulated) {
-                return seg.toScaleConfig();
-            }
-        }
-        
-        // Fallback to last segment
-        return segments.back().toScaleConfig();
+        return segments[static_cast<size_t>(getSegmentIndexAtPosition(positionBars))].toScaleConfig();
+    }
+    
+    /**
+     * Get the snapping table for the segment at a given position in bars (wraps around)
+     * @param positionBars Position in bars from start
+     */
+    const ScaleNoteTable& getNoteTableAtPosition(double positionBars) const {
+        return segmentNoteTables[static_cast<size_t>(std::max(0, getSegmentIndexAtPosition(positionBars)))];
     }
     
     /**
@@ -426,25 +964,54 @@ struct ScaleSequencerConfig {
      */
     int getSegmentIndexAtPosition(double positionBars) const {
         if (segments.empty()) return -1;
+        if (lookupTotalBars <= 0) return 0;
         
-        int totalBars = getTotalLengthBars();
-        if (totalBars <= 0) return 0;
+        double wrappedPos = std::fmod(positionBars, static_cast<double>(lookupTotalBars));
+        if (wrappedPos < 0) wrappedPos += lookupTotalBars;
         
-        double wrappedPos = std::fmod(positionBars, static_cast<double>(totalBars));
-        if (wrappedPos < 0) wrappedPos += totalBars;
+        // Segments are whole bars, so the bar index alone picks the segment
+        int bar = std::min(static_cast<int>(wrappedPos), lookupTotalBars - 1);
+        int index = barToSegment[static_cast<size_t>(bar)];
         
-        double accumulated = 0.0;
-        for (size_t i = 0; i < segments.size(); ++i) {
-            accumulated += segments[i].lengthBars;
-            if (wrappedPos < accumulated) {
-                return static_cast<int>(i);
-            }
-        }
-        
-        return static_cast<int>(segments.size() - 1);
+        // Guard against segments edited without a rebuild
+        return std::min(index, static_cast<int>(segments.size()) - 1);
+    }
+
+private:
+    // Lookup tables derived from segments by rebuildLookup()
+    std::array<uint8_t, MAX_TOTAL_BARS> barToSegment {};
+    std::array<ScaleNoteTable, MAX_SEGMENTS> segmentNoteTables;
+    int lookupTotalBars = 0;
+};
+
+//==============================================================================
+/**
+ * Ratchet of a square: the note repeats at a fixed rate instead of playing once
+ *
+ * Repeats start at the square's gate and stop at its right edge, each lasting
+ * until the next. The velocity ramps from the square's own velocity on the
+ * first repeat to the ramped velocity on the last.
+ */
+struct Ratchet {
+    static constexpr int MAX_COUNT = 16;
+    
+    int count = 1;                   // Repeats (1 = a single note, no ratchet)
+    QuantizationValue rate = Q_1_32; // Time between repeats
+    float velocityRamp = 0.0f;       // -1 to 1: the last repeat's velocity change, as a fraction of the square's
+    
+    bool operator==(const Ratchet& other) const {
+        return count == other.count && rate == other.rate && velocityRamp == other.velocityRamp;
     }
+    bool operator!=(const Ratchet& other) const { return !(*this == other); }
 };
 
+//==============================================================================
+/**
+ * Smallest square width and height, in normalized plane coordinates
+ * PatternModel clamps every square to it, so no square has zero size.
+ */
+constexpr float MIN_SQUARE_SIZE = 0.01f;
+
 //==============================================================================
 /**
  * Square represents a MIDI note event on the sequencing plane
@@ -455,8 +1022,9 @@ struct Square {
     float width;         // Normalized duration (0.0 to 1.0)
     float topEdge;       // Normalized vertical position (0.0 = top)
     float height;        // Normalized vertical size (0.0 to 1.0)
-    int colorChannelId;  // Index of assigned color channel (0-3)
+    int colorChannelId;  // Index of assigned color channel (0 to MAX_COLOR_CHANNELS - 1)
     uint32_t uniqueId;   // Unique identifier for tracking and editing
+    Ratchet ratchet;     // Repeats of the note (a single note by default)
     
     Square()
         : leftEdge(0.0f)
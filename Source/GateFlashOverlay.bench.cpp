@@ -0,0 +1,100 @@
+#include "GateFlashOverlay.h"
+#include "PatternModel.h"
+#include "VisualFeedback.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using namespace SquareBeats;
+
+//==============================================================================
+// GateFlashOverlay paint benchmarks
+// Renders into an offscreen software image. Run a release build; timings from
+// debug builds are not meaningful.
+
+/**
+ * The previous paint: a radial gradient filled over the whole overlay every frame
+ */
+void paintGradientPerFrame(juce::Graphics& g, juce::Rectangle<float> bounds, juce::Colour flashColor) {
+    juce::ColourGradient gradient(flashColor, bounds.getCentreX(), bounds.getCentreY(),
+                                  flashColor.withAlpha(0.0f), bounds.getX(), bounds.getY(), true);
+    g.setGradientFill(gradient);
+    g.fillRect(bounds);
+}
+
+template <typename PaintFunction>
+double timeFrames(int width, int height, float scale, int numFrames, PaintFunction&& paint) {
+    juce::Image image(juce::Image::ARGB, juce::roundToInt(width * scale), juce::roundToInt(height * scale), true);
+    juce::Graphics g(image);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < numFrames; ++frame) {
+        paint(g);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    return std::chrono::duration<double, std::milli>(end - start).count() / numFrames;
+}
+
+//==============================================================================
+// Benchmark: one flashing color at common editor sizes
+void benchmarkGateFlashPaint() {
+    const int numFrames = 60;
+    
+    struct Size { int width; int height; float scale; const char* label; };
+    const Size sizes[] = {
+        { 800, 700, 1.0f, "Default editor (800x700)" },
+        { 800, 700, 2.0f, "Default editor, 2x display" },
+        { 3840, 2160, 1.0f, "Full-screen 4K" }
+    };
+    
+    PatternModel model;
+    VisualFeedbackState feedback;
+    feedback.updateTime(0.0f);
+    feedback.triggerGateOn(0, 100);
+    feedback.updateTime(20.0f);  // Part-way through the fade
+    
+    GateFlashOverlay overlay(model, feedback);
+    
+    for (const auto& size : sizes) {
+        std::cout << "\n=== Benchmark: " << size.label << " ===" << std::endl;
+        overlay.setBounds(0, 0, size.width, size.height);
+        
+        juce::Colour flashColor = model.getColorConfig(0).displayColor.withAlpha(0.1f);
+        double gradientMs = timeFrames(size.width, size.height, size.scale, numFrames, [&](juce::Graphics& g) {
+            paintGradientPerFrame(g, overlay.getLocalBounds().toFloat(), flashColor);
+        });
+        
+        // The first frame renders the mask; later ones only composite it
+        double firstFrameMs = timeFrames(size.width, size.height, size.scale, 1, [&](juce::Graphics& g) {
+            overlay.paint(g);
+        });
+        double cachedMs = timeFrames(size.width, size.height, size.scale, numFrames, [&](juce::Graphics& g) {
+            overlay.paint(g);
+        });
+        
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  gradient per frame: " << gradientMs << " ms/frame\n"
+                  << "  cached mask:        " << cachedMs << " ms/frame (first frame " << firstFrameMs << " ms)\n"
+                  << "  speed-up:           " << gradientMs / cachedMs << "x" << std::endl;
+    }
+    
+    // Once the flash has faded there is nothing to draw
+    feedback.updateTime(1000.0f);
+    overlay.setBounds(0, 0, 3840, 2160);
+    double idleMs = timeFrames(3840, 2160, 1.0f, numFrames, [&](juce::Graphics& g) {
+        overlay.paint(g);
+    });
+    std::cout << "\nIdle (no flash), 4K: " << idleMs << " ms/frame" << std::endl;
+}
+
+int main() {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    std::cout << "Running GateFlashOverlay Benchmarks..." << std::endl;
+    
+    benchmarkGateFlashPaint();
+    
+    return 0;
+}
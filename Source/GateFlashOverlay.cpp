@@ -21,12 +21,38 @@ GateFlashOverlay::~GateFlashOverlay()
 //==============================================================================
 void GateFlashOverlay::paint(juce::Graphics& g)
 {
-    auto bounds = getLocalBounds().toFloat();
+    juce::Colour flashColor = getFlashColour();
+    if (flashColor.isTransparent())
+        return;
     
+    // The mask matches the physical pixels, so compositing it needs no resampling
+    auto bounds = getLocalBounds();
+    float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const juce::Image& mask = getFlashMask(juce::roundToInt(bounds.getWidth() * scale),
+                                           juce::roundToInt(bounds.getHeight() * scale));
+    
+    // Tint the mask: each pixel gets the flash colour at the mask's alpha
+    g.setColour(flashColor);
+    g.drawImage(mask, bounds.toFloat(), juce::RectanglePlacement::stretchToFit, true);
+}
+
+void GateFlashOverlay::refresh()
+{
+    bool flashing = !getFlashColour().isTransparent();
+    
+    // One more repaint after the last flash fades, to clear it
+    if (flashing || flashShowing)
+        repaint();
+    
+    flashShowing = flashing;
+}
+
+juce::Colour GateFlashOverlay::getFlashColour() const
+{
     // Accumulate color from all active flashes
     float totalR = 0.0f, totalG = 0.0f, totalB = 0.0f, totalA = 0.0f;
     
-    for (int colorId = 0; colorId < 4; ++colorId)
+    for (int colorId = 0; colorId < patternModel.getNumColorChannels(); ++colorId)
     {
         float intensity = visualFeedback.getFlashIntensity(colorId);
         
@@ -49,29 +75,36 @@ void GateFlashOverlay::paint(juce::Graphics& g)
         }
     }
     
-    // Draw the combined flash if there's any intensity
-    if (totalA > 0.001f)
-    {
-        // Clamp values to valid range
-        totalR = juce::jlimit(0.0f, 1.0f, totalR);
-        totalG = juce::jlimit(0.0f, 1.0f, totalG);
-        totalB = juce::jlimit(0.0f, 1.0f, totalB);
-        totalA = juce::jlimit(0.0f, 0.5f, totalA);  // Cap alpha to prevent overwhelming
-        
-        juce::Colour flashColor = juce::Colour::fromFloatRGBA(totalR, totalG, totalB, totalA);
-        
-        // Draw as a gradient from center for more interesting visual
-        juce::ColourGradient gradient(
-            flashColor,
-            bounds.getCentreX(), bounds.getCentreY(),
-            flashColor.withAlpha(0.0f),
-            bounds.getX(), bounds.getY(),
-            true  // Radial gradient
-        );
-        
-        g.setGradientFill(gradient);
-        g.fillRect(bounds);
-    }
+    if (totalA <= 0.001f)
+        return juce::Colours::transparentBlack;
+    
+    // Clamp values to valid range
+    totalR = juce::jlimit(0.0f, 1.0f, totalR);
+    totalG = juce::jlimit(0.0f, 1.0f, totalG);
+    totalB = juce::jlimit(0.0f, 1.0f, totalB);
+    totalA = juce::jlimit(0.0f, 0.5f, totalA);  // Cap alpha to prevent overwhelming
+    
+    return juce::Colour::fromFloatRGBA(totalR, totalG, totalB, totalA);
+}
+
+const juce::Image& GateFlashOverlay::getFlashMask(int width, int height)
+{
+    width = juce::jmax(1, width);
+    height = juce::jmax(1, height);
+    
+    if (flashMask.isValid() && flashMask.getWidth() == width && flashMask.getHeight() == height)
+        return flashMask;
+    
+    flashMask = juce::Image(juce::Image::SingleChannel, width, height, true);
+    juce::Graphics g(flashMask);
+    
+    // Same falloff as a radial gradient from the centre to the top-left corner
+    auto bounds = flashMask.getBounds().toFloat();
+    g.setGradientFill(juce::ColourGradient(juce::Colours::white, bounds.getCentreX(), bounds.getCentreY(),
+                                           juce::Colours::transparentWhite, bounds.getX(), bounds.getY(),
+                                           true));
+    g.fillRect(bounds);
+    return flashMask;
 }
 
 } // namespace SquareBeats
@@ -19,6 +19,10 @@ namespace SquareBeats {
  * - Smooth exponential decay
  * - Additive color blending for multiple simultaneous triggers
  * - Beat pulse effect on grid
+ * 
+ * The radial falloff is rendered once into an alpha mask (per physical size)
+ * and each frame only tints and composites it. Nothing is repainted while
+ * no flash is showing.
  */
 class GateFlashOverlay : public juce::Component
 {
@@ -30,6 +34,11 @@ public:
     //==============================================================================
     void paint(juce::Graphics& g) override;
     
+    /**
+     * Repaint if a flash is showing or has just faded out (call from the editor's timer)
+     */
+    void refresh();
+    
     /**
      * Set the base opacity for flash effects (0.0 to 1.0)
      * Default is 0.15 for subtle effect
@@ -47,6 +56,20 @@ private:
     
     float flashOpacity = 0.12f;  // Base opacity for flash (subtle)
     bool beatPulseEnabled = true;
+    bool flashShowing = false;   // Whether the last refresh() found a flash to draw
+    
+    // Radial falloff from the centre (opaque) to the corners (transparent), in physical pixels
+    juce::Image flashMask;
+    
+    /**
+     * Combined colour of all active flashes (transparent when none is active)
+     */
+    juce::Colour getFlashColour() const;
+    
+    /**
+     * Get the falloff mask for a size in physical pixels, rendering it if the size changed
+     */
+    const juce::Image& getFlashMask(int width, int height);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GateFlashOverlay)
 };
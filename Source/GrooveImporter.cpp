@@ -0,0 +1,86 @@
+#include "GrooveImporter.h"
+#include "MIDIGenerator.h"
+#include <cmath>
+
+namespace SquareBeats {
+
+//==============================================================================
+bool GrooveImporter::loadTemplate(const juce::File& file, QuantizationValue quantize, std::vector<Groove::Step>& steps)
+{
+    juce::FileInputStream stream(file);
+    juce::MidiFile midiFile;
+    if (!stream.openedOk() || !midiFile.readFrom(stream))
+    {
+        juce::Logger::writeToLog("GrooveImporter: Could not read " + file.getFullPathName());
+        return false;
+    }
+    
+    // Timestamps stay in ticks; SMPTE-timed files have no beats to measure against
+    const int ticksPerQuarterNote = midiFile.getTimeFormat();
+    if (ticksPerQuarterNote <= 0)
+    {
+        juce::Logger::writeToLog("GrooveImporter: SMPTE time format not supported in " + file.getFileName());
+        return false;
+    }
+    
+    std::vector<PlayedNote> notes;
+    for (int track = 0; track < midiFile.getNumTracks(); ++track)
+    {
+        const juce::MidiMessageSequence* sequence = midiFile.getTrack(track);
+        for (int i = 0; i < sequence->getNumEvents(); ++i)
+        {
+            const juce::MidiMessage& message = sequence->getEventPointer(i)->message;
+            if (message.isNoteOn())
+                notes.push_back({ message.getTimeStamp() / ticksPerQuarterNote, message.getVelocity() });
+        }
+    }
+    
+    if (notes.empty())
+    {
+        juce::Logger::writeToLog("GrooveImporter: No notes in " + file.getFileName());
+        return false;
+    }
+    
+    steps = extractTemplate(notes, quantize);
+    return true;
+}
+
+//==============================================================================
+std::vector<Groove::Step> GrooveImporter::extractTemplate(const std::vector<PlayedNote>& notes, QuantizationValue quantize)
+{
+    const TimeSignature timeSig(4, 4);
+    const double stepBeats = MIDIGenerator::getQuantizeInterval(quantize, timeSig);
+    const int numSteps = juce::jlimit(1, Groove::MAX_STEPS, juce::roundToInt(timeSig.getBeatsPerBar() / stepBeats));
+    
+    std::vector<double> timingSums(static_cast<size_t>(numSteps), 0.0);
+    std::vector<double> velocitySums(static_cast<size_t>(numSteps), 0.0);
+    std::vector<int> counts(static_cast<size_t>(numSteps), 0);
+    double totalVelocity = 0.0;
+    
+    for (const PlayedNote& note : notes)
+    {
+        const double gridPosition = juce::jmax(0.0, note.positionBeats) / stepBeats;
+        const double nearestStep = std::round(gridPosition);
+        const size_t step = static_cast<size_t>(static_cast<int64_t>(nearestStep) % numSteps);
+        
+        timingSums[step] += gridPosition - nearestStep;
+        velocitySums[step] += note.velocity;
+        ++counts[step];
+        totalVelocity += note.velocity;
+    }
+    
+    const double averageVelocity = notes.empty() ? 0.0 : totalVelocity / static_cast<double>(notes.size());
+    
+    std::vector<Groove::Step> steps(static_cast<size_t>(numSteps));
+    for (size_t step = 0; step < steps.size(); ++step)
+    {
+        if (counts[step] == 0)
+            continue;
+        
+        steps[step].timing = static_cast<float>(timingSums[step] / counts[step]);
+        steps[step].velocity = juce::roundToInt(velocitySums[step] / counts[step] - averageVelocity);
+    }
+    return steps;
+}
+
+} // namespace SquareBeats
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "DataStructures.h"
+#include <vector>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * GrooveImporter takes a groove template from the notes of a MIDI file
+ *
+ * Each note-on is matched to its nearest step on the grid of a color's
+ * quantize setting, and the steps are folded onto one bar (at most
+ * Groove::MAX_STEPS steps). A template step's timing is the average distance
+ * of its notes from the grid, and its velocity how much louder or softer they
+ * were than the average note in the file. Steps no note falls on stay straight.
+ */
+class GrooveImporter
+{
+public:
+    struct PlayedNote
+    {
+        double positionBeats;
+        int velocity;
+    };
+    
+    /**
+     * Read a template from a Standard MIDI File (all tracks)
+     * @return false if the file cannot be read or has no notes
+     */
+    static bool loadTemplate(const juce::File& file, QuantizationValue quantize, std::vector<Groove::Step>& steps);
+    
+    /**
+     * Template for notes on the grid of a quantize setting (4/4, one bar long)
+     */
+    static std::vector<Groove::Step> extractTemplate(const std::vector<PlayedNote>& notes, QuantizationValue quantize);
+};
+
+} // namespace SquareBeats
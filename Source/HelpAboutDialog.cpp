@@ -18,7 +18,7 @@ HelpAboutDialog::HelpAboutDialog()
     addAndMakeVisible(closeButton);
     
     // Configure website link
-    websiteLink.setFont(AppFont::getFont(16.0f), false);
+    websiteLink.setFont(AppFont::getFont(*fonts, 16.0f), false);
     addAndMakeVisible(websiteLink);
     
     setSize(600, 750);
@@ -38,29 +38,29 @@ void HelpAboutDialog::paint(juce::Graphics& g)
     
     // Title
     g.setColour(juce::Colours::white);
-    g.setFont(AppFont::getFont(32.0f, true));
+    g.setFont(AppFont::getFont(*fonts, 32.0f, true));
     g.drawText("SquareBeats", bounds.getX(), y, bounds.getWidth(), 40, juce::Justification::centred);
     y += 45;
     
     // Version
-    g.setFont(AppFont::getFont(16.0f));
+    g.setFont(AppFont::getFont(*fonts, 16.0f));
     g.setColour(juce::Colour(0xffaaaaaa));
     g.drawText("Version 1.0.0", bounds.getX(), y, bounds.getWidth(), 20, juce::Justification::centred);
     y += 30;
     
     // Description
     g.setColour(juce::Colours::white);
-    g.setFont(AppFont::getFont(14.0f));
+    g.setFont(AppFont::getFont(*fonts, 14.0f));
     juce::String description = "A VST3 MIDI sequencer plugin with a unique square-drawing interface.";
     g.drawFittedText(description, bounds.getX(), y, bounds.getWidth(), 40, juce::Justification::centred, 2);
     y += 50;
     
     // Quick Start section
-    g.setFont(AppFont::getFont(18.0f, true));
+    g.setFont(AppFont::getFont(*fonts, 18.0f, true));
     g.drawText("Quick Start", bounds.getX(), y, bounds.getWidth(), 25, juce::Justification::left);
     y += 28;
     
-    g.setFont(AppFont::getFont(12.0f));
+    g.setFont(AppFont::getFont(*fonts, 12.0f));
     g.setColour(juce::Colour(0xffdddddd));
     
     juce::StringArray quickStartSteps = {
@@ -85,16 +85,16 @@ void HelpAboutDialog::paint(juce::Graphics& g)
     y += 15;
     
     // Features section
-    g.setFont(AppFont::getFont(18.0f, true));
+    g.setFont(AppFont::getFont(*fonts, 18.0f, true));
     g.setColour(juce::Colours::white);
     g.drawText("Key Features", bounds.getX(), y, bounds.getWidth(), 25, juce::Justification::left);
     y += 28;
     
-    g.setFont(AppFont::getFont(12.0f));
+    g.setFont(AppFont::getFont(*fonts, 12.0f));
     g.setColour(juce::Colour(0xffdddddd));
     
     juce::StringArray features = {
-        "- 4 independent color channels with MIDI routing",
+        "- Up to 16 independent color channels with MIDI routing",
         "- Per-color pitch sequencer with polyrhythmic loop lengths",
         "- Scale sequencer for evolving harmonic progressions",
         "- Multiple play modes with probability-based randomization",
@@ -112,7 +112,7 @@ void HelpAboutDialog::paint(juce::Graphics& g)
     y += 25;
     
     // Copyright
-    g.setFont(AppFont::getFont(11.0f));
+    g.setFont(AppFont::getFont(*fonts, 11.0f));
     g.setColour(juce::Colour(0xff888888));
     g.drawText("(c) 2026 TouchMachines. All rights reserved.", 
                bounds.getX(), y, bounds.getWidth(), 20, juce::Justification::centred);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <juce_gui_basics/juce_gui_basics.h>
+#include "AppFont.h"
 
 namespace SquareBeats
 {
@@ -28,6 +29,7 @@ public:
     static void show(juce::Component* parent);
 
 private:
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
     juce::TextButton closeButton;
     juce::HyperlinkButton websiteLink;
     
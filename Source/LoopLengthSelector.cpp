@@ -11,7 +11,7 @@ LoopLengthSelector::LoopLengthSelector(PatternModel& model)
     loopLengthLabel.setText("Global\nLoop Length", juce::dontSendNotification);
     loopLengthLabel.setColour(juce::Label::textColourId, juce::Colours::white);
     loopLengthLabel.setJustificationType(juce::Justification::centredRight);
-    loopLengthLabel.setFont(AppFont::label());
+    loopLengthLabel.setFont(AppFont::label(*fonts));
     addAndMakeVisible(loopLengthLabel);
     
     // Setup combo box with steps (1-15) and bars (1-8, 16, 32, 64)
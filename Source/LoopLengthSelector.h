@@ -2,6 +2,7 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "PatternModel.h"
+#include "AppFont.h"
 
 namespace SquareBeats {
 
@@ -35,6 +36,7 @@ public:
 
 private:
     PatternModel& patternModel;
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
     
     // UI Components
     juce::Label loopLengthLabel;
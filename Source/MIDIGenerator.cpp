@@ -18,6 +18,15 @@ int MIDIGenerator::calculateMidiNote(const Square& square,
     return scaleConfig.snapToScale(midiNote);
 }
 
+int MIDIGenerator::calculateMidiNote(const Square& square, 
+                                     const ColorChannelConfig& config,
+                                     float pitchOffset,
+                                     const ScaleNoteTable& noteTable)
+{
+    int midiNote = mapVerticalPositionToNote(square.getCenterY(), config.highNote, config.lowNote, pitchOffset);
+    return noteTable.snap(midiNote);
+}
+
 //==============================================================================
 int MIDIGenerator::calculateVelocity(const Square& square)
 {
@@ -29,37 +38,34 @@ int MIDIGenerator::calculateVelocity(const Square& square)
 double MIDIGenerator::applyQuantization(double timeBeats, 
                                        QuantizationValue quantize,
                                        const TimeSignature& timeSig)
+{
+    double quantizeInterval = getQuantizeInterval(quantize, timeSig);
+    
+    // Round to nearest quantization interval
+    return std::round(timeBeats / quantizeInterval) * quantizeInterval;
+}
+
+double MIDIGenerator::getQuantizeInterval(QuantizationValue quantize, const TimeSignature& timeSig)
 {
     double beatsPerBar = timeSig.getBeatsPerBar();
-    double quantizeInterval;
     
     // Calculate quantization interval based on quantization value
     switch (quantize) {
         case Q_1_32:
-            quantizeInterval = beatsPerBar / 32.0;
-            break;
+            return beatsPerBar / 32.0;
         case Q_1_16:
-            quantizeInterval = beatsPerBar / 16.0;
-            break;
+            return beatsPerBar / 16.0;
         case Q_1_8:
-            quantizeInterval = beatsPerBar / 8.0;
-            break;
+            return beatsPerBar / 8.0;
         case Q_1_4:
-            quantizeInterval = beatsPerBar / 4.0;
-            break;
+            return beatsPerBar / 4.0;
         case Q_1_2:
-            quantizeInterval = beatsPerBar / 2.0;
-            break;
+            return beatsPerBar / 2.0;
         case Q_1_BAR:
-            quantizeInterval = beatsPerBar;
-            break;
+            return beatsPerBar;
         default:
-            quantizeInterval = beatsPerBar / 16.0; // Default to 1/16
-            break;
+            return beatsPerBar / 16.0; // Default to 1/16
     }
-    
-    // Round to nearest quantization interval
-    return std::round(timeBeats / quantizeInterval) * quantizeInterval;
 }
 
 //==============================================================================
@@ -76,4 +82,24 @@ juce::MidiMessage MIDIGenerator::createNoteOff(int channel, int note)
     return juce::MidiMessage::noteOff(channel, note);
 }
 
+//==============================================================================
+int MIDIGenerator::calculatePitchBend(float pitchOffset, int bendRange)
+{
+    if (bendRange <= 0)
+    {
+        return 8192;
+    }
+    
+    // 8192 steps per bend range in each direction; round to the nearest step
+    double steps = static_cast<double>(pitchOffset) / bendRange * 8192.0;
+    return juce::jlimit(0, 16383, 8192 + static_cast<int>(std::lround(steps)));
+}
+
+//==============================================================================
+juce::MidiMessage MIDIGenerator::createPitchBend(int channel, int value)
+{
+    // JUCE MIDI channels are 1-16, pitch-wheel values are 0-16383
+    return juce::MidiMessage::pitchWheel(channel, juce::jlimit(0, 16383, value));
+}
+
 } // namespace SquareBeats
@@ -28,6 +28,19 @@ public:
                                  float pitchOffset,
                                  const ScaleConfig& scaleConfig = ScaleConfig());
     
+    /**
+     * Calculate MIDI note number using a precomputed scale snapping table
+     * @param square The square to calculate note for
+     * @param config Color channel configuration with pitch range
+     * @param pitchOffset Additional pitch offset from pitch sequencer (in semitones)
+     * @param noteTable Snapping table for the active scale
+     * @return MIDI note number (0-127), clamped to valid range
+     */
+    static int calculateMidiNote(const Square& square, 
+                                 const ColorChannelConfig& config,
+                                 float pitchOffset,
+                                 const ScaleNoteTable& noteTable);
+    
     /**
      * Calculate MIDI velocity from square height
      * @param square The square to calculate velocity for
@@ -46,6 +59,14 @@ public:
                                    QuantizationValue quantize,
                                    const TimeSignature& timeSig);
     
+    /**
+     * Get the grid step of a quantization setting
+     * @param quantize Quantization setting
+     * @param timeSig Time signature for calculating quantization intervals
+     * @return Grid step in beats
+     */
+    static double getQuantizeInterval(QuantizationValue quantize, const TimeSignature& timeSig);
+    
     /**
      * Create a MIDI note-on message
      * @param channel MIDI channel (1-16)
@@ -62,6 +83,22 @@ public:
      * @return MIDI note-off message
      */
     static juce::MidiMessage createNoteOff(int channel, int note);
+    
+    /**
+     * Convert a pitch offset to a 14-bit pitch-bend value
+     * @param pitchOffset Offset in semitones
+     * @param bendRange Synth pitch-bend range in semitones (> 0)
+     * @return Pitch-bend value (0-16383, 8192 = centre), clamped at the range
+     */
+    static int calculatePitchBend(float pitchOffset, int bendRange);
+    
+    /**
+     * Create a MIDI pitch-bend message
+     * @param channel MIDI channel (1-16)
+     * @param value Pitch-bend value (0-16383, 8192 = centre)
+     * @return MIDI pitch-bend message
+     */
+    static juce::MidiMessage createPitchBend(int channel, int value);
 };
 
 } // namespace SquareBeats
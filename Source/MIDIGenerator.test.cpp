@@ -153,6 +153,30 @@ void testCreateNoteMessages() {
     std::cout << "  ✓ All MIDI message creation tests passed" << std::endl;
 }
 
+void testPitchBend() {
+    std::cout << "Testing calculatePitchBend() and createPitchBend()..." << std::endl;
+    
+    // Centre, full range and clamping beyond the range
+    assert(MIDIGenerator::calculatePitchBend(0.0f, 12) == 8192);
+    assert(MIDIGenerator::calculatePitchBend(12.0f, 12) == 16383);
+    assert(MIDIGenerator::calculatePitchBend(-12.0f, 12) == 0);
+    assert(MIDIGenerator::calculatePitchBend(30.0f, 12) == 16383);
+    assert(MIDIGenerator::calculatePitchBend(6.0f, 12) == 8192 + 4096);
+    assert(MIDIGenerator::calculatePitchBend(-1.0f, 2) == 8192 - 4096);
+    
+    // No bend range means no bend
+    assert(MIDIGenerator::calculatePitchBend(5.0f, 0) == 8192);
+    
+    auto bend = MIDIGenerator::createPitchBend(3, 12288);
+    assert(bend.isPitchWheel());
+    assert(bend.getChannel() == 3);
+    assert(bend.getPitchWheelValue() == 12288);
+    std::cout << "  Pitch-bend: channel=" << bend.getChannel() 
+              << " value=" << bend.getPitchWheelValue() << std::endl;
+    
+    std::cout << "  ✓ All pitch-bend tests passed" << std::endl;
+}
+
 //==============================================================================
 int main() {
     std::cout << "\n=== MIDIGenerator Unit Tests ===" << std::endl;
@@ -162,6 +186,7 @@ int main() {
         testCalculateVelocity();
         testApplyQuantization();
         testCreateNoteMessages();
+        testPitchBend();
         
         std::cout << "\n✓ All MIDIGenerator tests passed!" << std::endl;
         return 0;
@@ -0,0 +1,351 @@
+#include "MidiFileImporter.h"
+#include "ConversionUtils.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace SquareBeats {
+
+//==============================================================================
+bool MidiFileImporter::importFile(const juce::File& file, PatternModel& model, ColorMapping mapping, Result& result)
+{
+    juce::FileInputStream fileStream(file);
+    if (!fileStream.openedOk())
+    {
+        juce::Logger::writeToLog("MidiFileImporter: Could not open " + file.getFullPathName());
+        return false;
+    }
+    
+    // Events are read a byte at a time
+    juce::BufferedInputStream stream(fileStream, 32768);
+    if (!importStream(stream, model, mapping, result))
+    {
+        juce::Logger::writeToLog("MidiFileImporter: Nothing imported from " + file.getFileName());
+        return false;
+    }
+    
+    juce::Logger::writeToLog("MidiFileImporter: Imported " + juce::String(result.numSquares) + " notes into "
+                             + juce::String(result.numColors) + " colors from " + file.getFileName()
+                             + (result.numSkippedNotes > 0 ? " (" + juce::String(result.numSkippedNotes) + " skipped)"
+                                                           : juce::String()));
+    return true;
+}
+
+bool MidiFileImporter::importStream(juce::InputStream& stream, PatternModel& model, ColorMapping mapping, Result& result)
+{
+    result = Result();
+    
+    std::vector<Note> notes;
+    FileInfo info;
+    if (!readNotes(stream, [&notes](const Note& note) { notes.push_back(note); }, info))
+        return false;
+    
+    if (notes.empty())
+    {
+        juce::Logger::writeToLog("MidiFileImporter: No notes in MIDI data");
+        return false;
+    }
+    
+    // Notes arrive as they end, track by track; colors go to tracks or channels in the order they first play
+    std::stable_sort(notes.begin(), notes.end(),
+                     [](const Note& a, const Note& b) { return a.startBeats < b.startBeats; });
+    
+    bool byChannel = mapping == COLORS_BY_CHANNEL;
+    if (mapping == COLORS_AUTO)
+    {
+        const int firstTrack = notes.front().track;
+        byChannel = std::all_of(notes.begin(), notes.end(),
+                                [firstTrack](const Note& note) { return note.track == firstTrack; });
+    }
+    
+    std::vector<int> colorForKey;
+    for (const Note& note : notes)
+    {
+        const size_t key = static_cast<size_t>(byChannel ? note.channel : note.track);
+        if (key >= colorForKey.size())
+            colorForKey.resize(key + 1, -1);
+        if (colorForKey[key] < 0 && result.numColors < MAX_COLOR_CHANNELS)
+            colorForKey[key] = result.numColors++;
+    }
+    
+    // The loop covers the whole file, in whole bars of its time signature. Patterns always
+    // play in 4/4 (saved states keep no time signature), so the file's bars only set the
+    // loop's length and notes keep their beats; any meter's bar is a whole number of steps.
+    model.setTimeSignature(4, 4);
+    const double fileBeatsPerBar = info.numerator > 0 ? TimeSignature(info.numerator, info.denominator).getBeatsPerBar()
+                                                      : model.getTimeSignature().getBeatsPerBar();
+    double lengthBeats = info.lengthBeats;
+    for (const Note& note : notes)
+        lengthBeats = juce::jmax(lengthBeats, note.endBeats);
+    const double fileBars = juce::jmax(1.0, std::ceil(lengthBeats / fileBeatsPerBar - 1.0e-9));
+    model.setLoopLength(juce::jmin(MAX_LOOP_LENGTH_BARS, fileBars * fileBeatsPerBar / model.getTimeSignature().getBeatsPerBar()));
+    
+    // The file replaces the pattern, including squares kept on channels not in use
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId)
+        model.clearColorChannel(colorId);
+    if (result.numColors > model.getNumColorChannels())
+        model.setNumColorChannels(result.numColors);
+    
+    const std::vector<Square> squares = buildSquares(notes, colorForKey, byChannel, model, result);
+    model.addSquares(squares);
+    result.numSquares = static_cast<int>(squares.size());
+    return true;
+}
+
+std::vector<Square> MidiFileImporter::buildSquares(const std::vector<Note>& notes, const std::vector<int>& colorForKey,
+                                                   bool byChannel, const PatternModel& model, Result& result)
+{
+    const TimeSignature timeSig = model.getTimeSignature();
+    
+    std::vector<Square> squares;
+    squares.reserve(notes.size());
+    
+    for (const Note& note : notes)
+    {
+        const int colorId = colorForKey[static_cast<size_t>(byChannel ? note.channel : note.track)];
+        if (colorId < 0)
+        {
+            ++result.numSkippedNotes;
+            continue;
+        }
+        
+        // The color's own loop if it has one, as the engine plays it
+        const ColorChannelConfig& config = model.getColorConfig(colorId);
+        const double loopLengthBars = config.mainLoopLengthBars > 0.0 ? config.mainLoopLengthBars : model.getLoopLength();
+        if (note.startBeats >= loopLengthBars * timeSig.getBeatsPerBar())
+        {
+            ++result.numSkippedNotes;
+            continue;
+        }
+        
+        // Centred on the note within the color's range, as tall as its velocity; the model cuts it off at the loop end
+        float topEdge, height;
+        mapVelocityAroundPosition(mapNoteToVerticalPosition(note.note, config.highNote, config.lowNote),
+                                  note.velocity, MIN_SQUARE_SIZE, topEdge, height);
+        
+        squares.emplace_back(beatsToNormalized(note.startBeats, loopLengthBars, timeSig),
+                             topEdge,
+                             juce::jmax(MIN_SQUARE_SIZE, beatsToNormalized(note.endBeats - note.startBeats, loopLengthBars, timeSig)),
+                             height,
+                             colorId,
+                             0);
+    }
+    return squares;
+}
+
+bool MidiFileImporter::isMidiFile(const juce::File& file)
+{
+    return file.hasFileExtension("mid;midi;smf");
+}
+
+//==============================================================================
+bool MidiFileImporter::readNotes(juce::InputStream& stream, const NoteCallback& callback, FileInfo& info)
+{
+    // Header chunk: format, number of tracks and time division
+    if (stream.readIntBigEndian() != HEADER_CHUNK)
+    {
+        juce::Logger::writeToLog("MidiFileImporter: Not a Standard MIDI File");
+        return false;
+    }
+    
+    const int64_t headerLength = static_cast<uint32_t>(stream.readIntBigEndian());
+    stream.readShortBigEndian();  // Format: tracks are read one after another whatever it is
+    const int numTracks = static_cast<uint16_t>(stream.readShortBigEndian());
+    const int division = static_cast<uint16_t>(stream.readShortBigEndian());
+    if (headerLength < 6 || stream.isExhausted())
+    {
+        juce::Logger::writeToLog("MidiFileImporter: MIDI file header is cut short");
+        return false;
+    }
+    stream.skipNextBytes(headerLength - 6);
+    
+    // Timestamps stay in ticks; SMPTE-timed files have no beats to measure against
+    if ((division & 0x8000) != 0 || division == 0)
+    {
+        juce::Logger::writeToLog("MidiFileImporter: SMPTE time format not supported");
+        return false;
+    }
+    
+    bool timeSignatureFound = false;
+    int track = 0;
+    while (track < numTracks && !stream.isExhausted())
+    {
+        const int chunkId = stream.readIntBigEndian();
+        const int64_t length = static_cast<uint32_t>(stream.readIntBigEndian());
+        
+        // Chunks of other types are skipped, as the format asks
+        if (chunkId != TRACK_CHUNK)
+        {
+            stream.skipNextBytes(length);
+            continue;
+        }
+        
+        if (!readTrack(stream, length, track, division, callback, info, timeSignatureFound))
+        {
+            juce::Logger::writeToLog("MidiFileImporter: Track " + juce::String(track + 1) + " is cut short or malformed");
+            return false;
+        }
+        ++track;
+    }
+    return true;
+}
+
+bool MidiFileImporter::readTrack(juce::InputStream& stream, int64_t length, int track, int ticksPerQuarterNote,
+                                 const NoteCallback& callback, FileInfo& info, bool& timeSignatureFound)
+{
+    // Note-ons waiting for their note-off, by channel and note (velocity 0 when not held)
+    struct HeldNote
+    {
+        uint64_t startTick = 0;
+        int velocity = 0;
+    };
+    std::array<HeldNote, 16 * 128> heldNotes {};
+    
+    const double beatsPerTick = 1.0 / ticksPerQuarterNote;
+    TrackReader reader { stream, length };
+    uint64_t tick = 0;
+    int runningStatus = 0;
+    
+    auto endNote = [&](int channel, int note, uint64_t endTick)
+    {
+        HeldNote& held = heldNotes[static_cast<size_t>(channel * 128 + note)];
+        if (held.velocity == 0)
+            return;
+        
+        callback({ track, channel, note, held.velocity, held.startTick * beatsPerTick, endTick * beatsPerTick });
+        held.velocity = 0;
+    };
+    
+    while (reader.bytesLeft > 0 && !reader.failed)
+    {
+        tick += reader.readVariableLength();
+        
+        int status = reader.readByte();
+        int data1 = -1;
+        if (status < 0x80)
+        {
+            // Running status: the byte was the first data byte of another message like the last
+            if (runningStatus == 0)
+                return false;
+            data1 = status;
+            status = runningStatus;
+        }
+        
+        if (status == 0xFF)
+        {
+            // Meta event: only the end of the track and the first time signature matter here
+            runningStatus = 0;
+            const int type = reader.readByte();
+            const uint32_t size = reader.readVariableLength();
+            if (type == 0x2F)
+            {
+                reader.skip(static_cast<uint32_t>(juce::jmax<int64_t>(0, reader.bytesLeft)));
+                break;
+            }
+            
+            if (type == 0x58 && size >= 2 && !timeSignatureFound)
+            {
+                info.numerator = reader.readByte();
+                info.denominator = 1 << juce::jmin(4, reader.readByte());
+                reader.skip(size - 2);
+                timeSignatureFound = true;
+            }
+            else
+            {
+                reader.skip(size);
+            }
+            continue;
+        }
+        
+        if (status == 0xF0 || status == 0xF7)
+        {
+            // System exclusive
+            runningStatus = 0;
+            reader.skip(reader.readVariableLength());
+            continue;
+        }
+        
+        // Other system messages have no place in a file
+        if (status > 0xF0)
+            return false;
+        
+        runningStatus = status;
+        if (data1 < 0)
+            data1 = reader.readByte();
+        
+        // Program change and channel pressure have one data byte, the others two
+        const int type = status & 0xF0;
+        const int channel = status & 0x0F;
+        const int data2 = (type == 0xC0 || type == 0xD0) ? 0 : reader.readByte();
+        const int note = data1 & 0x7F;
+        const int velocity = data2 & 0x7F;
+        
+        if (type == 0x80 || (type == 0x90 && velocity == 0))
+        {
+            endNote(channel, note, tick);
+        }
+        else if (type == 0x90)
+        {
+            // A note-on for a note that is already down ends the earlier one first
+            endNote(channel, note, tick);
+            heldNotes[static_cast<size_t>(channel * 128 + note)] = { tick, velocity };
+        }
+    }
+    
+    if (reader.failed)
+        return false;
+    
+    // Notes still held end with the track
+    for (int channel = 0; channel < 16; ++channel)
+    {
+        for (int note = 0; note < 128; ++note)
+            endNote(channel, note, tick);
+    }
+    
+    info.lengthBeats = juce::jmax(info.lengthBeats, tick * beatsPerTick);
+    return true;
+}
+
+//==============================================================================
+int MidiFileImporter::TrackReader::readByte()
+{
+    uint8_t byte = 0;
+    if (bytesLeft <= 0 || stream.read(&byte, 1) != 1)
+    {
+        failed = true;
+        return 0;
+    }
+    
+    --bytesLeft;
+    return byte;
+}
+
+uint32_t MidiFileImporter::TrackReader::readVariableLength()
+{
+    // Seven bits per byte, most significant first; every byte but the last has its top bit set
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const int byte = readByte();
+        value = (value << 7) | static_cast<uint32_t>(byte & 0x7F);
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    
+    failed = true;
+    return 0;
+}
+
+void MidiFileImporter::TrackReader::skip(uint32_t numBytes)
+{
+    if (static_cast<int64_t>(numBytes) > bytesLeft)
+    {
+        failed = true;
+        return;
+    }
+    
+    stream.skipNextBytes(numBytes);
+    bytesLeft -= numBytes;
+}
+
+} // namespace SquareBeats
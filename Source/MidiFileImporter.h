@@ -0,0 +1,136 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "DataStructures.h"
+#include "PatternModel.h"
+#include <functional>
+#include <vector>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * MidiFileImporter turns the notes of a Standard MIDI File into squares
+ *
+ * The file is parsed straight from its stream, one event at a time: only
+ * notes still held are remembered, and each note is reported once it ends,
+ * so no track is ever held in memory as a whole (unlike juce::MidiFile).
+ *
+ * Importing replaces the pattern. Each track (or MIDI channel) with notes
+ * becomes a color, in the order they first play; the loop becomes the
+ * file's length rounded up to whole bars of the file's time signature. The
+ * pattern stays in 4/4, the only time signature saved states keep, so notes
+ * keep their beats (three bars of 3/4 make a loop of 2.25 bars).
+ * Squares are placed the way MidiRecorder places played notes: the centre
+ * gives the pitch within the color's note range, the height the velocity,
+ * and the width the note's length, cut off at the color's loop end. All of
+ * them reach the model through one PatternModel::addSquares() call.
+ */
+class MidiFileImporter
+{
+public:
+    /**
+     * What a color stands for
+     */
+    enum ColorMapping
+    {
+        COLORS_AUTO,        // Tracks, or channels when all notes are on one track (type 0 files)
+        COLORS_BY_TRACK,
+        COLORS_BY_CHANNEL
+    };
+    
+    /**
+     * A note as read from the file
+     */
+    struct Note
+    {
+        int track;
+        int channel;      // 0-15
+        int note;
+        int velocity;     // 1-127
+        double startBeats;
+        double endBeats;
+    };
+    
+    /**
+     * Timing read from the file alongside its notes
+     */
+    struct FileInfo
+    {
+        int numerator = 4;      // First time signature (4/4 if there is none)
+        int denominator = 4;
+        double lengthBeats = 0.0;  // End of the longest track
+    };
+    
+    /**
+     * What an import did
+     */
+    struct Result
+    {
+        int numSquares = 0;
+        int numColors = 0;
+        int numSkippedNotes = 0;  // Beyond the last color, or starting after their color's loop end
+    };
+    
+    using NoteCallback = std::function<void(const Note& note)>;
+    
+    /**
+     * Replace a model's pattern with a Standard MIDI File's notes
+     * @return false if the file cannot be read or has no notes (the model is left alone)
+     */
+    static bool importFile(const juce::File& file, PatternModel& model, ColorMapping mapping, Result& result);
+    
+    /**
+     * Replace a model's pattern with the notes of a Standard MIDI File read from a stream
+     * @return false if the stream is not a readable file or has no notes (the model is left alone)
+     */
+    static bool importStream(juce::InputStream& stream, PatternModel& model, ColorMapping mapping, Result& result);
+    
+    /**
+     * Parse a Standard MIDI File, reporting each note as it ends
+     * Notes still held at the end of their track end there.
+     * @return false if the stream is not a Standard MIDI File, is SMPTE-timed or is cut short
+     */
+    static bool readNotes(juce::InputStream& stream, const NoteCallback& callback, FileInfo& info);
+    
+    /**
+     * Whether a file looks like a Standard MIDI File (by its extension)
+     */
+    static bool isMidiFile(const juce::File& file);
+    
+    // Longest loop a file is fitted into, in 4/4 bars (as PatternModel::setLoopLength())
+    static constexpr double MAX_LOOP_LENGTH_BARS = 64.0;
+
+private:
+    static constexpr int HEADER_CHUNK = 0x4D546864;  // "MThd"
+    static constexpr int TRACK_CHUNK = 0x4D54726B;   // "MTrk"
+    
+    /**
+     * Reads within one track chunk, failing once the chunk or the stream runs out
+     */
+    struct TrackReader
+    {
+        juce::InputStream& stream;
+        int64_t bytesLeft;
+        bool failed = false;
+        
+        int readByte();
+        uint32_t readVariableLength();
+        void skip(uint32_t numBytes);
+    };
+    
+    /**
+     * Parse one track chunk
+     * @return false if the chunk is malformed or cut short
+     */
+    static bool readTrack(juce::InputStream& stream, int64_t length, int track, int ticksPerQuarterNote,
+                          const NoteCallback& callback, FileInfo& info, bool& timeSignatureFound);
+    
+    /**
+     * Squares for the notes, with colors assigned; the model's loop and colors must already fit
+     */
+    static std::vector<Square> buildSquares(const std::vector<Note>& notes, const std::vector<int>& colorForKey,
+                                            bool byChannel, const PatternModel& model, Result& result);
+};
+
+} // namespace SquareBeats
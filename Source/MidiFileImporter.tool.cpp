@@ -0,0 +1,88 @@
+#include "PatternModel.h"
+#include "MidiFileImporter.h"
+#include "StateManager.h"
+#include <iostream>
+
+using namespace SquareBeats;
+
+//==============================================================================
+// Batch conversion of Standard MIDI Files into SquareBeats presets
+// Runs headless: each file is imported into a fresh default pattern and saved
+// as <name>.vstpreset, next to the file or in the output directory. Copy the
+// presets into the plugin's preset folder to load them from the editor.
+//
+// Usage: SquareBeatsMidiImport [--by-track | --by-channel] [--output DIR] FILE_OR_DIR...
+//   --by-track      One color per track with notes
+//   --by-channel    One color per MIDI channel with notes
+//                   (default: tracks, or channels for files with all notes on one track)
+//   --output DIR    Write presets to DIR instead of next to each file
+// Directories are searched (with subdirectories) for .mid, .midi and .smf files.
+// Exit code 1 if any file could not be converted.
+
+int main(int argc, char* argv[]) {
+    MidiFileImporter::ColorMapping mapping = MidiFileImporter::COLORS_AUTO;
+    juce::File outputDirectory;
+    juce::Array<juce::File> inputs;
+    
+    for (int i = 1; i < argc; ++i) {
+        juce::String arg(argv[i]);
+        if (arg == "--by-track") {
+            mapping = MidiFileImporter::COLORS_BY_TRACK;
+        } else if (arg == "--by-channel") {
+            mapping = MidiFileImporter::COLORS_BY_CHANNEL;
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else if (!arg.startsWith("-")) {
+            const juce::File input = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+            if (input.isDirectory())
+                inputs.addArray(input.findChildFiles(juce::File::findFiles, true, "*.mid;*.midi;*.smf"));
+            else
+                inputs.add(input);
+        } else {
+            inputs.clear();
+            break;
+        }
+    }
+    
+    if (inputs.isEmpty()) {
+        std::cout << "Usage: " << argv[0] << " [--by-track | --by-channel] [--output DIR] FILE_OR_DIR..." << std::endl;
+        return 1;
+    }
+    
+    if (outputDirectory != juce::File() && outputDirectory.createDirectory().failed()) {
+        std::cerr << "Cannot create " << outputDirectory.getFullPathName().toStdString() << std::endl;
+        return 1;
+    }
+    
+    int numFailed = 0;
+    for (const juce::File& input : inputs) {
+        // A fresh pattern per file, so nothing carries over from the one before
+        PatternModel model;
+        MidiFileImporter::Result result;
+        if (!MidiFileImporter::importFile(input, model, mapping, result)) {
+            std::cerr << "Failed: " << input.getFullPathName().toStdString() << std::endl;
+            ++numFailed;
+            continue;
+        }
+        
+        juce::MemoryBlock state;
+        StateManager::saveState(model, state);
+        
+        const juce::File directory = outputDirectory != juce::File() ? outputDirectory : input.getParentDirectory();
+        const juce::File preset = directory.getChildFile(input.getFileNameWithoutExtension() + ".vstpreset");
+        if (!preset.replaceWithData(state.getData(), state.getSize())) {
+            std::cerr << "Cannot write " << preset.getFullPathName().toStdString() << std::endl;
+            ++numFailed;
+            continue;
+        }
+        
+        std::cout << input.getFileName().toStdString() << " -> " << preset.getFileName().toStdString() << ": "
+                  << result.numSquares << " squares in " << result.numColors << " colors";
+        if (result.numSkippedNotes > 0)
+            std::cout << " (" << result.numSkippedNotes << " notes skipped)";
+        std::cout << std::endl;
+    }
+    
+    std::cout << (inputs.size() - numFailed) << " of " << inputs.size() << " files converted" << std::endl;
+    return numFailed == 0 ? 0 : 1;
+}
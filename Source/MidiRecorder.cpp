@@ -0,0 +1,142 @@
+#include "MidiRecorder.h"
+#include "MIDIGenerator.h"
+#include "ConversionUtils.h"
+#include <cmath>
+
+namespace SquareBeats {
+
+//==============================================================================
+MidiRecorder::MidiRecorder(PatternModel& liveModel)
+    : live(liveModel)
+    , fifo(QUEUE_CAPACITY)
+    , events(static_cast<size_t>(QUEUE_CAPACITY))
+{
+    finishedSquares.reserve(MAX_EVENTS_PER_UPDATE);
+}
+
+//==============================================================================
+void MidiRecorder::noteOn(int note, int velocity, double positionBeats)
+{
+    if (note < 0 || note > 127)
+        return;
+    
+    if (velocity <= 0)
+    {
+        noteOff(note, positionBeats);
+        return;
+    }
+    
+    // A note-on for a note that is already down ends the earlier one first
+    if (notesOnAudioThread[static_cast<size_t>(note)])
+        noteOff(note, positionBeats);
+    
+    if (push({ positionBeats, note, juce::jmin(velocity, 127) }))
+        notesOnAudioThread.set(static_cast<size_t>(note));
+}
+
+void MidiRecorder::noteOff(int note, double positionBeats)
+{
+    if (note < 0 || note > 127 || !notesOnAudioThread[static_cast<size_t>(note)])
+        return;
+    
+    notesOnAudioThread.reset(static_cast<size_t>(note));
+    push({ positionBeats, note, 0 });
+}
+
+void MidiRecorder::allNotesOff(double positionBeats)
+{
+    if (notesOnAudioThread.none())
+        return;
+    
+    for (int note = 0; note < 128; ++note)
+        noteOff(note, positionBeats);
+}
+
+bool MidiRecorder::push(const NoteEvent& event)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+    {
+        numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    events[static_cast<size_t>(size1 > 0 ? start1 : start2)] = event;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+//==============================================================================
+void MidiRecorder::update()
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(MAX_EVENTS_PER_UPDATE, start1, size1, start2, size2);
+    
+    finishedSquares.clear();
+    for (int i = 0; i < size1; ++i)
+        handleEvent(events[static_cast<size_t>(start1 + i)]);
+    for (int i = 0; i < size2; ++i)
+        handleEvent(events[static_cast<size_t>(start2 + i)]);
+    
+    fifo.finishedRead(size1 + size2);
+    
+    // One change message and one edit for the engine per batch, however many notes ended
+    live.addSquares(finishedSquares);
+}
+
+void MidiRecorder::handleEvent(const NoteEvent& event)
+{
+    HeldNote& held = heldNotes[static_cast<size_t>(event.note)];
+    
+    if (event.velocity > 0)
+    {
+        held.startBeats = event.positionBeats;
+        held.velocity = event.velocity;
+        return;
+    }
+    
+    if (held.velocity > 0)
+    {
+        addSquare(event.note, held.velocity, held.startBeats, event.positionBeats);
+        held.velocity = 0;
+    }
+}
+
+void MidiRecorder::addSquare(int note, int velocity, double startBeats, double endBeats)
+{
+    const int colorId = juce::jlimit(0, live.getNumColorChannels() - 1, recordColor);
+    const ColorChannelConfig& config = live.getColorConfig(colorId);
+    const TimeSignature timeSig = live.getTimeSignature();
+    
+    // The color's own loop if it has one, as the engine plays it
+    const double loopLengthBars = config.mainLoopLengthBars > 0.0 ? config.mainLoopLengthBars : live.getLoopLength();
+    const double loopLengthBeats = loopLengthBars * timeSig.getBeatsPerBar();
+    if (loopLengthBeats <= 0.0)
+        return;
+    
+    // Start within the loop, snapped to the color's grid (the last step rounds up to the loop start)
+    double loopStartBeats = std::fmod(juce::jmax(0.0, startBeats), loopLengthBeats);
+    loopStartBeats = MIDIGenerator::applyQuantization(loopStartBeats, config.quantize, timeSig);
+    if (loopStartBeats >= loopLengthBeats)
+        loopStartBeats = 0.0;
+    
+    // The length as played; a square cannot wrap past the loop end
+    const double lengthBeats = juce::jmin(endBeats - startBeats, loopLengthBeats - loopStartBeats);
+    if (lengthBeats <= 0.0)
+        return;
+    
+    // Centred on the note within the color's range, as tall as its velocity
+    float topEdge, height;
+    mapVelocityAroundPosition(mapNoteToVerticalPosition(note, config.highNote, config.lowNote),
+                              velocity, MIN_SQUARE_SIZE, topEdge, height);
+    
+    finishedSquares.emplace_back(beatsToNormalized(loopStartBeats, loopLengthBars, timeSig),
+                                 topEdge,
+                                 beatsToNormalized(lengthBeats, loopLengthBars, timeSig),
+                                 height,
+                                 colorId,
+                                 0);
+}
+
+} // namespace SquareBeats
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "DataStructures.h"
+#include "PatternModel.h"
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <vector>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * MidiRecorder turns notes played into the plugin into squares
+ *
+ * The audio thread timestamps each note-on and note-off with its position on
+ * the host timeline and pushes it into a bounded single-producer,
+ * single-consumer queue; it never touches the pattern model. The message
+ * thread drains the queue in batches, pairs each note-on with its note-off
+ * and adds the squares of the notes finished in a batch to the live model in
+ * one PatternModel::addSquares() call, which PatternSync then sends on to the
+ * engine like any other edit.
+ *
+ * A square's left edge is the note's start, wrapped into its color's loop
+ * and quantized with the color's quantize setting; its width is the held
+ * length, cut off at the loop end. Pitch and velocity are mapped back the way
+ * the engine maps squares to notes: the square's centre gives the pitch
+ * within the color's note range and its height gives the velocity. Notes
+ * outside the range land on its nearest edge, and squares near the top or
+ * bottom are made shorter so their centre (the pitch) stays put.
+ */
+class MidiRecorder
+{
+public:
+    explicit MidiRecorder(PatternModel& liveModel);
+    
+    //==============================================================================
+    // Audio thread
+    
+    /**
+     * Record the start of a note
+     * @param positionBeats Host timeline position of the note-on
+     */
+    void noteOn(int note, int velocity, double positionBeats);
+    
+    /**
+     * Record the end of a note (ignored if its note-on was not recorded)
+     */
+    void noteOff(int note, double positionBeats);
+    
+    /**
+     * End every note still held, when recording or the transport stops
+     */
+    void allNotesOff(double positionBeats);
+    
+    //==============================================================================
+    // Message thread
+    
+    /**
+     * Add squares for the notes recorded since the last call (call from a timer)
+     */
+    void update();
+    
+    /**
+     * Color channel that recorded notes are added to
+     */
+    int getRecordColor() const { return recordColor; }
+    void setRecordColor(int colorId) { recordColor = colorId; }
+    
+    /**
+     * Note events lost because the queue was full
+     */
+    int getNumDroppedEvents() const { return numDroppedEvents.load(std::memory_order_relaxed); }
+    
+    // Note events the queue holds between two updates: several seconds of dense playing,
+    // so a busy message thread does not lose notes
+    static constexpr int QUEUE_CAPACITY = 4096;
+    
+    // Upper bound on the events one update() turns into squares; the rest wait for the next
+    static constexpr int MAX_EVENTS_PER_UPDATE = 512;
+
+private:
+    struct NoteEvent
+    {
+        double positionBeats;
+        int note;
+        int velocity;  // 0 for a note-off
+    };
+    
+    /**
+     * Queue an event (audio thread)
+     * @return false if the queue was full and the event was dropped
+     */
+    bool push(const NoteEvent& event);
+    
+    /**
+     * Pair an event with what is held and add a square for a finished note
+     */
+    void handleEvent(const NoteEvent& event);
+    
+    /**
+     * Add the square for one played note to the batch update() adds to the live model
+     */
+    void addSquare(int note, int velocity, double startBeats, double endBeats);
+    
+    //==============================================================================
+    PatternModel& live;
+    
+    juce::AbstractFifo fifo;
+    std::vector<NoteEvent> events;
+    std::atomic<int> numDroppedEvents { 0 };
+    
+    // Message thread: squares of the notes finished in the current update()
+    std::vector<Square> finishedSquares;
+    
+    // Audio thread: notes whose note-on was queued and whose note-off was not
+    std::bitset<128> notesOnAudioThread;
+    
+    // Message thread: note-ons waiting for their note-off
+    struct HeldNote
+    {
+        double startBeats = 0.0;
+        int velocity = 0;  // 0 when the note is not held
+    };
+    std::array<HeldNote, 128> heldNotes;
+    int recordColor = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiRecorder)
+};
+
+} // namespace SquareBeats
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "DataStructures.h"
+#include <memory>
+#include <vector>
+
+namespace SquareBeats {
+
+class PatternModel;
+
+//==============================================================================
+/**
+ * One edit to a pattern, as sent from the message thread to the audio thread
+ *
+ * Commands carry the result of an edit (a square after clamping, a whole
+ * config), not the request, so applying one never validates or computes
+ * anything. Payloads that would make every command large (color configs,
+ * note tables, scale sequences) are shared, immutable and built on the
+ * message thread; the queue slot keeps them alive until the message thread
+ * overwrites it.
+ */
+struct PatternCommand {
+    enum Type {
+        ADD_SQUARE = 0,          // square (with its ID)
+        UPDATE_SQUARE,           // square, matched by ID
+        DELETE_SQUARE,           // square.uniqueId
+        CLEAR_COLOR_CHANNEL,     // colorId
+        SET_NUM_COLOR_CHANNELS,  // intValue
+        SET_LOOP_LENGTH,         // doubleValue (bars)
+        SET_TIME_SIGNATURE,      // timeSignature
+        SET_COLOR_CONFIG,        // colorId, colorConfig
+        SET_PLAY_MODE,           // playMode
+        SET_SCALE,               // scale, noteTable
+        SET_SCALE_SEQUENCER,     // scaleSequencer
+        REPLACE_PATTERN          // pattern, takePlayback, releaseNotes
+    };
+    
+    Type type = ADD_SQUARE;
+    uint64_t sequence = 0;  // Assigned by the sender, reported back once applied
+    
+    Square square;
+    int colorId = 0;
+    int intValue = 0;
+    double doubleValue = 0.0;
+    TimeSignature timeSignature;
+    std::shared_ptr<const ColorChannelConfig> colorConfig;
+    PlayModeConfig playMode;
+    ScaleConfig scale;
+    std::shared_ptr<const ScaleNoteTable> noteTable;
+    std::shared_ptr<const ScaleSequencerConfig> scaleSequencer;
+    
+    // REPLACE_PATTERN: later commands edit this model instead. Playback moves to it
+    // if takePlayback is set or the engine was playing the model it replaces.
+    PatternModel* pattern = nullptr;
+    bool takePlayback = false;
+    bool releaseNotes = false;
+};
+
+//==============================================================================
+/**
+ * A host automation value for one setting, applied by the audio thread to the
+ * pattern copy it owns from a sample of the block on
+ *
+ * Only settings that are a plain value in the model are automated this way;
+ * ones that need work on the message thread first (loop length, scales) go
+ * through the live model and PatternSync instead.
+ */
+struct AutomationChange {
+    enum Target {
+        PROBABILITY = 0,  // Play mode probability (0.0 to 1.0)
+        STEP_JUMP_SIZE,   // Play mode step jump size (0.0 to 1.0)
+        HIGH_NOTE,        // colorId's high note (0-127)
+        LOW_NOTE,         // colorId's low note (0-127)
+        QUANTIZE          // colorId's QuantizationValue
+    };
+    
+    Target target = PROBABILITY;
+    int colorId = 0;
+    float value = 0.0f;
+    int sampleOffset = 0;  // Within the coming block
+};
+
+//==============================================================================
+/**
+ * Bounded single-producer, single-consumer queue of pattern commands
+ *
+ * The message thread pushes and the audio thread pops; neither ever waits
+ * for the other. All slots are allocated up front, and a popped command's
+ * payload is released when the message thread next overwrites its slot, so
+ * the audio thread never frees memory.
+ */
+class PatternCommandQueue {
+public:
+    static constexpr int DEFAULT_CAPACITY = 1024;
+    
+    explicit PatternCommandQueue(int capacity = DEFAULT_CAPACITY)
+        : fifo(capacity)
+        , commands(static_cast<size_t>(capacity))
+    {}
+    
+    /**
+     * Add a command (message thread)
+     * @return false if the queue is full
+     */
+    bool push(const PatternCommand& command) {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 + size2 < 1) {
+            return false;
+        }
+        
+        commands[static_cast<size_t>(size1 > 0 ? start1 : start2)] = command;
+        fifo.finishedWrite(1);
+        return true;
+    }
+    
+    /**
+     * Hand queued commands to a function, oldest first (audio thread)
+     * @param maxCommands Upper bound on the work done in one call
+     * @return Number of commands handled
+     */
+    template <typename Function>
+    int popAll(Function&& handle, int maxCommands) {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(maxCommands, start1, size1, start2, size2);
+        
+        for (int i = 0; i < size1; ++i) {
+            handle(static_cast<const PatternCommand&>(commands[static_cast<size_t>(start1 + i)]));
+        }
+        for (int i = 0; i < size2; ++i) {
+            handle(static_cast<const PatternCommand&>(commands[static_cast<size_t>(start2 + i)]));
+        }
+        
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+    
+    int getNumReady() const { return fifo.getNumReady(); }
+    int getFreeSpace() const { return fifo.getFreeSpace(); }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<PatternCommand> commands;
+    
+    JUCE_DECLARE_NON_COPYABLE(PatternCommandQueue)
+};
+
+} // namespace SquareBeats
@@ -0,0 +1,93 @@
+#include "PatternGenerator.h"
+#include "ConversionUtils.h"
+#include <cmath>
+
+namespace SquareBeats {
+
+//==============================================================================
+void PatternGenerator::euclidean(std::vector<Square>& squares, int colorId, int pulses, int steps, int rotation,
+                                 float position, int velocity, float gate)
+{
+    if (steps <= 0)
+        return;
+    
+    pulses = juce::jlimit(0, steps, pulses);
+    rotation = ((rotation % steps) + steps) % steps;
+    
+    // Bresenham's line through steps x pulses gives the same spacing as Bjorklund's algorithm
+    for (int step = 0; step < steps; ++step)
+    {
+        const int unrotated = (step - rotation + steps) % steps;
+        if ((unrotated * pulses) % steps < pulses)
+            squares.push_back(makeSquare(colorId, step, steps, position, velocity, gate));
+    }
+}
+
+void PatternGenerator::probabilityField(std::vector<Square>& squares, int colorId, int steps, int rows,
+                                        const ProbabilityField& field, int velocity, juce::Random& random,
+                                        float gate)
+{
+    if (steps <= 0 || rows <= 0 || field == nullptr)
+        return;
+    
+    for (int step = 0; step < steps; ++step)
+    {
+        const float time = static_cast<float>(step) / steps;
+        for (int row = 0; row < rows; ++row)
+        {
+            const float position = (row + 0.5f) / rows;
+            if (random.nextFloat() < field(time, position))
+                squares.push_back(makeSquare(colorId, step, steps, position, velocity, gate));
+        }
+    }
+}
+
+void PatternGenerator::randomWalk(std::vector<Square>& squares, int colorId, int steps, int rows, int startRow,
+                                  int maxJump, int velocity, juce::Random& random, float gate)
+{
+    if (steps <= 0 || rows <= 0)
+        return;
+    
+    maxJump = juce::jmax(0, maxJump);
+    int row = juce::jlimit(0, rows - 1, startRow);
+    for (int step = 0; step < steps; ++step)
+    {
+        squares.push_back(makeSquare(colorId, step, steps, (row + 0.5f) / rows, velocity, gate));
+        row = juce::jlimit(0, rows - 1, row + random.nextInt(2 * maxJump + 1) - maxJump);
+    }
+}
+
+//==============================================================================
+void PatternGenerator::mirrorTime(std::vector<Square>& squares, size_t first)
+{
+    for (size_t index = first; index < squares.size(); ++index)
+        squares[index].leftEdge = juce::jmax(0.0f, 1.0f - squares[index].getRightEdge());
+}
+
+void PatternGenerator::mirrorPitch(std::vector<Square>& squares, size_t first)
+{
+    for (size_t index = first; index < squares.size(); ++index)
+        squares[index].topEdge = juce::jmax(0.0f, 1.0f - squares[index].getBottomEdge());
+}
+
+void PatternGenerator::rotate(std::vector<Square>& squares, float amount, size_t first)
+{
+    for (size_t index = first; index < squares.size(); ++index)
+    {
+        float left = std::fmod(squares[index].leftEdge + amount, 1.0f);
+        squares[index].leftEdge = left < 0.0f ? left + 1.0f : left;
+    }
+}
+
+//==============================================================================
+Square PatternGenerator::makeSquare(int colorId, int step, int steps, float position, int velocity, float gate)
+{
+    // Centred on its row, as tall as the velocity (kept inside the plane)
+    float topEdge, height;
+    mapVelocityAroundPosition(position, velocity, MIN_SQUARE_SIZE, topEdge, height);
+    const float stepWidth = 1.0f / steps;
+    
+    return Square(step * stepWidth, topEdge, juce::jmax(MIN_SQUARE_SIZE, gate * stepWidth), height, colorId, 0);
+}
+
+} // namespace SquareBeats
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "DataStructures.h"
+#include <functional>
+#include <vector>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * PatternGenerator writes squares for algorithmic patterns
+ *
+ * Generators append to a list of squares instead of a model: a whole pattern
+ * (any number of generators and colors, reshaped by the operations) is built
+ * first and handed to PatternModel::addSquares() in one go, which costs one
+ * change message however many squares there are.
+ *
+ * Steps divide the loop evenly and rows divide the plane from the top (the
+ * color's high note) to the bottom. Each square is centred on its row, with
+ * the height that plays the given velocity (kept inside the plane), and lasts
+ * gate steps.
+ */
+class PatternGenerator
+{
+public:
+    /**
+     * Probability (0-1) of a square at a point of the plane
+     * @param time Normalized time of a step's start
+     * @param position Normalized vertical position of a row's centre
+     */
+    using ProbabilityField = std::function<float(float time, float position)>;
+    
+    /**
+     * Euclidean rhythm: pulses spread as evenly as possible over steps, all on one row
+     * @param rotation Steps the rhythm is shifted later by
+     * @param position Normalized vertical position of the squares' centre
+     */
+    static void euclidean(std::vector<Square>& squares, int colorId, int pulses, int steps, int rotation,
+                          float position, int velocity, float gate = 0.5f);
+    
+    /**
+     * A square in each cell of a steps x rows grid, placed with the field's probability there
+     */
+    static void probabilityField(std::vector<Square>& squares, int colorId, int steps, int rows,
+                                 const ProbabilityField& field, int velocity, juce::Random& random,
+                                 float gate = 0.5f);
+    
+    /**
+     * A square on every step, each up to maxJump rows above or below the last (staying on the plane)
+     */
+    static void randomWalk(std::vector<Square>& squares, int colorId, int steps, int rows, int startRow,
+                           int maxJump, int velocity, juce::Random& random, float gate = 0.5f);
+    
+    /**
+     * Play squares backwards: each one ends where it started from the loop end
+     * @param first Index of the first square to change (e.g. the first a generator added)
+     */
+    static void mirrorTime(std::vector<Square>& squares, size_t first = 0);
+    
+    /**
+     * Turn squares upside down, so high notes become low ones
+     */
+    static void mirrorPitch(std::vector<Square>& squares, size_t first = 0);
+    
+    /**
+     * Shift squares later in time by a fraction of the loop, wrapping at the loop end
+     * (a square that then crosses the loop end is shortened to it when added to a model)
+     */
+    static void rotate(std::vector<Square>& squares, float amount, size_t first = 0);
+
+private:
+    /**
+     * Square on a grid cell
+     */
+    static Square makeSquare(int colorId, int step, int steps, float position, int velocity, float gate);
+};
+
+} // namespace SquareBeats
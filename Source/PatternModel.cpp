@@ -4,11 +4,14 @@ namespace SquareBeats {
 
 //==============================================================================
 PatternModel::PatternModel()
-    : loopLengthBars(2)
+    : numColorChannels(DEFAULT_COLOR_CHANNELS)
+    , loopLengthBars(2)
     , timeSignature(4, 4)
     , nextUniqueId(1)
+    , editVersion(0)
 {
     initializeDefaultColorConfigs();
+    scaleNoteTable = ScaleNoteTable(scaleConfig);
 }
 
 //==============================================================================
@@ -16,24 +19,39 @@ PatternModel::PatternModel()
 
 Square* PatternModel::createSquare(float left, float top, float width, float height, int colorId)
 {
-    // Define minimum square size to prevent zero-width/height squares
-    constexpr float MIN_SIZE = 0.01f;
+    // Create square with unique ID
+    Square square(left, top, width, height, colorId, nextUniqueId++);
+    clampSquare(square);
+    squares.push_back(square);
+    sendSquareCommand(PatternCommand::ADD_SQUARE, squares.back());
     
-    // Clamp coordinates to valid range [0.0, 1.0]
-    left = juce::jlimit(0.0f, 1.0f, left);
-    top = juce::jlimit(0.0f, 1.0f, top);
-    width = juce::jlimit(MIN_SIZE, 1.0f - left, width);
-    height = juce::jlimit(MIN_SIZE, 1.0f - top, height);
+    sendChangeMessage();
+    return &squares.back();
+}
+
+void PatternModel::addSquares(const std::vector<Square>& newSquares)
+{
+    if (newSquares.empty())
+        return;
     
-    // Clamp color ID to valid range [0, 3]
-    colorId = juce::jlimit(0, 3, colorId);
+    // Grow at least geometrically, so repeated small batches stay cheap
+    const size_t needed = squares.size() + newSquares.size();
+    if (needed > squares.capacity())
+        squares.reserve(std::max(needed, squares.capacity() * 2));
     
-    // Create square with unique ID
-    uint32_t id = nextUniqueId++;
-    squares.emplace_back(left, top, width, height, colorId, id);
+    for (const Square& newSquare : newSquares)
+    {
+        Square square = newSquare;
+        square.uniqueId = nextUniqueId++;
+        clampSquare(square);
+        squares.push_back(square);
+    }
     
+    if (commandSink != nullptr)
+    {
+        commandSink->squaresAdded(newSquares.size());
+    }
     sendChangeMessage();
-    return &squares.back();
 }
 
 bool PatternModel::deleteSquare(uint32_t squareId)
@@ -41,7 +59,9 @@ bool PatternModel::deleteSquare(uint32_t squareId)
     auto it = findSquareById(squareId);
     if (it != squares.end())
     {
+        Square deleted = *it;
         squares.erase(it);
+        sendSquareCommand(PatternCommand::DELETE_SQUARE, deleted);
         sendChangeMessage();
         return true;
     }
@@ -56,6 +76,7 @@ bool PatternModel::moveSquare(uint32_t squareId, float newLeft, float newTop)
         // Clamp to valid range
         it->leftEdge = juce::jlimit(0.0f, 1.0f, newLeft);
         it->topEdge = juce::jlimit(0.0f, 1.0f, newTop);
+        sendSquareCommand(PatternCommand::UPDATE_SQUARE, *it);
         sendChangeMessage();
         return true;
     }
@@ -64,15 +85,28 @@ bool PatternModel::moveSquare(uint32_t squareId, float newLeft, float newTop)
 
 bool PatternModel::resizeSquare(uint32_t squareId, float newWidth, float newHeight)
 {
-    // Define minimum square size to prevent zero-width/height squares
-    constexpr float MIN_SIZE = 0.01f;
-    
     auto it = findSquareById(squareId);
     if (it != squares.end())
     {
         // Clamp to valid range, ensuring square doesn't extend beyond bounds
-        it->width = juce::jlimit(MIN_SIZE, 1.0f - it->leftEdge, newWidth);
-        it->height = juce::jlimit(MIN_SIZE, 1.0f - it->topEdge, newHeight);
+        it->width = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - it->leftEdge, newWidth);
+        it->height = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - it->topEdge, newHeight);
+        sendSquareCommand(PatternCommand::UPDATE_SQUARE, *it);
+        sendChangeMessage();
+        return true;
+    }
+    return false;
+}
+
+bool PatternModel::setSquareRatchet(uint32_t squareId, const Ratchet& ratchet)
+{
+    auto it = findSquareById(squareId);
+    if (it != squares.end())
+    {
+        it->ratchet.count = juce::jlimit(1, Ratchet::MAX_COUNT, ratchet.count);
+        it->ratchet.rate = ratchet.rate;
+        it->ratchet.velocityRamp = juce::jlimit(-1.0f, 1.0f, ratchet.velocityRamp);
+        sendSquareCommand(PatternCommand::UPDATE_SQUARE, *it);
         sendChangeMessage();
         return true;
     }
@@ -89,6 +123,14 @@ void PatternModel::clearColorChannel(int colorId)
             }),
         squares.end()
     );
+    
+    if (commandSink != nullptr)
+    {
+        PatternCommand command;
+        command.type = PatternCommand::CLEAR_COLOR_CHANNEL;
+        command.colorId = colorId;
+        commandSink->squareCommand(command);
+    }
     sendChangeMessage();
 }
 
@@ -98,7 +140,12 @@ void PatternModel::clearColorChannel(int colorId)
 std::vector<Square*> PatternModel::getSquaresInTimeRange(float startTime, float endTime)
 {
     std::vector<Square*> result;
-    
+    getSquaresInTimeRange(startTime, endTime, result);
+    return result;
+}
+
+void PatternModel::getSquaresInTimeRange(float startTime, float endTime, std::vector<Square*>& result)
+{
     for (auto& square : squares)
     {
         float squareStart = square.leftEdge;
@@ -110,8 +157,15 @@ std::vector<Square*> PatternModel::getSquaresInTimeRange(float startTime, float
             result.push_back(&square);
         }
     }
-    
-    return result;
+}
+
+const Square* PatternModel::getSquare(uint32_t squareId) const
+{
+    auto it = std::find_if(squares.begin(), squares.end(),
+        [squareId](const Square& square) {
+            return square.uniqueId == squareId;
+        });
+    return it != squares.end() ? &*it : nullptr;
 }
 
 std::vector<Square*> PatternModel::getAllSquares()
@@ -145,19 +199,19 @@ std::vector<const Square*> PatternModel::getAllSquares() const
 
 ColorChannelConfig& PatternModel::getColorConfig(int colorId)
 {
-    colorId = juce::jlimit(0, 3, colorId);
+    colorId = juce::jlimit(0, MAX_COLOR_CHANNELS - 1, colorId);
     return colorConfigs[colorId];
 }
 
 const ColorChannelConfig& PatternModel::getColorConfig(int colorId) const
 {
-    colorId = juce::jlimit(0, 3, colorId);
+    colorId = juce::jlimit(0, MAX_COLOR_CHANNELS - 1, colorId);
     return colorConfigs[colorId];
 }
 
 void PatternModel::setColorConfig(int colorId, const ColorChannelConfig& config)
 {
-    colorId = juce::jlimit(0, 3, colorId);
+    colorId = juce::jlimit(0, MAX_COLOR_CHANNELS - 1, colorId);
     
     // Create a validated copy of the config with clamped values
     ColorChannelConfig validatedConfig = config;
@@ -169,10 +223,64 @@ void PatternModel::setColorConfig(int colorId, const ColorChannelConfig& config)
     validatedConfig.highNote = juce::jlimit(0, 127, config.highNote);
     validatedConfig.lowNote = juce::jlimit(0, 127, config.lowNote);
     
+    // Clamp polyphony to the voice pool capacity
+    validatedConfig.polyphony = juce::jlimit(1, MAX_VOICES_PER_COLOR, config.polyphony);
+    
+    // Clamp pitch-bend output settings
+    validatedConfig.pitchBendRange = juce::jlimit(0, MAX_PITCH_BEND_RANGE, config.pitchBendRange);
+    validatedConfig.pitchBendRateHz = juce::jlimit(MIN_PITCH_BEND_RATE_HZ, MAX_PITCH_BEND_RATE_HZ, config.pitchBendRateHz);
+    
+    // The waveform is shared, not copied; keep the old envelope until readers let go
+    PitchWaveform::EnvelopePtr previousWaveform = colorConfigs[colorId].pitchWaveform.getEnvelope();
+    
     colorConfigs[colorId] = validatedConfig;
+    
+    if (previousWaveform != colorConfigs[colorId].pitchWaveform.getEnvelope())
+    {
+        retirePitchWaveform(std::move(previousWaveform));
+    }
+    
     sendChangeMessage();
 }
 
+void PatternModel::setPitchWaveform(int colorId, PitchWaveform::EnvelopePtr envelope)
+{
+    colorId = juce::jlimit(0, MAX_COLOR_CHANNELS - 1, colorId);
+    
+    PitchWaveform::EnvelopePtr previousWaveform = colorConfigs[colorId].pitchWaveform.getEnvelope();
+    colorConfigs[colorId].pitchWaveform.publish(std::move(envelope));
+    retirePitchWaveform(std::move(previousWaveform));
+    
+    sendChangeMessage();
+}
+
+void PatternModel::retirePitchWaveform(PitchWaveform::EnvelopePtr envelope)
+{
+    // A retired envelope referenced only from this list has no readers left
+    retiredPitchWaveforms.erase(
+        std::remove_if(retiredPitchWaveforms.begin(), retiredPitchWaveforms.end(),
+            [](const PitchWaveform::EnvelopePtr& retired) { return retired.use_count() == 1; }),
+        retiredPitchWaveforms.end()
+    );
+    
+    if (envelope != nullptr)
+    {
+        retiredPitchWaveforms.push_back(std::move(envelope));
+    }
+}
+
+void PatternModel::setNumColorChannels(int numChannels)
+{
+    // Squares on channels no longer in use stay in the pattern for when the count goes back up
+    numColorChannels = juce::jlimit(1, MAX_COLOR_CHANNELS, numChannels);
+    sendChangeMessage();
+}
+
+int PatternModel::getNumColorChannels() const
+{
+    return numColorChannels;
+}
+
 //==============================================================================
 // Pitch sequencer
 
@@ -220,6 +328,14 @@ ScaleConfig PatternModel::getActiveScale(double positionBars) const
     return scaleConfig;
 }
 
+const ScaleNoteTable& PatternModel::getActiveNoteTable(double positionBars) const
+{
+    if (scaleSequencer.enabled && !scaleSequencer.segments.empty()) {
+        return scaleSequencer.getNoteTableAtPosition(positionBars);
+    }
+    return scaleNoteTable;
+}
+
 //==============================================================================
 // Global settings
 
@@ -269,6 +385,7 @@ TimeSignature PatternModel::getTimeSignature() const
 void PatternModel::setScaleConfig(const ScaleConfig& config)
 {
     scaleConfig = config;
+    scaleNoteTable = ScaleNoteTable(scaleConfig);
     sendChangeMessage();
 }
 
@@ -277,9 +394,203 @@ const ScaleConfig& PatternModel::getScaleConfig() const
     return scaleConfig;
 }
 
+//==============================================================================
+// Change tracking
+
+void PatternModel::sendChangeMessage()
+{
+    markEdited();
+    juce::ChangeBroadcaster::sendChangeMessage();
+}
+
+void PatternModel::markEdited()
+{
+    editVersion.fetch_add(1, std::memory_order_release);
+    
+    if (commandSink != nullptr)
+    {
+        commandSink->patternEdited();
+    }
+}
+
+uint64_t PatternModel::getEditVersion() const
+{
+    return editVersion.load(std::memory_order_acquire);
+}
+
+//==============================================================================
+// Commands
+
+void PatternModel::setCommandSink(CommandSink* sink)
+{
+    commandSink = sink;
+}
+
+void PatternModel::copyFrom(const PatternModel& other, size_t squareCapacity)
+{
+    squares.reserve(std::max(squareCapacity, other.squares.size()));
+    squares = other.squares;
+    colorConfigs = other.colorConfigs;
+    numColorChannels = other.numColorChannels;
+    pitchSequencer = other.pitchSequencer;
+    playModeConfig = other.playModeConfig;
+    scaleSequencer.segments.reserve(ScaleSequencerConfig::MAX_SEGMENTS);
+    scaleSequencer = other.scaleSequencer;
+    scaleConfig = other.scaleConfig;
+    scaleNoteTable = other.scaleNoteTable;
+    loopLengthBars = other.loopLengthBars;
+    timeSignature = other.timeSignature;
+    nextUniqueId = other.nextUniqueId;
+}
+
+void PatternModel::applyCommand(const PatternCommand& command)
+{
+    switch (command.type)
+    {
+        case PatternCommand::ADD_SQUARE:
+            // The sender resyncs instead of overfilling the reserved capacity
+            if (squares.size() < squares.capacity())
+            {
+                squares.push_back(command.square);
+            }
+            break;
+        
+        case PatternCommand::UPDATE_SQUARE:
+        {
+            auto it = findSquareById(command.square.uniqueId);
+            if (it != squares.end())
+            {
+                *it = command.square;
+            }
+            break;
+        }
+        
+        case PatternCommand::DELETE_SQUARE:
+        {
+            auto it = findSquareById(command.square.uniqueId);
+            if (it != squares.end())
+            {
+                squares.erase(it);
+            }
+            break;
+        }
+        
+        case PatternCommand::CLEAR_COLOR_CHANNEL:
+        {
+            const int colorId = command.colorId;
+            squares.erase(std::remove_if(squares.begin(), squares.end(),
+                                         [colorId](const Square& square) { return square.colorChannelId == colorId; }),
+                          squares.end());
+            break;
+        }
+        
+        case PatternCommand::SET_NUM_COLOR_CHANNELS:
+            numColorChannels = juce::jlimit(1, MAX_COLOR_CHANNELS, command.intValue);
+            break;
+        
+        case PatternCommand::SET_LOOP_LENGTH:
+            loopLengthBars = command.doubleValue;
+            break;
+        
+        case PatternCommand::SET_TIME_SIGNATURE:
+            timeSignature = command.timeSignature;
+            break;
+        
+        case PatternCommand::SET_COLOR_CONFIG:
+            // Shares the sender's waveform envelope, which the sender keeps alive
+            if (command.colorConfig != nullptr)
+            {
+                colorConfigs[static_cast<size_t>(juce::jlimit(0, MAX_COLOR_CHANNELS - 1, command.colorId))] = *command.colorConfig;
+            }
+            break;
+        
+        case PatternCommand::SET_PLAY_MODE:
+            // pendulumForward is playback state and stays as it is
+            playModeConfig.mode = command.playMode.mode;
+            playModeConfig.stepJumpSize = command.playMode.stepJumpSize;
+            playModeConfig.probability = command.playMode.probability;
+            break;
+        
+        case PatternCommand::SET_SCALE:
+            scaleConfig = command.scale;
+            if (command.noteTable != nullptr)
+            {
+                scaleNoteTable = *command.noteTable;
+            }
+            break;
+        
+        case PatternCommand::SET_SCALE_SEQUENCER:
+            // Segments fit the capacity reserved by copyFrom(), so this copies in place
+            if (command.scaleSequencer != nullptr
+                && command.scaleSequencer->segments.size() <= scaleSequencer.segments.capacity())
+            {
+                scaleSequencer = *command.scaleSequencer;
+            }
+            break;
+        
+        case PatternCommand::REPLACE_PATTERN:
+            break;
+    }
+}
+
+void PatternModel::applyAutomation(const AutomationChange& change)
+{
+    ColorChannelConfig& config = colorConfigs[static_cast<size_t>(juce::jlimit(0, MAX_COLOR_CHANNELS - 1, change.colorId))];
+    
+    switch (change.target)
+    {
+        case AutomationChange::PROBABILITY:
+            playModeConfig.probability = juce::jlimit(0.0f, 1.0f, change.value);
+            break;
+        
+        case AutomationChange::STEP_JUMP_SIZE:
+            playModeConfig.stepJumpSize = juce::jlimit(0.0f, 1.0f, change.value);
+            break;
+        
+        case AutomationChange::HIGH_NOTE:
+            config.highNote = juce::jlimit(0, 127, juce::roundToInt(change.value));
+            break;
+        
+        case AutomationChange::LOW_NOTE:
+            config.lowNote = juce::jlimit(0, 127, juce::roundToInt(change.value));
+            break;
+        
+        case AutomationChange::QUANTIZE:
+            config.quantize = static_cast<QuantizationValue>(juce::jlimit(static_cast<int>(Q_1_32), static_cast<int>(Q_1_BAR),
+                                                                          juce::roundToInt(change.value)));
+            break;
+    }
+}
+
+void PatternModel::sendSquareCommand(PatternCommand::Type type, const Square& square)
+{
+    if (commandSink != nullptr)
+    {
+        PatternCommand command;
+        command.type = type;
+        command.square = square;
+        commandSink->squareCommand(command);
+    }
+}
+
 //==============================================================================
 // Helper methods
 
+void PatternModel::clampSquare(Square& square) const
+{
+    // Clamp coordinates to valid range [0.0, 1.0]
+    square.leftEdge = juce::jlimit(0.0f, 1.0f, square.leftEdge);
+    square.topEdge = juce::jlimit(0.0f, 1.0f, square.topEdge);
+    square.width = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - square.leftEdge, square.width);
+    square.height = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - square.topEdge, square.height);
+    
+    // Clamp color ID to the channels in use
+    square.colorChannelId = juce::jlimit(0, numColorChannels - 1, square.colorChannelId);
+    
+    square.ratchet.count = juce::jlimit(1, Ratchet::MAX_COUNT, square.ratchet.count);
+    square.ratchet.velocityRamp = juce::jlimit(-1.0f, 1.0f, square.ratchet.velocityRamp);
+}
+
 std::vector<Square>::iterator PatternModel::findSquareById(uint32_t squareId)
 {
     return std::find_if(squares.begin(), squares.end(),
@@ -290,10 +601,10 @@ std::vector<Square>::iterator PatternModel::findSquareById(uint32_t squareId)
 
 void PatternModel::initializeDefaultColorConfigs()
 {
-    // Default waveform resolution
-    const int waveformResolution = 256;
+    // Every channel starts on the shared flat waveform
+    const PitchWaveform flatWaveform = PitchWaveform::flat(PitchWaveform::DEFAULT_RESOLUTION);
     
-    // Initialize 4 color channels with color-blind friendly metallic colors
+    // Initialize the first 4 color channels with color-blind friendly metallic colors
     
     // Channel 0: Copper/Rose Gold - warm metallic
     colorConfigs[0].midiChannel = 1;
@@ -301,7 +612,7 @@ void PatternModel::initializeDefaultColorConfigs()
     colorConfigs[0].lowNote = 48;   // C3
     colorConfigs[0].quantize = Q_1_16;
     colorConfigs[0].displayColor = juce::Colour(0xFFE8A87C);  // Copper/Rose Gold
-    colorConfigs[0].pitchWaveform.resize(waveformResolution, 0.0f);
+    colorConfigs[0].pitchWaveform = flatWaveform;
     
     // Channel 1: Steel Blue - cool metallic, high contrast with copper
     colorConfigs[1].midiChannel = 2;
@@ -309,7 +620,7 @@ void PatternModel::initializeDefaultColorConfigs()
     colorConfigs[1].lowNote = 48;   // C3
     colorConfigs[1].quantize = Q_1_16;
     colorConfigs[1].displayColor = juce::Colour(0xFF85C1E9);  // Steel Blue
-    colorConfigs[1].pitchWaveform.resize(waveformResolution, 0.0f);
+    colorConfigs[1].pitchWaveform = flatWaveform;
     
     // Channel 2: Deep Purple/Violet - distinct from blue, good saturation
     colorConfigs[2].midiChannel = 3;
@@ -317,7 +628,7 @@ void PatternModel::initializeDefaultColorConfigs()
     colorConfigs[2].lowNote = 48;   // C3
     colorConfigs[2].quantize = Q_1_16;
     colorConfigs[2].displayColor = juce::Colour(0xFFAF7AC5);  // Deep Purple
-    colorConfigs[2].pitchWaveform.resize(waveformResolution, 0.0f);
+    colorConfigs[2].pitchWaveform = flatWaveform;
     
     // Channel 3: Bright Cyan/Teal - high brightness, distinct from purple
     colorConfigs[3].midiChannel = 4;
@@ -325,7 +636,33 @@ void PatternModel::initializeDefaultColorConfigs()
     colorConfigs[3].lowNote = 48;   // C3
     colorConfigs[3].quantize = Q_1_16;
     colorConfigs[3].displayColor = juce::Colour(0xFF48C9B0);  // Bright Teal
-    colorConfigs[3].pitchWaveform.resize(waveformResolution, 0.0f);
+    colorConfigs[3].pitchWaveform = flatWaveform;
+    
+    // Channels 4-15: one per remaining MIDI channel, same pitch range and quantization
+    static const juce::uint32 extraColors[MAX_COLOR_CHANNELS - 4] = {
+        0xFFF4D03F,  // Gold
+        0xFFEC7063,  // Coral
+        0xFF5DADE2,  // Sky Blue
+        0xFF58D68D,  // Green
+        0xFFDC7633,  // Orange
+        0xFFBB8FCE,  // Lilac
+        0xFF45B39D,  // Jade
+        0xFFF5B7B1,  // Pink
+        0xFF7FB3D5,  // Slate
+        0xFFD4AC0D,  // Mustard
+        0xFFA569BD,  // Lavender
+        0xFF76D7C4   // Mint
+    };
+    
+    for (int i = 4; i < MAX_COLOR_CHANNELS; ++i)
+    {
+        colorConfigs[i].midiChannel = i + 1;
+        colorConfigs[i].highNote = 84;  // C6
+        colorConfigs[i].lowNote = 48;   // C3
+        colorConfigs[i].quantize = Q_1_16;
+        colorConfigs[i].displayColor = juce::Colour(extraColors[i - 4]);
+        colorConfigs[i].pitchWaveform = flatWaveform;
+    }
 }
 
 } // namespace SquareBeats
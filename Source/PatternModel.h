@@ -3,9 +3,11 @@
 #include <juce_core/juce_core.h>
 #include <juce_graphics/juce_graphics.h>
 #include "DataStructures.h"
+#include "PatternCommand.h"
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <atomic>
 
 namespace SquareBeats {
 
@@ -15,7 +17,8 @@ namespace SquareBeats {
  * 
  * This includes:
  * - All squares with their positions, sizes, and color assignments
- * - Color channel configurations (quantization, pitch range, MIDI channel)
+ * - Color channel configurations (quantization, pitch range, MIDI channel),
+ *   up to MAX_COLOR_CHANNELS of which getNumColorChannels() are in use
  * - Pitch sequencer waveform data
  * - Global settings (loop length, time signature)
  * 
@@ -23,6 +26,32 @@ namespace SquareBeats {
  */
 class PatternModel : public juce::ChangeBroadcaster {
 public:
+    //==============================================================================
+    /**
+     * Receives this model's edits as commands (see PatternSync)
+     * Called on the thread making the edit, after the model has changed.
+     */
+    class CommandSink {
+    public:
+        virtual ~CommandSink() = default;
+        
+        /**
+         * A square was added, changed or deleted, or a color channel cleared
+         */
+        virtual void squareCommand(const PatternCommand& command) = 0;
+        
+        /**
+         * Squares were appended to the end of the model in one go (addSquares())
+         */
+        virtual void squaresAdded(size_t count) = 0;
+        
+        /**
+         * An edit was announced (sendChangeMessage() or markEdited()); settings
+         * changed through the mutable getters are only visible from here
+         */
+        virtual void patternEdited() = 0;
+    };
+    
     //==============================================================================
     PatternModel();
     ~PatternModel() = default;
@@ -36,6 +65,14 @@ public:
      */
     Square* createSquare(float left, float top, float width, float height, int colorId);
     
+    /**
+     * Add many squares at once, clamped like createSquare() (their IDs are assigned here)
+     * Room is reserved once and listeners are notified once, so a generated
+     * pattern of tens of thousands of squares costs one change message and
+     * reaches playback as one copy of the model.
+     */
+    void addSquares(const std::vector<Square>& newSquares);
+    
     /**
      * Delete a square by its unique ID
      * @return true if square was found and deleted, false otherwise
@@ -54,6 +91,12 @@ public:
      */
     bool resizeSquare(uint32_t squareId, float newWidth, float newHeight);
     
+    /**
+     * Set how a square's note repeats (count and ramp are clamped)
+     * @return true if square was found, false otherwise
+     */
+    bool setSquareRatchet(uint32_t squareId, const Ratchet& ratchet);
+    
     /**
      * Remove all squares of a specific color channel
      */
@@ -68,6 +111,12 @@ public:
      */
     std::vector<Square*> getSquaresInTimeRange(float startTime, float endTime);
     
+    /**
+     * Append the squares whose time range intersects [startTime, endTime] to a list
+     * (which does not allocate while the list has room)
+     */
+    void getSquaresInTimeRange(float startTime, float endTime, std::vector<Square*>& result);
+    
     /**
      * Get all squares in the pattern
      */
@@ -78,6 +127,17 @@ public:
      */
     std::vector<const Square*> getAllSquares() const;
     
+    /**
+     * Get all squares in creation order, without building a pointer list
+     */
+    const std::vector<Square>& getSquares() const { return squares; }
+    
+    /**
+     * Get a square by its unique ID
+     * @return The square, or nullptr if there is none with this ID
+     */
+    const Square* getSquare(uint32_t squareId) const;
+    
     //==============================================================================
     // Color channel configuration
     
@@ -96,6 +156,27 @@ public:
      */
     void setColorConfig(int colorId, const ColorChannelConfig& config);
     
+    /**
+     * Publish a new pitch waveform for a color channel
+     * The previous envelope is kept alive here until no reader holds it, so the
+     * audio thread never releases the last reference.
+     * @param colorId Color channel ID (0 to MAX_COLOR_CHANNELS - 1)
+     * @param envelope New immutable waveform envelope (null clears the waveform)
+     */
+    void setPitchWaveform(int colorId, PitchWaveform::EnvelopePtr envelope);
+    
+    /**
+     * Set the number of color channels in use (1 to MAX_COLOR_CHANNELS)
+     * Squares on channels beyond the new count are kept, but neither played nor
+     * shown; raising the count again brings them back.
+     */
+    void setNumColorChannels(int numChannels);
+    
+    /**
+     * Get the number of color channels in use
+     */
+    int getNumColorChannels() const;
+    
     //==============================================================================
     // Pitch sequencer
     
@@ -141,6 +222,13 @@ public:
      */
     ScaleConfig getActiveScale(double positionBars) const;
     
+    /**
+     * Get the snapping table for the currently active scale
+     * Same selection as getActiveScale(), without rebuilding the scale per call
+     * @param positionBars Current playback position in bars
+     */
+    const ScaleNoteTable& getActiveNoteTable(double positionBars) const;
+    
     //==============================================================================
     // Global settings
     
@@ -175,28 +263,108 @@ public:
      */
     const ScaleConfig& getScaleConfig() const;
     
+    //==============================================================================
+    // Change tracking
+    
+    /**
+     * Notify listeners that the pattern changed, and advance the edit version
+     * Hides ChangeBroadcaster::sendChangeMessage(), so edits made through the
+     * mutable getters are counted when their caller announces them.
+     */
+    void sendChangeMessage();
+    
+    /**
+     * Advance the edit version without notifying listeners
+     * For continuous edits (e.g. XY pad drags) that skip change messages.
+     */
+    void markEdited();
+    
+    /**
+     * Get the edit version
+     * Increases with every change to the pattern, so an unchanged version means
+     * a previously saved state is still current. Safe to read from any thread.
+     */
+    uint64_t getEditVersion() const;
+    
+    //==============================================================================
+    // Commands
+    
+    /**
+     * Send this model's edits to a sink (nullptr to stop)
+     */
+    void setCommandSink(CommandSink* sink);
+    
+    /**
+     * Make this model an exact copy of another, including square IDs
+     * Listeners and the edit version are not copied. Reserves room for
+     * squareCapacity squares, so that many can be added by commands without
+     * allocating.
+     */
+    void copyFrom(const PatternModel& other, size_t squareCapacity);
+    
+    /**
+     * Get the number of squares this model can hold without allocating
+     */
+    size_t getSquareCapacity() const { return squares.capacity(); }
+    
+    /**
+     * Apply a command to this model (audio thread, on a playback copy)
+     * Nothing is validated, broadcast or allocated, provided the model was
+     * prepared with copyFrom() and the sender respects getSquareCapacity().
+     * REPLACE_PATTERN is handled by the engine and ignored here.
+     */
+    void applyCommand(const PatternCommand& command);
+    
+    /**
+     * Set one automated setting in place (audio thread, on a playback copy)
+     * Like applyCommand(), nothing is broadcast or allocated; the value is clamped to the setting's range.
+     */
+    void applyAutomation(const AutomationChange& change);
+
 private:
     //==============================================================================
     // Data members
     std::vector<Square> squares;
-    std::array<ColorChannelConfig, 4> colorConfigs;
+    std::array<ColorChannelConfig, MAX_COLOR_CHANNELS> colorConfigs;
+    int numColorChannels;
     PitchSequencer pitchSequencer;
     PlayModeConfig playModeConfig;
     ScaleSequencerConfig scaleSequencer;
     ScaleConfig scaleConfig;
+    ScaleNoteTable scaleNoteTable;  // Snapping table for scaleConfig
     double loopLengthBars;
     TimeSignature timeSignature;
     uint32_t nextUniqueId;
+    std::atomic<uint64_t> editVersion;
+    CommandSink* commandSink = nullptr;
+    
+    // Replaced pitch waveform envelopes, freed once nothing else references them
+    std::vector<PitchWaveform::EnvelopePtr> retiredPitchWaveforms;
     
     //==============================================================================
     // Helper methods
     
+    /**
+     * Hold a replaced waveform envelope and free retired envelopes no longer in use
+     */
+    void retirePitchWaveform(PitchWaveform::EnvelopePtr envelope);
+    
     /**
      * Find a square by its unique ID
      * @return Iterator to the square, or squares.end() if not found
      */
     std::vector<Square>::iterator findSquareById(uint32_t squareId);
     
+    /**
+     * Clamp a square to the plane, the minimum size and the channels in use
+     */
+    void clampSquare(Square& square) const;
+    
+    /**
+     * Send a square command to the sink, if there is one
+     */
+    void sendSquareCommand(PatternCommand::Type type, const Square& square);
+    
     /**
      * Initialize default color channel configurations
      */
@@ -1,4 +1,10 @@
 #include "PatternModel.h"
+#include "PatternGenerator.h"
+#include "MidiFileImporter.h"
+#include "StateManager.h"
+#include "ConversionUtils.h"
+#include "WaveformMipmap.h"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
@@ -391,6 +397,360 @@ void testLoopLengthDecreaseBoundaryCase()
     std::cout << "✓ Loop length decrease boundary case test passed\n";
 }
 
+void testScaleSequencerLookup()
+{
+    PatternModel model;
+    
+    auto& scaleSeq = model.getScaleSequencer();
+    scaleSeq.enabled = true;
+    scaleSeq.segments.clear();
+    scaleSeq.segments.push_back(ScaleSequenceSegment(ROOT_C, SCALE_MAJOR, 2));
+    scaleSeq.segments.push_back(ScaleSequenceSegment(ROOT_A, SCALE_NATURAL_MINOR, 1));
+    scaleSeq.segments.push_back(ScaleSequenceSegment(ROOT_D, SCALE_DORIAN, 3));
+    scaleSeq.rebuildLookup();
+    
+    // Segment boundaries: [0,2) [2,3) [3,6), wrapping every 6 bars
+    assert(scaleSeq.getSegmentIndexAtPosition(0.0) == 0);
+    assert(scaleSeq.getSegmentIndexAtPosition(1.99) == 0);
+    assert(scaleSeq.getSegmentIndexAtPosition(2.0) == 1);
+    assert(scaleSeq.getSegmentIndexAtPosition(2.5) == 1);
+    assert(scaleSeq.getSegmentIndexAtPosition(3.0) == 2);
+    assert(scaleSeq.getSegmentIndexAtPosition(5.99) == 2);
+    assert(scaleSeq.getSegmentIndexAtPosition(6.0) == 0);
+    assert(scaleSeq.getSegmentIndexAtPosition(8.25) == 1);
+    
+    ScaleConfig active = model.getActiveScale(14.5);  // 14.5 mod 6 = 2.5
+    assert(active.rootNote == ROOT_A);
+    assert(active.scaleType == SCALE_NATURAL_MINOR);
+    
+    // Note tables snap exactly like the scale they were built from
+    for (double bar = 0.0; bar < 12.0; bar += 0.5)
+    {
+        ScaleConfig scale = model.getActiveScale(bar);
+        const ScaleNoteTable& table = model.getActiveNoteTable(bar);
+        for (int note = 0; note < 128; ++note)
+            assert(table.snap(note) == scale.snapToScale(note));
+    }
+    
+    // Edits take effect after a rebuild
+    scaleSeq.segments[0].lengthBars = 4;
+    scaleSeq.rebuildLookup();
+    assert(scaleSeq.getSegmentIndexAtPosition(3.0) == 0);
+    assert(scaleSeq.getSegmentIndexAtPosition(4.0) == 1);
+    
+    // Disabled sequencer falls back to the global scale
+    scaleSeq.enabled = false;
+    model.setScaleConfig(ScaleConfig(ROOT_E, SCALE_PENTATONIC_MINOR));
+    assert(model.getActiveNoteTable(3.0).snap(61) == ScaleConfig(ROOT_E, SCALE_PENTATONIC_MINOR).snapToScale(61));
+    
+    std::cout << "✓ Scale sequencer lookup test passed\n";
+}
+
+void testPitchWaveformSharing()
+{
+    PatternModel model;
+    
+    // Untouched channels share one flat envelope
+    auto flat0 = model.getColorConfig(0).pitchWaveform.getEnvelope();
+    auto flat1 = model.getColorConfig(1).pitchWaveform.getEnvelope();
+    assert(flat0 != nullptr && flat0 == flat1);
+    assert(flat0->getResolution() == PitchWaveform::DEFAULT_RESOLUTION);
+    
+    // Changing other settings shares the waveform instead of copying it
+    ColorChannelConfig config = model.getColorConfig(0);
+    config.highNote = 96;
+    model.setColorConfig(0, config);
+    assert(model.getColorConfig(0).pitchWaveform.getEnvelope() == flat0);
+    
+    // Publishing a new waveform leaves snapshots already taken untouched
+    auto snapshot = model.getColorConfig(0).pitchWaveform.getEnvelope();
+    model.setPitchWaveform(0, std::make_shared<const PitchEnvelope>(PitchEnvelope::fromSamples({ 0.0f, 12.0f })));
+    assert(snapshot->getResolution() == PitchWaveform::DEFAULT_RESOLUTION);
+    assert(snapshot->getSample(1) == 0.0f);
+    assert(model.getColorConfig(0).pitchWaveform.size() == 2);
+    assert(std::abs(model.getColorConfig(0).getPitchOffsetAt(0.5) - 6.0f) < 0.01f);
+    assert(model.getColorConfig(1).pitchWaveform.getEnvelope() == flat1);
+    
+    // Clearing publishes an empty waveform
+    model.setPitchWaveform(0, nullptr);
+    assert(model.getColorConfig(0).pitchWaveform.empty());
+    assert(model.getColorConfig(0).getPitchOffsetAt(0.5) == 0.0f);
+    assert(model.getColorConfig(0).pitchWaveform.get() == nullptr);
+    assert(model.getColorConfig(0).pitchWaveform[0] == 0.0f);
+    
+    std::cout << "✓ Pitch waveform sharing test passed\n";
+}
+
+void testPitchEnvelope()
+{
+    // Dense samples convert losslessly, and flat runs collapse to their ends
+    std::vector<float> samples(1024, 0.0f);
+    for (int i = 300; i < 340; ++i)
+    {
+        samples[i] = std::sin(i * 0.37f) * 7.0f;
+    }
+    for (int i = 600; i < 800; ++i)
+    {
+        samples[i] = -3.25f;
+    }
+    
+    PitchEnvelope envelope = PitchEnvelope::fromSamples(samples);
+    assert(envelope.getResolution() == 1024);
+    assert(envelope.getBreakpoints().size() < 60);
+    assert(envelope.toSamples() == samples);
+    for (int i = 0; i < 1024; ++i)
+    {
+        assert(envelope.getSample(i) == samples[i]);
+    }
+    
+    // Evaluation matches interpolating the dense samples directly
+    for (int step = 0; step <= 5000; ++step)
+    {
+        double position = step / 5000.0;
+        double indexFloat = (position - std::floor(position)) * (samples.size() - 1);
+        int index0 = static_cast<int>(std::floor(indexFloat));
+        int index1 = std::min(index0 + 1, static_cast<int>(samples.size() - 1));
+        float t = static_cast<float>(indexFloat - index0);
+        float dense = samples[index0] * (1.0f - t) + samples[index1] * t;
+        assert(std::abs(envelope.getValueAt(position) - dense) < 1.0e-5f);
+    }
+    
+    // A flat envelope is two breakpoints at any resolution
+    PitchEnvelope flat = PitchEnvelope::flat(64 * 1024 + 1);
+    assert(flat.getBreakpoints().size() == 2);
+    assert(flat.isFlat());
+    
+    // A ramp edit changes only its own grid points and adds a handful of breakpoints
+    PitchEnvelope ramp = flat.withRamp(2000, 6.0f, 1000, -6.0f);
+    assert(ramp.getBreakpoints().size() == 6);
+    assert(ramp.getSample(999) == 0.0f);
+    assert(ramp.getSample(1000) == -6.0f);
+    assert(std::abs(ramp.getSample(1500)) < 1.0e-5f);
+    assert(ramp.getSample(2000) == 6.0f);
+    assert(ramp.getSample(2001) == 0.0f);
+    assert(!ramp.isFlat());
+    
+    // Refining the grid keeps the curve's shape
+    PitchEnvelope coarse = PitchEnvelope::fromSamples({ 0.0f, 4.0f, -2.0f });
+    PitchEnvelope fine = coarse.withResolution(1000);
+    assert(fine.getResolution() >= 1000);
+    assert((fine.getResolution() - 1) % 2 == 0);
+    for (int step = 0; step <= 100; ++step)
+    {
+        double position = step / 100.0;
+        assert(std::abs(fine.getValueAt(position) - coarse.getValueAt(position)) < 1.0e-5f);
+    }
+    
+    std::cout << "✓ Pitch envelope test passed\n";
+}
+
+void testWaveformMipmap()
+{
+    std::vector<float> samples(1000);
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        samples[i] = std::sin(i * 0.11f) * 9.0f + std::sin(i * 1.7f);
+    }
+    
+    WaveformMipmap mipmap(PitchEnvelope::fromSamples(samples));
+    assert(mipmap.getNumSamples() == 1000);
+    
+    // Every range query matches a linear scan, including odd-sized and unaligned ranges
+    const int starts[] = { 0, 1, 7, 255, 256, 511, 998, 999 };
+    const int lengths[] = { 0, 1, 2, 3, 16, 100, 333, 1000 };
+    for (int start : starts)
+    {
+        for (int length : lengths)
+        {
+            int end = std::min(start + length, 999);
+            float expectedMin = samples[start];
+            float expectedMax = samples[start];
+            for (int i = start; i <= end; ++i)
+            {
+                expectedMin = std::min(expectedMin, samples[i]);
+                expectedMax = std::max(expectedMax, samples[i]);
+            }
+            
+            WaveformMipmap::Range range = mipmap.getRange(start, end);
+            assert(range.min == expectedMin);
+            assert(range.max == expectedMax);
+        }
+    }
+    
+    // Out-of-range indices are clamped to the grid
+    WaveformMipmap::Range whole = mipmap.getRange(-10, 5000);
+    assert(whole.min == *std::min_element(samples.begin(), samples.end()));
+    assert(whole.max == *std::max_element(samples.begin(), samples.end()));
+    
+    // An empty mipmap reports a zero range
+    WaveformMipmap empty;
+    assert(empty.getNumSamples() == 0);
+    assert(empty.getRange(0, 10).min == 0.0f);
+    
+    std::cout << "✓ Waveform mipmap test passed\n";
+}
+
+void testEditVersion()
+{
+    PatternModel model;
+    uint64_t version = model.getEditVersion();
+    
+    // Every setter advances the version
+    Square* square = model.createSquare(0.1f, 0.1f, 0.2f, 0.2f, 0);
+    uint32_t squareId = square->uniqueId;
+    assert(model.getEditVersion() > version);
+    version = model.getEditVersion();
+    
+    model.moveSquare(squareId, 0.3f, 0.3f);
+    assert(model.getEditVersion() > version);
+    version = model.getEditVersion();
+    
+    model.setLoopLength(4);
+    assert(model.getEditVersion() > version);
+    version = model.getEditVersion();
+    
+    // Failed edits and reads leave it alone
+    assert(!model.deleteSquare(9999));
+    model.getAllSquares();
+    model.getColorConfig(0);
+    assert(model.getEditVersion() == version);
+    
+    // Direct edits count once announced, or once marked when no message is wanted
+    model.getPlayModeConfig().mode = PLAY_PENDULUM;
+    model.sendChangeMessage();
+    assert(model.getEditVersion() > version);
+    version = model.getEditVersion();
+    
+    model.getPlayModeConfig().probability = 0.25f;
+    model.markEdited();
+    assert(model.getEditVersion() > version);
+    
+    std::cout << "✓ Edit version test passed\n";
+}
+
+void testBulkInsertAndGenerators()
+{
+    // Tresillo: 3 pulses over 8 steps land on steps 0, 3 and 6; rotated by 1, on 1, 4 and 7
+    std::vector<Square> squares;
+    PatternGenerator::euclidean(squares, 0, 3, 8, 0, 0.5f, 100);
+    assert(squares.size() == 3);
+    assert(squares[1].leftEdge == 3.0f / 8.0f && squares[2].leftEdge == 6.0f / 8.0f);
+    PatternGenerator::euclidean(squares, 1, 3, 8, 1, 0.5f, 100);
+    assert(squares.size() == 6 && squares[3].leftEdge == 1.0f / 8.0f && squares[5].leftEdge == 7.0f / 8.0f);
+    
+    // Operations only touch the squares from the given index on
+    PatternGenerator::mirrorTime(squares, 3);
+    assert(squares[0].leftEdge == 0.0f);
+    assert(std::abs(squares[5].leftEdge - (1.0f - squares[5].width - 7.0f / 8.0f)) < 1.0e-6f);
+    PatternGenerator::rotate(squares, 0.25f);
+    assert(squares[0].leftEdge == 0.25f && squares[2].leftEdge == 0.0f);
+    
+    // A dense field: one announcement and fresh IDs for tens of thousands of squares
+    juce::Random random(1);
+    std::vector<Square> field;
+    PatternGenerator::probabilityField(field, 2, 256, 256, [](float, float) { return 0.8f; }, 90, random);
+    assert(field.size() > 50000);
+    
+    PatternModel model;
+    model.createSquare(0.0f, 0.0f, 0.1f, 0.1f, 0);
+    uint64_t version = model.getEditVersion();
+    model.addSquares(field);
+    assert(model.getEditVersion() == version + 1);
+    assert(model.getSquares().size() == field.size() + 1);
+    assert(model.getSquares().back().uniqueId == field.size() + 1);
+    assert(model.getSquares().back().colorChannelId == 2);
+    
+    // Bulk squares are clamped like created ones
+    Square outside(0.95f, -0.5f, 0.5f, 0.2f, 99, 0);
+    model.addSquares({ outside });
+    const Square& clamped = model.getSquares().back();
+    assert(clamped.topEdge == 0.0f && clamped.getRightEdge() <= 1.0f);
+    assert(clamped.colorChannelId == model.getNumColorChannels() - 1);
+    
+    std::cout << "✓ Bulk insert and generators test passed\n";
+}
+
+void testMidiFileImport()
+{
+    // A type 1 file at 96 ticks per beat: a tempo track in 3/4, a chord-less melody on
+    // channel 1 (with running status and a system exclusive message) and a drum hit
+    std::vector<unsigned char> file { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 3, 0, 96 };
+    auto addChunk = [&file](const char* id, std::vector<unsigned char> data)
+    {
+        file.insert(file.end(), id, id + 4);
+        for (int shift = 24; shift >= 0; shift -= 8)
+            file.push_back(static_cast<unsigned char>(data.size() >> shift));
+        file.insert(file.end(), data.begin(), data.end());
+    };
+    addChunk("MTrk", { 0x00, 0xFF, 0x58, 0x04, 0x03, 0x02, 0x18, 0x08, 0x00, 0xFF, 0x2F, 0x00 });
+    addChunk("MTrk", { 0x00, 0x90, 60, 64,                   // C4 from beat 0...
+                       0x00, 0xF0, 0x03, 0x7E, 0x7F, 0xF7,
+                       0x60, 0x90, 60, 0,                    // ...to beat 1
+                       0x00, 72, 64,                         // C5 from beat 1 (running status)...
+                       0x30, 0x80, 72, 0,                    // ...to beat 1.5
+                       0x00, 0x90, 48, 80,                   // C3, held until the track ends at beat 2
+                       0x30, 0xFF, 0x2F, 0x00 });
+    addChunk("XFIH", { 1, 2, 3 });
+    addChunk("MTrk", { 0x00, 0xC9, 0x05,
+                       0x85, 0x20, 0x99, 36, 100,            // Kick on beat 7...
+                       0x60, 0x89, 36, 0,                    // ...to beat 8
+                       0x00, 0xFF, 0x2F, 0x00 });
+    
+    PatternModel model;
+    model.createSquare(0.5f, 0.5f, 0.1f, 0.1f, 0);
+    
+    MidiFileImporter::Result result;
+    juce::MemoryInputStream stream(file.data(), file.size(), false);
+    assert(MidiFileImporter::importStream(stream, model, MidiFileImporter::COLORS_AUTO, result));
+    assert(result.numSquares == 4 && result.numColors == 2 && result.numSkippedNotes == 0);
+    
+    // 8 beats of 3/4 fit into 3 bars of it, a loop of 2.25 bars of 4/4; the earlier square is gone
+    assert(model.getTimeSignature().numerator == 4 && model.getLoopLength() == 2.25);
+    const std::vector<Square>& squares = model.getSquares();
+    assert(squares.size() == 4);
+    
+    const ColorChannelConfig& config = model.getColorConfig(0);
+    const Square& first = squares[0];
+    assert(first.colorChannelId == 0 && first.leftEdge == 0.0f);
+    assert(std::abs(first.width - 1.0f / 9.0f) < 1.0e-6f);
+    assert(std::abs(first.topEdge + first.height * 0.5f - mapNoteToVerticalPosition(60, config.highNote, config.lowNote)) < 1.0e-6f);
+    assert(mapHeightToVelocity(first.height) == 64);
+    assert(std::abs(squares[2].getRightEdge() - 2.0f / 9.0f) < 1.0e-6f);
+    
+    // The second track with notes is the second color
+    assert(squares[3].colorChannelId == 1);
+    assert(std::abs(squares[3].leftEdge - 7.0f / 9.0f) < 1.0e-6f);
+    
+    // Saved and loaded (as the command-line tool's presets are), the notes keep their timing
+    juce::MemoryBlock state;
+    StateManager::saveState(model, state);
+    PatternModel reloaded;
+    assert(StateManager::loadState(reloaded, state.getData(), static_cast<int>(state.getSize())));
+    assert(reloaded.getLoopLength() == 2.25);
+    assert(reloaded.getSquares().size() == squares.size());
+    const float tolerance = 1.0f / StateManager::COORDINATE_STEPS;
+    for (const Square& square : squares)
+    {
+        const auto& loaded = reloaded.getSquares();
+        const bool found = std::any_of(loaded.begin(), loaded.end(), [&square, tolerance](const Square& other)
+        {
+            return other.colorChannelId == square.colorChannelId
+                && std::abs(other.leftEdge - square.leftEdge) <= tolerance
+                && std::abs(other.width - square.width) <= tolerance
+                && std::abs(other.topEdge - square.topEdge) <= tolerance;
+        });
+        assert(found);
+    }
+    
+    // A file cut short leaves the pattern alone
+    file.resize(file.size() - 5);
+    juce::MemoryInputStream truncated(file.data(), file.size(), false);
+    assert(!MidiFileImporter::importStream(truncated, model, MidiFileImporter::COLORS_BY_CHANNEL, result));
+    assert(model.getSquares().size() == 4);
+    
+    std::cout << "✓ MIDI file import test passed\n";
+}
+
 int main()
 {
     std::cout << "Running PatternModel unit tests...\n\n";
@@ -411,6 +771,13 @@ int main()
         testLoopLengthChangePreservesSquares();
         testLoopLengthIncreasePreservesAllSquares();
         testLoopLengthDecreaseBoundaryCase();
+        testScaleSequencerLookup();
+        testPitchWaveformSharing();
+        testPitchEnvelope();
+        testWaveformMipmap();
+        testEditVersion();
+        testBulkInsertAndGenerators();
+        testMidiFileImport();
         
         std::cout << "\n✓ All tests passed!\n";
         return 0;
@@ -0,0 +1,130 @@
+#include "PatternSlots.h"
+#include "StateManager.h"
+
+namespace SquareBeats {
+
+//==============================================================================
+PatternSlots::PatternSlots()
+{
+    for (auto& model : publishedModels)
+    {
+        model.store(nullptr);
+    }
+}
+
+//==============================================================================
+PatternModel* PatternSlots::getSlotModel(int slot) const
+{
+    if (!isValidSlot(slot))
+        return nullptr;
+    
+    return publishedModels[static_cast<size_t>(slot)].load(std::memory_order_acquire);
+}
+
+int PatternSlots::findSlot(const PatternModel* model) const
+{
+    if (model == nullptr)
+        return NO_SLOT;
+    
+    for (int slot = 0; slot < NUM_SLOTS; ++slot)
+    {
+        if (getSlotModel(slot) == model)
+            return slot;
+    }
+    return NO_SLOT;
+}
+
+//==============================================================================
+std::unique_ptr<PatternModel> PatternSlots::storeSlot(int slot, const PatternModel& source)
+{
+    if (!isValidSlot(slot))
+        return nullptr;
+    
+    juce::MemoryBlock state;
+    StateManager::saveState(source, state);
+    
+    // The slot plays from its own loaded copy, so later edits to the source do not leak in
+    auto model = std::make_unique<PatternModel>();
+    if (!StateManager::loadState(*model, state.getData(), static_cast<int>(state.getSize())))
+    {
+        juce::Logger::writeToLog("PatternSlots: Failed to store slot " + juce::String(slot + 1));
+        return nullptr;
+    }
+    
+    return replaceSlot(slot, std::move(model), std::move(state));
+}
+
+std::unique_ptr<PatternModel> PatternSlots::restoreSlot(int slot, const juce::MemoryBlock& state)
+{
+    if (!isValidSlot(slot))
+        return nullptr;
+    
+    if (state.isEmpty())
+        return clearSlot(slot);
+    
+    auto model = std::make_unique<PatternModel>();
+    if (!StateManager::loadState(*model, state.getData(), static_cast<int>(state.getSize())))
+    {
+        juce::Logger::writeToLog("PatternSlots: Failed to restore slot " + juce::String(slot + 1));
+        return clearSlot(slot);
+    }
+    
+    return replaceSlot(slot, std::move(model), state);
+}
+
+std::unique_ptr<PatternModel> PatternSlots::clearSlot(int slot)
+{
+    if (!isValidSlot(slot))
+        return nullptr;
+    
+    if (activeSlot.load() == slot)
+        setActiveSlot(NO_SLOT);
+    
+    return replaceSlot(slot, nullptr, juce::MemoryBlock());
+}
+
+std::unique_ptr<PatternModel> PatternSlots::replaceSlot(int slot, std::unique_ptr<PatternModel> model,
+                                                        juce::MemoryBlock state)
+{
+    Slot& target = slots[static_cast<size_t>(slot)];
+    
+    // Publish the new model before handing the old one back
+    publishedModels[static_cast<size_t>(slot)].store(model.get(), std::memory_order_release);
+    std::swap(target.model, model);
+    target.state = std::move(state);
+    ++version;
+    
+    return model;
+}
+
+//==============================================================================
+bool PatternSlots::loadSlotInto(int slot, PatternModel& target) const
+{
+    const juce::MemoryBlock& state = getSlotState(slot);
+    if (state.isEmpty())
+        return false;
+    
+    return StateManager::loadState(target, state.getData(), static_cast<int>(state.getSize()));
+}
+
+const juce::MemoryBlock& PatternSlots::getSlotState(int slot) const
+{
+    static const juce::MemoryBlock emptyState;
+    return isValidSlot(slot) ? slots[static_cast<size_t>(slot)].state : emptyState;
+}
+
+int PatternSlots::getNumSquares(int slot) const
+{
+    if (!isValidSlot(slot) || slots[static_cast<size_t>(slot)].model == nullptr)
+        return 0;
+    
+    return static_cast<int>(slots[static_cast<size_t>(slot)].model->getSquares().size());
+}
+
+void PatternSlots::setActiveSlot(int slot)
+{
+    activeSlot.store(isValidSlot(slot) ? slot : NO_SLOT);
+    ++version;
+}
+
+} // namespace SquareBeats
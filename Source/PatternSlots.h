@@ -0,0 +1,133 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "PatternModel.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * PatternSlots holds a bank of patterns that can be launched during playback
+ *
+ * Each filled slot keeps its pattern twice: as a fully loaded PatternModel,
+ * ready for PlaybackEngine::schedulePatternSwitch(), and as its compact saved
+ * state, used for plugin state and for copying the slot into the live model.
+ * Empty slots hold nothing, so memory grows with the squares actually stored.
+ *
+ * The live model (the one the editor works on) is the working copy of the
+ * active slot; it is stored back into that slot before another one is loaded.
+ *
+ * Slot contents are changed on the message thread only. The audio thread may
+ * look up slot models (to launch a slot from a MIDI note), so a model replaced
+ * here is handed back to the caller, who must keep it alive until the audio
+ * thread has let go of it.
+ */
+class PatternSlots
+{
+public:
+    static constexpr int NUM_SLOTS = 8;
+    static constexpr int NO_SLOT = -1;
+    
+    PatternSlots();
+    ~PatternSlots() = default;
+    
+    //==============================================================================
+    // Any thread
+    
+    /**
+     * Get the pattern model of a slot, or nullptr if the slot is empty or out of range
+     */
+    PatternModel* getSlotModel(int slot) const;
+    
+    /**
+     * Check whether a slot holds no pattern
+     */
+    bool isSlotEmpty(int slot) const { return getSlotModel(slot) == nullptr; }
+    
+    /**
+     * Find the slot a pattern model belongs to
+     * @return The slot index, or NO_SLOT
+     */
+    int findSlot(const PatternModel* model) const;
+    
+    /**
+     * Get the slot whose pattern is loaded into the live model, or NO_SLOT
+     */
+    int getActiveSlot() const { return activeSlot.load(); }
+    
+    /**
+     * Get a counter that changes whenever a slot or the active slot changes
+     */
+    uint64_t getVersion() const { return version.load(); }
+    
+    //==============================================================================
+    // Message thread
+    
+    /**
+     * Store a copy of a pattern in a slot
+     * @return The slot's previous model (may still be playing), or nullptr
+     */
+    std::unique_ptr<PatternModel> storeSlot(int slot, const PatternModel& source);
+    
+    /**
+     * Fill a slot from saved pattern state (as written by StateManager::saveState)
+     * @return The slot's previous model (may still be playing), or nullptr
+     */
+    std::unique_ptr<PatternModel> restoreSlot(int slot, const juce::MemoryBlock& state);
+    
+    /**
+     * Empty a slot
+     * @return The slot's previous model (may still be playing), or nullptr
+     */
+    std::unique_ptr<PatternModel> clearSlot(int slot);
+    
+    /**
+     * Load a slot's pattern into another model (normally the live model)
+     * @return false if the slot is empty or its state could not be loaded
+     */
+    bool loadSlotInto(int slot, PatternModel& target) const;
+    
+    /**
+     * Get a slot's saved state (empty for an empty slot)
+     */
+    const juce::MemoryBlock& getSlotState(int slot) const;
+    
+    /**
+     * Get the number of squares in a slot's pattern (0 for an empty slot)
+     */
+    int getNumSquares(int slot) const;
+    
+    /**
+     * Set the slot whose pattern is loaded into the live model (NO_SLOT for none)
+     */
+    void setActiveSlot(int slot);
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<PatternModel> model;  // Loaded pattern, ready to play
+        juce::MemoryBlock state;              // The same pattern as saved state
+    };
+    
+    std::array<Slot, NUM_SLOTS> slots;
+    
+    // Copies of slots[i].model.get(), for lookups from the audio thread
+    std::array<std::atomic<PatternModel*>, NUM_SLOTS> publishedModels;
+    
+    std::atomic<int> activeSlot { NO_SLOT };
+    std::atomic<uint64_t> version { 0 };
+    
+    static bool isValidSlot(int slot) { return slot >= 0 && slot < NUM_SLOTS; }
+    
+    /**
+     * Replace a slot's contents and publish its new model
+     */
+    std::unique_ptr<PatternModel> replaceSlot(int slot, std::unique_ptr<PatternModel> model, juce::MemoryBlock state);
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatternSlots)
+};
+
+} // namespace SquareBeats
@@ -0,0 +1,150 @@
+#include "PatternSlotsComponent.h"
+#include "AppFont.h"
+
+namespace SquareBeats {
+
+//==============================================================================
+PatternSlotsComponent::PatternSlotsComponent(const PatternSlots& slots)
+    : patternSlots(slots)
+{
+    // Launch quantization (ids are SwitchQuantize + 1)
+    quantizeCombo.addItem("Now", SWITCH_IMMEDIATE + 1);
+    quantizeCombo.addItem("Beat", SWITCH_NEXT_BEAT + 1);
+    quantizeCombo.addItem("Bar", SWITCH_NEXT_BAR + 1);
+    quantizeCombo.addItem("Loop", SWITCH_NEXT_LOOP + 1);
+    quantizeCombo.setSelectedId(SWITCH_NEXT_BAR + 1, juce::dontSendNotification);
+    quantizeCombo.setTooltip("When a slot launched during playback takes over");
+    quantizeCombo.onChange = [this]()
+    {
+        if (onQuantizeChanged)
+            onQuantizeChanged(static_cast<SwitchQuantize>(quantizeCombo.getSelectedId() - 1));
+    };
+    addAndMakeVisible(quantizeCombo);
+    
+    shownVersion = patternSlots.getVersion();
+}
+
+PatternSlotsComponent::~PatternSlotsComponent()
+{
+}
+
+//==============================================================================
+void PatternSlotsComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xff2a2a2a));
+    
+    const juce::Colour activeColour(0xff4488ff);
+    const int activeSlot = patternSlots.getActiveSlot();
+    
+    for (int slot = 0; slot < PatternSlots::NUM_SLOTS; ++slot)
+    {
+        auto bounds = getSlotBounds(slot).toFloat();
+        const bool isEmpty = patternSlots.isSlotEmpty(slot);
+        
+        if (slot == activeSlot)
+            g.setColour(activeColour);
+        else
+            g.setColour(isEmpty ? juce::Colour(0xff1a1a1a) : juce::Colour(0xff444444));
+        g.fillRoundedRectangle(bounds, 3.0f);
+        
+        // Queued slots are outlined until their launch boundary
+        if (slot == shownQueuedSlot)
+        {
+            g.setColour(activeColour);
+            g.drawRoundedRectangle(bounds.reduced(1.0f), 3.0f, 2.0f);
+        }
+        
+        g.setColour(isEmpty ? juce::Colour(0xff555555) : juce::Colours::white);
+        slotNumberTexts[static_cast<size_t>(slot)].draw(g, juce::String(slot + 1), AppFont::tiny(*fonts), bounds,
+                                                        juce::Justification::centred);
+    }
+}
+
+void PatternSlotsComponent::resized()
+{
+    auto bounds = getLocalBounds().reduced(5, 2);
+    
+    // Quantize selector on the right, slot buttons fill the rest
+    quantizeCombo.setBounds(bounds.removeFromRight(70));
+    bounds.removeFromRight(5);
+    slotArea = bounds;
+}
+
+void PatternSlotsComponent::mouseDown(const juce::MouseEvent& event)
+{
+    const int slot = getSlotAt(event.getPosition());
+    if (slot == PatternSlots::NO_SLOT)
+        return;
+    
+    if (event.mods.isPopupMenu())
+    {
+        showSlotMenu(slot);
+    }
+    else if (patternSlots.isSlotEmpty(slot))
+    {
+        if (onStore)
+            onStore(slot);
+    }
+    else if (onLaunch)
+    {
+        onLaunch(slot);
+    }
+}
+
+//==============================================================================
+void PatternSlotsComponent::refresh(int queuedSlot)
+{
+    const uint64_t version = patternSlots.getVersion();
+    if (version == shownVersion && queuedSlot == shownQueuedSlot)
+        return;
+    
+    shownVersion = version;
+    shownQueuedSlot = queuedSlot;
+    repaint(slotArea);
+}
+
+void PatternSlotsComponent::setLaunchQuantize(SwitchQuantize quantize)
+{
+    quantizeCombo.setSelectedId(quantize + 1, juce::dontSendNotification);
+}
+
+//==============================================================================
+juce::Rectangle<int> PatternSlotsComponent::getSlotBounds(int slot) const
+{
+    const int gap = 3;
+    const int slotWidth = (slotArea.getWidth() - gap * (PatternSlots::NUM_SLOTS - 1)) / PatternSlots::NUM_SLOTS;
+    return { slotArea.getX() + slot * (slotWidth + gap), slotArea.getY(), slotWidth, slotArea.getHeight() };
+}
+
+int PatternSlotsComponent::getSlotAt(juce::Point<int> position) const
+{
+    for (int slot = 0; slot < PatternSlots::NUM_SLOTS; ++slot)
+    {
+        if (getSlotBounds(slot).contains(position))
+            return slot;
+    }
+    return PatternSlots::NO_SLOT;
+}
+
+void PatternSlotsComponent::showSlotMenu(int slot)
+{
+    juce::PopupMenu menu;
+    menu.addItem(1, "Store Current Pattern");
+    menu.addItem(2, "Clear Slot", !patternSlots.isSlotEmpty(slot));
+    
+    // The menu can outlive the editor, so check the component is still there
+    juce::Component::SafePointer<PatternSlotsComponent> safeThis(this);
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this),
+                       [safeThis, slot](int result)
+                       {
+                           if (safeThis == nullptr)
+                               return;
+                           
+                           if (result == 1 && safeThis->onStore)
+                               safeThis->onStore(slot);
+                           else if (result == 2 && safeThis->onClear)
+                               safeThis->onClear(slot);
+                       });
+}
+
+} // namespace SquareBeats
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "PatternSlots.h"
+#include "AppFont.h"
+#include <array>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * PatternSlotsComponent - Row of pattern slot buttons with a launch quantize selector
+ * 
+ * - Click a filled slot to launch it
+ * - Click an empty slot to store the current pattern in it
+ * - Right-click a slot to store into it or clear it
+ * 
+ * The active slot is highlighted, and a slot waiting for its launch boundary
+ * is outlined. The owner calls refresh() from its timer to pick up changes.
+ */
+class PatternSlotsComponent : public juce::Component
+{
+public:
+    //==============================================================================
+    PatternSlotsComponent(const PatternSlots& slots);
+    ~PatternSlotsComponent() override;
+    
+    //==============================================================================
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    void mouseDown(const juce::MouseEvent& event) override;
+    
+    //==============================================================================
+    /**
+     * Repaint if the slots or the queued slot changed since the last call
+     * @param queuedSlot Slot waiting for its launch boundary, or PatternSlots::NO_SLOT
+     */
+    void refresh(int queuedSlot);
+    
+    /**
+     * Show the launch quantization without notifying onQuantizeChanged
+     */
+    void setLaunchQuantize(SwitchQuantize quantize);
+    
+    // Callbacks with the slot index (0 to PatternSlots::NUM_SLOTS - 1)
+    std::function<void(int)> onLaunch;
+    std::function<void(int)> onStore;
+    std::function<void(int)> onClear;
+    
+    // Callback when the launch quantization changes
+    std::function<void(SwitchQuantize)> onQuantizeChanged;
+
+private:
+    const PatternSlots& patternSlots;
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
+    
+    juce::ComboBox quantizeCombo;
+    juce::Rectangle<int> slotArea;
+    
+    // What was last painted, to skip repaints when nothing changed
+    uint64_t shownVersion = 0;
+    int shownQueuedSlot = PatternSlots::NO_SLOT;
+    
+    // Slot numbers, laid out once
+    std::array<CachedText, PatternSlots::NUM_SLOTS> slotNumberTexts;
+    
+    /**
+     * Get the bounds of one slot button
+     */
+    juce::Rectangle<int> getSlotBounds(int slot) const;
+    
+    /**
+     * Find the slot under a point, or PatternSlots::NO_SLOT
+     */
+    int getSlotAt(juce::Point<int> position) const;
+    
+    /**
+     * Show the store/clear menu for a slot
+     */
+    void showSlotMenu(int slot);
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatternSlotsComponent)
+};
+
+} // namespace SquareBeats
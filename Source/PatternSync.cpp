@@ -0,0 +1,337 @@
+#include "PatternSync.h"
+
+namespace SquareBeats {
+
+//==============================================================================
+PatternSync::PatternSync(PatternModel& liveModel, PlaybackEngine& playbackEngine)
+    : live(liveModel)
+    , engine(playbackEngine)
+    , playbackModel(std::make_unique<PatternModel>())
+{
+    playbackModel->copyFrom(live, live.getSquares().size() + SQUARE_HEADROOM);
+    takeSnapshot();
+    
+    engine.setPatternModel(playbackModel.get());
+    engine.setPatternCommandQueue(&queue, playbackModel.get());
+    live.setCommandSink(this);
+}
+
+PatternSync::~PatternSync()
+{
+    live.setCommandSink(nullptr);
+    engine.setPatternCommandQueue(nullptr, nullptr);
+}
+
+//==============================================================================
+void PatternSync::suspend()
+{
+    suspended = true;
+}
+
+void PatternSync::resume(bool takePlayback, bool releaseNotes)
+{
+    suspended = false;
+    resync(takePlayback, releaseNotes);
+}
+
+void PatternSync::update()
+{
+    if (resyncPending && !suspended)
+        resync(pendingTakePlayback, pendingReleaseNotes);
+    
+    freeRetiredModels();
+}
+
+bool PatternSync::isUpToDate() const
+{
+    return !resyncPending && engine.getAppliedCommandSequence() >= replaceSequence;
+}
+
+bool PatternSync::isPlaybackModel(const PatternModel* model) const
+{
+    return model != nullptr && model == playbackModel.get();
+}
+
+void PatternSync::retire(std::unique_ptr<PatternModel> model)
+{
+    if (model != nullptr)
+        retiredModels.push_back({ std::move(model), juce::Time::getMillisecondCounter(), 0 });
+}
+
+//==============================================================================
+void PatternSync::squareCommand(const PatternCommand& command)
+{
+    if (suspended || resyncPending)
+        return;
+    
+    // The playback model only grows into the room reserved when it was copied
+    if (command.type == PatternCommand::ADD_SQUARE
+        && live.getSquares().size() > playbackModel->getSquareCapacity())
+    {
+        resyncPending = true;
+        return;
+    }
+    
+    send(command);
+}
+
+void PatternSync::squaresAdded(size_t count)
+{
+    if (suspended || resyncPending)
+        return;
+    
+    // A batch that does not fit goes over as one copy when the edit is announced
+    const auto& squares = live.getSquares();
+    if (squares.size() > playbackModel->getSquareCapacity()
+        || count > static_cast<size_t>(queue.getFreeSpace()))
+    {
+        resyncPending = true;
+        return;
+    }
+    
+    for (size_t index = squares.size() - count; index < squares.size(); ++index)
+    {
+        PatternCommand command;
+        command.type = PatternCommand::ADD_SQUARE;
+        command.square = squares[index];
+        send(command);
+    }
+}
+
+void PatternSync::patternEdited()
+{
+    if (suspended)
+        return;
+    
+    if (resyncPending)
+    {
+        resync(pendingTakePlayback, pendingReleaseNotes);
+        return;
+    }
+    
+    sendChangedSettings();
+}
+
+void PatternSync::sendChangedSettings()
+{
+    // Only the count is sent: both models keep the squares on channels beyond it
+    if (live.getNumColorChannels() != sentNumColorChannels)
+    {
+        sentNumColorChannels = live.getNumColorChannels();
+        
+        PatternCommand command;
+        command.type = PatternCommand::SET_NUM_COLOR_CHANNELS;
+        command.intValue = sentNumColorChannels;
+        send(command);
+    }
+    
+    if (live.getLoopLength() != sentLoopLength)
+    {
+        sentLoopLength = live.getLoopLength();
+        
+        PatternCommand command;
+        command.type = PatternCommand::SET_LOOP_LENGTH;
+        command.doubleValue = sentLoopLength;
+        send(command);
+    }
+    
+    const TimeSignature timeSignature = live.getTimeSignature();
+    if (timeSignature.numerator != sentTimeSignature.numerator
+        || timeSignature.denominator != sentTimeSignature.denominator)
+    {
+        sentTimeSignature = timeSignature;
+        
+        PatternCommand command;
+        command.type = PatternCommand::SET_TIME_SIGNATURE;
+        command.timeSignature = timeSignature;
+        send(command);
+    }
+    
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId)
+    {
+        const ColorChannelConfig& config = live.getColorConfig(colorId);
+        ColorChannelConfig& sent = sentColorConfigs[static_cast<size_t>(colorId)];
+        if (isSameColorConfig(config, sent))
+            continue;
+        
+        holdPitchWaveform(sent.pitchWaveform.getEnvelope());
+        sent = config;
+        
+        PatternCommand command;
+        command.type = PatternCommand::SET_COLOR_CONFIG;
+        command.colorId = colorId;
+        command.colorConfig = std::make_shared<const ColorChannelConfig>(config);
+        send(command);
+    }
+    
+    const PlayModeConfig& playMode = live.getPlayModeConfig();
+    if (playMode.mode != sentPlayMode.mode
+        || playMode.stepJumpSize != sentPlayMode.stepJumpSize
+        || playMode.probability != sentPlayMode.probability)
+    {
+        sentPlayMode = playMode;
+        
+        PatternCommand command;
+        command.type = PatternCommand::SET_PLAY_MODE;
+        command.playMode = playMode;
+        send(command);
+    }
+    
+    const ScaleConfig& scale = live.getScaleConfig();
+    if (scale.rootNote != sentScale.rootNote || scale.scaleType != sentScale.scaleType)
+    {
+        sentScale = scale;
+        
+        // The snapping table is built here rather than by the audio thread
+        PatternCommand command;
+        command.type = PatternCommand::SET_SCALE;
+        command.scale = scale;
+        command.noteTable = std::make_shared<const ScaleNoteTable>(scale);
+        send(command);
+    }
+    
+    const ScaleSequencerConfig& scaleSequencer = live.getScaleSequencer();
+    if (!isSameScaleSequencer(scaleSequencer, sentScaleSequencer))
+    {
+        sentScaleSequencer = scaleSequencer;
+        
+        PatternCommand command;
+        command.type = PatternCommand::SET_SCALE_SEQUENCER;
+        command.scaleSequencer = std::make_shared<const ScaleSequencerConfig>(scaleSequencer);
+        send(command);
+    }
+}
+
+//==============================================================================
+bool PatternSync::resync(bool takePlayback, bool releaseNotes)
+{
+    // A later resync covers an earlier one that is still waiting, so keep the stronger request
+    resyncPending = true;
+    pendingTakePlayback = pendingTakePlayback || takePlayback;
+    pendingReleaseNotes = pendingReleaseNotes || releaseNotes;
+    
+    if (queue.getFreeSpace() < 1)
+        return false;
+    
+    auto copy = std::make_unique<PatternModel>();
+    copy->copyFrom(live, live.getSquares().size() + SQUARE_HEADROOM);
+    
+    PatternCommand command;
+    command.type = PatternCommand::REPLACE_PATTERN;
+    command.sequence = nextSequence++;
+    command.pattern = copy.get();
+    command.takePlayback = pendingTakePlayback;
+    command.releaseNotes = pendingReleaseNotes;
+    queue.push(command);
+    
+    // The old copy stays alive until the engine has moved off it; while the command that hands
+    // it over is still queued the engine cannot have taken it yet, let alone moved off it
+    retiredModels.push_back({ std::move(playbackModel), juce::Time::getMillisecondCounter(), replaceSequence });
+    playbackModel = std::move(copy);
+    replaceSequence = command.sequence;
+    
+    resyncPending = false;
+    pendingTakePlayback = false;
+    pendingReleaseNotes = false;
+    takeSnapshot();
+    return true;
+}
+
+void PatternSync::send(PatternCommand command)
+{
+    // Once one command is dropped, later ones would apply out of context
+    if (resyncPending)
+        return;
+    
+    command.sequence = nextSequence;
+    if (!queue.push(command))
+    {
+        // The audio thread is behind (or not running): catch up with one copy later on
+        resyncPending = true;
+        return;
+    }
+    ++nextSequence;
+}
+
+void PatternSync::takeSnapshot()
+{
+    sentLoopLength = live.getLoopLength();
+    sentTimeSignature = live.getTimeSignature();
+    sentNumColorChannels = live.getNumColorChannels();
+    
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId)
+    {
+        ColorChannelConfig& sent = sentColorConfigs[static_cast<size_t>(colorId)];
+        holdPitchWaveform(sent.pitchWaveform.getEnvelope());
+        sent = live.getColorConfig(colorId);
+    }
+    
+    sentPlayMode = live.getPlayModeConfig();
+    sentScale = live.getScaleConfig();
+    sentScaleSequencer = live.getScaleSequencer();
+}
+
+void PatternSync::holdPitchWaveform(PitchWaveform::EnvelopePtr envelope)
+{
+    // An envelope held only by this list is no longer shared with the audio thread
+    heldPitchWaveforms.erase(
+        std::remove_if(heldPitchWaveforms.begin(), heldPitchWaveforms.end(),
+            [](const PitchWaveform::EnvelopePtr& held) { return held.use_count() == 1; }),
+        heldPitchWaveforms.end()
+    );
+    
+    if (envelope != nullptr)
+        heldPitchWaveforms.push_back(std::move(envelope));
+}
+
+void PatternSync::freeRetiredModels()
+{
+    // The grace period covers a MIDI launch that read a slot's model just before it was replaced
+    const juce::uint32 now = juce::Time::getMillisecondCounter();
+    const uint64_t appliedSequence = engine.getAppliedCommandSequence();
+    retiredModels.erase(std::remove_if(retiredModels.begin(), retiredModels.end(),
+                                       [this, now, appliedSequence](const RetiredModel& retired)
+                                       {
+                                           return appliedSequence >= retired.sequence
+                                               && now - retired.retiredAtMs > 100
+                                               && !engine.isPatternModelInUse(retired.model.get());
+                                       }),
+                        retiredModels.end());
+    
+    holdPitchWaveform(nullptr);
+}
+
+//==============================================================================
+bool PatternSync::isSameColorConfig(const ColorChannelConfig& a, const ColorChannelConfig& b)
+{
+    return a.midiChannel == b.midiChannel
+        && a.highNote == b.highNote
+        && a.lowNote == b.lowNote
+        && a.quantize == b.quantize
+        && a.displayColor == b.displayColor
+        && a.pitchWaveform.getEnvelope() == b.pitchWaveform.getEnvelope()
+        && a.pitchSeqLoopLengthBars == b.pitchSeqLoopLengthBars
+        && a.mainLoopLengthBars == b.mainLoopLengthBars
+        && a.polyphony == b.polyphony
+        && a.stealPolicy == b.stealPolicy
+        && a.pitchBendRange == b.pitchBendRange
+        && a.pitchBendRateHz == b.pitchBendRateHz
+        && a.groove == b.groove;
+}
+
+bool PatternSync::isSameScaleSequencer(const ScaleSequencerConfig& a, const ScaleSequencerConfig& b)
+{
+    if (a.enabled != b.enabled || a.segments.size() != b.segments.size())
+        return false;
+    
+    for (size_t i = 0; i < a.segments.size(); ++i)
+    {
+        if (a.segments[i].rootNote != b.segments[i].rootNote
+            || a.segments[i].scaleType != b.segments[i].scaleType
+            || a.segments[i].lengthBars != b.segments[i].lengthBars)
+            return false;
+    }
+    return true;
+}
+
+} // namespace SquareBeats
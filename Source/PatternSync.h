@@ -0,0 +1,152 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "DataStructures.h"
+#include "PatternCommand.h"
+#include "PatternModel.h"
+#include "PlaybackEngine.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * PatternSync keeps the pattern the audio thread plays in step with the one
+ * the editor works on
+ *
+ * The live model belongs to the message thread. The engine plays a separate
+ * copy (the playback model), which only the audio thread touches once it is
+ * handed over. Every edit to the live model is turned into a PatternCommand:
+ * square edits as they happen, settings by comparing them with what was last
+ * sent whenever the model announces an edit. The engine applies queued
+ * commands at the start of each block and reports back the sequence number
+ * of the last one it applied.
+ *
+ * Nothing here ever waits for the audio thread. If the queue fills up, or
+ * the playback model runs out of reserved room for squares, commands are
+ * dropped and the playback model is replaced with a fresh copy instead.
+ * Bulk loads (presets, slots, host state) suspend the commands and end with
+ * such a copy as well; squares added in bulk go as commands only while they
+ * fit in the queue.
+ *
+ * All methods are for the message thread.
+ */
+class PatternSync : private PatternModel::CommandSink
+{
+public:
+    PatternSync(PatternModel& liveModel, PlaybackEngine& engine);
+    ~PatternSync() override;
+    
+    /**
+     * Stop sending commands, before loading a whole pattern into the live model
+     */
+    void suspend();
+    
+    /**
+     * Send commands again, starting with a fresh copy of the live model
+     * @param takePlayback Play the copy from the next block even if another model is playing
+     * @param releaseNotes End held notes and resync positions when the copy takes over
+     */
+    void resume(bool takePlayback, bool releaseNotes);
+    
+    /**
+     * Retry a resync that did not fit in the queue and free retired models (call from a timer)
+     */
+    void update();
+    
+    /**
+     * Whether the engine has taken the latest copy and no resync is outstanding
+     */
+    bool isUpToDate() const;
+    
+    /**
+     * Whether a model is the copy the live model is mirrored into
+     */
+    bool isPlaybackModel(const PatternModel* model) const;
+    
+    /**
+     * Keep a model alive until the audio thread can no longer be reading it
+     */
+    void retire(std::unique_ptr<PatternModel> model);
+    
+    // Squares the playback model has room for beyond the live model's count
+    static constexpr size_t SQUARE_HEADROOM = 1024;
+
+private:
+    //==============================================================================
+    // PatternModel::CommandSink
+    void squareCommand(const PatternCommand& command) override;
+    void squaresAdded(size_t count) override;
+    void patternEdited() override;
+    
+    /**
+     * Send the settings that changed since they were last sent
+     */
+    void sendChangedSettings();
+    
+    /**
+     * Replace the playback model with a fresh copy of the live model
+     * @return false if the queue had no room (resyncPending stays set)
+     */
+    bool resync(bool takePlayback, bool releaseNotes);
+    
+    /**
+     * Queue a command, or fall back to a resync if the queue is full
+     */
+    void send(PatternCommand command);
+    
+    /**
+     * Remember the live model's settings as sent
+     */
+    void takeSnapshot();
+    
+    /**
+     * Hold a waveform envelope that the playback model may still share
+     */
+    void holdPitchWaveform(PitchWaveform::EnvelopePtr envelope);
+    
+    void freeRetiredModels();
+    
+    static bool isSameColorConfig(const ColorChannelConfig& a, const ColorChannelConfig& b);
+    static bool isSameScaleSequencer(const ScaleSequencerConfig& a, const ScaleSequencerConfig& b);
+    
+    //==============================================================================
+    PatternModel& live;
+    PlaybackEngine& engine;
+    PatternCommandQueue queue;
+    
+    std::unique_ptr<PatternModel> playbackModel;
+    uint64_t nextSequence = 1;
+    uint64_t replaceSequence = 0;  // Sequence of the REPLACE_PATTERN that handed over playbackModel
+    bool resyncPending = false;
+    bool pendingTakePlayback = false;
+    bool pendingReleaseNotes = false;
+    bool suspended = false;
+    
+    // Settings as last sent
+    double sentLoopLength = 0.0;
+    TimeSignature sentTimeSignature;
+    int sentNumColorChannels = 0;
+    std::array<ColorChannelConfig, MAX_COLOR_CHANNELS> sentColorConfigs;
+    PlayModeConfig sentPlayMode;
+    ScaleConfig sentScale;
+    ScaleSequencerConfig sentScaleSequencer;
+    
+    // Envelopes replaced in sentColorConfigs; the last reference must not go with a command
+    std::vector<PitchWaveform::EnvelopePtr> heldPitchWaveforms;
+    
+    // Models replaced while the audio thread may still read them
+    struct RetiredModel
+    {
+        std::unique_ptr<PatternModel> model;
+        juce::uint32 retiredAtMs;
+        uint64_t sequence;  // REPLACE_PATTERN that hands the model to the engine (0 if none)
+    };
+    std::vector<RetiredModel> retiredModels;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatternSync)
+};
+
+} // namespace SquareBeats
@@ -11,6 +11,7 @@ PitchSequencerComponent::PitchSequencerComponent(PatternModel& model)
     , isDrawing(false)
     , lastNormalizedX(0.0f)
     , lastPitchOffset(0.0f)
+    , cachedEditingPitch(false)
 {
     // Waveforms are now initialized per-color in PatternModel
     
@@ -25,69 +26,16 @@ PitchSequencerComponent::~PitchSequencerComponent()
 //==============================================================================
 void PitchSequencerComponent::paint(juce::Graphics& g)
 {
-    auto& pitchSequencer = patternModel.getPitchSequencer();
-    auto bounds = getLocalBounds().toFloat();
-    
-    // Always draw the waveform (pitch modulation is always active)
-    // But only show the full editing overlay when in pitch editing mode
-    
-    if (pitchSequencer.editingPitch)
+    if (getWidth() <= 0 || getHeight() <= 0)
     {
-        // Full editing mode: show semi-transparent background and reference lines
-        g.fillAll(juce::Colour(0x40000000));
-        
-        // Draw center line (0 semitones)
-        float centerY = bounds.getCentreY();
-        g.setColour(juce::Colours::white.withAlpha(0.3f));
-        g.drawLine(bounds.getX(), centerY, bounds.getRight(), centerY, 1.0f);
-        
-        // Draw +/- 12 semitone reference lines
-        float octaveUpY = pitchOffsetToPixelY(12.0f);
-        float octaveDownY = pitchOffsetToPixelY(-12.0f);
-        g.setColour(juce::Colours::white.withAlpha(0.2f));
-        g.drawLine(bounds.getX(), octaveUpY, bounds.getRight(), octaveUpY, 1.0f);
-        g.drawLine(bounds.getX(), octaveDownY, bounds.getRight(), octaveDownY, 1.0f);
+        return;
     }
     
-    // Always draw the waveform (visible in both modes)
-    drawWaveform(g);
+    // Overlay and waveform come from the cached image; only the dot is drawn per frame
+    updateWaveformCache(g.getInternalContext().getPhysicalPixelScaleFactor());
+    g.drawImage(waveformCache, getLocalBounds().toFloat());
     
-    // Draw playback position as a circle moving along the waveform (no vertical bar)
-    auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
-    float pixelX = bounds.getX() + playbackPosition * bounds.getWidth();
-    
-    // Draw a larger glowing dot at the current waveform value (touch-friendly)
-    if (!colorConfig.pitchWaveform.empty())
-    {
-        float currentPitch = colorConfig.getPitchOffsetAt(playbackPosition);
-        float dotY = pitchOffsetToPixelY(currentPitch);
-        
-        // Large outer glow
-        g.setColour(colorConfig.displayColor.withAlpha(0.3f));
-        g.fillEllipse(pixelX - 20.0f, dotY - 20.0f, 40.0f, 40.0f);
-        
-        // Medium glow ring
-        g.setColour(colorConfig.displayColor.withAlpha(0.5f));
-        g.fillEllipse(pixelX - 12.0f, dotY - 12.0f, 24.0f, 24.0f);
-        
-        // Inner bright dot
-        g.setColour(juce::Colours::white);
-        g.fillEllipse(pixelX - 6.0f, dotY - 6.0f, 12.0f, 12.0f);
-    }
-    else
-    {
-        // No waveform yet - show dot at center line
-        float dotY = bounds.getCentreY();
-        
-        g.setColour(colorConfig.displayColor.withAlpha(0.3f));
-        g.fillEllipse(pixelX - 20.0f, dotY - 20.0f, 40.0f, 40.0f);
-        
-        g.setColour(colorConfig.displayColor.withAlpha(0.5f));
-        g.fillEllipse(pixelX - 12.0f, dotY - 12.0f, 24.0f, 24.0f);
-        
-        g.setColour(juce::Colours::white);
-        g.fillEllipse(pixelX - 6.0f, dotY - 6.0f, 12.0f, 12.0f);
-    }
+    drawPlayhead(g);
 }
 
 void PitchSequencerComponent::resized()
@@ -111,14 +59,14 @@ void PitchSequencerComponent::setWaveformResolution(int numSamples)
 {
     if (numSamples > 0 && numSamples != waveformResolution)
     {
-        waveformResolution = numSamples;
-        // Waveforms are managed per-color in PatternModel
+        waveformResolution = juce::jmin(numSamples, PitchEnvelope::MAX_RESOLUTION);
+        // Waveforms are managed per-color in PatternModel; this only affects edits
     }
 }
 
 void PitchSequencerComponent::setSelectedColorChannel(int colorId)
 {
-    selectedColorChannel = juce::jlimit(0, 3, colorId);
+    selectedColorChannel = juce::jlimit(0, patternModel.getNumColorChannels() - 1, colorId);
     repaint();
 }
 
@@ -126,58 +74,209 @@ void PitchSequencerComponent::setPlaybackPosition(float normalizedPosition)
 {
     if (playbackPosition != normalizedPosition)
     {
+        // Only the dot moves; the waveform underneath is redrawn from the cache
+        repaint(getPlayheadBounds());
         playbackPosition = normalizedPosition;
-        repaint();
+        repaint(getPlayheadBounds());
     }
 }
 
 //==============================================================================
+void PitchSequencerComponent::updateWaveformCache(float pixelScale)
+{
+    const auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
+    auto envelope = colorConfig.pitchWaveform.getEnvelope();
+    bool editingPitch = patternModel.getPitchSequencer().editingPitch;
+    int imageWidth = juce::jmax(1, juce::roundToInt(getWidth() * pixelScale));
+    int imageHeight = juce::jmax(1, juce::roundToInt(getHeight() * pixelScale));
+    
+    if (waveformCache.isValid()
+        && waveformCache.getWidth() == imageWidth
+        && waveformCache.getHeight() == imageHeight
+        && envelope == cachedEnvelope
+        && colorConfig.displayColor == cachedColour
+        && editingPitch == cachedEditingPitch)
+    {
+        return;
+    }
+    
+    cachedEnvelope = envelope;
+    cachedColour = colorConfig.displayColor;
+    cachedEditingPitch = editingPitch;
+    
+    waveformCache = juce::Image(juce::Image::ARGB, imageWidth, imageHeight, true);
+    juce::Graphics imageGraphics(waveformCache);
+    imageGraphics.addTransform(juce::AffineTransform::scale(static_cast<float>(imageWidth) / getWidth(),
+                                                            static_cast<float>(imageHeight) / getHeight()));
+    
+    // Only show the full editing overlay when in pitch editing mode
+    if (editingPitch)
+    {
+        drawOverlay(imageGraphics);
+    }
+    
+    // Always draw the waveform (visible in both modes)
+    drawWaveform(imageGraphics);
+}
+
+void PitchSequencerComponent::drawOverlay(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+    
+    // Semi-transparent background
+    g.fillAll(juce::Colour(0x40000000));
+    
+    // Draw center line (0 semitones)
+    float centerY = bounds.getCentreY();
+    g.setColour(juce::Colours::white.withAlpha(0.3f));
+    g.drawLine(bounds.getX(), centerY, bounds.getRight(), centerY, 1.0f);
+    
+    // Draw +/- 12 semitone reference lines
+    float octaveUpY = pitchOffsetToPixelY(12.0f);
+    float octaveDownY = pitchOffsetToPixelY(-12.0f);
+    g.setColour(juce::Colours::white.withAlpha(0.2f));
+    g.drawLine(bounds.getX(), octaveUpY, bounds.getRight(), octaveUpY, 1.0f);
+    g.drawLine(bounds.getX(), octaveDownY, bounds.getRight(), octaveDownY, 1.0f);
+}
+
 void PitchSequencerComponent::drawWaveform(juce::Graphics& g)
 {
     auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
     
-    if (colorConfig.pitchWaveform.empty())
+    // Draw from one snapshot of the shared waveform envelope
+    auto envelope = colorConfig.pitchWaveform.getEnvelope();
+    if (envelope == nullptr || envelope->empty())
     {
         return;
     }
     
+    const auto& breakpoints = envelope->getBreakpoints();
+    const int gridSteps = std::max(1, envelope->getResolution() - 1);
     auto bounds = getLocalBounds().toFloat();
     
-    // Create a path for the waveform
+    // One column per physical pixel bounds the drawing cost
+    float pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    int numColumns = juce::jmax(1, static_cast<int>(std::ceil(bounds.getWidth() * pixelScale)));
+    
     juce::Path waveformPath;
     
-    bool firstPoint = true;
-    for (size_t i = 0; i < colorConfig.pitchWaveform.size(); ++i)
+    if (static_cast<int>(breakpoints.size()) <= numColumns)
     {
-        float normalizedX = static_cast<float>(i) / (colorConfig.pitchWaveform.size() - 1);
-        float pixelX = bounds.getX() + normalizedX * bounds.getWidth();
-        float pixelY = pitchOffsetToPixelY(colorConfig.pitchWaveform[i]);
-        
-        if (firstPoint)
+        // Only breakpoints need drawing; the curve is straight between them
+        bool firstPoint = true;
+        for (const auto& point : breakpoints)
         {
-            waveformPath.startNewSubPath(pixelX, pixelY);
-            firstPoint = false;
+            float normalizedX = static_cast<float>(point.index) / gridSteps;
+            float pixelX = bounds.getX() + normalizedX * bounds.getWidth();
+            float pixelY = pitchOffsetToPixelY(point.value);
+            
+            if (firstPoint)
+            {
+                waveformPath.startNewSubPath(pixelX, pixelY);
+                firstPoint = false;
+            }
+            else
+            {
+                waveformPath.lineTo(pixelX, pixelY);
+            }
         }
-        else
+        
+        g.setColour(colorConfig.displayColor.withAlpha(0.8f));
+        g.strokePath(waveformPath, juce::PathStrokeType(2.0f));
+        
+        // Dots at each breakpoint while they are far enough apart to tell apart
+        if (static_cast<float>(breakpoints.size()) * 4.0f <= bounds.getWidth())
         {
-            waveformPath.lineTo(pixelX, pixelY);
+            g.setColour(colorConfig.displayColor);
+            for (const auto& point : breakpoints)
+            {
+                float normalizedX = static_cast<float>(point.index) / gridSteps;
+                float pixelX = bounds.getX() + normalizedX * bounds.getWidth();
+                float pixelY = pitchOffsetToPixelY(point.value);
+                
+                g.fillEllipse(pixelX - 2.0f, pixelY - 2.0f, 4.0f, 4.0f);
+            }
         }
+        return;
     }
     
-    // Draw the waveform path using the color's display color
-    g.setColour(colorConfig.displayColor.withAlpha(0.8f));
-    g.strokePath(waveformPath, juce::PathStrokeType(2.0f));
+    // Denser than the screen: draw the min/max of each pixel column as a band
+    if (envelope != mipmapEnvelope)
+    {
+        mipmap = WaveformMipmap(*envelope);
+        mipmapEnvelope = envelope;
+    }
     
-    // Draw dots at each sample point for better visibility
-    g.setColour(colorConfig.displayColor);
-    for (size_t i = 0; i < colorConfig.pitchWaveform.size(); ++i)
+    std::vector<WaveformMipmap::Range> columns(static_cast<size_t>(numColumns));
+    double stepsPerColumn = static_cast<double>(gridSteps) / numColumns;
+    for (int column = 0; column < numColumns; ++column)
     {
-        float normalizedX = static_cast<float>(i) / (colorConfig.pitchWaveform.size() - 1);
-        float pixelX = bounds.getX() + normalizedX * bounds.getWidth();
-        float pixelY = pitchOffsetToPixelY(colorConfig.pitchWaveform[i]);
-        
-        g.fillEllipse(pixelX - 2.0f, pixelY - 2.0f, 4.0f, 4.0f);
+        // Include the shared grid point at each edge so neighbouring columns join up
+        int firstIndex = static_cast<int>(std::floor(column * stepsPerColumn));
+        int lastIndex = static_cast<int>(std::ceil((column + 1) * stepsPerColumn));
+        columns[static_cast<size_t>(column)] = mipmap.getRange(firstIndex, lastIndex);
+    }
+    
+    auto columnX = [&](int column)
+    {
+        return bounds.getX() + (column + 0.5f) * bounds.getWidth() / numColumns;
+    };
+    
+    // Upper edge left to right, lower edge back again
+    waveformPath.startNewSubPath(columnX(0), pitchOffsetToPixelY(columns.front().max));
+    for (int column = 1; column < numColumns; ++column)
+    {
+        waveformPath.lineTo(columnX(column), pitchOffsetToPixelY(columns[static_cast<size_t>(column)].max));
     }
+    for (int column = numColumns - 1; column >= 0; --column)
+    {
+        waveformPath.lineTo(columnX(column), pitchOffsetToPixelY(columns[static_cast<size_t>(column)].min));
+    }
+    waveformPath.closeSubPath();
+    
+    g.setColour(colorConfig.displayColor.withAlpha(0.8f));
+    g.fillPath(waveformPath);
+    g.strokePath(waveformPath, juce::PathStrokeType(2.0f));
+}
+
+void PitchSequencerComponent::drawPlayhead(juce::Graphics& g)
+{
+    // Draw playback position as a circle moving along the waveform (no vertical bar)
+    auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
+    auto centre = getPlayheadCentre();
+    
+    // Large outer glow (touch-friendly)
+    g.setColour(colorConfig.displayColor.withAlpha(0.3f));
+    g.fillEllipse(centre.x - 20.0f, centre.y - 20.0f, 40.0f, 40.0f);
+    
+    // Medium glow ring
+    g.setColour(colorConfig.displayColor.withAlpha(0.5f));
+    g.fillEllipse(centre.x - 12.0f, centre.y - 12.0f, 24.0f, 24.0f);
+    
+    // Inner bright dot
+    g.setColour(juce::Colours::white);
+    g.fillEllipse(centre.x - 6.0f, centre.y - 6.0f, 12.0f, 12.0f);
+}
+
+juce::Point<float> PitchSequencerComponent::getPlayheadCentre() const
+{
+    auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
+    auto bounds = getLocalBounds().toFloat();
+    float pixelX = bounds.getX() + playbackPosition * bounds.getWidth();
+    
+    // Dot sits on the waveform value, or on the center line if there is no waveform yet
+    float dotY = colorConfig.pitchWaveform.empty()
+        ? bounds.getCentreY()
+        : pitchOffsetToPixelY(colorConfig.getPitchOffsetAt(playbackPosition));
+    
+    return { pixelX, dotY };
+}
+
+juce::Rectangle<int> PitchSequencerComponent::getPlayheadBounds() const
+{
+    // Outer glow plus a pixel for antialiasing
+    auto centre = getPlayheadCentre();
+    return juce::Rectangle<float>(centre.x - 21.0f, centre.y - 21.0f, 42.0f, 42.0f).getSmallestIntegerContainer();
 }
 
 //==============================================================================
@@ -250,49 +349,17 @@ void PitchSequencerComponent::mouseDrag(const juce::MouseEvent& event)
     float currentNormalizedX = juce::jlimit(0.0f, 1.0f, pixelXToNormalized(mousePos.x));
     float currentPitchOffset = juce::jlimit(-12.0f, 12.0f, pixelYToPitchOffset(mousePos.y));
     
-    // Interpolate between last position and current position to fill gaps
+    // Draw a straight line from the last position to the current one
     // This prevents choppy drawing when the mouse moves fast
-    auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
-    
-    // Ensure waveform is initialized
-    if (colorConfig.pitchWaveform.empty())
-    {
-        colorConfig.pitchWaveform.resize(waveformResolution, 0.0f);
-    }
+    PitchEnvelope envelope = getEnvelopeForEdit();
     
-    int waveformSize = static_cast<int>(colorConfig.pitchWaveform.size());
-    int lastIndex = static_cast<int>(lastNormalizedX * (waveformSize - 1));
-    int currentIndex = static_cast<int>(currentNormalizedX * (waveformSize - 1));
+    int gridSteps = envelope.getResolution() - 1;
+    int lastIndex = static_cast<int>(lastNormalizedX * gridSteps);
+    int currentIndex = static_cast<int>(currentNormalizedX * gridSteps);
     
-    // Determine direction and fill all points between last and current
-    int startIndex = std::min(lastIndex, currentIndex);
-    int endIndex = std::max(lastIndex, currentIndex);
-    
-    for (int i = startIndex; i <= endIndex; ++i)
-    {
-        // Calculate interpolation factor
-        float t = 0.0f;
-        if (endIndex != startIndex)
-        {
-            if (currentIndex > lastIndex)
-            {
-                t = static_cast<float>(i - lastIndex) / static_cast<float>(currentIndex - lastIndex);
-            }
-            else
-            {
-                t = static_cast<float>(i - currentIndex) / static_cast<float>(lastIndex - currentIndex);
-                t = 1.0f - t;  // Reverse interpolation direction
-            }
-        }
-        
-        // Interpolate pitch offset
-        float interpolatedPitch = lastPitchOffset + t * (currentPitchOffset - lastPitchOffset);
-        interpolatedPitch = juce::jlimit(-12.0f, 12.0f, interpolatedPitch);
-        
-        // Store the interpolated value
-        int clampedIndex = juce::jlimit(0, waveformSize - 1, i);
-        colorConfig.pitchWaveform[clampedIndex] = interpolatedPitch;
-    }
+    // Publish the whole stroke segment as one new envelope
+    patternModel.setPitchWaveform(selectedColorChannel, std::make_shared<const PitchEnvelope>(
+        envelope.withRamp(lastIndex, lastPitchOffset, currentIndex, currentPitchOffset)));
     
     // Update last position for next drag event
     lastNormalizedX = currentNormalizedX;
@@ -310,20 +377,39 @@ void PitchSequencerComponent::mouseUp(const juce::MouseEvent& event)
 //==============================================================================
 void PitchSequencerComponent::recordPitchOffset(float normalizedX, float pitchOffset)
 {
-    auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
+    PitchEnvelope envelope = getEnvelopeForEdit();
+    
+    // Map normalized X to a grid point
+    int index = static_cast<int>(normalizedX * (envelope.getResolution() - 1));
     
-    // Ensure waveform is initialized
-    if (colorConfig.pitchWaveform.empty())
+    // Store the pitch offset and publish the edited copy
+    patternModel.setPitchWaveform(selectedColorChannel, std::make_shared<const PitchEnvelope>(
+        envelope.withRamp(index, pitchOffset, index, pitchOffset)));
+}
+
+PitchEnvelope PitchSequencerComponent::getEnvelopeForEdit() const
+{
+    auto current = patternModel.getColorConfig(selectedColorChannel).pitchWaveform.getEnvelope();
+    int editResolution = getEditResolution();
+    
+    // Start from a flat waveform if this color has none yet
+    if (current == nullptr || current->getResolution() < 2)
     {
-        colorConfig.pitchWaveform.resize(waveformResolution, 0.0f);
+        return PitchEnvelope::flat(editResolution);
     }
     
-    // Map normalized X to waveform index
-    int index = static_cast<int>(normalizedX * (colorConfig.pitchWaveform.size() - 1));
-    index = juce::jlimit(0, static_cast<int>(colorConfig.pitchWaveform.size() - 1), index);
+    return current->withResolution(editResolution);
+}
+
+int PitchSequencerComponent::getEditResolution() const
+{
+    const auto& colorConfig = patternModel.getColorConfig(selectedColorChannel);
+    double pitchLoopBars = (colorConfig.pitchSeqLoopLengthBars > 0)
+        ? colorConfig.pitchSeqLoopLengthBars
+        : patternModel.getLoopLength();
     
-    // Store the pitch offset
-    colorConfig.pitchWaveform[index] = pitchOffset;
+    int stepsForLoop = static_cast<int>(std::ceil(pitchLoopBars * EDIT_STEPS_PER_BAR)) + 1;
+    return juce::jlimit(waveformResolution, PitchEnvelope::MAX_RESOLUTION, stepsForLoop);
 }
 
 void PitchSequencerComponent::initializeWaveform()
@@ -2,6 +2,7 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "PatternModel.h"
+#include "WaveformMipmap.h"
 
 namespace SquareBeats {
 
@@ -57,24 +58,51 @@ public:
     void setPlaybackPosition(float normalizedPosition);
     
     /**
-     * Set the waveform resolution (number of samples)
+     * Set the minimum waveform resolution (grid points across the pitch loop)
      */
     void setWaveformResolution(int numSamples);
     
     /**
-     * Get the current waveform resolution
+     * Get the minimum waveform resolution
      */
     int getWaveformResolution() const { return waveformResolution; }
+    
+    /**
+     * Grid steps per bar that drawing can address on long pitch loops
+     */
+    static constexpr int EDIT_STEPS_PER_BAR = 64;
 
 protected:
     //==============================================================================
     // Rendering helpers (protected for testing)
     
+    /**
+     * Draw the editing overlay background and reference lines
+     */
+    void drawOverlay(juce::Graphics& g);
+    
     /**
      * Draw the pitch waveform
+     * Sparse envelopes are drawn through their breakpoints; envelopes with more
+     * breakpoints than pixel columns are drawn as a min/max band from the mipmap.
      */
     void drawWaveform(juce::Graphics& g);
     
+    /**
+     * Draw the playback position dot
+     */
+    void drawPlayhead(juce::Graphics& g);
+    
+    /**
+     * Centre of the playback position dot
+     */
+    juce::Point<float> getPlayheadCentre() const;
+    
+    /**
+     * Area covered by the playback position dot, including its glow
+     */
+    juce::Rectangle<int> getPlayheadBounds() const;
+    
     /**
      * Convert pixel X coordinate to normalized time (0.0 to 1.0)
      */
@@ -97,18 +125,45 @@ private:
     //==============================================================================
     // Data members
     PatternModel& patternModel;
-    int waveformResolution;  // Number of samples in the waveform
+    int waveformResolution;  // Minimum grid resolution of edited waveforms
     int selectedColorChannel; // Currently selected color channel
     float playbackPosition;  // Current playback position (0.0 to 1.0)
     bool isDrawing;          // True when user is actively drawing
     float lastNormalizedX;   // Last recorded X position for interpolation
     float lastPitchOffset;   // Last recorded pitch offset for interpolation
     
+    // Overlay and waveform rendered at the display's pixel scale. Envelopes are
+    // immutable, so a new envelope pointer means the waveform was edited.
+    juce::Image waveformCache;
+    PitchWaveform::EnvelopePtr cachedEnvelope;
+    juce::Colour cachedColour;
+    bool cachedEditingPitch;
+    
+    // Min/max pyramid for the envelope it was built from
+    WaveformMipmap mipmap;
+    PitchWaveform::EnvelopePtr mipmapEnvelope;
+    
+    /**
+     * Re-render the waveform cache if the envelope, color, editing mode or size changed
+     */
+    void updateWaveformCache(float pixelScale);
+    
     /**
      * Record a pitch offset at the given normalized position
      */
     void recordPitchOffset(float normalizedX, float pitchOffset);
     
+    /**
+     * Selected color's envelope refined to the edit resolution (flat if empty)
+     */
+    PitchEnvelope getEnvelopeForEdit() const;
+    
+    /**
+     * Grid resolution for edits: waveformResolution, or EDIT_STEPS_PER_BAR
+     * per bar of the pitch loop when that is finer
+     */
+    int getEditResolution() const;
+    
     /**
      * Initialize waveform with default values (all zeros)
      */
@@ -87,6 +87,10 @@ PlayModeButtons::PlayModeButtons(PatternModel& model)
 
 PlayModeButtons::~PlayModeButtons()
 {
+    forwardButton.setLookAndFeel(nullptr);
+    backwardButton.setLookAndFeel(nullptr);
+    pendulumButton.setLookAndFeel(nullptr);
+    probabilityButton.setLookAndFeel(nullptr);
 }
 
 void PlayModeButtons::paint(juce::Graphics& g)
@@ -113,18 +117,22 @@ void PlayModeButtons::refreshFromModel()
 void PlayModeButtons::setupComponents()
 {
     forwardButton.setButtonText("-->");
+    forwardButton.setLookAndFeel(&buttonLookAndFeel);
     forwardButton.onClick = [this]() { onModeButtonClicked(PLAY_FORWARD); };
     addAndMakeVisible(forwardButton);
     
     backwardButton.setButtonText("<--");
+    backwardButton.setLookAndFeel(&buttonLookAndFeel);
     backwardButton.onClick = [this]() { onModeButtonClicked(PLAY_BACKWARD); };
     addAndMakeVisible(backwardButton);
     
     pendulumButton.setButtonText("<-->");
+    pendulumButton.setLookAndFeel(&buttonLookAndFeel);
     pendulumButton.onClick = [this]() { onModeButtonClicked(PLAY_PENDULUM); };
     addAndMakeVisible(pendulumButton);
     
     probabilityButton.setButtonText("--?>");
+    probabilityButton.setLookAndFeel(&buttonLookAndFeel);
     probabilityButton.onClick = [this]() { onModeButtonClicked(PLAY_PROBABILITY); };
     addAndMakeVisible(probabilityButton);
 }
@@ -227,17 +235,17 @@ void PlayModeXYPad::setupComponents()
     
     xyPadLabel.setText("PROBABILITY XY PAD", juce::dontSendNotification);
     xyPadLabel.setJustificationType(juce::Justification::centred);
-    xyPadLabel.setFont(AppFont::smallLabel());
+    xyPadLabel.setFont(AppFont::smallLabel(*fonts));
     addAndMakeVisible(xyPadLabel);
     
     xAxisLabel.setText("Step Jump Size", juce::dontSendNotification);
     xAxisLabel.setJustificationType(juce::Justification::centred);
-    xAxisLabel.setFont(AppFont::tiny());
+    xAxisLabel.setFont(AppFont::tiny(*fonts));
     addAndMakeVisible(xAxisLabel);
     
     yAxisLabel.setText("Prob%", juce::dontSendNotification);
     yAxisLabel.setJustificationType(juce::Justification::centred);
-    yAxisLabel.setFont(AppFont::micro());
+    yAxisLabel.setFont(AppFont::micro(*fonts));
     addAndMakeVisible(yAxisLabel);
 }
 
@@ -246,6 +254,7 @@ void PlayModeXYPad::onXYPadChanged(float x, float y)
     auto& config = patternModel.getPlayModeConfig();
     config.stepJumpSize = x;
     config.probability = y;
+    patternModel.markEdited();
 }
 
 //==============================================================================
@@ -357,19 +366,19 @@ void PlayModeControls::setupComponents()
     // XY Pad label
     xyPadLabel.setText("PROBABILITY", juce::dontSendNotification);
     xyPadLabel.setJustificationType(juce::Justification::centred);
-    xyPadLabel.setFont(AppFont::smallLabel());
+    xyPadLabel.setFont(AppFont::smallLabel(*fonts));
     addAndMakeVisible(xyPadLabel);
     
     // X-axis label
     xAxisLabel.setText("Step Jump Size", juce::dontSendNotification);
     xAxisLabel.setJustificationType(juce::Justification::centred);
-    xAxisLabel.setFont(AppFont::tiny());
+    xAxisLabel.setFont(AppFont::tiny(*fonts));
     addAndMakeVisible(xAxisLabel);
     
     // Y-axis label (rotated text would be ideal, but we'll use abbreviated)
     yAxisLabel.setText("Prob%", juce::dontSendNotification);
     yAxisLabel.setJustificationType(juce::Justification::centred);
-    yAxisLabel.setFont(AppFont::micro());
+    yAxisLabel.setFont(AppFont::micro(*fonts));
     addAndMakeVisible(yAxisLabel);
 }
 
@@ -411,6 +420,7 @@ void PlayModeControls::onXYPadChanged(float x, float y)
     
     // Don't send change message for every drag - too noisy
     // The values are read directly during playback
+    patternModel.markEdited();
 }
 
 } // namespace SquareBeats
@@ -2,6 +2,8 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "PatternModel.h"
+#include "AppFont.h"
+#include <map>
 
 namespace SquareBeats {
 
@@ -26,7 +28,7 @@ public:
     void setYValue(float y) { yValue = juce::jlimit(0.0f, 1.0f, y); repaint(); }
     
     std::function<void(float, float)> onValueChanged;
-    
+
 private:
     float xValue = 0.5f;
     float yValue = 0.5f;
@@ -36,6 +38,42 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(XYPadComponent)
 };
 
+//==============================================================================
+/**
+ * LookAndFeel for the play mode buttons: draws each arrow label from glyphs laid
+ * out once, instead of shaping the text on every repaint
+ */
+class PlayModeButtonLookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+    void drawButtonText(juce::Graphics& g,
+                        juce::TextButton& button,
+                        bool /*shouldDrawButtonAsHighlighted*/,
+                        bool /*shouldDrawButtonAsDown*/) override
+    {
+        juce::Font font(getTextButtonFont(button, button.getHeight()));
+        g.setColour(button.findColour(button.getToggleState() ? juce::TextButton::textColourOnId
+                                                                : juce::TextButton::textColourOffId)
+                        .withMultipliedAlpha(button.isEnabled() ? 1.0f : 0.5f));
+        
+        // Same insets as LookAndFeel_V2::drawButtonText()
+        const int yIndent = juce::jmin(4, button.proportionOfHeight(0.3f));
+        const int cornerSize = juce::jmin(button.getHeight(), button.getWidth()) / 2;
+        const int fontHeight = juce::roundToInt(font.getHeight() * 0.6f);
+        const int leftIndent = juce::jmin(fontHeight, 2 + cornerSize / (button.isConnectedOnLeft() ? 4 : 2));
+        const int rightIndent = juce::jmin(fontHeight, 2 + cornerSize / (button.isConnectedOnRight() ? 4 : 2));
+        const int textWidth = button.getWidth() - leftIndent - rightIndent;
+        
+        if (textWidth > 0)
+            buttonTexts[&button].drawFitted(g, button.getButtonText(), font,
+                                            { leftIndent, yIndent, textWidth, button.getHeight() - yIndent * 2 },
+                                            juce::Justification::centred, 2);
+    }
+
+private:
+    std::map<const juce::Button*, CachedText> buttonTexts;
+};
+
 //==============================================================================
 /**
  * PlayModeButtons - Compact play mode selector buttons for the top bar
@@ -63,6 +101,9 @@ public:
 private:
     PatternModel& patternModel;
     
+    // Declared before the buttons so it outlives them
+    PlayModeButtonLookAndFeel buttonLookAndFeel;
+    
     juce::TextButton forwardButton;
     juce::TextButton backwardButton;
     juce::TextButton pendulumButton;
@@ -95,6 +136,7 @@ public:
 
 private:
     PatternModel& patternModel;
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
     
     std::unique_ptr<XYPadComponent> xyPad;
     juce::Label xyPadLabel;
@@ -126,6 +168,7 @@ public:
 
 private:
     PatternModel& patternModel;
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
     
     // Mode buttons
     juce::TextButton forwardButton;
@@ -0,0 +1,138 @@
+#include "PlaybackEngine.h"
+#include "PatternModel.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+using namespace SquareBeats;
+
+//==============================================================================
+// PlaybackEngine benchmarks
+// Run a release build; timings from debug builds are not meaningful.
+
+struct BlockStats {
+    long long noteEvents = 0;
+    long long pitchBendEvents = 0;
+    int maxEventsPerBlock = 0;
+    double totalMicroseconds = 0.0;
+    double maxMicroseconds = 0.0;
+};
+
+/**
+ * Pattern using all sixteen color channels, each with its own MIDI channel,
+ * four voices, a dense pitch waveform and overlapping squares
+ */
+void setUpSixteenChannelPattern(PatternModel& model, int pitchBendRange, int pitchBendRateHz) {
+    model.setLoopLength(2);
+    model.setTimeSignature(4, 4);
+    model.setNumColorChannels(MAX_COLOR_CHANNELS);
+    
+    PitchWaveform::Samples waveform(4097);
+    for (size_t i = 0; i < waveform.size(); ++i) {
+        waveform[i] = 7.0f * std::sin(static_cast<float>(i) * 0.013f) + 0.5f * std::sin(static_cast<float>(i) * 0.41f);
+    }
+    
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId) {
+        ColorChannelConfig config = model.getColorConfig(colorId);
+        config.midiChannel = colorId + 1;
+        config.polyphony = 4;
+        config.pitchWaveform = waveform;
+        config.pitchBendRange = pitchBendRange;
+        config.pitchBendRateHz = pitchBendRateHz;
+        model.setColorConfig(colorId, config);
+    }
+    
+    juce::Random random(42);
+    for (int i = 0; i < 16 * MAX_COLOR_CHANNELS; ++i) {
+        model.createSquare(random.nextFloat() * 0.9f, random.nextFloat() * 0.9f,
+                           0.05f + random.nextFloat() * 0.3f, 0.05f, i % MAX_COLOR_CHANNELS);
+    }
+}
+
+BlockStats runBlocks(PatternModel& model, double sampleRate, int blockSize, int numBlocks) {
+    PlaybackEngine engine;
+    engine.setPatternModel(&model);
+    engine.prepareToPlay(sampleRate);
+    engine.handleTransportChange(true, sampleRate, 120.0, 0.0, 0.0);
+    
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(4096);
+    
+    BlockStats stats;
+    for (int block = 0; block < numBlocks; ++block) {
+        midiMessages.clear();
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        engine.processBlock(buffer, midiMessages);
+        auto end = std::chrono::high_resolution_clock::now();
+        
+        double microseconds = std::chrono::duration<double, std::micro>(end - start).count();
+        stats.totalMicroseconds += microseconds;
+        stats.maxMicroseconds = std::max(stats.maxMicroseconds, microseconds);
+        
+        int blockEvents = 0;
+        for (const auto metadata : midiMessages) {
+            auto msg = metadata.getMessage();
+            if (msg.isPitchWheel()) {
+                ++stats.pitchBendEvents;
+            } else if (msg.isNoteOn() || msg.isNoteOff()) {
+                ++stats.noteEvents;
+            }
+            ++blockEvents;
+        }
+        stats.maxEventsPerBlock = std::max(stats.maxEventsPerBlock, blockEvents);
+    }
+    return stats;
+}
+
+void printStats(const char* label, const BlockStats& stats, double sampleRate, int blockSize, int numBlocks) {
+    double seconds = numBlocks * blockSize / sampleRate;
+    double budgetMicroseconds = blockSize / sampleRate * 1.0e6;
+    double meanMicroseconds = stats.totalMicroseconds / numBlocks;
+    
+    std::cout << std::fixed << std::setprecision(2)
+              << label << "\n"
+              << "  pitch-bends/s:      " << stats.pitchBendEvents / seconds << "\n"
+              << "  note events/s:      " << stats.noteEvents / seconds << "\n"
+              << "  max events/block:   " << stats.maxEventsPerBlock << "\n"
+              << "  mean us/block:      " << meanMicroseconds
+              << " (" << 100.0 * meanMicroseconds / budgetMicroseconds << "% of " << budgetMicroseconds << " us)\n"
+              << "  max us/block:       " << stats.maxMicroseconds << std::endl;
+}
+
+//==============================================================================
+// Benchmark: pitch-bend output at 1 kHz across all sixteen color channels
+void benchmarkPitchBendOutput() {
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+    const int numBlocks = 60 * static_cast<int>(sampleRate) / blockSize;  // One minute
+    
+    std::cout << "\n=== Benchmark: Pitch-bend output, 16 channels, "
+              << blockSize << "-sample blocks at " << sampleRate << " Hz ===" << std::endl;
+    
+    PatternModel noteNumbers;
+    setUpSixteenChannelPattern(noteNumbers, 0, DEFAULT_PITCH_BEND_RATE_HZ);
+    printStats("Pitch offsets in note numbers (no pitch-bend)",
+               runBlocks(noteNumbers, sampleRate, blockSize, numBlocks), sampleRate, blockSize, numBlocks);
+    
+    PatternModel bend1k;
+    setUpSixteenChannelPattern(bend1k, 12, 1000);
+    printStats("Pitch-bend at 1 kHz",
+               runBlocks(bend1k, sampleRate, blockSize, numBlocks), sampleRate, blockSize, numBlocks);
+    
+    PatternModel bendDefault;
+    setUpSixteenChannelPattern(bendDefault, 12, DEFAULT_PITCH_BEND_RATE_HZ);
+    printStats("Pitch-bend at default rate",
+               runBlocks(bendDefault, sampleRate, blockSize, numBlocks), sampleRate, blockSize, numBlocks);
+}
+
+int main() {
+    std::cout << "Running PlaybackEngine Benchmarks..." << std::endl;
+    
+    benchmarkPitchBendOutput();
+    
+    return 0;
+}
+
@@ -10,26 +10,37 @@ PlaybackEngine::PlaybackEngine()
     , currentPositionBeats(0.0)
     , absolutePositionBeats(0.0)
     , loopLengthBeats(0.0)
+    , numActiveColors(DEFAULT_COLOR_CHANNELS)
     , isPlaying(false)
     , sampleRate(44100.0)
     , bpm(120.0)
     , currentStepIndex(0)
     , totalSteps(16)
     , pendulumForward(true)
+    , blockDispatch(&modeDispatchTable[PLAY_FORWARD])
 {
     // Initialize per-color positions and pendulum directions
-    for (int i = 0; i < 4; ++i) {
+    for (int i = 0; i < MAX_COLOR_CHANNELS; ++i) {
         colorPositionBeats[i] = 0.0;
         colorLoopLengthBeats[i] = 0.0;
         colorPendulumForward[i] = true;
         colorCurrentStep[i] = 0;
+        colorStepCount[i] = 1;
+        colorBeatsPerStep[i] = 0.0;
+        lastPitchBend[i] = NO_PITCH_BEND;
+        samplesUntilPitchBend[i] = 0.0;
+        liveTranspose[i] = 0;
     }
+    
+    // Trigger lists are reused every block and never grow: squares past TRIGGER_LIST_CAPACITY count as dropped notes
+    triggerCandidates.reserve(TRIGGER_LIST_CAPACITY);
 }
 
 //==============================================================================
 void PlaybackEngine::setPatternModel(PatternModel* model)
 {
     pattern = model;
+    activePattern.store(model, std::memory_order_release);
     
     // Recalculate loop length when pattern changes
     if (pattern != nullptr) {
@@ -37,9 +48,10 @@ void PlaybackEngine::setPatternModel(PatternModel* model)
         double loopBars = pattern->getLoopLength();
         loopLengthBeats = loopBars * timeSig.getBeatsPerBar();
         totalSteps = calculateTotalSteps();
+        numActiveColors = pattern->getNumColorChannels();
         
         // Update per-color loop lengths
-        for (int colorId = 0; colorId < 4; ++colorId) {
+        for (int colorId = 0; colorId < numActiveColors; ++colorId) {
             const ColorChannelConfig& config = pattern->getColorConfig(colorId);
             if (config.mainLoopLengthBars > 0.0) {
                 // Use per-color override
@@ -48,6 +60,28 @@ void PlaybackEngine::setPatternModel(PatternModel* model)
                 // Use global loop length
                 colorLoopLengthBeats[colorId] = loopLengthBeats;
             }
+            updateColorStepGrid(colorId, timeSig.getBeatsPerBar());
+        }
+    }
+}
+
+void PlaybackEngine::prepareToPlay(double sr)
+{
+    if (sr > 0.0) {
+        sampleRate = sr;
+    }
+    
+    // Room for a block's worth of events in a split run, so the audio thread never grows it:
+    // every note-on may end a voice as well (9 bytes per event: sample, size and data)
+    runMessages.ensureSize(4096 + 2 * MAX_NOTES_PER_BLOCK * 9);
+    
+    // Playback is not running yet, so any tracked voices can be dropped silently
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId) {
+        voicePools[colorId].reset();
+        lastPitchBend[colorId] = NO_PITCH_BEND;
+        samplesUntilPitchBend[colorId] = 0.0;
+        if (pattern != nullptr) {
+            voicePools[colorId].setVoiceLimit(pattern->getColorConfig(colorId).polyphony);
         }
     }
 }
@@ -79,7 +113,6 @@ void PlaybackEngine::handleTransportChange(bool playing, double sr, double tempo
     if (wasPlaying && !isPlaying) {
         juce::MidiBuffer tempBuffer;
         stopAllNotes(tempBuffer);
-        activeNotesByColor.clear();
         
         // Clear all visual feedback states
         if (visualFeedback != nullptr) {
@@ -91,7 +124,7 @@ void PlaybackEngine::handleTransportChange(bool playing, double sr, double tempo
         pendulumForward = true;
         
         // Reset per-color positions, pendulum directions, and step indices
-        for (int i = 0; i < 4; ++i) {
+        for (int i = 0; i < MAX_COLOR_CHANNELS; ++i) {
             colorPositionBeats[i] = 0.0;
             colorPendulumForward[i] = true;
             colorCurrentStep[i] = 0;
@@ -125,9 +158,10 @@ void PlaybackEngine::handleTransportChange(bool playing, double sr, double tempo
         }
         
         pendulumForward = true;
+        numActiveColors = pattern->getNumColorChannels();
         
         // Sync per-color positions and pendulum directions
-        for (int colorId = 0; colorId < 4; ++colorId) {
+        for (int colorId = 0; colorId < numActiveColors; ++colorId) {
             colorPendulumForward[colorId] = true;
             
             if (colorLoopLengthBeats[colorId] > 0.0) {
@@ -162,179 +196,180 @@ void PlaybackEngine::updatePlaybackPosition(int numSamples)
     // Advance absolute position (for pitch sequencer - never wraps to main loop)
     absolutePositionBeats += beatsElapsed;
     
-    // Get play mode configuration
-    const PlayModeConfig& playModeConfig = pattern->getPlayModeConfig();
-    
-    // Get time signature for step calculations
-    TimeSignature timeSig = pattern->getTimeSignature();
-    
-    // Calculate step duration
-    totalSteps = calculateTotalSteps();
+    // Calculate step duration (totalSteps is refreshed by processBlock)
     double beatsPerStep = loopLengthBeats / totalSteps;
     
-    // Update per-color positions based on play mode
-    for (int colorId = 0; colorId < 4; ++colorId) {
+    // Per-color positions first, then the global position, using this block's mode
+    (this->*blockDispatch->advanceColors)(beatsElapsed);
+    (this->*blockDispatch->advanceGlobal)(beatsElapsed, beatsPerStep);
+}
+
+//==============================================================================
+const PlaybackEngine::ModeDispatch PlaybackEngine::modeDispatchTable[NUM_PLAY_MODES] = {
+    { &PlaybackEngine::advanceColors<PLAY_FORWARD>,
+      &PlaybackEngine::advanceGlobal<PLAY_FORWARD>,
+      &PlaybackEngine::triggerColors<PLAY_FORWARD> },
+    { &PlaybackEngine::advanceColors<PLAY_BACKWARD>,
+      &PlaybackEngine::advanceGlobal<PLAY_BACKWARD>,
+      &PlaybackEngine::triggerColors<PLAY_BACKWARD> },
+    { &PlaybackEngine::advanceColors<PLAY_PENDULUM>,
+      &PlaybackEngine::advanceGlobal<PLAY_PENDULUM>,
+      &PlaybackEngine::triggerColors<PLAY_PENDULUM> },
+    { &PlaybackEngine::advanceColors<PLAY_PROBABILITY>,
+      &PlaybackEngine::advanceGlobal<PLAY_PROBABILITY>,
+      &PlaybackEngine::triggerColors<PLAY_PROBABILITY> }
+};
+
+static_assert(NUM_PLAY_MODES == 4, "modeDispatchTable needs an entry for every PlayMode");
+
+const PlaybackEngine::ModeDispatch& PlaybackEngine::getModeDispatch(PlayMode mode)
+{
+    if (mode < 0 || mode >= NUM_PLAY_MODES) {
+        return modeDispatchTable[PLAY_FORWARD];
+    }
+    return modeDispatchTable[mode];
+}
+
+void PlaybackEngine::updateColorStepGrid(int colorId, double beatsPerBar)
+{
+    double colorLoopBeats = colorLoopLengthBeats[colorId];
+    if (colorLoopBeats <= 0.0 || beatsPerBar <= 0.0) {
+        colorStepCount[colorId] = 1;
+        colorBeatsPerStep[colorId] = 0.0;
+        return;
+    }
+    
+    // 1/16 note grid, matching calculateTotalSteps() for the global loop
+    colorStepCount[colorId] = std::max(1, static_cast<int>(colorLoopBeats / (beatsPerBar / 16.0)));
+    colorBeatsPerStep[colorId] = colorLoopBeats / colorStepCount[colorId];
+}
+
+//==============================================================================
+template <PlayMode Mode>
+void PlaybackEngine::advanceColors(double beatsElapsed)
+{
+    for (int colorId = 0; colorId < numActiveColors; ++colorId) {
         double colorLoopBeats = colorLoopLengthBeats[colorId];
         if (colorLoopBeats <= 0.0) continue;
         
-        switch (playModeConfig.mode) {
-            case PLAY_FORWARD:
-            default:
-                colorPositionBeats[colorId] += beatsElapsed;
-                if (colorPositionBeats[colorId] >= colorLoopBeats) {
-                    colorPositionBeats[colorId] = std::fmod(colorPositionBeats[colorId], colorLoopBeats);
-                }
-                break;
-                
-            case PLAY_BACKWARD:
-                colorPositionBeats[colorId] -= beatsElapsed;
-                if (colorPositionBeats[colorId] < 0.0) {
-                    colorPositionBeats[colorId] = colorLoopBeats + std::fmod(colorPositionBeats[colorId], colorLoopBeats);
-                }
-                break;
-                
-            case PLAY_PENDULUM:
-                // Each color has its own pendulum direction based on its own loop length
-                if (colorPendulumForward[colorId]) {
-                    colorPositionBeats[colorId] += beatsElapsed;
-                    if (colorPositionBeats[colorId] >= colorLoopBeats) {
-                        // Hit the end - bounce back
-                        colorPositionBeats[colorId] = colorLoopBeats - (colorPositionBeats[colorId] - colorLoopBeats);
-                        colorPendulumForward[colorId] = false;
-                    }
-                } else {
-                    colorPositionBeats[colorId] -= beatsElapsed;
-                    if (colorPositionBeats[colorId] <= 0.0) {
-                        // Hit the start - bounce forward
-                        colorPositionBeats[colorId] = -colorPositionBeats[colorId];
-                        colorPendulumForward[colorId] = true;
-                    }
+        double& position = colorPositionBeats[colorId];
+        
+        if constexpr (Mode == PLAY_BACKWARD) {
+            position -= beatsElapsed;
+            if (position < 0.0) {
+                position = colorLoopBeats + std::fmod(position, colorLoopBeats);
+            }
+        } else if constexpr (Mode == PLAY_PENDULUM) {
+            // Each color has its own pendulum direction based on its own loop length
+            if (colorPendulumForward[colorId]) {
+                position += beatsElapsed;
+                if (position >= colorLoopBeats) {
+                    // Hit the end - bounce back
+                    position = colorLoopBeats - (position - colorLoopBeats);
+                    colorPendulumForward[colorId] = false;
                 }
-                break;
-                
-            case PLAY_PROBABILITY:
-                // Each color advances normally and may jump forward on BEAT boundaries
-                // This makes jumps feel musical and quantized, not chaotic
-                {
-                    // Calculate steps for this color's loop
-                    int colorSteps = std::max(1, static_cast<int>(colorLoopBeats / (timeSig.getBeatsPerBar() / 16.0)));
-                    double beatsPerColorStep = colorLoopBeats / colorSteps;
-                    
-                    // Store previous position to detect beat crossings
-                    double previousColorPosition = colorPositionBeats[colorId];
-                    
-                    // Advance position normally
-                    colorPositionBeats[colorId] += beatsElapsed;
-                    if (colorPositionBeats[colorId] >= colorLoopBeats) {
-                        colorPositionBeats[colorId] = std::fmod(colorPositionBeats[colorId], colorLoopBeats);
-                    }
-                    
-                    // Check for jumps only on BEAT boundaries (not every 1/16 note)
-                    int currentBeat = static_cast<int>(colorPositionBeats[colorId]);
-                    int previousBeat = static_cast<int>(previousColorPosition);
-                    
-                    // If we crossed a beat boundary, check for jump
-                    if (currentBeat != previousBeat) {
-                        // Roll for probability jump
-                        if (randomGenerator.nextFloat() < playModeConfig.probability) {
-                            // Jump forward by musical step size (1, 2, 4, 8, or 16 steps)
-                            int jumpSteps = playModeConfig.getStepJumpSteps();
-                            colorCurrentStep[colorId] = (colorCurrentStep[colorId] + jumpSteps) % colorSteps;
-                            
-                            // Update position to match new step (quantized to step grid)
-                            colorPositionBeats[colorId] = colorCurrentStep[colorId] * beatsPerColorStep;
-                        } else {
-                            // Normal advance - update step index to match current position
-                            colorCurrentStep[colorId] = static_cast<int>(colorPositionBeats[colorId] / beatsPerColorStep) % colorSteps;
-                        }
-                    } else {
-                        // No beat boundary crossed - just update step index
-                        colorCurrentStep[colorId] = static_cast<int>(colorPositionBeats[colorId] / beatsPerColorStep) % colorSteps;
-                    }
+            } else {
+                position -= beatsElapsed;
+                if (position <= 0.0) {
+                    // Hit the start - bounce forward
+                    position = -position;
+                    colorPendulumForward[colorId] = true;
                 }
-                break;
+            }
+        } else if constexpr (Mode == PLAY_PROBABILITY) {
+            // Each color advances normally and may jump forward on BEAT boundaries
+            // This makes jumps feel musical and quantized, not chaotic
+            int colorSteps = colorStepCount[colorId];
+            double beatsPerColorStep = colorBeatsPerStep[colorId];
+            
+            // Store previous position to detect beat crossings
+            double previousColorPosition = position;
+            
+            // Advance position normally
+            position += beatsElapsed;
+            if (position >= colorLoopBeats) {
+                position = std::fmod(position, colorLoopBeats);
+            }
+            
+            // Check for jumps only on BEAT boundaries (not every 1/16 note)
+            int currentBeat = static_cast<int>(position);
+            int previousBeat = static_cast<int>(previousColorPosition);
+            
+            // If we crossed a beat boundary, roll for a jump
+            if (currentBeat != previousBeat && randomGenerator.nextFloat() < blockPlayMode.probability) {
+                // Jump forward by musical step size, quantized to the step grid
+                colorCurrentStep[colorId] = (colorCurrentStep[colorId] + blockPlayMode.getStepJumpSteps()) % colorSteps;
+                position = colorCurrentStep[colorId] * beatsPerColorStep;
+            } else {
+                // Normal advance - update step index to match current position
+                colorCurrentStep[colorId] = static_cast<int>(position / beatsPerColorStep) % colorSteps;
+            }
+        } else {
+            position += beatsElapsed;
+            if (position >= colorLoopBeats) {
+                position = std::fmod(position, colorLoopBeats);
+            }
         }
         
         // Ensure position stays in valid range
-        if (colorPositionBeats[colorId] < 0.0) {
-            colorPositionBeats[colorId] = 0.0;
+        if (position < 0.0) {
+            position = 0.0;
         }
-        if (colorPositionBeats[colorId] >= colorLoopBeats) {
-            colorPositionBeats[colorId] = std::fmod(colorPositionBeats[colorId], colorLoopBeats);
+        if (position >= colorLoopBeats) {
+            position = std::fmod(position, colorLoopBeats);
         }
     }
-    
-    // Advance position based on play mode (for global position tracking)
-    switch (playModeConfig.mode) {
-        case PLAY_FORWARD:
-        default:
+}
+
+template <PlayMode Mode>
+void PlaybackEngine::advanceGlobal(double beatsElapsed, double beatsPerStep)
+{
+    if constexpr (Mode == PLAY_BACKWARD) {
+        currentPositionBeats -= beatsElapsed;
+        if (currentPositionBeats < 0.0) {
+            currentPositionBeats = loopLengthBeats + std::fmod(currentPositionBeats, loopLengthBeats);
+        }
+        currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
+    } else if constexpr (Mode == PLAY_PENDULUM) {
+        if (pendulumForward) {
             currentPositionBeats += beatsElapsed;
-            if (loopLengthBeats > 0.0 && currentPositionBeats >= loopLengthBeats) {
-                currentPositionBeats = std::fmod(currentPositionBeats, loopLengthBeats);
+            if (currentPositionBeats >= loopLengthBeats) {
+                currentPositionBeats = loopLengthBeats - (currentPositionBeats - loopLengthBeats);
+                pendulumForward = false;
             }
-            currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
-            break;
-            
-        case PLAY_BACKWARD:
+        } else {
             currentPositionBeats -= beatsElapsed;
-            if (currentPositionBeats < 0.0) {
-                currentPositionBeats = loopLengthBeats + std::fmod(currentPositionBeats, loopLengthBeats);
-            }
-            currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
-            break;
-            
-        case PLAY_PENDULUM:
-            if (pendulumForward) {
-                currentPositionBeats += beatsElapsed;
-                if (currentPositionBeats >= loopLengthBeats) {
-                    currentPositionBeats = loopLengthBeats - (currentPositionBeats - loopLengthBeats);
-                    pendulumForward = false;
-                }
-            } else {
-                currentPositionBeats -= beatsElapsed;
-                if (currentPositionBeats <= 0.0) {
-                    currentPositionBeats = -currentPositionBeats;
-                    pendulumForward = true;
-                }
+            if (currentPositionBeats <= 0.0) {
+                currentPositionBeats = -currentPositionBeats;
+                pendulumForward = true;
             }
+        }
+        currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
+    } else if constexpr (Mode == PLAY_PROBABILITY) {
+        // In probability mode, we advance normally but may jump on BEAT boundaries
+        double previousPositionBeats = currentPositionBeats;
+        currentPositionBeats += beatsElapsed;
+        if (loopLengthBeats > 0.0 && currentPositionBeats >= loopLengthBeats) {
+            currentPositionBeats = std::fmod(currentPositionBeats, loopLengthBeats);
+        }
+        
+        int currentBeat = static_cast<int>(currentPositionBeats);
+        int previousBeat = static_cast<int>(previousPositionBeats);
+        
+        if (currentBeat != previousBeat && randomGenerator.nextFloat() < blockPlayMode.probability) {
+            // Jump forward by step jump size (always forward, matching per-color behavior)
+            currentStepIndex = (currentStepIndex + blockPlayMode.getStepJumpSteps()) % totalSteps;
+            currentPositionBeats = currentStepIndex * beatsPerStep;
+        } else {
+            // Normal advance - update step index to match current position
             currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
-            break;
-            
-        case PLAY_PROBABILITY:
-            // In probability mode, we advance normally but may jump on BEAT boundaries
-            // This makes jumps feel musical and quantized, not chaotic
-            {
-                double previousPositionBeats = currentPositionBeats;
-                currentPositionBeats += beatsElapsed;
-                if (loopLengthBeats > 0.0 && currentPositionBeats >= loopLengthBeats) {
-                    currentPositionBeats = std::fmod(currentPositionBeats, loopLengthBeats);
-                }
-                
-                // Check for jumps only on BEAT boundaries (not every 1/16 note)
-                // This gives musical, quantized jumps instead of chaotic randomness
-                int currentBeat = static_cast<int>(currentPositionBeats);
-                int previousBeat = static_cast<int>(previousPositionBeats);
-                
-                // If we crossed a beat boundary, check for jump
-                if (currentBeat != previousBeat) {
-                    // Roll for probability jump
-                    if (randomGenerator.nextFloat() < playModeConfig.probability) {
-                        // Jump forward by step jump size (always forward, matching per-color behavior)
-                        int jumpSteps = playModeConfig.getStepJumpSteps();
-                        currentStepIndex = (currentStepIndex + jumpSteps) % totalSteps;
-                        
-                        // Update position to match new step (quantized to step grid)
-                        currentPositionBeats = currentStepIndex * beatsPerStep;
-                    } else {
-                        // Normal advance - update step index to match current position
-                        currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
-                    }
-                } else {
-                    // No beat boundary crossed - just update step index
-                    currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
-                }
-            }
-            break;
+        }
+    } else {
+        currentPositionBeats += beatsElapsed;
+        if (loopLengthBeats > 0.0 && currentPositionBeats >= loopLengthBeats) {
+            currentPositionBeats = std::fmod(currentPositionBeats, loopLengthBeats);
+        }
+        currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
     }
     
     // Ensure position stays in valid range
@@ -346,6 +381,51 @@ void PlaybackEngine::updatePlaybackPosition(int numSamples)
     }
 }
 
+template <PlayMode Mode>
+void PlaybackEngine::triggerColors(juce::MidiBuffer& midiMessages, const double* colorBlockStartBeats)
+{
+    for (int colorId = 0; colorId < numActiveColors; ++colorId) {
+        double colorLoopBeats = colorLoopLengthBeats[colorId];
+        if (colorLoopBeats <= 0.0) continue;
+        
+        double colorStartBeats = colorBlockStartBeats[colorId];
+        double colorEndBeats = colorPositionBeats[colorId];
+        
+        if constexpr (Mode == PLAY_BACKWARD) {
+            if (colorEndBeats > colorStartBeats) {
+                // Wrapped around loop boundary
+                processColorTriggers(midiMessages, colorId, 0.0, colorStartBeats, colorLoopBeats);
+                processColorTriggers(midiMessages, colorId, colorEndBeats, colorLoopBeats, colorLoopBeats);
+            } else {
+                processColorTriggers(midiMessages, colorId, colorEndBeats, colorStartBeats, colorLoopBeats);
+            }
+        } else if constexpr (Mode == PLAY_PENDULUM) {
+            double minPos = std::min(colorStartBeats, colorEndBeats);
+            double maxPos = std::max(colorStartBeats, colorEndBeats);
+            processColorTriggers(midiMessages, colorId, minPos, maxPos, colorLoopBeats);
+        } else if constexpr (Mode == PLAY_PROBABILITY) {
+            // Trigger the whole step the playhead landed in, once, when it enters it
+            int colorSteps = colorStepCount[colorId];
+            double beatsPerStep = colorBeatsPerStep[colorId];
+            int currentColorStep = static_cast<int>(colorEndBeats / beatsPerStep) % colorSteps;
+            double stepStart = currentColorStep * beatsPerStep;
+            double stepEnd = stepStart + beatsPerStep;
+            
+            if (colorStartBeats < stepStart || colorStartBeats >= stepEnd) {
+                processColorTriggers(midiMessages, colorId, stepStart, stepEnd, colorLoopBeats);
+            }
+        } else {
+            if (colorEndBeats < colorStartBeats) {
+                // Wrapped around loop boundary
+                processColorTriggers(midiMessages, colorId, colorStartBeats, colorLoopBeats, colorLoopBeats);
+                processColorTriggers(midiMessages, colorId, 0.0, colorEndBeats, colorLoopBeats);
+            } else {
+                processColorTriggers(midiMessages, colorId, colorStartBeats, colorEndBeats, colorLoopBeats);
+            }
+        }
+    }
+}
+
 //==============================================================================
 float PlaybackEngine::getNormalizedPlaybackPosition() const
 {
@@ -357,7 +437,7 @@ float PlaybackEngine::getNormalizedPlaybackPosition() const
 
 float PlaybackEngine::getNormalizedPlaybackPositionForColor(int colorId) const
 {
-    if (colorId < 0 || colorId >= 4) {
+    if (colorId < 0 || colorId >= MAX_COLOR_CHANNELS) {
         return 0.0f;
     }
     
@@ -434,6 +514,15 @@ double PlaybackEngine::getPositionInBars() const
     return absolutePositionBeats / beatsPerBar;
 }
 
+double PlaybackEngine::getHostPositionBeatsAt(int sampleOffset) const
+{
+    if (sampleRate <= 0.0) {
+        return absolutePositionBeats;
+    }
+    
+    return absolutePositionBeats + sampleOffset * bpm / (60.0 * sampleRate);
+}
+
 void PlaybackEngine::resetPlaybackPosition()
 {
     // Stop all active notes when resetting
@@ -446,7 +535,7 @@ void PlaybackEngine::resetPlaybackPosition()
         absolutePositionBeats = 0.0;
         currentStepIndex = 0;
         
-        for (int i = 0; i < 4; ++i) {
+        for (int i = 0; i < MAX_COLOR_CHANNELS; ++i) {
             colorPositionBeats[i] = 0.0;
             colorPendulumForward[i] = true;
             colorCurrentStep[i] = 0;
@@ -474,6 +563,7 @@ void PlaybackEngine::resetPlaybackPosition()
     
     // Reset pendulum direction to forward
     pendulumForward = true;
+    numActiveColors = pattern->getNumColorChannels();
     
     // Calculate current step index
     TimeSignature timeSig = pattern->getTimeSignature();
@@ -481,7 +571,7 @@ void PlaybackEngine::resetPlaybackPosition()
     currentStepIndex = static_cast<int>(currentPositionBeats / beatsPerStep) % totalSteps;
     
     // Sync per-color positions based on their individual loop lengths
-    for (int colorId = 0; colorId < 4; ++colorId) {
+    for (int colorId = 0; colorId < numActiveColors; ++colorId) {
         colorPendulumForward[colorId] = true;
         
         if (colorLoopLengthBeats[colorId] > 0.0) {
@@ -500,9 +590,8 @@ void PlaybackEngine::resetPlaybackPosition()
             }
             
             // Calculate step index for this color (for probability mode)
-            int colorSteps = std::max(1, static_cast<int>(colorLoopLengthBeats[colorId] / (timeSig.getBeatsPerBar() / 16.0)));
-            double beatsPerColorStep = colorLoopLengthBeats[colorId] / colorSteps;
-            colorCurrentStep[colorId] = static_cast<int>(colorPositionBeats[colorId] / beatsPerColorStep) % colorSteps;
+            updateColorStepGrid(colorId, timeSig.getBeatsPerBar());
+            colorCurrentStep[colorId] = static_cast<int>(colorPositionBeats[colorId] / colorBeatsPerStep[colorId]) % colorStepCount[colorId];
         } else {
             colorPositionBeats[colorId] = 0.0;
             colorCurrentStep[colorId] = 0;
@@ -510,110 +599,303 @@ void PlaybackEngine::resetPlaybackPosition()
     }
 }
 
+void PlaybackEngine::schedulePatternSwitch(PatternModel* model, SwitchQuantize quantize, bool releaseNotes)
+{
+    // Settings first: the audio thread reads them after it sees the new pointer. With a single
+    // caller they belong to that switch or a later one, and a later switch to another model
+    // fails the audio thread's compare-exchange.
+    pendingQuantize.store(quantize, std::memory_order_relaxed);
+    pendingReleaseNotes.store(releaseNotes, std::memory_order_relaxed);
+    pendingPattern.store(model, std::memory_order_release);
+}
+
+void PlaybackEngine::setPatternCommandQueue(PatternCommandQueue* queue, PatternModel* target)
+{
+    commandQueue = queue;
+    editTarget = target;
+    publishedEditTarget.store(target, std::memory_order_release);
+}
+
+bool PlaybackEngine::cancelPatternSwitch(PatternModel* model)
+{
+    return model != nullptr && pendingPattern.compare_exchange_strong(model, nullptr);
+}
+
+bool PlaybackEngine::isPatternModelInUse(const PatternModel* model) const
+{
+    // Pending first: processBlock publishes a model as active before taking it off pending
+    return model != nullptr
+        && (pendingPattern.load() == model || activePattern.load() == model || publishedEditTarget.load() == model);
+}
+
+void PlaybackEngine::applyPatternCommands(juce::MidiBuffer& midiMessages)
+{
+    if (commandQueue == nullptr) {
+        return;
+    }
+    
+    uint64_t lastSequence = 0;
+    int numApplied = commandQueue->popAll([this, &midiMessages, &lastSequence](const PatternCommand& command) {
+        lastSequence = command.sequence;
+        
+        if (command.type != PatternCommand::REPLACE_PATTERN) {
+            if (editTarget != nullptr) {
+                editTarget->applyCommand(command);
+            }
+            return;
+        }
+        
+        // A fresh copy of the edited pattern: later edits go to it, and if the old copy
+        // was playing (or the sender asks for it), it plays from here on
+        PatternModel* replaced = editTarget;
+        editTarget = command.pattern;
+        publishedEditTarget.store(editTarget, std::memory_order_release);
+        
+        if (command.pattern != nullptr && (command.takePlayback || pattern == replaced)) {
+            switchBoundaryBeats = absolutePositionBeats;
+            switchPattern(midiMessages, command.pattern, command.releaseNotes, 0);
+        }
+    }, MAX_COMMANDS_PER_BLOCK);
+    
+    if (numApplied > 0) {
+        appliedCommandSequence.store(lastSequence, std::memory_order_release);
+    }
+}
+
+//==============================================================================
 void PlaybackEngine::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    int numSamples = buffer.getNumSamples();
+    blockNoteCount = 0;
+    
+    applyPatternCommands(midiMessages);
+    
+    PatternModel* nextPattern = pendingPattern.load(std::memory_order_acquire);
+    int switchOffset = -1;
+    if (nextPattern != nullptr) {
+        SwitchQuantize quantize = static_cast<SwitchQuantize>(pendingQuantize.load(std::memory_order_relaxed));
+        switchOffset = getPatternSwitchOffset(quantize, numSamples);
+    }
+    
+    // Render up to each automation change and the switch boundary in turn, then the rest
+    int position = 0;
+    int nextChange = 0;
+    bool switchPending = switchOffset >= 0;
+    for (;;) {
+        int runEnd = numSamples;
+        if (switchPending) {
+            runEnd = std::min(runEnd, switchOffset);
+        }
+        if (nextChange < numAutomationChanges) {
+            runEnd = std::min(runEnd, std::max(position, automationChanges[nextChange].sampleOffset));
+        }
+        
+        if (runEnd > position) {
+            renderRun(midiMessages, position, runEnd - position);
+            position = runEnd;
+        }
+        
+        // At the same sample, the switch comes first so the change applies to the new pattern
+        if (switchPending && switchOffset <= position) {
+            takePendingPattern(midiMessages, nextPattern, switchOffset);
+            switchPending = false;
+        } else if (nextChange < numAutomationChanges && automationChanges[nextChange].sampleOffset <= position) {
+            applyAutomationChange(automationChanges[nextChange++]);
+        } else if (position >= numSamples) {
+            break;
+        }
+    }
+    
+    // Changes past the block end take effect from the next block
+    while (nextChange < numAutomationChanges) {
+        applyAutomationChange(automationChanges[nextChange++]);
+    }
+    numAutomationChanges = 0;
+    commitLiveInputChanges();
+}
+
+void PlaybackEngine::renderRun(juce::MidiBuffer& midiMessages, int startOffset, int numSamples)
+{
+    renderStartOffset = startOffset;
+    if (startOffset == 0) {
+        renderSamples(midiMessages, numSamples);
+        return;
+    }
+    
+    runMessages.clear();
+    renderSamples(runMessages, numSamples);
+    midiMessages.addEvents(runMessages, 0, -1, startOffset);
+}
+
+void PlaybackEngine::takePendingPattern(juce::MidiBuffer& midiMessages, PatternModel* nextPattern, int switchOffset)
+{
+    // Publish the new model before taking it, so it is always pending or active while in use
+    bool releaseNotes = pendingReleaseNotes.load(std::memory_order_relaxed);
+    activePattern.store(nextPattern);
+    if (pendingPattern.compare_exchange_strong(nextPattern, nullptr)) {
+        switchPattern(midiMessages, nextPattern, releaseNotes, switchOffset);
+    } else {
+        activePattern.store(pattern);
+    }
+}
+
+void PlaybackEngine::addAutomationChange(const AutomationChange& change)
+{
+    // The oldest change then applies from the block start
+    if (numAutomationChanges == MAX_AUTOMATION_CHANGES) {
+        applyAutomationChange(automationChanges[0]);
+        std::copy(automationChanges + 1, automationChanges + numAutomationChanges, automationChanges);
+        --numAutomationChanges;
+    }
+    
+    // Keep sample order; changes at the same sample stay in the order they were added
+    int index = numAutomationChanges;
+    while (index > 0 && automationChanges[index - 1].sampleOffset > change.sampleOffset) {
+        automationChanges[index] = automationChanges[index - 1];
+        --index;
+    }
+    automationChanges[index] = change;
+    automationChanges[index].sampleOffset = std::max(0, change.sampleOffset);
+    ++numAutomationChanges;
+}
+
+void PlaybackEngine::applyAutomationChange(const AutomationChange& change)
+{
+    // Only the edited copy belongs to the audio thread; a staged or slot model picks the
+    // value up when the live model (mirrored from the parameters) is handed back
+    PatternModel* target = commandQueue != nullptr ? editTarget : pattern;
+    if (target != nullptr) {
+        target->applyAutomation(change);
+    }
+}
+
+int PlaybackEngine::getPatternSwitchOffset(SwitchQuantize quantize, int numSamples)
+{
+    switchBoundaryBeats = absolutePositionBeats;
+    
+    // Nothing is sounding while stopped, so there is nothing to wait for
+    if (!isPlaying || pattern == nullptr || quantize == SWITCH_IMMEDIATE || sampleRate <= 0.0 || bpm <= 0.0) {
+        return 0;
+    }
+    
+    TimeSignature timeSig = pattern->getTimeSignature();
+    if (timeSig.numerator <= 0 || timeSig.denominator <= 0) {
+        timeSig = TimeSignature(4, 4);
+    }
+    
+    double intervalBeats;
+    switch (quantize) {
+        case SWITCH_NEXT_BEAT: intervalBeats = 4.0 / timeSig.denominator; break;
+        case SWITCH_NEXT_BAR:  intervalBeats = timeSig.getBeatsPerBar(); break;
+        default:               intervalBeats = loopLengthBeats; break;
+    }
+    if (intervalBeats <= 0.0) {
+        return 0;
+    }
+    
+    // Boundaries sit on the host timeline, so loop starts line up with the forward playhead
+    const double epsilon = 1.0e-9;
+    double boundaryBeats = std::ceil(absolutePositionBeats / intervalBeats - epsilon) * intervalBeats;
+    double beatsPerSample = bpm / (60.0 * sampleRate);
+    
+    // Round down so the old pattern stops short of the boundary and the new one starts on it
+    double offset = std::floor((boundaryBeats - absolutePositionBeats) / beatsPerSample + epsilon);
+    if (offset >= numSamples) {
+        return -1;
+    }
+    
+    switchBoundaryBeats = std::max(boundaryBeats, absolutePositionBeats);
+    return std::max(0, static_cast<int>(offset));
+}
+
+void PlaybackEngine::switchPattern(juce::MidiBuffer& midiMessages, PatternModel* model, bool releaseNotes, int sampleOffset)
+{
+    if (releaseNotes && pattern != nullptr) {
+        // End the old pattern's notes and bends on the channels they were sent on
+        for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId) {
+            releaseColorVoices(midiMessages, colorId, sampleOffset);
+            if (lastPitchBend[colorId] != NO_PITCH_BEND && lastPitchBend[colorId] != 8192) {
+                int channel = pattern->getColorConfig(colorId).midiChannel;
+                midiMessages.addEvent(MIDIGenerator::createPitchBend(channel, 8192), sampleOffset);
+            }
+        }
+    }
+    
+    if (!releaseNotes) {
+        // An identical copy: carry on from exactly where we are
+        pattern = model;
+        activePattern.store(model, std::memory_order_release);
+        return;
+    }
+    
+    // Start the new pattern in time with the host from the boundary
+    absolutePositionBeats = switchBoundaryBeats;
+    setPatternModel(model);
+    resetPlaybackPosition();
+}
+
+//==============================================================================
+void PlaybackEngine::renderSamples(juce::MidiBuffer& midiMessages, int numSamples)
 {
     if (!isPlaying || pattern == nullptr) {
         return;
     }
     
+    // Resolve the play mode once for the whole block
+    blockPlayMode = pattern->getPlayModeConfig();
+    blockDispatch = &getModeDispatch(blockPlayMode.mode);
+    
+    // Release notes on channels that were switched off since the last block
+    int previousActiveColors = numActiveColors;
+    numActiveColors = pattern->getNumColorChannels();
+    for (int colorId = numActiveColors; colorId < previousActiveColors; ++colorId) {
+        releaseColorVoices(midiMessages, colorId, 0);
+    }
+    
     // Recalculate loop lengths in case they changed
     TimeSignature timeSig = pattern->getTimeSignature();
+    double beatsPerBar = timeSig.getBeatsPerBar();
     double loopBars = pattern->getLoopLength();
-    loopLengthBeats = loopBars * timeSig.getBeatsPerBar();
+    loopLengthBeats = loopBars * beatsPerBar;
+    totalSteps = calculateTotalSteps();
     
     // Update per-color loop lengths and sync positions for colors using global
-    for (int colorId = 0; colorId < 4; ++colorId) {
+    for (int colorId = 0; colorId < numActiveColors; ++colorId) {
         const ColorChannelConfig& config = pattern->getColorConfig(colorId);
         if (config.mainLoopLengthBars > 0.0) {
             // Using per-color override
-            colorLoopLengthBeats[colorId] = config.mainLoopLengthBars * timeSig.getBeatsPerBar();
+            colorLoopLengthBeats[colorId] = config.mainLoopLengthBars * beatsPerBar;
         } else {
             // Using global - sync position to global playhead
             colorLoopLengthBeats[colorId] = loopLengthBeats;
             colorPositionBeats[colorId] = currentPositionBeats;
         }
+        updateColorStepGrid(colorId, beatsPerBar);
+        applyVoiceLimit(midiMessages, colorId);
     }
     
-    int numSamples = buffer.getNumSamples();
-    
     // Store positions BEFORE updating
-    double blockStartBeats = currentPositionBeats;
-    double colorBlockStartBeats[4];
-    for (int i = 0; i < 4; ++i) {
+    double colorBlockStartBeats[MAX_COLOR_CHANNELS];
+    for (int i = 0; i < numActiveColors; ++i) {
         colorBlockStartBeats[i] = colorPositionBeats[i];
     }
+    double blockStartAbsoluteBeats = absolutePositionBeats;
     
     // Update playback position based on play mode
     updatePlaybackPosition(numSamples);
     
-    // Now we have end positions
-    double blockEndBeats = currentPositionBeats;
-    
-    // Get play mode to determine how to process triggers
-    const PlayModeConfig& playModeConfig = pattern->getPlayModeConfig();
-    
     // Process each color independently with its own loop length
-    for (int colorId = 0; colorId < 4; ++colorId) {
-        double colorLoopBeats = colorLoopLengthBeats[colorId];
-        if (colorLoopBeats <= 0.0) continue;
-        
-        double colorStartBeats = colorBlockStartBeats[colorId];
-        double colorEndBeats = colorPositionBeats[colorId];
-        
-        // Process square triggers based on play mode
-        switch (playModeConfig.mode) {
-            case PLAY_FORWARD:
-            default:
-                if (colorEndBeats < colorStartBeats) {
-                    // Wrapped around loop boundary
-                    processColorTriggers(midiMessages, colorId, colorStartBeats, colorLoopBeats, colorLoopBeats);
-                    processColorTriggers(midiMessages, colorId, 0.0, colorEndBeats, colorLoopBeats);
-                } else {
-                    processColorTriggers(midiMessages, colorId, colorStartBeats, colorEndBeats, colorLoopBeats);
-                }
-                break;
-                
-            case PLAY_BACKWARD:
-                if (colorEndBeats > colorStartBeats) {
-                    // Wrapped around loop boundary
-                    processColorTriggers(midiMessages, colorId, 0.0, colorStartBeats, colorLoopBeats);
-                    processColorTriggers(midiMessages, colorId, colorEndBeats, colorLoopBeats, colorLoopBeats);
-                } else {
-                    processColorTriggers(midiMessages, colorId, colorEndBeats, colorStartBeats, colorLoopBeats);
-                }
-                break;
-                
-            case PLAY_PENDULUM:
-            {
-                double minPos = std::min(colorStartBeats, colorEndBeats);
-                double maxPos = std::max(colorStartBeats, colorEndBeats);
-                processColorTriggers(midiMessages, colorId, minPos, maxPos, colorLoopBeats);
-            }
-            break;
-                
-            case PLAY_PROBABILITY:
-            {
-                // Calculate steps for this color's loop
-                int colorSteps = std::max(1, static_cast<int>(colorLoopBeats / (timeSig.getBeatsPerBar() / 16.0)));
-                double beatsPerStep = colorLoopBeats / colorSteps;
-                int currentColorStep = static_cast<int>(colorEndBeats / beatsPerStep) % colorSteps;
-                double stepStart = currentColorStep * beatsPerStep;
-                double stepEnd = stepStart + beatsPerStep;
-                
-                if (colorStartBeats < stepStart || colorStartBeats >= stepEnd) {
-                    processColorTriggers(midiMessages, colorId, stepStart, stepEnd, colorLoopBeats);
-                }
-            }
-            break;
-        }
-    }
+    (this->*blockDispatch->triggerColors)(midiMessages, colorBlockStartBeats);
+    
+    // Pitch-bend for colors that send the pitch sequencer continuously
+    sendPitchBends(midiMessages, blockStartAbsoluteBeats, numSamples);
 }
 
 //==============================================================================
 void PlaybackEngine::processColorTriggers(juce::MidiBuffer& midiMessages, int colorId,
                                          double startBeats, double endBeats, double loopBeats)
 {
-    if (pattern == nullptr || colorId < 0 || colorId >= 4) {
+    if (pattern == nullptr || colorId < 0 || colorId >= MAX_COLOR_CHANNELS) {
         return;
     }
     
@@ -631,17 +913,7 @@ void PlaybackEngine::processColorTriggers(juce::MidiBuffer& midiMessages, int co
     const ColorChannelConfig& config = pattern->getColorConfig(colorId);
     
     // Calculate quantization interval for this color
-    double beatsPerBar = timeSig.getBeatsPerBar();
-    double quantizeInterval;
-    switch (config.quantize) {
-        case Q_1_32: quantizeInterval = beatsPerBar / 32.0; break;
-        case Q_1_16: quantizeInterval = beatsPerBar / 16.0; break;
-        case Q_1_8:  quantizeInterval = beatsPerBar / 8.0;  break;
-        case Q_1_4:  quantizeInterval = beatsPerBar / 4.0;  break;
-        case Q_1_2:  quantizeInterval = beatsPerBar / 2.0;  break;
-        case Q_1_BAR: quantizeInterval = beatsPerBar;       break;
-        default:     quantizeInterval = beatsPerBar / 16.0; break;
-    }
+    double quantizeInterval = MIDIGenerator::getQuantizeInterval(config.quantize, timeSig);
     
     // Expand search range
     double expandedStartBeats = std::max(0.0, startBeats - quantizeInterval);
@@ -654,128 +926,19 @@ void PlaybackEngine::processColorTriggers(juce::MidiBuffer& midiMessages, int co
     // Handle wrap-around
     bool wrapsAroundLoop = endNormalized < startNormalized || endBeats > loopBeats;
     
-    // Get squares for this color only
-    std::vector<Square*> allSquares;
-    if (wrapsAroundLoop) {
-        auto squares1 = pattern->getSquaresInTimeRange(startNormalized, 1.0f);
-        auto squares2 = pattern->getSquaresInTimeRange(0.0f, endNormalized);
-        allSquares.insert(allSquares.end(), squares1.begin(), squares1.end());
-        allSquares.insert(allSquares.end(), squares2.begin(), squares2.end());
-    } else {
-        allSquares = pattern->getSquaresInTimeRange(startNormalized, endNormalized);
-    }
-    
-    // Filter to only this color
-    std::vector<Square*> squares;
-    for (Square* sq : allSquares) {
-        if (sq != nullptr && sq->colorChannelId == colorId) {
-            squares.push_back(sq);
-        }
-    }
-    
-    // Sort by gate time
-    std::stable_sort(squares.begin(), squares.end(), 
-        [loopBars, &timeSig](const Square* a, const Square* b) {
-            double gateA = normalizedToBeats(a->leftEdge, loopBars, timeSig);
-            double gateB = normalizedToBeats(b->leftEdge, loopBars, timeSig);
-            return gateA < gateB;
-        });
+    // Squares of this color that may trigger, sorted by gate time
+    collectTriggerCandidates(startNormalized, endNormalized, wrapsAroundLoop, colorId, loopBars, timeSig);
     
     // Process each square
-    for (Square* square : squares) {
-        if (square == nullptr) continue;
-        
-        // Calculate gate time
-        double gateTimeBeats = normalizedToBeats(square->leftEdge, loopBars, timeSig);
-        
-        // Apply quantization
-        double quantizedGateBeats = MIDIGenerator::applyQuantization(gateTimeBeats, config.quantize, timeSig);
-        
-        // Wrap to loop length
-        if (quantizedGateBeats >= loopBeats) {
-            quantizedGateBeats = std::fmod(quantizedGateBeats, loopBeats);
-        }
+    for (const TriggerCandidate& candidate : triggerCandidates) {
+        triggerSquare(midiMessages, *candidate.square, timeSig, loopBars, startBeats, endBeats, loopBeats, wrapsAroundLoop);
         
-        // Check if trigger is in block
-        bool triggerInBlock = false;
-        if (wrapsAroundLoop) {
-            double wrappedStart = std::fmod(startBeats, loopBeats);
-            double wrappedEnd = std::fmod(endBeats, loopBeats);
-            
-            if (wrappedEnd < wrappedStart) {
-                triggerInBlock = (quantizedGateBeats >= wrappedStart) || (quantizedGateBeats < wrappedEnd);
-            } else {
-                triggerInBlock = (quantizedGateBeats >= wrappedStart && quantizedGateBeats < wrappedEnd);
-            }
-        } else {
-            triggerInBlock = (quantizedGateBeats >= startBeats && quantizedGateBeats < endBeats);
-        }
-        
-        if (triggerInBlock) {
-            // Calculate sample offset
-            double blockDurationBeats = endBeats - startBeats;
-            int blockSamples = static_cast<int>(blockDurationBeats * 60.0 / bpm * sampleRate);
-            int sampleOffset = calculateSampleOffset(quantizedGateBeats, startBeats, blockSamples);
-            
-            // Monophonic: stop previous note
-            if (activeNotesByColor.find(colorId) != activeNotesByColor.end()) {
-                sendNoteOff(midiMessages, colorId, sampleOffset);
-            }
-            
-            // Send new note-on
-            sendNoteOn(midiMessages, *square, sampleOffset);
-            
-            // Track active note
-            double endTimeBeats = normalizedToBeats(square->getRightEdge(), loopBars, timeSig);
-            if (endTimeBeats > loopBeats) {
-                endTimeBeats = std::fmod(endTimeBeats, loopBeats);
-            }
-            
-            // Calculate pitch offset
-            float pitchOffset = 0.0f;
-            if (!config.pitchWaveform.empty()) {
-                // Use global loop length if pitchSeqLoopLengthBars is 0
-                double pitchSeqLoopBars = (config.pitchSeqLoopLengthBars > 0) 
-                    ? config.pitchSeqLoopLengthBars 
-                    : pattern->getLoopLength();
-                double pitchSeqLoopBeats = pitchSeqLoopBars * timeSig.getBeatsPerBar();
-                if (pitchSeqLoopBeats > 0.0) {
-                    double normalizedPitchSeqPos = std::fmod(absolutePositionBeats, pitchSeqLoopBeats) / pitchSeqLoopBeats;
-                    pitchOffset = config.getPitchOffsetAt(normalizedPitchSeqPos);
-                }
-            }
-            
-            int midiNote = MIDIGenerator::calculateMidiNote(*square, config, pitchOffset, pattern->getActiveScale(getPositionInBars()));
-            activeNotesByColor[colorId] = {midiNote, colorId, endTimeBeats};
-        }
-        
-        // Check if note should end
-        auto activeIt = activeNotesByColor.find(colorId);
-        if (activeIt != activeNotesByColor.end()) {
-            double noteEndBeats = activeIt->second.endTime;
-            
-            bool noteEndsInBlock = false;
-            if (wrapsAroundLoop) {
-                double wrappedStart = std::fmod(startBeats, loopBeats);
-                double wrappedEnd = std::fmod(endBeats, loopBeats);
-                
-                if (wrappedEnd < wrappedStart) {
-                    noteEndsInBlock = (noteEndBeats >= wrappedStart) || (noteEndBeats < wrappedEnd);
-                } else {
-                    noteEndsInBlock = (noteEndBeats >= wrappedStart && noteEndBeats < wrappedEnd);
-                }
-            } else {
-                noteEndsInBlock = (noteEndBeats >= startBeats && noteEndBeats < endBeats);
-            }
-            
-            if (noteEndsInBlock) {
-                double blockDurationBeats = endBeats - startBeats;
-                int blockSamples = static_cast<int>(blockDurationBeats * 60.0 / bpm * sampleRate);
-                int sampleOffset = calculateSampleOffset(noteEndBeats, startBeats, blockSamples);
-                sendNoteOff(midiMessages, colorId, sampleOffset);
-            }
-        }
+        // Release voices that end in this block
+        releaseEndingVoices(midiMessages, colorId, startBeats, endBeats, loopBeats, wrapsAroundLoop);
     }
+    
+    // Voices also end in blocks where no square starts
+    releaseEndingVoices(midiMessages, colorId, startBeats, endBeats, loopBeats, wrapsAroundLoop);
 }
 
 //==============================================================================
@@ -800,19 +963,9 @@ void PlaybackEngine::processSquareTriggers(juce::MidiBuffer& midiMessages,
     // Calculate the maximum quantization interval across all color channels
     // This determines how much we need to expand our search range
     double maxQuantizeInterval = 0.0;
-    double beatsPerBar = timeSig.getBeatsPerBar();
-    for (int colorId = 0; colorId < 4; ++colorId) {
+    for (int colorId = 0; colorId < numActiveColors; ++colorId) {
         const ColorChannelConfig& config = pattern->getColorConfig(colorId);
-        double quantizeInterval;
-        switch (config.quantize) {
-            case Q_1_32: quantizeInterval = beatsPerBar / 32.0; break;
-            case Q_1_16: quantizeInterval = beatsPerBar / 16.0; break;
-            case Q_1_8:  quantizeInterval = beatsPerBar / 8.0;  break;
-            case Q_1_4:  quantizeInterval = beatsPerBar / 4.0;  break;
-            case Q_1_2:  quantizeInterval = beatsPerBar / 2.0;  break;
-            case Q_1_BAR: quantizeInterval = beatsPerBar;       break;
-            default:     quantizeInterval = beatsPerBar / 16.0; break;
-        }
+        double quantizeInterval = MIDIGenerator::getQuantizeInterval(config.quantize, timeSig);
         maxQuantizeInterval = std::max(maxQuantizeInterval, quantizeInterval);
     }
     
@@ -834,191 +987,223 @@ void PlaybackEngine::processSquareTriggers(juce::MidiBuffer& midiMessages,
     // Handle loop wrap-around (squares spanning loop boundaries)
     bool wrapsAroundLoop = endNormalized < startNormalized || endBeats > loopLengthBeats;
     
-    std::vector<Square*> squares;
-    if (wrapsAroundLoop) {
-        // Query two ranges: [start, 1.0] and [0.0, end]
-        auto squares1 = pattern->getSquaresInTimeRange(startNormalized, 1.0f);
-        auto squares2 = pattern->getSquaresInTimeRange(0.0f, endNormalized);
-        squares.insert(squares.end(), squares1.begin(), squares1.end());
-        squares.insert(squares.end(), squares2.begin(), squares2.end());
-    } else {
-        squares = pattern->getSquaresInTimeRange(startNormalized, endNormalized);
-    }
-    
     // Sort squares by gate time to handle multiple squares on same quantized time consistently
-    // Process in order of creation (stable sort preserves original order for equal elements)
-    std::stable_sort(squares.begin(), squares.end(), 
-        [loopBars, &timeSig](const Square* a, const Square* b) {
-            double gateA = normalizedToBeats(a->leftEdge, loopBars, timeSig);
-            double gateB = normalizedToBeats(b->leftEdge, loopBars, timeSig);
-            return gateA < gateB;
-        });
+    // (squares with the same gate time keep the order they were found in)
+    collectTriggerCandidates(startNormalized, endNormalized, wrapsAroundLoop, ALL_COLORS, loopBars, timeSig);
     
     // Process each square
-    for (Square* square : squares) {
-        if (square == nullptr) continue;
+    for (const TriggerCandidate& candidate : triggerCandidates) {
+        triggerSquare(midiMessages, *candidate.square, timeSig, loopBars, startBeats, endBeats, loopLengthBeats,
+                      wrapsAroundLoop);
         
-        int colorId = square->colorChannelId;
-        const ColorChannelConfig& config = pattern->getColorConfig(colorId);
+        // Release voices of this color that end in this block
+        releaseEndingVoices(midiMessages, candidate.square->colorChannelId, startBeats, endBeats, loopLengthBeats,
+                            wrapsAroundLoop);
+    }
+    
+    // Voices also end in blocks where no square starts
+    for (int colorId = 0; colorId < numActiveColors; ++colorId) {
+        releaseEndingVoices(midiMessages, colorId, startBeats, endBeats, loopLengthBeats, wrapsAroundLoop);
+    }
+}
+
+//==============================================================================
+void PlaybackEngine::collectTriggerCandidates(float startNormalized, float endNormalized, bool wrapsAroundLoop,
+                                              int colorId, double loopBars, const TimeSignature& timeSig)
+{
+    // Only squares that can start a note in the range: those whose gate falls in it (the range
+    // already allows for quantization and groove) and ratcheted ones overlapping it. The list
+    // never grows past the capacity reserved up front; squares beyond it are dropped and counted.
+    auto startsInRange = [](const Square& square, float rangeStart, float rangeEnd) {
+        if (square.ratchet.count > 1) {
+            return square.leftEdge < rangeEnd && square.getRightEdge() > rangeStart;
+        }
+        return square.leftEdge >= rangeStart && square.leftEdge < rangeEnd;
+    };
+    
+    triggerCandidates.clear();
+    for (const Square& square : pattern->getSquares()) {
+        // Squares on channels not in use are kept in the pattern but not played
+        if (colorId == ALL_COLORS ? square.colorChannelId >= numActiveColors : square.colorChannelId != colorId) {
+            continue;
+        }
         
-        // Calculate gate time (left edge of square)
-        double gateTimeBeats = normalizedToBeats(square->leftEdge, loopBars, timeSig);
+        // A range across the loop boundary is [start, 1.0] and [0.0, end]
+        bool inRange = wrapsAroundLoop
+            ? startsInRange(square, startNormalized, 1.0f) || startsInRange(square, 0.0f, endNormalized)
+            : startsInRange(square, startNormalized, endNormalized);
+        if (!inRange) {
+            continue;
+        }
         
-        // Apply quantization
-        double quantizedGateBeats = MIDIGenerator::applyQuantization(gateTimeBeats, config.quantize, timeSig);
+        if (triggerCandidates.size() == TRIGGER_LIST_CAPACITY) {
+            numDroppedNotes.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
         
-        // Wrap quantized gate time to loop length
-        if (quantizedGateBeats >= loopLengthBeats) {
-            quantizedGateBeats = std::fmod(quantizedGateBeats, loopLengthBeats);
+        double gateBeats = normalizedToBeats(square.leftEdge, loopBars, timeSig);
+        triggerCandidates.push_back({ gateBeats, static_cast<int>(triggerCandidates.size()), &square });
+    }
+    
+    // A stable sort by gate time, without the buffer std::stable_sort allocates
+    std::sort(triggerCandidates.begin(), triggerCandidates.end(),
+        [](const TriggerCandidate& a, const TriggerCandidate& b) {
+            return a.gateBeats < b.gateBeats || (a.gateBeats == b.gateBeats && a.order < b.order);
+        });
+}
+
+void PlaybackEngine::triggerSquare(juce::MidiBuffer& midiMessages, const Square& square, const TimeSignature& timeSig,
+                                   double loopBars, double startBeats, double endBeats, double loopBeats,
+                                   bool wrapsAroundLoop)
+{
+    const ColorChannelConfig& config = pattern->getColorConfig(square.colorChannelId);
+    
+    // Calculate gate time (left edge of square)
+    double gateTimeBeats = normalizedToBeats(square.leftEdge, loopBars, timeSig);
+    
+    // Apply quantization
+    double quantizeInterval = MIDIGenerator::getQuantizeInterval(config.quantize, timeSig);
+    double quantizedGateBeats = MIDIGenerator::applyQuantization(gateTimeBeats, config.quantize, timeSig);
+    
+    // Groove offsets of the grid step it landed on (zero when straight); the first
+    // step of the loop is never pulled back into the previous loop
+    const Groove::Step& grooveStep = config.groove.getStep(std::llround(quantizedGateBeats / quantizeInterval));
+    double grooveOffsetBeats = std::max(grooveStep.timing * quantizeInterval, -quantizedGateBeats);
+    quantizedGateBeats += grooveOffsetBeats;
+    
+    // Note-off time, moved with the note
+    double squareEndBeats = normalizedToBeats(square.getRightEdge(), loopBars, timeSig) + grooveOffsetBeats;
+    
+    // Ratchet repeats that start before the square ends (the first always plays)
+    const Ratchet& ratchet = square.ratchet;
+    double ratchetInterval = MIDIGenerator::getQuantizeInterval(ratchet.rate, timeSig);
+    int numRepeats = 1;
+    if (ratchet.count > 1) {
+        double repeatsInSquare = std::ceil((squareEndBeats - quantizedGateBeats) / ratchetInterval - 1.0e-9);
+        numRepeats = static_cast<int>(juce::jlimit(1.0, static_cast<double>(ratchet.count), repeatsInSquare));
+    }
+    
+    for (int repeat = 0; repeat < numRepeats; ++repeat) {
+        double triggerBeats = quantizedGateBeats + repeat * ratchetInterval;
+        
+        // Each repeat lasts until the next one; a single note lasts the whole square
+        double endTimeBeats = squareEndBeats;
+        if (numRepeats > 1) {
+            endTimeBeats = std::min(triggerBeats + ratchetInterval, squareEndBeats);
+        }
+        
+        // Wrap to loop length
+        if (triggerBeats >= loopBeats) {
+            triggerBeats = std::fmod(triggerBeats, loopBeats);
         }
         
-        // Check if this trigger falls within current block
+        // Check if trigger is in block
         bool triggerInBlock = false;
         if (wrapsAroundLoop) {
             // Handle wrap-around case: trigger is in block if it's after start OR before end
-            double wrappedStart = std::fmod(startBeats, loopLengthBeats);
-            double wrappedEnd = std::fmod(endBeats, loopLengthBeats);
+            double wrappedStart = std::fmod(startBeats, loopBeats);
+            double wrappedEnd = std::fmod(endBeats, loopBeats);
             
             if (wrappedEnd < wrappedStart) {
-                // Block wraps around loop boundary
-                triggerInBlock = (quantizedGateBeats >= wrappedStart) || (quantizedGateBeats < wrappedEnd);
+                triggerInBlock = (triggerBeats >= wrappedStart) || (triggerBeats < wrappedEnd);
             } else {
-                triggerInBlock = (quantizedGateBeats >= wrappedStart && quantizedGateBeats < wrappedEnd);
+                triggerInBlock = (triggerBeats >= wrappedStart && triggerBeats < wrappedEnd);
             }
         } else {
-            triggerInBlock = (quantizedGateBeats >= startBeats && quantizedGateBeats < endBeats);
+            triggerInBlock = (triggerBeats >= startBeats && triggerBeats < endBeats);
         }
         
-        if (triggerInBlock) {
-            // Calculate sample offset for this trigger
-            double blockDurationBeats = endBeats - startBeats;
-            int blockSamples = static_cast<int>(blockDurationBeats * 60.0 / bpm * sampleRate);
-            int sampleOffset = calculateSampleOffset(quantizedGateBeats, startBeats, blockSamples);
-            
-            // If a note is already playing for this color, send note-off first (monophonic)
-            if (activeNotesByColor.find(colorId) != activeNotesByColor.end()) {
-                sendNoteOff(midiMessages, colorId, sampleOffset);
-            }
-            
-            // Send new note-on
-            sendNoteOn(midiMessages, *square, sampleOffset);
-            
-            // Track active note with end time
-            double endTimeBeats = normalizedToBeats(square->getRightEdge(), loopBars, timeSig);
-            
-            // Wrap end time to loop length if square spans loop boundary
-            if (endTimeBeats > loopLengthBeats) {
-                endTimeBeats = std::fmod(endTimeBeats, loopLengthBeats);
-            }
-            
-            // Calculate pitch offset for tracking (same logic as in sendNoteOn)
-            // Pitch modulation is always applied regardless of editing mode
-            float pitchOffset = 0.0f;
-            if (!config.pitchWaveform.empty()) {
-                // Use global loop length if pitchSeqLoopLengthBars is 0
-                double pitchSeqLoopBars = (config.pitchSeqLoopLengthBars > 0) 
-                    ? config.pitchSeqLoopLengthBars 
-                    : pattern->getLoopLength();
-                double pitchSeqLoopBeats = pitchSeqLoopBars * timeSig.getBeatsPerBar();
-                if (pitchSeqLoopBeats > 0.0) {
-                    // Use absolute position so pitch sequencer runs independently of main loop
-                    double normalizedPitchSeqPos = std::fmod(absolutePositionBeats, pitchSeqLoopBeats) / pitchSeqLoopBeats;
-                    pitchOffset = config.getPitchOffsetAt(normalizedPitchSeqPos);
-                }
-            }
-            
-            int midiNote = MIDIGenerator::calculateMidiNote(*square, config, pitchOffset, pattern->getActiveScale(getPositionInBars()));
-            activeNotesByColor[colorId] = {midiNote, colorId, endTimeBeats};
+        if (!triggerInBlock) {
+            continue;
         }
         
-        // Check if note should end in this block
-        auto activeIt = activeNotesByColor.find(colorId);
-        if (activeIt != activeNotesByColor.end()) {
-            double noteEndBeats = activeIt->second.endTime;
-            
-            bool noteEndsInBlock = false;
-            if (wrapsAroundLoop) {
-                double wrappedStart = std::fmod(startBeats, loopLengthBeats);
-                double wrappedEnd = std::fmod(endBeats, loopLengthBeats);
-                
-                if (wrappedEnd < wrappedStart) {
-                    noteEndsInBlock = (noteEndBeats >= wrappedStart) || (noteEndBeats < wrappedEnd);
-                } else {
-                    noteEndsInBlock = (noteEndBeats >= wrappedStart && noteEndBeats < wrappedEnd);
-                }
-            } else {
-                noteEndsInBlock = (noteEndBeats >= startBeats && noteEndBeats < endBeats);
-            }
-            
-            if (noteEndsInBlock) {
-                double blockDurationBeats = endBeats - startBeats;
-                int blockSamples = static_cast<int>(blockDurationBeats * 60.0 / bpm * sampleRate);
-                int sampleOffset = calculateSampleOffset(noteEndBeats, startBeats, blockSamples);
-                sendNoteOff(midiMessages, colorId, sampleOffset);
-            }
+        // Calculate sample offset
+        double blockDurationBeats = endBeats - startBeats;
+        int blockSamples = static_cast<int>(blockDurationBeats * 60.0 / bpm * sampleRate);
+        int sampleOffset = calculateSampleOffset(triggerBeats, startBeats, blockSamples);
+        
+        // Wrap end time to loop length if the note spans the loop boundary
+        if (endTimeBeats > loopBeats) {
+            endTimeBeats = std::fmod(endTimeBeats, loopBeats);
+        }
+        
+        // Repeats ramp from the square's velocity to the ramped one on the last repeat
+        int velocityOffset = grooveStep.velocity;
+        if (repeat > 0) {
+            float rampPosition = static_cast<float>(repeat) / static_cast<float>(numRepeats - 1);
+            velocityOffset += juce::roundToInt(static_cast<float>(MIDIGenerator::calculateVelocity(square))
+                                               * ratchet.velocityRamp * rampPosition);
         }
+        
+        sendNoteOn(midiMessages, square, endTimeBeats, sampleOffset, velocityOffset);
     }
 }
 
 //==============================================================================
-void PlaybackEngine::sendNoteOff(juce::MidiBuffer& midiMessages, int colorId, int sampleOffset)
+void PlaybackEngine::sendNoteOff(juce::MidiBuffer& midiMessages, int colorId, int voiceSlot, int sampleOffset)
 {
-    auto it = activeNotesByColor.find(colorId);
-    if (it == activeNotesByColor.end()) {
-        return;
-    }
-    
-    const ActiveNote& activeNote = it->second;
+    VoicePool& pool = voicePools[colorId];
     const ColorChannelConfig& config = pattern->getColorConfig(colorId);
     
-    juce::MidiMessage noteOff = MIDIGenerator::createNoteOff(config.midiChannel, activeNote.midiNote);
+    juce::MidiMessage noteOff = MIDIGenerator::createNoteOff(config.midiChannel, pool.getVoice(voiceSlot).midiNote);
     midiMessages.addEvent(noteOff, sampleOffset);
     
-    // Trigger visual feedback for gate-off
-    if (visualFeedback != nullptr) {
+    pool.stopVoice(voiceSlot);
+    
+    // Trigger visual feedback for gate-off once the color falls silent
+    if (visualFeedback != nullptr && pool.isEmpty()) {
         visualFeedback->triggerGateOff(colorId);
     }
-    
-    // Remove from active notes
-    activeNotesByColor.erase(it);
 }
 
 //==============================================================================
-void PlaybackEngine::sendNoteOn(juce::MidiBuffer& midiMessages, const Square& square, int sampleOffset)
+void PlaybackEngine::sendNoteOn(juce::MidiBuffer& midiMessages, const Square& square, double endTimeBeats, int sampleOffset,
+                                int velocityOffset)
 {
     if (pattern == nullptr) {
         return;
     }
     
+    // Past the block's limit, notes are dropped (and counted) so dense ratchets stay bounded
+    if (blockNoteCount == MAX_NOTES_PER_BLOCK) {
+        numDroppedNotes.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ++blockNoteCount;
+    
     int colorId = square.colorChannelId;
     const ColorChannelConfig& config = pattern->getColorConfig(colorId);
     
     // Get pitch offset from the color's pitch waveform
     // Pitch modulation is always applied regardless of editing mode
-    float pitchOffset = 0.0f;
+    float pitchOffset = getPitchOffsetAtBeats(config, absolutePositionBeats);
     
-    if (!config.pitchWaveform.empty()) {
-        // Use absolute position so pitch sequencer runs independently of main loop
-        TimeSignature timeSig = pattern->getTimeSignature();
-        
-        // Use global loop length if pitchSeqLoopLengthBars is 0
-        double pitchSeqLoopBars = (config.pitchSeqLoopLengthBars > 0) 
-            ? config.pitchSeqLoopLengthBars 
-            : pattern->getLoopLength();
-        double pitchSeqLoopBeats = pitchSeqLoopBars * timeSig.getBeatsPerBar();
-        
-        // Validate pitch sequencer loop length
-        if (pitchSeqLoopBeats > 0.0) {
-            // Normalize absolute position to pitch sequencer's loop
-            double normalizedPitchSeqPos = std::fmod(absolutePositionBeats, pitchSeqLoopBeats) / pitchSeqLoopBeats;
-            
-            pitchOffset = config.getPitchOffsetAt(normalizedPitchSeqPos);
-        }
+    // With pitch-bend output the offset is sent as a bend ahead of the note instead
+    if (config.pitchBendRange > 0) {
+        sendPitchBend(midiMessages, colorId, pitchOffset, sampleOffset);
+        pitchOffset = 0.0f;
     }
     
-    // Calculate MIDI note and velocity
-    int midiNote = MIDIGenerator::calculateMidiNote(square, config, pitchOffset, pattern->getActiveScale(getPositionInBars()));
-    int velocity = MIDIGenerator::calculateVelocity(square);
+    // Calculate MIDI note and velocity: a moved scale root snaps to the shifted scale,
+    // a live transpose moves the snapped note
+    int transpose = 0;
+    int scaleShift = 0;
+    getLiveInputAt(colorId, renderStartOffset + sampleOffset, transpose, scaleShift);
+    
+    int midiNote = MIDIGenerator::calculateMidiNote(square, config, pitchOffset - static_cast<float>(scaleShift),
+                                                    pattern->getActiveNoteTable(getPositionInBars()));
+    midiNote = juce::jlimit(0, 127, midiNote + scaleShift + transpose);
+    int velocity = juce::jlimit(1, 127, MIDIGenerator::calculateVelocity(square) + velocityOffset);
+    
+    // Free a voice: retrigger the same pitch, otherwise steal if the pool is full
+    VoicePool& pool = voicePools[colorId];
+    int voiceSlot = pool.findVoiceForNote(midiNote);
+    if (voiceSlot == VoicePool::NO_VOICE && pool.isFull()) {
+        voiceSlot = pool.chooseVoiceToSteal(config.stealPolicy, midiNote);
+    }
+    if (voiceSlot != VoicePool::NO_VOICE) {
+        sendNoteOff(midiMessages, colorId, voiceSlot, sampleOffset);
+    }
     
     // Create and add note-on message
     juce::MidiMessage noteOn = MIDIGenerator::createNoteOn(config.midiChannel, midiNote, velocity);
@@ -1028,6 +1213,214 @@ void PlaybackEngine::sendNoteOn(juce::MidiBuffer& midiMessages, const Square& sq
     if (visualFeedback != nullptr) {
         visualFeedback->triggerGateOn(colorId, velocity, square.uniqueId);
     }
+    
+    pool.startVoice(midiNote, velocity, endTimeBeats);
+}
+
+//==============================================================================
+void PlaybackEngine::setLiveTranspose(int colorId, int semitones, int sampleOffset)
+{
+    if (colorId != ALL_COLORS && (colorId < 0 || colorId >= MAX_COLOR_CHANNELS)) {
+        return;
+    }
+    
+    addLiveInputChange({ std::max(0, sampleOffset), false, colorId, juce::jlimit(-127, 127, semitones) });
+}
+
+void PlaybackEngine::setLiveScaleRoot(int rootNote, int sampleOffset)
+{
+    if (rootNote != NO_LIVE_SCALE_ROOT && (rootNote < 0 || rootNote >= 12)) {
+        return;
+    }
+    
+    addLiveInputChange({ std::max(0, sampleOffset), true, ALL_COLORS, rootNote });
+}
+
+void PlaybackEngine::addLiveInputChange(const LiveInputChange& change)
+{
+    // The oldest change then applies from the block start, but the state after the block stays right
+    if (numLiveInputChanges == MAX_LIVE_INPUT_CHANGES) {
+        applyLiveInputChange(liveInputChanges[0]);
+        std::copy(liveInputChanges + 1, liveInputChanges + numLiveInputChanges, liveInputChanges);
+        --numLiveInputChanges;
+    }
+    
+    liveInputChanges[numLiveInputChanges++] = change;
+}
+
+void PlaybackEngine::applyLiveInputChange(const LiveInputChange& change)
+{
+    if (change.isScaleRoot) {
+        liveScaleRoot = change.value;
+    } else if (change.colorId == ALL_COLORS) {
+        std::fill(liveTranspose, liveTranspose + MAX_COLOR_CHANNELS, change.value);
+    } else {
+        liveTranspose[change.colorId] = change.value;
+    }
+}
+
+void PlaybackEngine::commitLiveInputChanges()
+{
+    for (int i = 0; i < numLiveInputChanges; ++i) {
+        applyLiveInputChange(liveInputChanges[i]);
+    }
+    numLiveInputChanges = 0;
+}
+
+void PlaybackEngine::getLiveInputAt(int colorId, int blockOffset, int& transpose, int& scaleShift) const
+{
+    transpose = liveTranspose[colorId];
+    int scaleRoot = liveScaleRoot;
+    
+    for (int i = 0; i < numLiveInputChanges && liveInputChanges[i].sampleOffset <= blockOffset; ++i) {
+        const LiveInputChange& change = liveInputChanges[i];
+        if (change.isScaleRoot) {
+            scaleRoot = change.value;
+        } else if (change.colorId == ALL_COLORS || change.colorId == colorId) {
+            transpose = change.value;
+        }
+    }
+    
+    // Shift the scale the shorter way round, so notes stay near where they were drawn
+    scaleShift = 0;
+    if (scaleRoot != NO_LIVE_SCALE_ROOT && pattern != nullptr) {
+        scaleShift = (scaleRoot - static_cast<int>(pattern->getScaleConfig().rootNote) + 12) % 12;
+        if (scaleShift > 6) {
+            scaleShift -= 12;
+        }
+    }
+}
+
+//==============================================================================
+float PlaybackEngine::getPitchOffsetAtBeats(const ColorChannelConfig& config, double absoluteBeats) const
+{
+    if (config.pitchWaveform.empty()) {
+        return 0.0f;
+    }
+    
+    // Use global loop length if pitchSeqLoopLengthBars is 0
+    TimeSignature timeSig = pattern->getTimeSignature();
+    double pitchSeqLoopBars = (config.pitchSeqLoopLengthBars > 0) 
+        ? config.pitchSeqLoopLengthBars 
+        : pattern->getLoopLength();
+    double pitchSeqLoopBeats = pitchSeqLoopBars * timeSig.getBeatsPerBar();
+    
+    // Validate pitch sequencer loop length
+    if (pitchSeqLoopBeats <= 0.0) {
+        return 0.0f;
+    }
+    
+    // Normalize absolute position to pitch sequencer's loop
+    double normalizedPitchSeqPos = std::fmod(absoluteBeats, pitchSeqLoopBeats) / pitchSeqLoopBeats;
+    return config.getPitchOffsetAt(normalizedPitchSeqPos);
+}
+
+void PlaybackEngine::sendPitchBend(juce::MidiBuffer& midiMessages, int colorId, float pitchOffset, int sampleOffset)
+{
+    const ColorChannelConfig& config = pattern->getColorConfig(colorId);
+    int value = MIDIGenerator::calculatePitchBend(pitchOffset, config.pitchBendRange);
+    
+    // Repeating the last value would only add traffic for the synth
+    if (value == lastPitchBend[colorId]) {
+        return;
+    }
+    
+    midiMessages.addEvent(MIDIGenerator::createPitchBend(config.midiChannel, value), sampleOffset);
+    lastPitchBend[colorId] = value;
+}
+
+void PlaybackEngine::sendPitchBends(juce::MidiBuffer& midiMessages, double blockStartBeats, int numSamples)
+{
+    if (numSamples <= 0 || sampleRate <= 0.0 || bpm <= 0.0) {
+        return;
+    }
+    
+    double beatsPerSample = bpm / (60.0 * sampleRate);
+    
+    for (int colorId = 0; colorId < numActiveColors; ++colorId) {
+        const ColorChannelConfig& config = pattern->getColorConfig(colorId);
+        
+        // Pitch-bend output off: recentre once if a bend was left applied
+        if (config.pitchBendRange <= 0) {
+            if (lastPitchBend[colorId] != NO_PITCH_BEND && lastPitchBend[colorId] != 8192) {
+                midiMessages.addEvent(MIDIGenerator::createPitchBend(config.midiChannel, 8192), 0);
+            }
+            lastPitchBend[colorId] = NO_PITCH_BEND;
+            continue;
+        }
+        
+        // Ticks stay on the control-rate grid between notes; a rate change takes effect at the next tick
+        double tickInterval = sampleRate / config.pitchBendRateHz;
+        double& countdown = samplesUntilPitchBend[colorId];
+        countdown = std::min(countdown, tickInterval);
+        
+        bool notesHeld = !voicePools[colorId].isEmpty();
+        for (; countdown < numSamples; countdown += tickInterval) {
+            if (notesHeld) {
+                int sampleOffset = static_cast<int>(countdown);
+                float pitchOffset = getPitchOffsetAtBeats(config, blockStartBeats + sampleOffset * beatsPerSample);
+                sendPitchBend(midiMessages, colorId, pitchOffset, sampleOffset);
+            }
+        }
+        countdown -= numSamples;
+    }
+}
+
+//==============================================================================
+void PlaybackEngine::releaseEndingVoices(juce::MidiBuffer& midiMessages, int colorId,
+                                         double startBeats, double endBeats, double loopBeats, bool wrapsAroundLoop)
+{
+    VoicePool& pool = voicePools[colorId];
+    if (pool.isEmpty()) {
+        return;
+    }
+    
+    double wrappedStart = startBeats;
+    double wrappedEnd = endBeats;
+    if (wrapsAroundLoop) {
+        wrappedStart = std::fmod(startBeats, loopBeats);
+        wrappedEnd = std::fmod(endBeats, loopBeats);
+    }
+    
+    int slot = pool.getOldest();
+    while (slot != VoicePool::NO_VOICE) {
+        int nextSlot = pool.getVoice(slot).next;
+        double noteEndBeats = pool.getVoice(slot).endTime;
+        
+        bool noteEndsInBlock = false;
+        if (wrapsAroundLoop && wrappedEnd < wrappedStart) {
+            noteEndsInBlock = (noteEndBeats >= wrappedStart) || (noteEndBeats < wrappedEnd);
+        } else {
+            noteEndsInBlock = (noteEndBeats >= wrappedStart && noteEndBeats < wrappedEnd);
+        }
+        
+        if (noteEndsInBlock) {
+            double blockDurationBeats = endBeats - startBeats;
+            int blockSamples = static_cast<int>(blockDurationBeats * 60.0 / bpm * sampleRate);
+            int sampleOffset = calculateSampleOffset(noteEndBeats, startBeats, blockSamples);
+            sendNoteOff(midiMessages, colorId, slot, sampleOffset);
+        }
+        
+        slot = nextSlot;
+    }
+}
+
+void PlaybackEngine::releaseColorVoices(juce::MidiBuffer& midiMessages, int colorId, int sampleOffset)
+{
+    VoicePool& pool = voicePools[colorId];
+    while (!pool.isEmpty()) {
+        sendNoteOff(midiMessages, colorId, pool.getOldest(), sampleOffset);
+    }
+}
+
+void PlaybackEngine::applyVoiceLimit(juce::MidiBuffer& midiMessages, int colorId)
+{
+    VoicePool& pool = voicePools[colorId];
+    pool.setVoiceLimit(pattern->getColorConfig(colorId).polyphony);
+    
+    while (pool.isOverLimit()) {
+        sendNoteOff(midiMessages, colorId, pool.getOldest(), 0);
+    }
 }
 
 //==============================================================================
@@ -1052,15 +1445,23 @@ int PlaybackEngine::calculateSampleOffset(double timeBeats, double blockStartBea
 //==============================================================================
 void PlaybackEngine::stopAllNotes(juce::MidiBuffer& midiMessages)
 {
-    for (const auto& pair : activeNotesByColor) {
-        const ActiveNote& activeNote = pair.second;
-        const ColorChannelConfig& config = pattern->getColorConfig(activeNote.colorChannelId);
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId) {
+        VoicePool& pool = voicePools[colorId];
+        if (pool.isEmpty()) continue;
         
-        juce::MidiMessage noteOff = MIDIGenerator::createNoteOff(config.midiChannel, activeNote.midiNote);
-        midiMessages.addEvent(noteOff, 0);
+        const ColorChannelConfig& config = pattern->getColorConfig(colorId);
+        for (int slot = pool.getOldest(); slot != VoicePool::NO_VOICE; slot = pool.getVoice(slot).next) {
+            juce::MidiMessage noteOff = MIDIGenerator::createNoteOff(config.midiChannel, pool.getVoice(slot).midiNote);
+            midiMessages.addEvent(noteOff, 0);
+        }
+        
+        pool.reset();
     }
     
-    activeNotesByColor.clear();
+    // The synth's bend state is unknown from here; the next note sends a fresh one
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId) {
+        lastPitchBend[colorId] = NO_PITCH_BEND;
+    }
 }
 
 //==============================================================================
@@ -3,9 +3,11 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "DataStructures.h"
 #include "PatternModel.h"
+#include "PatternCommand.h"
 #include "MIDIGenerator.h"
 #include "VisualFeedback.h"
-#include <map>
+#include "VoicePool.h"
+#include <atomic>
 
 namespace SquareBeats {
 
@@ -17,8 +19,12 @@ namespace SquareBeats {
  * - Synchronize with host DAW transport (tempo, play/stop state)
  * - Advance playback position based on tempo
  * - Handle loop boundaries
- * - Detect square triggers and generate MIDI events
- * - Manage monophonic voice allocation per color channel
+ * - Detect square triggers and generate MIDI events (one per ratchet repeat,
+ *   at most MAX_NOTES_PER_BLOCK note-ons per block)
+ * - Allocate voices per color channel (bounded polyphony with voice stealing)
+ * - Send pitch sequencer curves as rate-limited pitch-bend where enabled
+ * - Swap to a prepared pattern model at a musical boundary (quantized switching)
+ * - Transpose notes or move the scale root from live MIDI input, sample-accurately
  */
 class PlaybackEngine {
 public:
@@ -29,9 +35,120 @@ public:
     //==============================================================================
     /**
      * Set the pattern model to use for playback
+     * Not safe while processBlock() may run; use schedulePatternSwitch() during playback.
      */
     void setPatternModel(PatternModel* model);
     
+    /**
+     * Set the queue of pattern edits to apply at the start of each block (see PatternSync)
+     * Not safe while processBlock() may run. The queue must outlive its use here.
+     * @param queue Commands to apply, or nullptr for none
+     * @param target Model the commands edit until a REPLACE_PATTERN command names another
+     */
+    void setPatternCommandQueue(PatternCommandQueue* queue, PatternModel* target);
+    
+    /**
+     * Sequence number of the last command applied by the audio thread
+     */
+    uint64_t getAppliedCommandSequence() const { return appliedCommandSequence.load(std::memory_order_acquire); }
+    
+    // Upper bound on commands applied at the start of one block; the rest wait for the next
+    static constexpr int MAX_COMMANDS_PER_BLOCK = 256;
+    
+    /**
+     * Schedule a switch to another pattern model (message thread)
+     *
+     * The model must be fully prepared beforehand: the audio thread only
+     * exchanges a pointer at the first boundary it reaches, splitting the block
+     * there, so the cost does not depend on the pattern's size. While stopped
+     * the switch happens at the next block. The model must stay alive until
+     * getActivePatternModel() returns something else. Only one thread may
+     * schedule switches, as the settings are stored apart from the pointer.
+     * @param model Pattern to play from the boundary on
+     * @param quantize Boundary to wait for
+     * @param releaseNotes End the old pattern's notes at the boundary and resync
+     *                     positions to the host (false when switching to an identical copy)
+     */
+    void schedulePatternSwitch(PatternModel* model, SwitchQuantize quantize, bool releaseNotes);
+    
+    /**
+     * Withdraw a pending switch to a model
+     * @return false if the audio thread has already taken it (or it was never pending)
+     */
+    bool cancelPatternSwitch(PatternModel* model);
+    
+    /**
+     * Whether a scheduled switch has not happened yet
+     */
+    bool isPatternSwitchPending() const { return pendingPattern.load() != nullptr; }
+    
+    /**
+     * The pattern model the audio thread is currently playing
+     */
+    PatternModel* getActivePatternModel() const { return activePattern.load(); }
+    
+    /**
+     * Whether the audio thread may still read a model (pending, playing or receiving commands)
+     * A model for which this returns false can be freed once nothing schedules it again.
+     */
+    bool isPatternModelInUse(const PatternModel* model) const;
+    
+    /**
+     * Transpose a color's notes from a sample of the coming block on (audio thread, before processBlock())
+     *
+     * Live input changes must be made in sample order. Each one applies to notes
+     * triggered from its sample offset on and stays in effect after the block.
+     * @param colorId Color to transpose, or ALL_COLORS
+     * @param semitones Transpose added after scale snapping
+     * @param sampleOffset Sample within the coming block
+     */
+    void setLiveTranspose(int colorId, int semitones, int sampleOffset);
+    
+    /**
+     * Move the scale root from a sample of the coming block on (audio thread, before processBlock())
+     * The pattern's scale is shifted so its root lands on this key; a scale
+     * sequence is shifted by the same interval.
+     * @param rootNote Key (0-11, C = 0), or NO_LIVE_SCALE_ROOT for the pattern's own root
+     * @param sampleOffset Sample within the coming block
+     */
+    void setLiveScaleRoot(int rootNote, int sampleOffset);
+    
+    static constexpr int ALL_COLORS = -1;
+    static constexpr int NO_LIVE_SCALE_ROOT = -1;
+    
+    // Live input changes kept per block; beyond this the oldest take effect from the block start
+    static constexpr int MAX_LIVE_INPUT_CHANGES = 64;
+    
+    /**
+     * Automate a setting from a sample of the coming block on (audio thread, before processBlock())
+     * The block is rendered in runs split at each change, which is applied to the
+     * pattern copy the engine edits (or, without a command queue, the one it plays).
+     */
+    void addAutomationChange(const AutomationChange& change);
+    
+    // Automation changes kept per block; beyond this the oldest take effect from the block start
+    static constexpr int MAX_AUTOMATION_CHANGES = 256;
+    
+    // Note-ons sent per block; beyond this notes are dropped. Each note-on ends at most
+    // one voice, so this also bounds the block's note-offs.
+    static constexpr int MAX_NOTES_PER_BLOCK = 512;
+    
+    // Squares that may start a note in one block; beyond this they are dropped and counted
+    static constexpr size_t TRIGGER_LIST_CAPACITY = 4096;
+    
+    /**
+     * Notes dropped by the per-block limits since the engine was created (any thread)
+     */
+    int getNumDroppedNotes() const { return numDroppedNotes.load(std::memory_order_relaxed); }
+    
+    /**
+     * Prepare for playback (call from the processor's prepareToPlay)
+     * Voice pools are fixed-size members, so this only resets them and applies
+     * each color's polyphony; nothing is allocated here or on the audio thread.
+     * @param sampleRate Sample rate playback will run at
+     */
+    void prepareToPlay(double sampleRate);
+    
     /**
      * Handle transport state changes from host DAW
      * @param isPlaying Whether transport is playing
@@ -58,13 +175,13 @@ public:
     
     /**
      * Get the current playback position for a specific color as a normalized value (0.0 to 1.0)
-     * @param colorId Color channel ID (0-3)
+     * @param colorId Color channel ID (0 to MAX_COLOR_CHANNELS - 1)
      */
     float getNormalizedPlaybackPositionForColor(int colorId) const;
     
     /**
      * Get the current pitch sequencer position for a specific color as a normalized value (0.0 to 1.0)
-     * @param colorId Color channel ID (0-3)
+     * @param colorId Color channel ID (0 to MAX_COLOR_CHANNELS - 1)
      */
     float getNormalizedPitchSeqPosition(int colorId) const;
     
@@ -78,6 +195,13 @@ public:
      */
     double getPositionInBars() const;
     
+    /**
+     * Get the host timeline position in beats at a sample within the current block
+     * (call after handleTransportChange(), before processBlock())
+     * @param sampleOffset Sample offset from the start of the block
+     */
+    double getHostPositionBeatsAt(int sampleOffset) const;
+    
     /**
      * Check if playback is currently active
      */
@@ -105,18 +229,8 @@ public:
      * Get the visual feedback state
      */
     VisualFeedbackState* getVisualFeedbackState() const { return visualFeedback; }
-    
+
 private:
-    //==============================================================================
-    /**
-     * Active note information for monophonic voice management
-     */
-    struct ActiveNote {
-        int midiNote;        // MIDI note number currently playing
-        int colorChannelId;  // Color channel this note belongs to
-        double endTime;      // When to send note-off (in beats, normalized to loop)
-    };
-    
     //==============================================================================
     // Data members
     PatternModel* pattern;
@@ -124,11 +238,13 @@ private:
     double absolutePositionBeats; // Absolute playback position in beats (for pitch sequencer)
     double loopLengthBeats;       // Loop length in beats
     
-    // Per-color playback positions (for independent loop lengths)
-    double colorPositionBeats[4];  // Current position for each color
-    double colorLoopLengthBeats[4]; // Loop length for each color
-    bool colorPendulumForward[4];  // Per-color pendulum direction
-    int colorCurrentStep[4];       // Per-color step index for probability mode
+    // Per-color playback state, one slot per possible channel (for independent loop lengths)
+    // Only the first numActiveColors slots are advanced each block.
+    int numActiveColors;                               // Color channels in use this block
+    double colorPositionBeats[MAX_COLOR_CHANNELS];     // Current position for each color
+    double colorLoopLengthBeats[MAX_COLOR_CHANNELS];   // Loop length for each color
+    bool colorPendulumForward[MAX_COLOR_CHANNELS];     // Per-color pendulum direction
+    int colorCurrentStep[MAX_COLOR_CHANNELS];          // Per-color step index for probability mode
     
     bool isPlaying;               // Transport play state
     double sampleRate;            // Current sample rate
@@ -140,21 +256,197 @@ private:
     bool pendulumForward;         // Global direction in pendulum mode (for global position tracking)
     juce::Random randomGenerator; // For probability mode
     
-    // Monophonic voice management: one active note per color channel
-    std::map<int, ActiveNote> activeNotesByColor;
+    // Per-color probability step grid (1/16 steps), refreshed with the loop lengths
+    int colorStepCount[MAX_COLOR_CHANNELS];        // Number of steps in each color's loop
+    double colorBeatsPerStep[MAX_COLOR_CHANNELS];  // Step duration for each color
+    
+    //==============================================================================
+    /**
+     * Per-mode advance and trigger routines, resolved once per block.
+     * Each entry points at the PlayMode instantiation of the templated helpers
+     * below, so the per-color loops never switch on the mode.
+     */
+    struct ModeDispatch {
+        void (PlaybackEngine::*advanceColors)(double beatsElapsed);
+        void (PlaybackEngine::*advanceGlobal)(double beatsElapsed, double beatsPerStep);
+        void (PlaybackEngine::*triggerColors)(juce::MidiBuffer& midiMessages, const double* colorBlockStartBeats);
+    };
+    
+    static const ModeDispatch modeDispatchTable[NUM_PLAY_MODES];
+    
+    PlayModeConfig blockPlayMode;         // Play mode snapshot taken at the start of each block
+    const ModeDispatch* blockDispatch;    // Routines for blockPlayMode.mode
+    
+    // Voice allocation: one fixed-capacity pool per color channel
+    VoicePool voicePools[MAX_COLOR_CHANNELS];
+    
+    // Pitch-bend output per color channel (colors with a pitch-bend range only)
+    static constexpr int NO_PITCH_BEND = -1;
+    int lastPitchBend[MAX_COLOR_CHANNELS];             // Last value sent, or NO_PITCH_BEND if unknown
+    double samplesUntilPitchBend[MAX_COLOR_CHANNELS];  // Samples to the next control-rate tick
     
     // Visual feedback state (owned by processor, shared with UI)
     VisualFeedbackState* visualFeedback = nullptr;
     
+    // Pattern switching: written by the message thread, taken by the audio thread
+    std::atomic<PatternModel*> pendingPattern { nullptr };
+    std::atomic<int> pendingQuantize { SWITCH_IMMEDIATE };
+    std::atomic<bool> pendingReleaseNotes { true };
+    std::atomic<PatternModel*> activePattern { nullptr };  // Published copy of pattern
+    double switchBoundaryBeats = 0.0;                      // Absolute beat the current switch lands on
+    juce::MidiBuffer runMessages;                          // Events of a run after the block start, before shifting
+    
+    // Pattern edits: commands are applied to editTarget, which REPLACE_PATTERN commands change
+    PatternCommandQueue* commandQueue = nullptr;
+    PatternModel* editTarget = nullptr;
+    std::atomic<PatternModel*> publishedEditTarget { nullptr };  // Published copy of editTarget
+    std::atomic<uint64_t> appliedCommandSequence { 0 };
+    
+    // Live input: the state at the start of the block, plus this block's changes in sample order
+    struct LiveInputChange {
+        int sampleOffset;
+        bool isScaleRoot;  // Otherwise a transpose of colorId
+        int colorId;
+        int value;
+    };
+    int liveTranspose[MAX_COLOR_CHANNELS];
+    int liveScaleRoot = NO_LIVE_SCALE_ROOT;
+    LiveInputChange liveInputChanges[MAX_LIVE_INPUT_CHANGES];
+    int numLiveInputChanges = 0;
+    int renderStartOffset = 0;  // Block offset of the run renderSamples() is working on
+    
+    // Automation: this block's changes in sample order
+    AutomationChange automationChanges[MAX_AUTOMATION_CHANGES];
+    int numAutomationChanges = 0;
+    
+    // Trigger detection: the squares that may start a note in a range, sorted by gate time
+    struct TriggerCandidate {
+        double gateBeats;      // Left edge, before quantization
+        int order;             // Position found in, so equal gate times keep the pattern's order
+        const Square* square;
+    };
+    std::vector<TriggerCandidate> triggerCandidates;
+    
+    // Note limit: note-ons sent in the current block, and notes dropped beyond MAX_NOTES_PER_BLOCK
+    // (or squares beyond TRIGGER_LIST_CAPACITY)
+    int blockNoteCount = 0;
+    std::atomic<int> numDroppedNotes { 0 };
+    
     //==============================================================================
     // Helper methods
     
+    /**
+     * Advance playback over a run of samples and generate its MIDI
+     * @param midiMessages MIDI buffer to add messages to (offsets relative to the run)
+     * @param numSamples Number of samples in the run
+     */
+    void renderSamples(juce::MidiBuffer& midiMessages, int numSamples);
+    
+    /**
+     * Render a run starting part-way into the block
+     * @param midiMessages MIDI buffer for the whole block
+     * @param startOffset Block offset the run starts at
+     * @param numSamples Number of samples in the run
+     */
+    void renderRun(juce::MidiBuffer& midiMessages, int startOffset, int numSamples);
+    
+    /**
+     * Take over the pending pattern at a block offset (if it is still pending)
+     */
+    void takePendingPattern(juce::MidiBuffer& midiMessages, PatternModel* nextPattern, int switchOffset);
+    
+    /**
+     * Apply an automation change to the pattern copy the engine edits
+     */
+    void applyAutomationChange(const AutomationChange& change);
+    
+    /**
+     * Record a live input change, folding the oldest into the block's start state if the list is full
+     */
+    void addLiveInputChange(const LiveInputChange& change);
+    
+    /**
+     * Apply a live input change to the state at the start of the block
+     */
+    void applyLiveInputChange(const LiveInputChange& change);
+    
+    /**
+     * Make this block's live input changes the state for the next block
+     */
+    void commitLiveInputChanges();
+    
+    /**
+     * Transpose and scale shift in effect for a color at a sample of the block
+     * @param scaleShift Semitones the active scale is moved by (-5 to 6)
+     */
+    void getLiveInputAt(int colorId, int blockOffset, int& transpose, int& scaleShift) const;
+    
+    /**
+     * Apply queued pattern commands (audio thread, start of each block)
+     * @param midiMessages MIDI buffer for note-offs when a replaced pattern takes over playback
+     */
+    void applyPatternCommands(juce::MidiBuffer& midiMessages);
+    
+    /**
+     * Sample offset of the pending switch's boundary within the coming block
+     * Also sets switchBoundaryBeats.
+     * @param quantize Boundary the switch waits for
+     * @param numSamples Number of samples in the block
+     * @return Offset within the block, or -1 if the boundary is beyond it
+     */
+    int getPatternSwitchOffset(SwitchQuantize quantize, int numSamples);
+    
+    /**
+     * Make a scheduled pattern the one being played (audio thread)
+     * @param midiMessages MIDI buffer to add note-offs to
+     * @param model Pattern to switch to
+     * @param releaseNotes Whether to end held notes and resync positions
+     * @param sampleOffset Sample offset of the switch within the block
+     */
+    void switchPattern(juce::MidiBuffer& midiMessages, PatternModel* model, bool releaseNotes, int sampleOffset);
+    
     /**
      * Update playback position based on buffer size and tempo
+     * Uses the play mode snapshot and dispatch selected by processBlock.
      * @param numSamples Number of samples in current buffer
      */
     void updatePlaybackPosition(int numSamples);
     
+    /**
+     * Get the dispatch entry for a play mode (out-of-range modes play forward)
+     */
+    static const ModeDispatch& getModeDispatch(PlayMode mode);
+    
+    /**
+     * Recalculate the probability step grid for one color from its loop length
+     * @param colorId Color channel ID (0 to MAX_COLOR_CHANNELS - 1)
+     * @param beatsPerBar Beats per bar of the current time signature
+     */
+    void updateColorStepGrid(int colorId, double beatsPerBar);
+    
+    /**
+     * Advance every color's position for one block in a fixed play mode
+     * @param beatsElapsed Beats covered by the block
+     */
+    template <PlayMode Mode>
+    void advanceColors(double beatsElapsed);
+    
+    /**
+     * Advance the global playhead and step index for one block in a fixed play mode
+     * @param beatsElapsed Beats covered by the block
+     * @param beatsPerStep Duration of one global step
+     */
+    template <PlayMode Mode>
+    void advanceGlobal(double beatsElapsed, double beatsPerStep);
+    
+    /**
+     * Fire square triggers for every color over the block in a fixed play mode
+     * @param midiMessages MIDI buffer to add messages to
+     * @param colorBlockStartBeats Per-color positions before the block was advanced
+     */
+    template <PlayMode Mode>
+    void triggerColors(juce::MidiBuffer& midiMessages, const double* colorBlockStartBeats);
+    
     /**
      * Process square triggers in the current time range
      * @param midiMessages MIDI buffer to add messages to
@@ -166,7 +458,7 @@ private:
     /**
      * Process square triggers for a specific color channel
      * @param midiMessages MIDI buffer to add messages to
-     * @param colorId Color channel ID (0-3)
+     * @param colorId Color channel ID (0 to MAX_COLOR_CHANNELS - 1)
      * @param startBeats Start of time range (in beats)
      * @param endBeats End of time range (in beats)
      * @param loopBeats Loop length for this color
@@ -175,20 +467,107 @@ private:
                               double startBeats, double endBeats, double loopBeats);
     
     /**
-     * Send note-off for a color channel
+     * Fill triggerCandidates with the squares that may start a note in a normalized range, sorted by gate time
+     * At most TRIGGER_LIST_CAPACITY squares are kept; the rest count as dropped notes.
+     * @param startNormalized Start of range (normalized)
+     * @param endNormalized End of range (normalized)
+     * @param wrapsAroundLoop Whether the range crosses the loop boundary (queried as two ranges)
+     * @param colorId Color channel ID, or ALL_COLORS
+     * @param loopBars Loop length the squares are placed in
+     * @param timeSig Time signature
+     */
+    void collectTriggerCandidates(float startNormalized, float endNormalized, bool wrapsAroundLoop,
+                                  int colorId, double loopBars, const TimeSignature& timeSig);
+    
+    /**
+     * Send a square's note-ons that fall in a time range: one, or one per ratchet repeat
+     * @param midiMessages MIDI buffer to add messages to
+     * @param square Square to trigger
+     * @param timeSig Time signature
+     * @param loopBars Loop length the square is placed in
+     * @param startBeats Start of time range (in beats)
+     * @param endBeats End of time range (in beats)
+     * @param loopBeats Loop length the range and note times are wrapped to
+     * @param wrapsAroundLoop Whether the range crosses the loop boundary
+     */
+    void triggerSquare(juce::MidiBuffer& midiMessages, const Square& square, const TimeSignature& timeSig,
+                       double loopBars, double startBeats, double endBeats, double loopBeats, bool wrapsAroundLoop);
+    
+    /**
+     * Send note-off for one voice of a color channel and free the voice
      * @param midiMessages MIDI buffer to add message to
      * @param colorId Color channel ID
+     * @param voiceSlot Voice slot in the color's pool
      * @param sampleOffset Sample offset within buffer
      */
-    void sendNoteOff(juce::MidiBuffer& midiMessages, int colorId, int sampleOffset);
+    void sendNoteOff(juce::MidiBuffer& midiMessages, int colorId, int voiceSlot, int sampleOffset);
     
     /**
-     * Send note-on for a square
-     * @param midiMessages MIDI buffer to add message to
+     * Send note-on for a square and start a voice for it
+     * A voice already sounding the same pitch is retriggered; otherwise, if the
+     * color's pool is full, a voice is stolen according to its steal policy.
+     * @param midiMessages MIDI buffer to add messages to
      * @param square Square to trigger
+     * @param endTimeBeats Note-off time (in beats, wrapped to the color's loop)
+     * @param sampleOffset Sample offset within buffer
+     * @param velocityOffset Added to the square's velocity (the color's groove and ratchet ramp)
+     */
+    void sendNoteOn(juce::MidiBuffer& midiMessages, const Square& square, double endTimeBeats, int sampleOffset,
+                    int velocityOffset);
+    
+    
+    /**
+     * Pitch sequencer offset for a color at an absolute position
+     * @param config Color channel configuration
+     * @param absoluteBeats Absolute position in beats (the pitch loop runs independently of the main loop)
+     * @return Offset in semitones (0 if the color has no waveform)
+     */
+    float getPitchOffsetAtBeats(const ColorChannelConfig& config, double absoluteBeats) const;
+    
+    /**
+     * Send a pitch-bend for a color unless it repeats the last value sent
+     * @param midiMessages MIDI buffer to add message to
+     * @param colorId Color channel ID
+     * @param pitchOffset Offset in semitones (clamped to the color's bend range)
+     * @param sampleOffset Sample offset within buffer
+     */
+    void sendPitchBend(juce::MidiBuffer& midiMessages, int colorId, float pitchOffset, int sampleOffset);
+    
+    /**
+     * Send control-rate pitch-bends for every color with pitch-bend output and
+     * held notes; recentre colors whose pitch-bend output was switched off
+     * @param midiMessages MIDI buffer to add messages to
+     * @param blockStartBeats Absolute position at the start of the block (in beats)
+     * @param numSamples Number of samples in the block
+     */
+    void sendPitchBends(juce::MidiBuffer& midiMessages, double blockStartBeats, int numSamples);
+    
+    /**
+     * Send note-offs for the voices of a color whose end time falls in a range
+     * @param midiMessages MIDI buffer to add messages to
+     * @param colorId Color channel ID
+     * @param startBeats Start of time range (in beats)
+     * @param endBeats End of time range (in beats)
+     * @param loopBeats Loop length the range and end times are wrapped to
+     * @param wrapsAroundLoop Whether the range crosses the loop boundary
+     */
+    void releaseEndingVoices(juce::MidiBuffer& midiMessages, int colorId,
+                             double startBeats, double endBeats, double loopBeats, bool wrapsAroundLoop);
+    
+    /**
+     * Send note-offs for every voice of a color channel
+     * @param midiMessages MIDI buffer to add messages to
+     * @param colorId Color channel ID
      * @param sampleOffset Sample offset within buffer
      */
-    void sendNoteOn(juce::MidiBuffer& midiMessages, const Square& square, int sampleOffset);
+    void releaseColorVoices(juce::MidiBuffer& midiMessages, int colorId, int sampleOffset);
+    
+    /**
+     * Apply a color's polyphony setting, releasing the oldest voices beyond it
+     * @param midiMessages MIDI buffer to add messages to
+     * @param colorId Color channel ID
+     */
+    void applyVoiceLimit(juce::MidiBuffer& midiMessages, int colorId);
     
     /**
      * Calculate sample offset for a time in beats
@@ -1,8 +1,12 @@
 #include "PlaybackEngine.h"
 #include "PatternModel.h"
+#include "PatternSync.h"
+#include "MidiRecorder.h"
+#include "ConversionUtils.h"
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 using namespace SquareBeats;
 
@@ -328,6 +332,970 @@ void testPitchSequencerIndependentLoop() {
 }
 
 //==============================================================================
+// Test: Play mode is resolved per block
+void testPlayModeResolvedPerBlock() {
+    std::cout << "\n=== Test: Play Mode Resolved Per Block ===" << std::endl;
+    
+    PlaybackEngine engine;
+    PatternModel model;
+    
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    engine.setPatternModel(&model);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    
+    juce::AudioBuffer<float> buffer(2, 512);
+    juce::MidiBuffer midiMessages;
+    
+    // Forward: playhead moves right
+    for (int i = 0; i < 8; ++i) {
+        engine.processBlock(buffer, midiMessages);
+    }
+    float forwardPos = engine.getNormalizedPlaybackPosition();
+    assertTrue(forwardPos > 0.0f, "Forward mode advances playhead");
+    
+    // Switching mode between blocks takes effect on the next block
+    model.getPlayModeConfig().mode = PLAY_BACKWARD;
+    engine.processBlock(buffer, midiMessages);
+    assertTrue(engine.getNormalizedPlaybackPosition() < forwardPos, "Backward mode moves playhead left");
+    
+    // Out-of-range modes fall back to forward playback
+    model.getPlayModeConfig().mode = static_cast<PlayMode>(NUM_PLAY_MODES);
+    float before = engine.getNormalizedPlaybackPosition();
+    engine.processBlock(buffer, midiMessages);
+    assertTrue(engine.getNormalizedPlaybackPosition() > before, "Invalid mode plays forward");
+    
+    // Probability mode keeps every color inside its loop
+    model.getPlayModeConfig().mode = PLAY_PROBABILITY;
+    model.getPlayModeConfig().probability = 1.0f;
+    bool allInRange = true;
+    for (int i = 0; i < 200; ++i) {
+        engine.processBlock(buffer, midiMessages);
+        for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId) {
+            float pos = engine.getNormalizedPlaybackPositionForColor(colorId);
+            allInRange = allInRange && pos >= 0.0f && pos < 1.0f;
+        }
+    }
+    assertTrue(allInRange, "Probability mode keeps color positions in range");
+}
+
+//==============================================================================
+// Test: All sixteen color channels play, and shrinking the count releases notes but keeps squares
+void testSixteenColorChannels() {
+    std::cout << "\n=== Test: Sixteen Color Channels ===" << std::endl;
+    
+    PlaybackEngine engine;
+    PatternModel model;
+    
+    model.setLoopLength(1);
+    model.setNumColorChannels(MAX_COLOR_CHANNELS);
+    for (int colorId = 0; colorId < MAX_COLOR_CHANNELS; ++colorId) {
+        model.createSquare(0.0f, 0.5f, 0.5f, 0.1f, colorId);
+    }
+    
+    engine.setPatternModel(&model);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    
+    juce::AudioBuffer<float> buffer(2, 512);
+    juce::MidiBuffer midiMessages;
+    engine.processBlock(buffer, midiMessages);
+    
+    bool channelSeen[MAX_COLOR_CHANNELS + 1] = {};
+    int noteOnCount = 0;
+    for (const auto metadata : midiMessages) {
+        auto msg = metadata.getMessage();
+        if (msg.isNoteOn()) {
+            ++noteOnCount;
+            channelSeen[msg.getChannel()] = true;
+        }
+    }
+    assertTrue(noteOnCount == MAX_COLOR_CHANNELS, "One note-on per color channel");
+    for (int channel = 1; channel <= MAX_COLOR_CHANNELS; ++channel) {
+        assertTrue(channelSeen[channel], "Every MIDI channel received a note-on");
+    }
+    
+    // Dropping to two channels releases the notes held on the removed ones
+    model.setNumColorChannels(2);
+    midiMessages.clear();
+    engine.processBlock(buffer, midiMessages);
+    
+    int noteOffCount = 0;
+    for (const auto metadata : midiMessages) {
+        if (metadata.getMessage().isNoteOff()) {
+            ++noteOffCount;
+        }
+    }
+    assertTrue(noteOffCount >= MAX_COLOR_CHANNELS - 2, "Removed channels receive note-offs");
+    assertTrue(model.getSquares().size() == static_cast<size_t>(MAX_COLOR_CHANNELS), "Squares on removed channels are kept");
+    
+    // Kept squares stay silent until their channels are back
+    auto countNoteOnsFromStart = [&model]() {
+        PlaybackEngine fresh;
+        fresh.setPatternModel(&model);
+        fresh.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+        juce::AudioBuffer<float> freshBuffer(2, 512);
+        juce::MidiBuffer freshMessages;
+        fresh.processBlock(freshBuffer, freshMessages);
+        int count = 0;
+        for (const auto metadata : freshMessages) {
+            if (metadata.getMessage().isNoteOn()) {
+                ++count;
+            }
+        }
+        return count;
+    };
+    assertTrue(countNoteOnsFromStart() == 2, "Only channels in use play");
+    model.setNumColorChannels(MAX_COLOR_CHANNELS);
+    assertTrue(countNoteOnsFromStart() == MAX_COLOR_CHANNELS, "Raising the count brings the squares back");
+}
+
+//==============================================================================
+// Test: Voice pool ordering and steal policies
+void testVoicePoolStealPolicies() {
+    std::cout << "\n=== Test: Voice Pool Steal Policies ===" << std::endl;
+    
+    VoicePool pool;
+    pool.setVoiceLimit(3);
+    
+    int a = pool.startVoice(60, 100, 1.0);
+    int b = pool.startVoice(64, 40, 2.0);
+    int c = pool.startVoice(72, 90, 3.0);
+    assertTrue(pool.isFull(), "Pool is full at its voice limit");
+    assertTrue(pool.findVoiceForNote(64) == b, "Voice found by note");
+    
+    assertTrue(pool.chooseVoiceToSteal(STEAL_OLDEST, 50) == a, "Oldest voice stolen");
+    assertTrue(pool.chooseVoiceToSteal(STEAL_LOWEST_VELOCITY, 50) == b, "Quietest voice stolen");
+    assertTrue(pool.chooseVoiceToSteal(STEAL_SAME_PITCH, 71) == c, "Closest pitch stolen");
+    
+    // Stopping from the middle keeps the start order of the others
+    pool.stopVoice(b);
+    assertTrue(pool.getOldest() == a && pool.getVoice(a).next == c, "Order kept after stop");
+    assertTrue(pool.findVoiceForNote(64) == VoicePool::NO_VOICE, "Stopped note no longer indexed");
+    
+    int d = pool.startVoice(64, 80, 4.0);
+    assertTrue(pool.getVoice(c).next == d, "Restarted voice is newest");
+    
+    pool.setVoiceLimit(2);
+    assertTrue(pool.isOverLimit(), "Lowered limit leaves pool over limit");
+}
+
+//==============================================================================
+// Test: Overlapping squares of one color play as chords up to the polyphony
+void testPolyphonicVoiceAllocation() {
+    std::cout << "\n=== Test: Polyphonic Voice Allocation ===" << std::endl;
+    
+    PlaybackEngine engine;
+    PatternModel model;
+    
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    
+    ColorChannelConfig config = model.getColorConfig(0);
+    config.polyphony = 3;
+    config.stealPolicy = STEAL_OLDEST;
+    model.setColorConfig(0, config);
+    
+    // Five stacked squares starting together on distinct pitches
+    for (int i = 0; i < 5; ++i) {
+        model.createSquare(0.0f, i * 0.2f, 0.5f, 0.1f, 0);
+    }
+    
+    engine.setPatternModel(&model);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    
+    juce::AudioBuffer<float> buffer(2, 512);
+    juce::MidiBuffer midiMessages;
+    engine.processBlock(buffer, midiMessages);
+    
+    int noteOns = 0;
+    int noteOffs = 0;
+    for (const auto metadata : midiMessages) {
+        auto msg = metadata.getMessage();
+        if (msg.isNoteOn()) ++noteOns;
+        else if (msg.isNoteOff()) ++noteOffs;
+    }
+    assertTrue(noteOns == 5, "Every square triggers a note-on");
+    assertTrue(noteOffs == 2, "Two voices stolen to stay within three");
+    
+    // Lowering the polyphony releases the oldest voices on the next block
+    config.polyphony = 1;
+    model.setColorConfig(0, config);
+    midiMessages.clear();
+    engine.processBlock(buffer, midiMessages);
+    
+    noteOffs = 0;
+    for (const auto metadata : midiMessages) {
+        if (metadata.getMessage().isNoteOff()) ++noteOffs;
+    }
+    assertTrue(noteOffs == 2, "Voices above the new limit released");
+}
+
+//==============================================================================
+// Test: Hundreds of overlapping squares never exceed the voice limit
+void testVoiceAllocationStress() {
+    std::cout << "\n=== Test: Voice Allocation Stress ===" << std::endl;
+    
+    PlaybackEngine engine;
+    PatternModel model;
+    
+    model.setLoopLength(2);
+    model.setTimeSignature(4, 4);
+    
+    for (int colorId = 0; colorId < 2; ++colorId) {
+        ColorChannelConfig config = model.getColorConfig(colorId);
+        config.polyphony = MAX_VOICES_PER_COLOR;
+        config.stealPolicy = (colorId == 0) ? STEAL_LOWEST_VELOCITY : STEAL_SAME_PITCH;
+        model.setColorConfig(colorId, config);
+    }
+    
+    juce::Random random(1234);
+    for (int i = 0; i < 400; ++i) {
+        model.createSquare(random.nextFloat() * 0.9f, random.nextFloat() * 0.9f,
+                           0.05f + random.nextFloat() * 0.5f, 0.02f + random.nextFloat() * 0.08f, i % 2);
+    }
+    
+    engine.setPatternModel(&model);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    
+    juce::AudioBuffer<float> buffer(2, 256);
+    juce::MidiBuffer midiMessages;
+    
+    // Held notes per MIDI channel, tracked from the output stream
+    bool held[17][128] = {};
+    int heldCount[17] = {};
+    bool withinLimit = true;
+    bool noDoubleNoteOn = true;
+    
+    for (int block = 0; block < 1500; ++block) {
+        midiMessages.clear();
+        engine.processBlock(buffer, midiMessages);
+        
+        for (const auto metadata : midiMessages) {
+            auto msg = metadata.getMessage();
+            int channel = msg.getChannel();
+            int note = msg.getNoteNumber();
+            if (msg.isNoteOn()) {
+                if (held[channel][note]) noDoubleNoteOn = false;
+                held[channel][note] = true;
+                ++heldCount[channel];
+                if (heldCount[channel] > MAX_VOICES_PER_COLOR) withinLimit = false;
+            } else if (msg.isNoteOff() && held[channel][note]) {
+                held[channel][note] = false;
+                --heldCount[channel];
+            }
+        }
+    }
+    
+    assertTrue(withinLimit, "Held notes never exceed the voice limit");
+    assertTrue(noDoubleNoteOn, "A sounding pitch is released before it is retriggered");
+}
+
+//==============================================================================
+// Test: Pitch sequencer sent as rate-limited, deduplicated pitch-bend
+void testPitchBendOutput() {
+    std::cout << "\n=== Test: Pitch Bend Output ===" << std::endl;
+    
+    PlaybackEngine engine;
+    PatternModel model;
+    
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    
+    // Color 0 ramps up an octave over the bar; color 1 stays flat
+    Square rampSquare = *model.createSquare(0.0f, 0.5f, 0.5f, 0.5f, 0);
+    model.createSquare(0.0f, 0.5f, 0.5f, 0.5f, 1);
+    
+    ColorChannelConfig rampConfig = model.getColorConfig(0);
+    rampConfig.pitchWaveform = {0.0f, 12.0f};
+    rampConfig.pitchBendRange = 12;
+    rampConfig.pitchBendRateHz = 1000;
+    model.setColorConfig(0, rampConfig);
+    
+    ColorChannelConfig flatConfig = model.getColorConfig(1);
+    flatConfig.midiChannel = rampConfig.midiChannel + 1;
+    flatConfig.pitchBendRange = 12;
+    flatConfig.pitchBendRateHz = 1000;
+    model.setColorConfig(1, flatConfig);
+    
+    engine.setPatternModel(&model);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    
+    // 10 ms blocks over the first bar (2 seconds at 120 BPM)
+    const int blockSize = 441;
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midiMessages;
+    
+    int rampBends = 0;
+    int flatBends = 0;
+    int maxBendsPerBlock = 0;
+    int lastRampValue = -1;
+    bool repeatedValue = false;
+    bool bendWithoutNote = false;
+    bool noteNumberShifted = false;
+    bool rampHeld = false;
+    
+    int baseNote = MIDIGenerator::calculateMidiNote(rampSquare, model.getColorConfig(0), 0.0f,
+                                                    model.getActiveNoteTable(0.0));
+    
+    for (int block = 0; block < 180; ++block) {
+        midiMessages.clear();
+        engine.processBlock(buffer, midiMessages);
+        
+        int blockRampBends = 0;
+        bool blockHadNoteEvent = false;
+        for (const auto metadata : midiMessages) {
+            auto msg = metadata.getMessage();
+            if (msg.isNoteOn() && msg.getChannel() == rampConfig.midiChannel) {
+                rampHeld = true;
+                blockHadNoteEvent = true;
+                if (msg.getNoteNumber() != baseNote) noteNumberShifted = true;
+            } else if (msg.isNoteOff() && msg.getChannel() == rampConfig.midiChannel) {
+                rampHeld = false;
+                blockHadNoteEvent = true;
+            } else if (msg.isPitchWheel() && msg.getChannel() == flatConfig.midiChannel) {
+                ++flatBends;
+            } else if (msg.isPitchWheel() && msg.getChannel() == rampConfig.midiChannel) {
+                ++blockRampBends;
+                if (msg.getPitchWheelValue() == lastRampValue) repeatedValue = true;
+                lastRampValue = msg.getPitchWheelValue();
+            }
+        }
+        
+        if (!rampHeld && !blockHadNoteEvent && blockRampBends > 0) bendWithoutNote = true;
+        rampBends += blockRampBends;
+        maxBendsPerBlock = std::max(maxBendsPerBlock, blockRampBends);
+    }
+    
+    assertTrue(!noteNumberShifted, "Pitch-bend colors play the unshifted note number");
+    assertTrue(rampBends > 50, "A held note on a ramp receives a stream of pitch-bends");
+    assertTrue(maxBendsPerBlock <= 11, "Pitch-bends are limited to the control rate (1 kHz = 10 per 10 ms block)");
+    assertTrue(!repeatedValue, "Consecutive pitch-bends never repeat a value");
+    assertTrue(!bendWithoutNote, "No pitch-bends are sent while no note is held");
+    assertTrue(flatBends == 1, "A flat waveform sends a single pitch-bend");
+}
+
+//==============================================================================
+// Test: Quantized pattern switching
+void testQuantizedPatternSwitch() {
+    std::cout << "\n=== Test: Quantized Pattern Switch ===" << std::endl;
+    
+    PlaybackEngine engine;
+    PatternModel current;
+    PatternModel next;
+    
+    // One long note each, at different pitches; the current one is still held at the first bar line
+    current.setLoopLength(2);
+    current.setTimeSignature(4, 4);
+    Square currentSquare = *current.createSquare(0.0f, 0.2f, 0.9f, 0.5f, 0);
+    next.setLoopLength(1);
+    next.setTimeSignature(4, 4);
+    Square nextSquare = *next.createSquare(0.0f, 0.7f, 0.9f, 0.5f, 0);
+    
+    int currentNote = MIDIGenerator::calculateMidiNote(currentSquare, current.getColorConfig(0), 0.0f,
+                                                       current.getActiveNoteTable(0.0));
+    int nextNote = MIDIGenerator::calculateMidiNote(nextSquare, next.getColorConfig(0), 0.0f,
+                                                    next.getActiveNoteTable(0.0));
+    assertTrue(currentNote != nextNote, "The two patterns play different notes");
+    
+    engine.setPatternModel(&current);
+    engine.prepareToPlay(44100.0);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    
+    // 500-sample blocks: the bar line (88200 samples at 120 BPM) falls 200 samples into block 176
+    const int blockSize = 500;
+    const int boundarySample = 88200;
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midiMessages;
+    
+    int currentNoteOffSample = -1;
+    int nextNoteOnSample = -1;
+    bool nextPlayedEarly = false;
+    bool offBeforeOn = false;
+    
+    for (int block = 0; block < 180; ++block) {
+        if (block == 10) {
+            engine.schedulePatternSwitch(&next, SWITCH_NEXT_BAR, true);
+        }
+        
+        midiMessages.clear();
+        engine.processBlock(buffer, midiMessages);
+        
+        for (const auto metadata : midiMessages) {
+            auto msg = metadata.getMessage();
+            int sample = block * blockSize + metadata.samplePosition;
+            if (msg.isNoteOff() && msg.getNoteNumber() == currentNote && currentNoteOffSample < 0) {
+                currentNoteOffSample = sample;
+            } else if (msg.isNoteOn() && msg.getNoteNumber() == nextNote) {
+                if (sample < boundarySample) nextPlayedEarly = true;
+                if (nextNoteOnSample < 0) {
+                    nextNoteOnSample = sample;
+                    offBeforeOn = currentNoteOffSample >= 0;
+                }
+            }
+        }
+        
+        if (block == 100) {
+            assertTrue(engine.isPatternSwitchPending(), "The switch waits for the bar line");
+            assertTrue(engine.getActivePatternModel() == &current, "The old pattern plays until the bar line");
+        }
+    }
+    
+    assertTrue(!engine.isPatternSwitchPending(), "The switch happened");
+    assertTrue(engine.getActivePatternModel() == &next, "The new pattern is active after the bar line");
+    assertTrue(!nextPlayedEarly, "The new pattern plays nothing before the bar line");
+    assertTrue(currentNoteOffSample == boundarySample, "The held note is released on the bar line");
+    assertTrue(nextNoteOnSample == boundarySample, "The new pattern's first note starts on the bar line");
+    assertTrue(offBeforeOn, "The old note is released before the new one starts");
+    
+    // Handing playback to an identical copy must not cut the held note
+    midiMessages.clear();
+    engine.schedulePatternSwitch(&current, SWITCH_IMMEDIATE, false);
+    engine.processBlock(buffer, midiMessages);
+    
+    bool noteOffOnHandover = false;
+    for (const auto metadata : midiMessages) {
+        if (metadata.getMessage().isNoteOff()) noteOffOnHandover = true;
+    }
+    assertTrue(engine.getActivePatternModel() == &current, "An immediate switch happens in the next block");
+    assertTrue(!noteOffOnHandover, "A switch without releasing notes leaves held notes alone");
+    assertTrue(engine.isPatternModelInUse(&current), "The playing pattern is in use");
+    assertTrue(!engine.isPatternModelInUse(&next), "A pattern switched away from is no longer in use");
+    
+    // A switch withdrawn before the audio thread takes it never happens
+    engine.schedulePatternSwitch(&next, SWITCH_NEXT_LOOP, true);
+    assertTrue(engine.isPatternModelInUse(&next), "A pending pattern is in use");
+    assertTrue(engine.cancelPatternSwitch(&next), "A pending switch can be cancelled");
+    assertTrue(!engine.cancelPatternSwitch(&next), "A switch cannot be cancelled twice");
+    midiMessages.clear();
+    engine.processBlock(buffer, midiMessages);
+    assertTrue(engine.getActivePatternModel() == &current, "A cancelled switch leaves the pattern alone");
+}
+
+//==============================================================================
+// Test: Pattern edits reach the engine's copy through the command queue
+bool samePattern(const PatternModel& a, const PatternModel& b) {
+    const auto& squaresA = a.getSquares();
+    const auto& squaresB = b.getSquares();
+    if (squaresA.size() != squaresB.size() || a.getLoopLength() != b.getLoopLength()
+        || a.getNumColorChannels() != b.getNumColorChannels()) {
+        return false;
+    }
+    for (size_t i = 0; i < squaresA.size(); ++i) {
+        if (squaresA[i].uniqueId != squaresB[i].uniqueId || squaresA[i].leftEdge != squaresB[i].leftEdge
+            || squaresA[i].topEdge != squaresB[i].topEdge || squaresA[i].width != squaresB[i].width) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testPatternCommandQueue() {
+    std::cout << "\n=== Test: Pattern Command Queue ===" << std::endl;
+    
+    PatternModel live;
+    PlaybackEngine engine;
+    PatternSync sync(live, engine);
+    engine.prepareToPlay(44100.0);
+    
+    PatternModel* playing = engine.getActivePatternModel();
+    assertTrue(playing != &live && sync.isPlaybackModel(playing), "The engine plays a copy of the live model");
+    
+    // 32-sample blocks, with an edit before every block
+    juce::AudioBuffer<float> buffer(2, 32);
+    juce::MidiBuffer midiMessages;
+    
+    Square* square = live.createSquare(0.0f, 0.3f, 0.25f, 0.2f, 0);
+    uint32_t squareId = square->uniqueId;
+    engine.processBlock(buffer, midiMessages);
+    assertTrue(samePattern(*playing, live), "An added square reaches the copy in the next block");
+    
+    bool inStep = true;
+    for (int edit = 0; edit < 200; ++edit) {
+        live.moveSquare(squareId, 0.001f * edit, 0.3f);
+        if (edit % 10 == 0) {
+            live.setLoopLength(1 + edit % 3);
+        }
+        engine.processBlock(buffer, midiMessages);
+        inStep = inStep && samePattern(*playing, live);
+    }
+    assertTrue(inStep, "200 edits at one per 32-sample block are each applied in the next block");
+    assertTrue(engine.getActivePatternModel() == playing, "Edits do not replace the copy");
+    assertTrue(sync.isUpToDate(), "The engine reports the commands it has applied");
+    
+    // Edits while the audio thread is not running overflow the queue
+    for (int i = 0; i < PatternCommandQueue::DEFAULT_CAPACITY + 200; ++i) {
+        live.createSquare(0.0005f * (i % 1000), 0.5f, 0.01f, 0.1f, i % 2);
+    }
+    live.deleteSquare(squareId);
+    assertTrue(!sync.isUpToDate(), "An overflowing queue waits for a fresh copy");
+    
+    for (int block = 0; block < 20 && !sync.isUpToDate(); ++block) {
+        engine.processBlock(buffer, midiMessages);
+        sync.update();
+        engine.processBlock(buffer, midiMessages);
+    }
+    assertTrue(sync.isUpToDate(), "The fresh copy is handed over once the queue drains");
+    assertTrue(engine.getActivePatternModel() != playing, "The fresh copy replaces the one being played");
+    assertTrue(sync.isPlaybackModel(engine.getActivePatternModel()), "The engine plays the fresh copy");
+    assertTrue(samePattern(*engine.getActivePatternModel(), live), "The fresh copy matches the live model");
+    
+    // Bulk loads are sent as one copy that takes over playback
+    sync.suspend();
+    live.clearColorChannel(1);
+    live.setNumColorChannels(2);
+    sync.resume(true, true);
+    engine.processBlock(buffer, midiMessages);
+    assertTrue(samePattern(*engine.getActivePatternModel(), live), "A bulk load reaches the engine as one copy");
+    
+    // The copy plays what was edited
+    live.clearColorChannel(0);
+    live.createSquare(0.0f, 0.4f, 0.5f, 0.3f, 0);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    midiMessages.clear();
+    engine.processBlock(buffer, midiMessages);
+    int noteOns = 0;
+    for (const auto metadata : midiMessages) {
+        if (metadata.getMessage().isNoteOn()) {
+            ++noteOns;
+        }
+    }
+    assertTrue(noteOns == 1, "A square added to the live model is played from the copy");
+}
+
+//==============================================================================
+// Test: Copies sent while the audio thread is not running stay alive until it takes them
+void testResyncWithoutProcessing() {
+    std::cout << "\n=== Test: Resync Without Processing ===" << std::endl;
+    
+    PatternModel live;
+    PlaybackEngine engine;
+    PatternSync sync(live, engine);
+    engine.prepareToPlay(44100.0);
+    
+    juce::AudioBuffer<float> buffer(2, 32);
+    juce::MidiBuffer midiMessages;
+    
+    // Two bulk loads with no block in between (suspended plugin, offline render, no audio device):
+    // the first copy is retired while the command that hands it over is still queued
+    for (int load = 0; load < 2; ++load) {
+        sync.suspend();
+        live.clearColorChannel(0);
+        live.createSquare(0.25f * load, 0.5f, 0.2f, 0.2f, 0);
+        sync.resume(true, true);
+    }
+    
+    // Past the grace period, the retired copy must still not be freed
+    juce::Thread::sleep(150);
+    sync.update();
+    
+    engine.processBlock(buffer, midiMessages);
+    sync.update();
+    assertTrue(sync.isUpToDate(), "Both queued copies are applied once processing resumes");
+    assertTrue(sync.isPlaybackModel(engine.getActivePatternModel()), "The engine plays the latest copy");
+    assertTrue(samePattern(*engine.getActivePatternModel(), live), "The latest copy matches the live model");
+}
+
+//==============================================================================
+// Test: Live transpose and scale root take effect from their sample on
+void testLiveInput() {
+    std::cout << "\n=== Test: Live Input ===" << std::endl;
+    
+    PatternModel model;
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    model.setScaleConfig(ScaleConfig(ROOT_C, SCALE_MAJOR));
+    
+    // Every square plays F (65) before live input
+    ColorChannelConfig config = model.getColorConfig(0);
+    config.highNote = 65;
+    config.lowNote = 65;
+    model.setColorConfig(0, config);
+    
+    // Squares on beats 1, 2 and 3 (samples 0, 22050 and 44100 at 120 BPM)
+    model.createSquare(0.0f, 0.4f, 0.1f, 0.2f, 0);
+    model.createSquare(0.25f, 0.4f, 0.1f, 0.2f, 0);
+    model.createSquare(0.5f, 0.4f, 0.1f, 0.2f, 0);
+    
+    auto playBlock = [](PlaybackEngine& engine, std::vector<std::pair<int, int>>& noteOns) {
+        juce::AudioBuffer<float> buffer(2, 32768);
+        juce::MidiBuffer midiMessages;
+        engine.processBlock(buffer, midiMessages);
+        
+        noteOns.clear();
+        for (const auto metadata : midiMessages) {
+            auto msg = metadata.getMessage();
+            if (msg.isNoteOn()) {
+                noteOns.push_back({ metadata.samplePosition, msg.getNoteNumber() });
+            }
+        }
+    };
+    
+    std::vector<std::pair<int, int>> noteOns;
+    
+    {
+        PlaybackEngine engine;
+        engine.setPatternModel(&model);
+        engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+        
+        // Up a fourth from the middle of the first beat
+        engine.setLiveTranspose(PlaybackEngine::ALL_COLORS, 5, 10000);
+        playBlock(engine, noteOns);
+        assertTrue(noteOns.size() == 2, "Two notes in the first block");
+        assertTrue(noteOns[0].second == 65, "Note before the transpose is untransposed");
+        assertTrue(noteOns[1].second == 70, "Note after the transpose is transposed");
+        
+        // The transpose outlasts its block
+        engine.handleTransportChange(true, 44100.0, 120.0, 32768.0, 32768.0 / 22050.0);
+        playBlock(engine, noteOns);
+        assertTrue(noteOns.size() == 1 && noteOns[0].second == 70, "Transpose stays in effect");
+    }
+    
+    {
+        PlaybackEngine engine;
+        engine.setPatternModel(&model);
+        engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+        
+        // A change on the note's own sample applies to it; other colors are untouched
+        engine.setLiveTranspose(1, 12, 0);
+        engine.setLiveTranspose(0, -2, 22050);
+        playBlock(engine, noteOns);
+        assertTrue(noteOns.size() == 2, "Two notes in the block");
+        assertTrue(noteOns[0].second == 65, "Other color's transpose ignored");
+        assertTrue(noteOns[1].first == 22050 && noteOns[1].second == 63, "Change applies from its own sample");
+    }
+    
+    {
+        PlaybackEngine engine;
+        engine.setPatternModel(&model);
+        engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+        
+        // F is not in D major: it snaps to a neighbour that is
+        engine.setLiveScaleRoot(ROOT_D, 0);
+        engine.setLiveScaleRoot(PlaybackEngine::NO_LIVE_SCALE_ROOT, 10000);
+        playBlock(engine, noteOns);
+        assertTrue(noteOns.size() == 2, "Two notes in the block");
+        
+        const auto intervals = ScaleConfig::getScaleIntervals(SCALE_MAJOR);
+        const int degree = (noteOns[0].second - ROOT_D + 12) % 12;
+        assertTrue(std::find(intervals.begin(), intervals.end(), degree) != intervals.end(), "Note snapped to D major");
+        assertTrue(std::abs(noteOns[0].second - 65) == 1, "Snapped to a neighbouring note");
+        assertTrue(noteOns[1].second == 65, "Pattern's own root restored");
+    }
+}
+
+//==============================================================================
+// Counts the batches a model announces to its command sink
+struct BatchCountingSink : PatternModel::CommandSink {
+    void squareCommand(const PatternCommand&) override { ++numCommands; }
+    void squaresAdded(size_t count) override { ++numBatches; numSquares += count; }
+    void patternEdited() override {}
+    
+    int numCommands = 0;
+    int numBatches = 0;
+    size_t numSquares = 0;
+};
+
+//==============================================================================
+// Test: Notes recorded into squares
+void testMidiRecorder() {
+    std::cout << "\n=== Test: MIDI Recorder ===" << std::endl;
+    
+    PatternModel model;
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    
+    ColorChannelConfig config = model.getColorConfig(1);
+    config.highNote = 84;
+    config.lowNote = 36;
+    config.quantize = Q_1_16;
+    model.setColorConfig(1, config);
+    
+    MidiRecorder recorder(model);
+    recorder.setRecordColor(1);
+    
+    // Slightly late on beat 2 of the second pass through the loop, held for half a beat
+    recorder.noteOn(60, 64, 5.05);
+    recorder.noteOff(60, 5.55);
+    recorder.noteOff(61, 5.6);  // Never started: ignored
+    recorder.update();
+    
+    assertTrue(model.getSquares().size() == 1, "One square per note");
+    const Square& square = model.getSquares()[0];
+    assertTrue(square.colorChannelId == 1, "Square in the record color");
+    assertNear(square.leftEdge, 0.25, 0.0001, "Start wrapped into the loop and quantized to 1/16");
+    assertNear(square.width, 0.125, 0.0001, "Width is the held length");
+    assertTrue(mapVerticalPositionToNote(square.getCenterY(), 84, 36, 0.0f) == 60, "Centre maps back to the note");
+    assertTrue(mapHeightToVelocity(square.height) == 64, "Height maps back to the velocity");
+    
+    // Notes still held when recording stops end there; a note running past the loop end is cut off
+    recorder.noteOn(36, 127, 3.5);
+    recorder.allNotesOff(6.0);
+    recorder.update();
+    assertTrue(model.getSquares().size() == 2, "Held note finished by allNotesOff");
+    const Square& lowSquare = model.getSquares()[1];
+    assertNear(lowSquare.leftEdge + lowSquare.width, 1.0, 0.0001, "Square stops at the loop end");
+    assertTrue(mapVerticalPositionToNote(lowSquare.getCenterY(), 84, 36, 0.0f) == 36, "Bottom note keeps its pitch");
+    
+    // A dense 1/32 performance over 64 bars, drained in batches as the timer would
+    PatternModel denseModel;
+    denseModel.setLoopLength(64);
+    denseModel.setTimeSignature(4, 4);
+    ColorChannelConfig denseConfig = denseModel.getColorConfig(0);
+    denseConfig.quantize = Q_1_32;
+    denseModel.setColorConfig(0, denseConfig);
+    
+    BatchCountingSink sink;
+    denseModel.setCommandSink(&sink);
+    
+    MidiRecorder denseRecorder(denseModel);
+    const double step = 4.0 / 32.0;
+    for (int i = 0; i < 64 * 32; ++i) {
+        denseRecorder.noteOn(60 + i % 12, 100, i * step);
+        denseRecorder.noteOff(60 + i % 12, i * step + step * 0.5);
+        
+        // About one timer tick's worth of playing at 120 BPM
+        if (i % 16 == 15) {
+            denseRecorder.update();
+        }
+    }
+    denseRecorder.update();
+    
+    assertTrue(denseRecorder.getNumDroppedEvents() == 0, "No events dropped");
+    assertTrue(denseModel.getSquares().size() == 64 * 32, "Every note recorded");
+    assertNear(denseModel.getSquares().back().leftEdge, (64 * 32 - 1) / (64.0 * 32.0), 0.0001, "Last note on the last 1/32 step");
+    assertTrue(sink.numBatches == 64 * 32 / 16 && sink.numSquares == 64 * 32, "One addSquares() per update");
+    assertTrue(sink.numCommands == 0, "No per-note commands");
+    denseModel.setCommandSink(nullptr);
+}
+
+//==============================================================================
+// Test: Automation changes split the block at their sample
+void testAutomationChanges() {
+    std::cout << "\n=== Test: Automation Changes ===" << std::endl;
+    
+    PatternModel model;
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    
+    // Every square plays F (65) until automated
+    ColorChannelConfig config = model.getColorConfig(0);
+    config.highNote = 65;
+    config.lowNote = 65;
+    model.setColorConfig(0, config);
+    
+    // Squares on beats 1, 2 and 3 (samples 0, 22050 and 44100 at 120 BPM)
+    model.createSquare(0.0f, 0.4f, 0.1f, 0.2f, 0);
+    model.createSquare(0.25f, 0.4f, 0.1f, 0.2f, 0);
+    model.createSquare(0.5f, 0.4f, 0.1f, 0.2f, 0);
+    
+    PlaybackEngine engine;
+    engine.setPatternModel(&model);
+    engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+    
+    auto automate = [&engine](AutomationChange::Target target, float value, int sampleOffset) {
+        AutomationChange change;
+        change.target = target;
+        change.colorId = 0;
+        change.value = value;
+        change.sampleOffset = sampleOffset;
+        engine.addAutomationChange(change);
+    };
+    
+    // Added out of order: the engine sorts them by sample
+    automate(AutomationChange::LOW_NOTE, 70.0f, 10000);
+    automate(AutomationChange::HIGH_NOTE, 70.0f, 10000);
+    automate(AutomationChange::QUANTIZE, static_cast<float>(Q_1_8), 40000);  // Past the block end
+    automate(AutomationChange::PROBABILITY, 0.25f, 5000);
+    
+    juce::AudioBuffer<float> buffer(2, 32768);
+    juce::MidiBuffer midiMessages;
+    engine.processBlock(buffer, midiMessages);
+    
+    std::vector<std::pair<int, int>> noteOns;
+    for (const auto metadata : midiMessages) {
+        auto msg = metadata.getMessage();
+        if (msg.isNoteOn()) {
+            noteOns.push_back({ metadata.samplePosition, msg.getNoteNumber() });
+        }
+    }
+    
+    assertTrue(noteOns.size() == 2, "Two notes in the block");
+    assertTrue(noteOns[0].first == 0 && noteOns[0].second == 65, "Note before the change keeps the old range");
+    assertTrue(noteOns[1].first == 22050 && noteOns[1].second == 70, "Note after the change uses the new range");
+    
+    assertTrue(model.getColorConfig(0).highNote == 70 && model.getColorConfig(0).lowNote == 70, "Note range stays automated");
+    assertNear(model.getPlayModeConfig().probability, 0.25, 0.0001, "Probability automated");
+    assertTrue(model.getColorConfig(0).quantize == Q_1_8, "Change past the block end applied for the next block");
+}
+
+//==============================================================================
+// Test: Swing and groove templates move notes by the color's per-step offsets
+void testGroove() {
+    std::cout << "\n=== Test: Swing and Groove ===" << std::endl;
+    
+    // Note-ons (sample, velocity) of the first two beats at 120 BPM
+    auto playBeats = [](PatternModel& model) {
+        PlaybackEngine engine;
+        engine.setPatternModel(&model);
+        engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+        
+        juce::AudioBuffer<float> buffer(2, 44100);
+        juce::MidiBuffer midiMessages;
+        engine.processBlock(buffer, midiMessages);
+        
+        std::vector<std::pair<int, int>> noteOns;
+        for (const auto metadata : midiMessages) {
+            auto msg = metadata.getMessage();
+            if (msg.isNoteOn()) {
+                noteOns.push_back({ metadata.samplePosition, msg.getVelocity() });
+            }
+        }
+        return noteOns;
+    };
+    
+    // Short squares on the first four 1/8 steps (samples 0, 11025, 22050, 33075)
+    PatternModel model;
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    ColorChannelConfig config = model.getColorConfig(0);
+    config.quantize = Q_1_8;
+    model.setColorConfig(0, config);
+    for (int step = 0; step < 4; ++step) {
+        model.createSquare(step / 8.0f, 0.3f, 0.05f, 0.4f, 0);
+    }
+    
+    auto straight = playBeats(model);
+    assertTrue(straight.size() == 4, "Four notes without a groove");
+    assertTrue(straight[1].first == 11025 && straight[3].first == 33075, "Straight notes on the grid");
+    
+    // Half swing: every second step a quarter of a step (2756 samples) late
+    config.groove.setSwing(0.5f);
+    model.setColorConfig(0, config);
+    auto swung = playBeats(model);
+    assertTrue(swung.size() == 4, "Four notes with swing");
+    assertTrue(swung[0].first == 0 && swung[2].first == 22050, "Even steps stay on the grid");
+    assertNear(swung[1].first, 11025 + 2756, 1.0, "Odd step delayed by the swing");
+    assertNear(swung[3].first, 33075 + 2756, 1.0, "Swing repeats every two steps");
+    
+    // Template: third step early and louder, first step early but held at the loop start
+    config.groove.setSwing(0.0f);
+    config.groove.setTemplate({ { -0.3f, 0 }, { 0.0f, 0 }, { -0.2f, 20 }, { 0.0f, 0 } });
+    model.setColorConfig(0, config);
+    auto grooved = playBeats(model);
+    assertTrue(grooved.size() == 4, "Four notes with a template");
+    assertTrue(grooved[0].first == 0, "First step not pulled before the loop start");
+    assertTrue(grooved[1].first == 11025, "Steps without an offset stay put");
+    assertNear(grooved[2].first, 22050 - 2205, 1.0, "Template step pulled early");
+    assertTrue(grooved[2].second == straight[2].second + 20, "Template velocity offset added");
+    
+    // Swing and template fold into one table, so every step costs one lookup
+    Groove groove;
+    assertTrue(groove.isStraight() && groove.getStep(7).timing == 0.0f, "Default groove is straight");
+    groove.setSwing(1.0f);
+    groove.setTemplate({ { 0.3f, 0 }, { 0.3f, 0 }, { 0.0f, 0 } });
+    assertNear(groove.getStep(1).timing, Groove::MAX_OFFSET, 0.0001, "Folded offsets are clamped to half a step");
+    assertNear(groove.getStep(4).timing, 0.3, 0.0001, "Odd-length template folded over two swing cycles");
+}
+
+void testRatchets() {
+    std::cout << "\n=== Test: Ratchets ===" << std::endl;
+    
+    // Note-ons (sample, velocity) and note-off count of the first two beats at 120 BPM
+    auto playBeats = [](PatternModel& model, PlaybackEngine& engine, int& numNoteOffs) {
+        engine.setPatternModel(&model);
+        engine.handleTransportChange(true, 44100.0, 120.0, 0.0, 0.0);
+        
+        juce::AudioBuffer<float> buffer(2, 44100);
+        juce::MidiBuffer midiMessages;
+        engine.processBlock(buffer, midiMessages);
+        
+        std::vector<std::pair<int, int>> noteOns;
+        numNoteOffs = 0;
+        for (const auto metadata : midiMessages) {
+            auto msg = metadata.getMessage();
+            if (msg.isNoteOn()) {
+                noteOns.push_back({ metadata.samplePosition, msg.getVelocity() });
+            } else if (msg.isNoteOff()) {
+                ++numNoteOffs;
+            }
+        }
+        return noteOns;
+    };
+    
+    // A one-beat square repeating every 1/16 (5512.5 samples), fading to half its velocity
+    PatternModel model;
+    model.setLoopLength(1);
+    model.setTimeSignature(4, 4);
+    Square* square = model.createSquare(0.0f, 0.3f, 0.25f, 0.4f, 0);
+    Ratchet ratchet;
+    ratchet.count = 4;
+    ratchet.rate = Q_1_16;
+    ratchet.velocityRamp = -0.5f;
+    assertTrue(model.setSquareRatchet(square->uniqueId, ratchet), "Ratchet set on the square");
+    
+    const int velocity = MIDIGenerator::calculateVelocity(*square);
+    PlaybackEngine engine;
+    int numNoteOffs = 0;
+    auto rolled = playBeats(model, engine, numNoteOffs);
+    assertTrue(rolled.size() == 4, "One note per repeat");
+    assertTrue(rolled[0].first == 0 && rolled[2].first == 11025, "Repeats at the ratchet rate");
+    assertNear(rolled[1].first, 5512.5, 1.0, "Second repeat a 1/16 later");
+    assertTrue(rolled[0].second == velocity, "First repeat at the square's velocity");
+    assertTrue(rolled[3].second == velocity - juce::roundToInt(velocity * 0.5f), "Last repeat at the ramped velocity");
+    assertTrue(numNoteOffs == 4, "Each repeat ends before the next, the last at the square's end");
+    
+    // Repeats stop at the square's right edge, and the ramp ends on the last that fits
+    ratchet.count = 8;
+    model.setSquareRatchet(square->uniqueId, ratchet);
+    PlaybackEngine cutEngine;
+    auto cut = playBeats(model, cutEngine, numNoteOffs);
+    assertTrue(cut.size() == 4, "Repeats past the square's end are not played");
+    assertTrue(cut[3].second == rolled[3].second, "Ramp spread over the repeats that fit");
+    
+    // Dense rolls: 40 two-beat squares of 16 repeats each is more than a block may send
+    PatternModel dense;
+    dense.setLoopLength(1);
+    dense.setTimeSignature(4, 4);
+    ratchet.count = 16;
+    ratchet.rate = Q_1_32;
+    ratchet.velocityRamp = 0.0f;
+    for (int i = 0; i < 40; ++i) {
+        Square* roll = dense.createSquare(0.0f, i * 0.02f, 0.5f, 0.02f, 0);
+        dense.setSquareRatchet(roll->uniqueId, ratchet);
+    }
+    
+    PlaybackEngine denseEngine;
+    auto capped = playBeats(dense, denseEngine, numNoteOffs);
+    assertTrue(static_cast<int>(capped.size()) == PlaybackEngine::MAX_NOTES_PER_BLOCK, "Note-ons capped per block");
+    assertTrue(denseEngine.getNumDroppedNotes() == 40 * 16 - PlaybackEngine::MAX_NOTES_PER_BLOCK, "Dropped notes counted");
+    
+    // Squares still sounding from the first two beats do not crowd out one starting in the next two
+    PatternModel crowded;
+    crowded.setLoopLength(2);
+    crowded.setTimeSignature(4, 4);
+    const int numLongSquares = static_cast<int>(PlaybackEngine::TRIGGER_LIST_CAPACITY) + 100;
+    for (int i = 0; i < numLongSquares; ++i) {
+        crowded.createSquare(0.0f, 0.3f, 0.45f, 0.4f, 0);
+    }
+    crowded.createSquare(0.375f, 0.3f, 0.05f, 0.4f, 1);
+    
+    PlaybackEngine crowdedEngine;
+    playBeats(crowded, crowdedEngine, numNoteOffs);
+    assertTrue(crowdedEngine.getNumDroppedNotes() > 0, "Squares beyond the trigger list and note limits dropped");
+    const int droppedBefore = crowdedEngine.getNumDroppedNotes();
+    juce::AudioBuffer<float> buffer(2, 44100);
+    juce::MidiBuffer secondHalf;
+    crowdedEngine.processBlock(buffer, secondHalf);
+    int lateNoteOns = 0;
+    for (const auto metadata : secondHalf) {
+        if (metadata.getMessage().isNoteOn()) {
+            ++lateNoteOns;
+        }
+    }
+    assertTrue(lateNoteOns == 1, "Square starting behind a full trigger list still plays");
+    assertTrue(crowdedEngine.getNumDroppedNotes() == droppedBefore, "Squares still sounding are not counted again");
+}
+
 int main() {
     std::cout << "Running PlaybackEngine Unit Tests..." << std::endl;
     
@@ -342,6 +1310,20 @@ int main() {
         testPitchSequencerIntegration();
         testPitchSequencerAlwaysApplies();
         testPitchSequencerIndependentLoop();
+        testPlayModeResolvedPerBlock();
+        testSixteenColorChannels();
+        testVoicePoolStealPolicies();
+        testPolyphonicVoiceAllocation();
+        testVoiceAllocationStress();
+        testPitchBendOutput();
+        testQuantizedPatternSwitch();
+        testPatternCommandQueue();
+        testResyncWithoutProcessing();
+        testLiveInput();
+        testMidiRecorder();
+        testAutomationChanges();
+        testGroove();
+        testRatchets();
         
         std::cout << "\n=== All PlaybackEngine tests passed! ===" << std::endl;
         return 0;
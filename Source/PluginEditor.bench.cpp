@@ -0,0 +1,288 @@
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using namespace SquareBeats;
+
+//==============================================================================
+// Editor paint benchmarks and golden-image checks
+// The editor is created without a window and rendered into offscreen software
+// images, so this runs headless (e.g. on a Linux CI machine). Run a release
+// build; timings from debug builds are not meaningful.
+//
+// Usage: PluginEditorBenchmarks [--frames N] [--golden DIR] [--update-golden DIR]
+//   --golden DIR         Compare renders with DIR/<scenario>.png; exit code 1 on a mismatch
+//   --update-golden DIR  Write the current renders to DIR as the new golden images
+//
+// Golden images depend on the fonts installed, so keep one set per platform
+// and regenerate them after an intended visual change.
+
+struct Scenario {
+    int numSquares;
+    bool flashing;
+    float scale;
+};
+
+/**
+ * Fill the pattern with squares spread over all color channels (same squares on every run)
+ */
+void fillPattern(PatternModel& model, int numSquares) {
+    juce::Random random(1234);
+    
+    for (int i = 0; i < numSquares; ++i) {
+        float left = random.nextFloat() * 0.95f;
+        float top = random.nextFloat() * 0.95f;
+        float width = 0.01f + random.nextFloat() * 0.04f;
+        float height = 0.01f + random.nextFloat() * 0.04f;
+        model.createSquare(left, top, width, height, i % model.getNumColorChannels());
+    }
+}
+
+juce::String getScenarioName(const Scenario& scenario) {
+    return juce::String(scenario.numSquares) + "-squares"
+        + (scenario.flashing ? "-flash" : "")
+        + "-" + juce::String(juce::roundToInt(scenario.scale)) + "x";
+}
+
+/**
+ * Short label for one of the editor's child components
+ */
+juce::String describeComponent(juce::Component* component) {
+    if (dynamic_cast<SequencingPlaneComponent*>(component) != nullptr) return "SequencingPlane";
+    if (dynamic_cast<PitchSequencerComponent*>(component) != nullptr) return "PitchSequencer";
+    if (dynamic_cast<GateFlashOverlay*>(component) != nullptr) return "GateFlashOverlay";
+    if (dynamic_cast<ScaleSequencerComponent*>(component) != nullptr) return "ScaleSequencer";
+    if (dynamic_cast<ColorSelectorComponent*>(component) != nullptr) return "ColorSelector";
+    if (dynamic_cast<ColorConfigPanel*>(component) != nullptr) return "ColorConfigPanel";
+    if (dynamic_cast<PatternSlotsComponent*>(component) != nullptr) return "PatternSlots";
+    if (dynamic_cast<PlayModeButtons*>(component) != nullptr) return "PlayModeButtons";
+    if (dynamic_cast<PlayModeXYPad*>(component) != nullptr) return "PlayModeXYPad";
+    if (dynamic_cast<ScaleControls*>(component) != nullptr) return "ScaleControls";
+    if (dynamic_cast<LoopLengthSelector*>(component) != nullptr) return "LoopLengthSelector";
+    if (dynamic_cast<ControlButtons*>(component) != nullptr) return "ControlButtons";
+    return component->getName().isNotEmpty() ? component->getName() : juce::String("(other)");
+}
+
+/**
+ * Render the editor once into a new image at the given display scale
+ */
+juce::Image renderEditor(juce::Component& editor, float scale) {
+    juce::Image image(juce::Image::ARGB, juce::roundToInt(editor.getWidth() * scale),
+                      juce::roundToInt(editor.getHeight() * scale), true, juce::SoftwareImageType());
+    juce::Graphics g(image);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    editor.paintEntireComponent(g, true);
+    return image;
+}
+
+template <typename PaintFunction>
+double timeFrames(juce::Image& image, float scale, int numFrames, PaintFunction&& paint) {
+    juce::Graphics g(image);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < numFrames; ++frame) {
+        paint(g);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    return std::chrono::duration<double, std::milli>(end - start).count() / numFrames;
+}
+
+//==============================================================================
+// Benchmark: whole editor and each child component, per frame
+void benchmarkScenario(juce::Component& editor, const Scenario& scenario, int numFrames) {
+    std::cout << "\n=== Benchmark: " << getScenarioName(scenario) << " ===" << std::endl;
+    
+    juce::Image image(juce::Image::ARGB, juce::roundToInt(editor.getWidth() * scenario.scale),
+                      juce::roundToInt(editor.getHeight() * scenario.scale), true, juce::SoftwareImageType());
+    
+    // The first frame fills any caches; later ones show the steady cost while playing
+    double firstFrameMs = timeFrames(image, scenario.scale, 1, [&](juce::Graphics& g) {
+        editor.paintEntireComponent(g, true);
+    });
+    double frameMs = timeFrames(image, scenario.scale, numFrames, [&](juce::Graphics& g) {
+        editor.paintEntireComponent(g, true);
+    });
+    
+    std::cout << std::fixed << std::setprecision(3)
+              << "  whole editor:         " << frameMs << " ms/frame (first frame " << firstFrameMs << " ms)\n";
+    
+    for (auto* child : editor.getChildren()) {
+        if (!child->isVisible() || child->getBounds().isEmpty()) {
+            continue;
+        }
+        
+        double childMs = timeFrames(image, scenario.scale, numFrames, [&](juce::Graphics& g) {
+            juce::Graphics::ScopedSaveState saveState(g);
+            g.setOrigin(child->getPosition());
+            g.reduceClipRegion(child->getLocalBounds());
+            child->paintEntireComponent(g, true);
+        });
+        
+        std::cout << "  " << std::left << std::setw(22) << (describeComponent(child) + ":").toStdString()
+                  << std::right << childMs << " ms/frame\n";
+    }
+    std::cout << std::flush;
+}
+
+//==============================================================================
+// Golden images
+
+/**
+ * Whether two renders match, allowing small per-channel differences from antialiasing
+ */
+bool compareImages(const juce::Image& actual, const juce::Image& expected, int& numDifferentPixels, int& maxDifference) {
+    numDifferentPixels = 0;
+    maxDifference = 0;
+    
+    if (actual.getWidth() != expected.getWidth() || actual.getHeight() != expected.getHeight()) {
+        return false;
+    }
+    
+    const int tolerance = 2;
+    
+    for (int y = 0; y < actual.getHeight(); ++y) {
+        for (int x = 0; x < actual.getWidth(); ++x) {
+            auto a = actual.getPixelAt(x, y);
+            auto b = expected.getPixelAt(x, y);
+            int difference = juce::jmax(std::abs(a.getRed() - b.getRed()),
+                                        std::abs(a.getGreen() - b.getGreen()),
+                                        std::abs(a.getBlue() - b.getBlue()),
+                                        std::abs(a.getAlpha() - b.getAlpha()));
+            maxDifference = juce::jmax(maxDifference, difference);
+            if (difference > tolerance) {
+                ++numDifferentPixels;
+            }
+        }
+    }
+    
+    return numDifferentPixels == 0;
+}
+
+bool writePng(const juce::Image& image, const juce::File& file) {
+    file.deleteFile();
+    juce::FileOutputStream stream(file);
+    juce::PNGImageFormat png;
+    return stream.openedOk() && png.writeImageToStream(image, stream);
+}
+
+/**
+ * Check (or with update set, rewrite) the golden image for a scenario
+ * @return false if the render differs from the golden image or it is missing
+ */
+bool checkGoldenImage(juce::Component& editor, const Scenario& scenario, const juce::File& directory, bool update) {
+    juce::Image actual = renderEditor(editor, scenario.scale);
+    juce::String name = getScenarioName(scenario);
+    juce::File goldenFile = directory.getChildFile(name + ".png");
+    
+    if (update) {
+        directory.createDirectory();
+        bool written = writePng(actual, goldenFile);
+        std::cout << "  " << name << ": " << (written ? "written" : "FAILED to write") << std::endl;
+        return written;
+    }
+    
+    juce::Image expected = juce::ImageFileFormat::loadFrom(goldenFile);
+    if (!expected.isValid()) {
+        std::cout << "  " << name << ": FAIL (no golden image at "
+                  << goldenFile.getFullPathName().toStdString() << ")" << std::endl;
+        return false;
+    }
+    
+    int numDifferentPixels = 0;
+    int maxDifference = 0;
+    if (compareImages(actual, expected.convertedToFormat(juce::Image::ARGB), numDifferentPixels, maxDifference)) {
+        std::cout << "  " << name << ": OK (max channel difference " << maxDifference << ")" << std::endl;
+        return true;
+    }
+    
+    // Keep the render next to the golden image for inspection
+    juce::File actualFile = directory.getChildFile(name + ".actual.png");
+    writePng(actual, actualFile);
+    std::cout << "  " << name << ": FAIL (" << numDifferentPixels << " pixels differ, max channel difference "
+              << maxDifference << "; render written to " << actualFile.getFullPathName().toStdString() << ")"
+              << std::endl;
+    return false;
+}
+
+//==============================================================================
+/**
+ * Run one scenario in a fresh processor and editor
+ * @return false if a golden image check failed
+ */
+bool runScenario(const Scenario& scenario, int numFrames, const juce::File& goldenDirectory, bool updateGolden) {
+    SquareBeatsAudioProcessor processor;
+    fillPattern(processor.getPatternModel(), scenario.numSquares);
+    
+    // Flashes are frozen part-way through their fade so every frame draws them
+    auto& feedback = processor.getVisualFeedbackState();
+    feedback.updateTime(0.0f);
+    if (scenario.flashing) {
+        for (int colorId = 0; colorId < processor.getPatternModel().getNumColorChannels(); ++colorId) {
+            feedback.triggerGateOn(colorId, 100);
+        }
+    }
+    feedback.updateTime(20.0f);
+    
+    // Created after the pattern is filled, so it starts from the finished pattern
+    SquareBeatsAudioProcessorEditor editor(processor);
+    
+    if (goldenDirectory != juce::File()) {
+        return checkGoldenImage(editor, scenario, goldenDirectory, updateGolden);
+    }
+    
+    benchmarkScenario(editor, scenario, numFrames);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    int numFrames = 30;
+    juce::File goldenDirectory;
+    bool updateGolden = false;
+    
+    for (int i = 1; i < argc; ++i) {
+        juce::String arg(argv[i]);
+        if (arg == "--frames" && i + 1 < argc) {
+            numFrames = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+        } else if ((arg == "--golden" || arg == "--update-golden") && i + 1 < argc) {
+            updateGolden = (arg == "--update-golden");
+            goldenDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--frames N] [--golden DIR] [--update-golden DIR]" << std::endl;
+            return 1;
+        }
+    }
+    
+    if (goldenDirectory != juce::File()) {
+        // A small set of scenes that between them cover every component and the flash
+        const Scenario goldenScenarios[] = {
+            { 0, false, 1.0f },
+            { 1000, true, 1.0f },
+            { 1000, true, 2.0f }
+        };
+        
+        std::cout << (updateGolden ? "Writing" : "Checking") << " golden images in "
+                  << goldenDirectory.getFullPathName().toStdString() << std::endl;
+        
+        bool allPassed = true;
+        for (const auto& scenario : goldenScenarios) {
+            allPassed = runScenario(scenario, numFrames, goldenDirectory, updateGolden) && allPassed;
+        }
+        return allPassed ? 0 : 1;
+    }
+    
+    std::cout << "Running PluginEditor Benchmarks (" << numFrames << " frames per measurement)..." << std::endl;
+    
+    for (int numSquares : { 0, 1000, 5000, 20000 }) {
+        for (float scale : { 1.0f, 2.0f }) {
+            runScenario({ numSquares, numSquares > 0, scale }, numFrames, {}, false);
+        }
+    }
+    
+    return 0;
+}
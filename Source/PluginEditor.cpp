@@ -2,6 +2,7 @@
 #include "PluginEditor.h"
 #include "BinaryData.h"
 #include "HelpAboutDialog.h"
+#include "MidiFileImporter.h"
 
 //==============================================================================
 SquareBeatsAudioProcessorEditor::SquareBeatsAudioProcessorEditor (SquareBeatsAudioProcessor& p)
@@ -37,6 +38,7 @@ SquareBeatsAudioProcessorEditor::SquareBeatsAudioProcessorEditor (SquareBeatsAud
     colorSelector->setVisualFeedbackState(&audioProcessor.getVisualFeedbackState());
     colorSelector->addListener(this);
     addAndMakeVisible(colorSelector.get());
+    audioProcessor.setMidiRecordColor(colorSelector->getSelectedColorChannel());
     
     // Create color config panel
     colorConfigPanel = std::make_unique<SquareBeats::ColorConfigPanel>(
@@ -57,6 +59,20 @@ SquareBeatsAudioProcessorEditor::SquareBeatsAudioProcessorEditor (SquareBeatsAud
     );
     addAndMakeVisible(loopLengthSelector.get());
     
+    // Create pattern slot buttons
+    patternSlots = std::make_unique<SquareBeats::PatternSlotsComponent>(
+        audioProcessor.getPatternSlots()
+    );
+    patternSlots->setLaunchQuantize(audioProcessor.getSlotLaunchQuantize());
+    patternSlots->onLaunch = [this](int slot) { audioProcessor.launchSlot(slot); };
+    patternSlots->onStore = [this](int slot) { audioProcessor.storeSlot(slot); };
+    patternSlots->onClear = [this](int slot) { audioProcessor.clearSlot(slot); };
+    patternSlots->onQuantizeChanged = [this](SquareBeats::SwitchQuantize quantize)
+    {
+        audioProcessor.setSlotLaunchQuantize(quantize);
+    };
+    addAndMakeVisible(patternSlots.get());
+    
     // Create scale controls
     scaleControls = std::make_unique<SquareBeats::ScaleControls>(
         audioProcessor.getPatternModel()
@@ -68,6 +84,28 @@ SquareBeatsAudioProcessorEditor::SquareBeatsAudioProcessorEditor (SquareBeatsAud
     clearAllButton.onClick = [this]() { onClearAllClicked(); };
     addAndMakeVisible(clearAllButton);
     
+    // Channel count selector (next to clear all)
+    for (int i = 1; i <= SquareBeats::MAX_COLOR_CHANNELS; ++i)
+    {
+        channelCountCombo.addItem(juce::String(i) + (i == 1 ? " Channel" : " Channels"), i);
+    }
+    channelCountCombo.setSelectedId(audioProcessor.getPatternModel().getNumColorChannels(), juce::dontSendNotification);
+    channelCountCombo.onChange = [this]() { onChannelCountChanged(); };
+    addAndMakeVisible(channelCountCombo);
+    
+    // Live MIDI input mode (next to the channel count)
+    liveInputCombo.addItem("MIDI Off", SquareBeats::LIVE_INPUT_OFF + 1);
+    liveInputCombo.addItem("Transpose", SquareBeats::LIVE_INPUT_TRANSPOSE + 1);
+    liveInputCombo.addItem("Key", SquareBeats::LIVE_INPUT_SCALE_ROOT + 1);
+    liveInputCombo.addItem("Record", SquareBeats::LIVE_INPUT_RECORD + 1);
+    liveInputCombo.setSelectedId(audioProcessor.getLiveInputMode() + 1, juce::dontSendNotification);
+    liveInputCombo.setTooltip("What incoming MIDI notes do: transpose every color from middle C, set the scale's key, or record into the selected color while playing");
+    liveInputCombo.onChange = [this]()
+    {
+        audioProcessor.setLiveInputMode(static_cast<SquareBeats::LiveInputMode>(liveInputCombo.getSelectedId() - 1));
+    };
+    addAndMakeVisible(liveInputCombo);
+    
     // Create preset controls (top bar)
     presetComboBox.setTextWhenNothingSelected("Select Preset...");
     presetComboBox.onChange = [this]() { onPresetSelected(); };
@@ -81,6 +119,19 @@ SquareBeatsAudioProcessorEditor::SquareBeatsAudioProcessorEditor (SquareBeatsAud
     deletePresetButton.onClick = [this]() { onDeletePresetClicked(); };
     addAndMakeVisible(deletePresetButton);
     
+    // Preset switch quantization (ids are SwitchQuantize + 1)
+    presetSwitchCombo.addItem("Now", SquareBeats::SWITCH_IMMEDIATE + 1);
+    presetSwitchCombo.addItem("Beat", SquareBeats::SWITCH_NEXT_BEAT + 1);
+    presetSwitchCombo.addItem("Bar", SquareBeats::SWITCH_NEXT_BAR + 1);
+    presetSwitchCombo.addItem("Loop", SquareBeats::SWITCH_NEXT_LOOP + 1);
+    presetSwitchCombo.setSelectedId(audioProcessor.getPresetSwitchQuantize() + 1, juce::dontSendNotification);
+    presetSwitchCombo.setTooltip("When a preset loaded during playback takes over");
+    presetSwitchCombo.onChange = [this]()
+    {
+        audioProcessor.setPresetSwitchQuantize(static_cast<SquareBeats::SwitchQuantize>(presetSwitchCombo.getSelectedId() - 1));
+    };
+    addAndMakeVisible(presetSwitchCombo);
+    
     // Populate preset list
     refreshPresetList();
     
@@ -144,6 +195,10 @@ SquareBeatsAudioProcessorEditor::SquareBeatsAudioProcessorEditor (SquareBeatsAud
     // Listen to pattern model changes
     audioProcessor.getPatternModel().addChangeListener(this);
     
+    // Listen to the preset index, and pick up presets added outside the plugin
+    audioProcessor.getPresetIndex().addChangeListener(this);
+    audioProcessor.getPresetIndex().rescan();
+    
     // Start timer for playback position updates (60 FPS for smooth visual effects)
     startTimerHz(60);
     
@@ -163,6 +218,7 @@ SquareBeatsAudioProcessorEditor::~SquareBeatsAudioProcessorEditor()
     
     // Remove listeners
     audioProcessor.getPatternModel().removeChangeListener(this);
+    audioProcessor.getPresetIndex().removeChangeListener(this);
     
     if (colorSelector != nullptr)
     {
@@ -227,6 +283,8 @@ void SquareBeatsAudioProcessorEditor::resized()
     presetArea.removeFromRight(5);
     savePresetButton.setBounds(presetArea.removeFromRight(presetButtonWidth));
     presetArea.removeFromRight(5);
+    presetSwitchCombo.setBounds(presetArea.removeFromRight(70));
+    presetArea.removeFromRight(5);
     presetComboBox.setBounds(presetArea);
     rightPanel.removeFromTop(5); // Spacing
     
@@ -234,8 +292,13 @@ void SquareBeatsAudioProcessorEditor::resized()
     loopLengthSelector->setBounds(rightPanel.removeFromTop(40));
     rightPanel.removeFromTop(5); // Spacing
     
-    // Clear All button
-    clearAllButton.setBounds(rightPanel.removeFromTop(standardButtonHeight).reduced(5, 0));
+    // Clear All button and channel count
+    auto clearAllArea = rightPanel.removeFromTop(standardButtonHeight).reduced(5, 0);
+    channelCountCombo.setBounds(clearAllArea.removeFromRight(100));
+    clearAllArea.removeFromRight(5);
+    liveInputCombo.setBounds(clearAllArea.removeFromRight(90));
+    clearAllArea.removeFromRight(5);
+    clearAllButton.setBounds(clearAllArea);
     rightPanel.removeFromTop(10); // Section spacing
     
     // === MIDDLE SECTION: Color Controls ===
@@ -245,7 +308,7 @@ void SquareBeatsAudioProcessorEditor::resized()
     rightPanel.removeFromTop(10); // Spacing
     
     // Color config panel (context-sensitive: squares or pitch mode)
-    colorConfigPanel->setBounds(rightPanel.removeFromTop(310));
+    colorConfigPanel->setBounds(rightPanel.removeFromTop(350));
     
     rightPanel.removeFromTop(10); // Spacing
     controlButtons->setBounds(rightPanel.removeFromTop(0));  // ControlButtons is now empty
@@ -284,6 +347,9 @@ void SquareBeatsAudioProcessorEditor::resized()
                                           logoWidth, 
                                           logoHeight);
     
+    // Pattern slots strip along the bottom of the main area (the right panel is full)
+    patternSlots->setBounds(bounds.removeFromBottom(standardButtonHeight + 4));
+    
     // Scale sequencer overlay (when visible, takes bottom portion of main area)
     auto& scaleSeqConfig = audioProcessor.getPatternModel().getScaleSequencer();
     if (scaleSeqConfig.enabled && scaleSequencer->isVisible()) {
@@ -324,6 +390,9 @@ void SquareBeatsAudioProcessorEditor::colorChannelSelected(int colorChannelId)
         controlButtons->setSelectedColorChannel(colorChannelId);
         controlButtons->refreshFromModel(); // Update pitch seq length dropdown for this color
     }
+    
+    // Notes played in record mode land in the selected color
+    audioProcessor.setMidiRecordColor(colorChannelId);
 }
 
 void SquareBeatsAudioProcessorEditor::pitchSequencerVisibilityChanged(bool isVisible)
@@ -337,6 +406,13 @@ void SquareBeatsAudioProcessorEditor::pitchSequencerVisibilityChanged(bool isVis
 
 void SquareBeatsAudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster* source)
 {
+    // Preset index has finished a scan or a save/delete - only the list needs updating
+    if (source == &audioProcessor.getPresetIndex())
+    {
+        refreshPresetList();
+        return;
+    }
+    
     // Pattern model has changed - update all UI components
     if (sequencingPlane != nullptr)
     {
@@ -394,6 +470,15 @@ void SquareBeatsAudioProcessorEditor::changeListenerCallback(juce::ChangeBroadca
         scaleControls->setControlsEnabled(!scaleSeqConfig.enabled);
     }
     
+    // Keep channel count and selection in sync (e.g. after loading a preset)
+    int numChannels = audioProcessor.getPatternModel().getNumColorChannels();
+    channelCountCombo.setSelectedId(numChannels, juce::dontSendNotification);
+    if (colorSelector != nullptr && colorSelector->getSelectedColorChannel() >= numChannels)
+    {
+        colorSelector->setSelectedColorChannel(numChannels - 1);
+        colorChannelSelected(numChannels - 1);
+    }
+    
     // Update context-sensitive controls
     updateContextSensitiveControls();
 }
@@ -406,10 +491,10 @@ void SquareBeatsAudioProcessorEditor::timerCallback()
     audioProcessor.getVisualFeedbackState().updateTime(currentTimeMs);
     audioProcessor.getBeatPulseState().updateTime(currentTimeMs);
     
-    // Repaint the gate flash overlay for smooth animation
+    // Animate gate flashes (the overlay is left alone while none is showing)
     if (gateFlashOverlay != nullptr)
     {
-        gateFlashOverlay->repaint();
+        gateFlashOverlay->refresh();
     }
     
     // Update beat pulse intensity and repaint sequencing plane
@@ -419,6 +504,12 @@ void SquareBeatsAudioProcessorEditor::timerCallback()
         sequencingPlane->setBeatPulseIntensity(beatPulse);
     }
     
+    // Show slot launches, including those triggered by incoming MIDI
+    if (patternSlots != nullptr)
+    {
+        patternSlots->refresh(audioProcessor.getQueuedSlot());
+    }
+    
     // Repaint color selector for activity indicators
     if (colorSelector != nullptr)
     {
@@ -432,7 +523,7 @@ void SquareBeatsAudioProcessorEditor::timerCallback()
         sequencingPlane->setPlaybackPosition(normalizedPosition);
         
         // Update per-color playback positions
-        for (int colorId = 0; colorId < 4; ++colorId)
+        for (int colorId = 0; colorId < audioProcessor.getPatternModel().getNumColorChannels(); ++colorId)
         {
             float colorPos = audioProcessor.getPlaybackEngine().getNormalizedPlaybackPositionForColor(colorId);
             sequencingPlane->setColorPlaybackPosition(colorId, colorPos);
@@ -480,20 +571,36 @@ void SquareBeatsAudioProcessorEditor::onClearAllClicked()
 {
     auto& patternModel = audioProcessor.getPatternModel();
     
-    // Clear all squares from all 4 color channels
-    for (int i = 0; i < 4; ++i)
+    // Clear all squares and pitch waveforms from every color channel, including ones not in use
+    for (int i = 0; i < SquareBeats::MAX_COLOR_CHANNELS; ++i)
     {
         patternModel.clearColorChannel(i);
         
-        // Clear pitch sequencer waveform for this color
-        auto& colorConfig = patternModel.getColorConfig(i);
-        std::fill(colorConfig.pitchWaveform.begin(), colorConfig.pitchWaveform.end(), 0.0f);
+        // Flatten pitch sequencer waveform for this color (keeping its resolution)
+        int waveformSize = patternModel.getColorConfig(i).pitchWaveform.size();
+        if (waveformSize > 0)
+            patternModel.setPitchWaveform(i, SquareBeats::PitchWaveform::flat(waveformSize).getEnvelope());
     }
     
     // Trigger UI update
     patternModel.sendChangeMessage();
 }
 
+void SquareBeatsAudioProcessorEditor::onChannelCountChanged()
+{
+    int numChannels = channelCountCombo.getSelectedId();
+    if (numChannels <= 0)
+        return;
+    
+    // Changing the count notifies listeners, which clamps the selected channel
+    audioProcessor.getPatternModel().setNumColorChannels(numChannels);
+    
+    if (colorSelector != nullptr)
+    {
+        colorSelector->repaint();
+    }
+}
+
 void SquareBeatsAudioProcessorEditor::updateContextSensitiveControls()
 {
     // Show/hide XY pad based on probability mode
@@ -524,18 +631,74 @@ juce::Rectangle<int> SquareBeatsAudioProcessorEditor::getLogoBounds() const
     return logoClickArea;
 }
 
+//==============================================================================
+// MIDI File Drop
+
+bool SquareBeatsAudioProcessorEditor::isInterestedInFileDrag(const juce::StringArray& files)
+{
+    for (const auto& path : files)
+    {
+        if (SquareBeats::MidiFileImporter::isMidiFile(juce::File(path)))
+            return true;
+    }
+    return false;
+}
+
+void SquareBeatsAudioProcessorEditor::filesDropped(const juce::StringArray& files, int x, int y)
+{
+    juce::ignoreUnused(x, y);
+    
+    // The first MIDI file replaces the pattern; the model's change message refreshes the editor
+    for (const auto& path : files)
+    {
+        const juce::File file(path);
+        if (!SquareBeats::MidiFileImporter::isMidiFile(file))
+            continue;
+        
+        SquareBeats::MidiFileImporter::Result result;
+        if (!SquareBeats::MidiFileImporter::importFile(file, audioProcessor.getPatternModel(),
+                                                       SquareBeats::MidiFileImporter::COLORS_AUTO, result))
+        {
+            juce::AlertWindow::showMessageBoxAsync(
+                juce::AlertWindow::WarningIcon,
+                "Import Failed",
+                "No notes could be read from '" + file.getFileName() + "'",
+                "OK"
+            );
+        }
+        return;
+    }
+}
+
 //==============================================================================
 // Preset Management
 
 void SquareBeatsAudioProcessorEditor::refreshPresetList()
 {
-    presetComboBox.clear(juce::dontSendNotification);
-    
     auto presetList = audioProcessor.getPresetList();
     
+    // Background rescans usually find nothing new; leave the menu alone then
+    juce::StringArray currentList;
+    for (int i = 0; i < presetComboBox.getNumItems(); ++i)
+    {
+        currentList.add(presetComboBox.getItemText(i));
+    }
+    if (currentList == presetList)
+    {
+        return;
+    }
+    
+    // Rebuild, keeping the selected preset selected
+    juce::String selectedName = presetComboBox.getSelectedId() > 0 ? presetComboBox.getText() : juce::String();
+    presetComboBox.clear(juce::dontSendNotification);
+    
     for (int i = 0; i < presetList.size(); ++i)
     {
         presetComboBox.addItem(presetList[i], i + 1);
+        if (presetList[i] == selectedName)
+        {
+            presetComboBox.setSelectedId(i + 1, juce::dontSendNotification);
+        }
     }
 }
 
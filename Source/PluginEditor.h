@@ -14,6 +14,8 @@
 #include "ScaleSequencerComponent.h"
 #include "GateFlashOverlay.h"
 #include "HelpAboutDialog.h"
+#include "PatternSlotsComponent.h"
+#include "AppFont.h"
 
 //==============================================================================
 /**
@@ -27,17 +29,20 @@
  * - Configuration panels (context-sensitive based on editing mode)
  * - Loop length and time signature controls
  * - Play mode buttons in top bar
+ *
+ * A Standard MIDI File dropped onto the editor replaces the pattern (see MidiFileImporter).
  */
 class SquareBeatsAudioProcessorEditor : public juce::AudioProcessorEditor,
                                          public SquareBeats::ColorSelectorComponent::Listener,
                                          public SquareBeats::ControlButtons::Listener,
+                                         public juce::FileDragAndDropTarget,
                                          private juce::ChangeListener,
                                          private juce::Timer
 {
 public:
     SquareBeatsAudioProcessorEditor (SquareBeatsAudioProcessor&);
     ~SquareBeatsAudioProcessorEditor() override;
-
+    
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
@@ -50,6 +55,10 @@ public:
     // ControlButtons::Listener
     void pitchSequencerVisibilityChanged(bool isVisible) override;
     
+    // FileDragAndDropTarget
+    bool isInterestedInFileDrag(const juce::StringArray& files) override;
+    void filesDropped(const juce::StringArray& files, int x, int y) override;
+    
     // ChangeListener
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     
@@ -58,6 +67,7 @@ public:
 
 private:
     void onClearAllClicked();
+    void onChannelCountChanged();
     void updateContextSensitiveControls();
     juce::Rectangle<int> getLogoBounds() const;
     
@@ -65,6 +75,9 @@ private:
     // access the processor object that created it.
     SquareBeatsAudioProcessor& audioProcessor;
     
+    // Keeps the font cache alive while the editor is open (declared before the components that use it)
+    juce::SharedResourcePointer<SquareBeats::AppFont::Cache> fontCache;
+    
     // Logo image
     juce::Image logoImage;
     juce::Rectangle<int> logoClickArea;
@@ -81,6 +94,7 @@ private:
     std::unique_ptr<SquareBeats::PlayModeButtons> playModeButtons;  // New: buttons in top bar
     std::unique_ptr<SquareBeats::PlayModeXYPad> playModeXYPad;      // New: XY pad in side panel
     std::unique_ptr<SquareBeats::ScaleSequencerComponent> scaleSequencer;
+    std::unique_ptr<SquareBeats::PatternSlotsComponent> patternSlots;
     
     // Scale sequencer toggle button
     juce::TextButton scaleSeqToggle;
@@ -88,15 +102,22 @@ private:
     // Top bar clear all button
     juce::TextButton clearAllButton;
     
+    // Number of color channels in use
+    juce::ComboBox channelCountCombo;
+    
+    // What incoming MIDI notes do (ids are LiveInputMode + 1)
+    juce::ComboBox liveInputCombo;
+    
     // Preset controls
     juce::ComboBox presetComboBox;
     juce::TextButton savePresetButton;
     juce::TextButton deletePresetButton;
+    juce::ComboBox presetSwitchCombo;  // Boundary at which presets loaded during playback take over
     
     void onSavePresetClicked();
     void onDeletePresetClicked();
     void onPresetSelected();
     void refreshPresetList();
-
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SquareBeatsAudioProcessorEditor)
 };
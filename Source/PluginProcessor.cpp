@@ -9,18 +9,19 @@ SquareBeatsAudioProcessor::SquareBeatsAudioProcessor()
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                        )
 {
-    // Initialize PlaybackEngine with PatternModel
-    playbackEngine.setPatternModel(&patternModel);
-    
     // Connect visual feedback state to playback engine
     playbackEngine.setVisualFeedbackState(&visualFeedbackState);
     
     // Create factory presets if needed
     presetManager.createFactoryPresetsIfNeeded();
+    
+    // Slots can be launched from incoming MIDI, so their handover is polled rather than started on demand
+    startTimerHz (30);
 }
 
 SquareBeatsAudioProcessor::~SquareBeatsAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -88,8 +89,7 @@ void SquareBeatsAudioProcessor::changeProgramName (int index, const juce::String
 //==============================================================================
 void SquareBeatsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
+    playbackEngine.prepareToPlay (sampleRate);
 }
 
 void SquareBeatsAudioProcessor::releaseResources()
@@ -104,7 +104,7 @@ bool SquareBeatsAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
     if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
      && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
-
+    
     return true;
 }
 
@@ -113,13 +113,19 @@ void SquareBeatsAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
-
+    
     // Clear any output channels that didn't contain input data
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
-
-    // Clear input MIDI - we only generate MIDI, don't pass through
-    midiMessages.clear();
+    
+    // Leaving a live input mode drops what it was doing
+    const auto inputMode = liveInputMode.load();
+    if (inputMode != appliedLiveInputMode)
+    {
+        playbackEngine.setLiveTranspose (SquareBeats::PlaybackEngine::ALL_COLORS, 0, 0);
+        playbackEngine.setLiveScaleRoot (SquareBeats::PlaybackEngine::NO_LIVE_SCALE_ROOT, 0);
+        appliedLiveInputMode = inputMode;
+    }
     
     // Get transport information from host using modern JUCE API
     if (auto* playHead = getPlayHead())
@@ -167,6 +173,65 @@ void SquareBeatsAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         }
     }
     
+    // Notes are recorded while the transport runs; anything still held ends where recording stops
+    const bool recording = inputMode == SquareBeats::LIVE_INPUT_RECORD && playbackEngine.getIsPlaying();
+    if (!recording)
+        midiRecorder.allNotesOff (playbackEngine.getHostPositionBeatsAt (0));
+    
+    // Incoming note-ons launch pattern slots, or drive the live input mode from their sample on
+    // (record mode takes note-offs too). The buffer is read once, in place, from the raw bytes, after the
+    // transport update (recording needs the block's position) and before the engine renders.
+    for (const auto metadata : midiMessages)
+    {
+        if (metadata.numBytes < 3)
+            continue;
+        
+        const int status = metadata.data[0] & 0xf0;
+        const int note = metadata.data[1];
+        const int velocity = metadata.data[2];
+        const bool isNoteOn = status == 0x90 && velocity > 0;
+        const bool isNoteOff = status == 0x80 || (status == 0x90 && velocity == 0);
+        if (!isNoteOn && !isNoteOff)
+            continue;
+        
+        const int slot = note - SLOT_LAUNCH_BASE_NOTE;
+        if (slot >= 0 && slot < SquareBeats::PatternSlots::NUM_SLOTS)
+        {
+            // The timer launches it, so pattern switches are only ever scheduled from one thread
+            if (isNoteOn && !patternSlots.isSlotEmpty (slot) && slot != patternSlots.getActiveSlot())
+                midiLaunchedSlot = slot;
+            continue;
+        }
+        
+        if (recording)
+        {
+            const double position = playbackEngine.getHostPositionBeatsAt (metadata.samplePosition);
+            if (isNoteOn)
+                midiRecorder.noteOn (note, velocity, position);
+            else
+                midiRecorder.noteOff (note, position);
+        }
+        else if (!isNoteOn)
+        {
+            continue;
+        }
+        else if (inputMode == SquareBeats::LIVE_INPUT_TRANSPOSE)
+        {
+            playbackEngine.setLiveTranspose (SquareBeats::PlaybackEngine::ALL_COLORS,
+                                             note - LIVE_TRANSPOSE_CENTRE_NOTE, metadata.samplePosition);
+        }
+        else if (inputMode == SquareBeats::LIVE_INPUT_SCALE_ROOT)
+        {
+            playbackEngine.setLiveScaleRoot (note % 12, metadata.samplePosition);
+        }
+    }
+    
+    // Clear input MIDI - we only generate MIDI, don't pass through
+    midiMessages.clear();
+    
+    // Settings the host automated since the last block
+    automationParameters.readBlock (playbackEngine);
+    
     // Generate MIDI events
     playbackEngine.processBlock(buffer, midiMessages);
 }
@@ -185,14 +250,241 @@ juce::AudioProcessorEditor* SquareBeatsAudioProcessor::createEditor()
 //==============================================================================
 void SquareBeatsAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // Serialize pattern model using StateManager
-    SquareBeats::StateManager::saveState(patternModel, destData);
+    const juce::ScopedLock lock (stateLock);
+    
+    // Hosts ask for state far more often than it changes (autosave, undo snapshots),
+    // so only re-serialize the pattern model when it has been edited since last time.
+    // The version is read first: an edit made while encoding leaves the cache stale.
+    const uint64_t editVersion = patternModel.getEditVersion();
+    const uint64_t slotsVersion = patternSlots.getVersion();
+    if (cachedState.isEmpty() || editVersion != cachedStateVersion || slotsVersion != cachedSlotsVersion)
+    {
+        SquareBeats::StateManager::saveState(patternModel, cachedState);
+        
+        std::vector<juce::MemoryBlock> slotStates;
+        slotStates.reserve (SquareBeats::PatternSlots::NUM_SLOTS);
+        for (int slot = 0; slot < SquareBeats::PatternSlots::NUM_SLOTS; ++slot)
+            slotStates.push_back (patternSlots.getSlotState (slot));
+        
+        SquareBeats::StateManager::saveSlots (cachedState, slotStates, patternSlots.getActiveSlot());
+        cachedStateVersion = editVersion;
+        cachedSlotsVersion = slotsVersion;
+    }
+    
+    destData = cachedState;
 }
 
 void SquareBeatsAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // Deserialize pattern model using StateManager
+    const juce::ScopedLock lock (stateLock);
+    
+    // New state replaces whatever was about to take over
+    withdrawStagedPreset();
+    withdrawQueuedSlot();
+    
+    // Deserialize pattern model using StateManager (its setters advance the edit version)
+    patternSync.suspend();
     SquareBeats::StateManager::loadState(patternModel, data, sizeInBytes);
+    patternSync.resume (true, true);
+    
+    // State without slots (older versions, presets) leaves every slot empty
+    std::vector<juce::MemoryBlock> slotStates;
+    int activeSlot = SquareBeats::PatternSlots::NO_SLOT;
+    SquareBeats::StateManager::loadSlots (data, sizeInBytes, slotStates, activeSlot);
+    
+    for (int slot = 0; slot < SquareBeats::PatternSlots::NUM_SLOTS; ++slot)
+    {
+        if (slot < static_cast<int> (slotStates.size()))
+            retirePattern (patternSlots.restoreSlot (slot, slotStates[static_cast<size_t> (slot)]));
+        else
+            retirePattern (patternSlots.clearSlot (slot));
+    }
+    
+    patternSlots.setActiveSlot (patternSlots.isSlotEmpty (activeSlot) ? SquareBeats::PatternSlots::NO_SLOT : activeSlot);
+}
+
+//==============================================================================
+bool SquareBeatsAudioProcessor::loadPreset (const juce::String& presetName)
+{
+    // The newest request wins over a preset or slot that has not taken over yet
+    withdrawStagedPreset();
+    withdrawQueuedSlot();
+    
+    // Stopped: nothing is sounding, so load straight into the live model
+    if (!playbackEngine.getIsPlaying())
+    {
+        patternSync.suspend();
+        const bool loaded = presetManager.loadPreset (patternModel, presetName);
+        patternSync.resume (true, true);
+        return loaded;
+    }
+    
+    // Playing: parse into a separate model here, so the audio thread only swaps a pointer
+    juce::MemoryBlock data;
+    if (!presetManager.readPreset (presetName, data))
+        return false;
+    
+    auto staged = std::make_unique<SquareBeats::PatternModel>();
+    if (!SquareBeats::StateManager::loadState (*staged, data.getData(), static_cast<int> (data.getSize())))
+    {
+        juce::Logger::writeToLog ("SquareBeatsAudioProcessor: Failed to deserialize preset '" + presetName + "'");
+        return false;
+    }
+    
+    stagedPattern = std::move (staged);
+    stagedPresetName = presetName;
+    stagedPresetData = std::move (data);
+    
+    playbackEngine.schedulePatternSwitch (stagedPattern.get(), presetSwitchQuantize, true);
+    return true;
+}
+
+void SquareBeatsAudioProcessor::withdrawStagedPreset()
+{
+    if (stagedPattern == nullptr)
+        return;
+    
+    // It may already be playing, or about to; the timer frees it once it is not
+    playbackEngine.cancelPatternSwitch (stagedPattern.get());
+    retirePattern (std::move (stagedPattern));
+    stagedPresetData.reset();
+}
+
+void SquareBeatsAudioProcessor::withdrawQueuedSlot()
+{
+    const int slot = queuedSlot.exchange (SquareBeats::PatternSlots::NO_SLOT);
+    if (slot != SquareBeats::PatternSlots::NO_SLOT)
+        playbackEngine.cancelPatternSwitch (patternSlots.getSlotModel (slot));
+}
+
+//==============================================================================
+void SquareBeatsAudioProcessor::storeSlot (int slot)
+{
+    const juce::ScopedLock lock (stateLock);
+    retirePattern (patternSlots.storeSlot (slot, patternModel));
+}
+
+void SquareBeatsAudioProcessor::clearSlot (int slot)
+{
+    const juce::ScopedLock lock (stateLock);
+    
+    if (queuedSlot.load() == slot)
+        withdrawQueuedSlot();
+    
+    retirePattern (patternSlots.clearSlot (slot));
+}
+
+bool SquareBeatsAudioProcessor::launchSlot (int slot)
+{
+    if (patternSlots.isSlotEmpty (slot) || slot == patternSlots.getActiveSlot())
+        return false;
+    
+    withdrawStagedPreset();
+    
+    if (playbackEngine.getIsPlaying())
+    {
+        queueSlotLaunch (slot);
+        return true;
+    }
+    
+    // Stopped: load straight into the live model, as presets do
+    withdrawQueuedSlot();
+    patternSync.suspend();
+    const bool loaded = activateSlot (slot);
+    patternSync.resume (true, true);
+    return loaded;
+}
+
+void SquareBeatsAudioProcessor::queueSlotLaunch (int slot)
+{
+    // The slot's model is already loaded, so the audio thread only swaps a pointer
+    if (auto* model = patternSlots.getSlotModel (slot))
+    {
+        playbackEngine.schedulePatternSwitch (model, slotLaunchQuantize.load(), true);
+        queuedSlot = slot;
+    }
+}
+
+bool SquareBeatsAudioProcessor::activateSlot (int slot)
+{
+    const juce::ScopedLock lock (stateLock);
+    
+    // The live model is the working copy of the active slot, so keep its edits there
+    const int previousSlot = patternSlots.getActiveSlot();
+    if (previousSlot != SquareBeats::PatternSlots::NO_SLOT && previousSlot != slot)
+        retirePattern (patternSlots.storeSlot (previousSlot, patternModel));
+    
+    const bool loaded = patternSlots.loadSlotInto (slot, patternModel);
+    patternSlots.setActiveSlot (loaded ? slot : SquareBeats::PatternSlots::NO_SLOT);
+    
+    if (queuedSlot.load() == slot)
+        queuedSlot = SquareBeats::PatternSlots::NO_SLOT;
+    
+    patternModel.sendChangeMessage();  // Notify UI of changes
+    return loaded;
+}
+
+//==============================================================================
+void SquareBeatsAudioProcessor::retirePattern (std::unique_ptr<SquareBeats::PatternModel> model)
+{
+    const juce::ScopedLock lock (stateLock);
+    patternSync.retire (std::move (model));
+}
+
+void SquareBeatsAudioProcessor::timerCallback()
+{
+    {
+        const juce::ScopedLock lock (stateLock);
+        midiRecorder.update();
+        automationParameters.syncWithModel (patternModel);
+        patternSync.update();
+    }
+    
+    const int launchedSlot = midiLaunchedSlot.exchange (SquareBeats::PatternSlots::NO_SLOT);
+    if (launchedSlot != SquareBeats::PatternSlots::NO_SLOT)
+        launchSlot (launchedSlot);
+    
+    // Log notes the engine dropped to stay within its per-block limit
+    const int droppedNotes = playbackEngine.getNumDroppedNotes();
+    if (droppedNotes != reportedDroppedNotes)
+    {
+        juce::Logger::writeToLog ("SquareBeatsAudioProcessor: " + juce::String (droppedNotes - reportedDroppedNotes)
+                                  + " notes dropped over the per-block limit");
+        reportedDroppedNotes = droppedNotes;
+    }
+    
+    // Wait until the engine has taken the latest copy of the live model
+    if (playbackEngine.isPatternSwitchPending() || !patternSync.isUpToDate())
+        return;
+    
+    auto* activePattern = playbackEngine.getActivePatternModel();
+    if (patternSync.isPlaybackModel (activePattern))
+    {
+        // Back on the live model's copy: the staged copy is no longer read by the audio thread
+        if (stagedPattern != nullptr)
+        {
+            stagedPattern.reset();
+            stagedPresetData.reset();
+        }
+        queuedSlot = SquareBeats::PatternSlots::NO_SLOT;
+        return;
+    }
+    
+    // A preset or slot is playing: load the same data into the live model (which the UI
+    // edits), then hand playback back to its copy. The copy is identical, so nothing is cut.
+    bool identical = false;
+    patternSync.suspend();
+    if (stagedPattern != nullptr && activePattern == stagedPattern.get())
+    {
+        identical = presetManager.loadPresetData (patternModel, stagedPresetName, stagedPresetData);
+    }
+    else
+    {
+        const int slot = patternSlots.findSlot (activePattern);
+        if (slot != SquareBeats::PatternSlots::NO_SLOT)
+            identical = activateSlot (slot);
+    }
+    patternSync.resume (true, !identical);
 }
 
 //==============================================================================
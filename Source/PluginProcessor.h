@@ -7,6 +7,10 @@
 #include "StateManager.h"
 #include "VisualFeedback.h"
 #include "PresetManager.h"
+#include "PatternSlots.h"
+#include "PatternSync.h"
+#include "MidiRecorder.h"
+#include "AutomationParameters.h"
 
 //==============================================================================
 /**
@@ -18,46 +22,47 @@
  * - State serialization/deserialization
  * - Communication with the editor UI
  */
-class SquareBeatsAudioProcessor : public juce::AudioProcessor
+class SquareBeatsAudioProcessor : public juce::AudioProcessor,
+                                  private juce::Timer
 {
 public:
     //==============================================================================
     SquareBeatsAudioProcessor();
     ~SquareBeatsAudioProcessor() override;
-
+    
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
-
+   
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
-
+    
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
+    
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
-
+    
     //==============================================================================
     const juce::String getName() const override;
-
+    
     bool acceptsMidi() const override;
     bool producesMidi() const override;
     bool isMidiEffect() const override;
     double getTailLengthSeconds() const override;
-
+    
     //==============================================================================
     int getNumPrograms() override;
     int getCurrentProgram() override;
     void setCurrentProgram (int index) override;
     const juce::String getProgramName (int index) override;
     void changeProgramName (int index, const juce::String& newName) override;
-
+    
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
-
+    
     //==============================================================================
     // Access to pattern model for UI
     SquareBeats::PatternModel& getPatternModel() { return patternModel; }
@@ -86,8 +91,16 @@ public:
     
     /**
      * Load a preset by name
+     * While playing, the preset is prepared in a separate pattern model and
+     * playback switches to it at the next preset switch boundary.
+     */
+    bool loadPreset(const juce::String& presetName);
+    
+    /**
+     * Boundary at which presets loaded during playback take over
      */
-    bool loadPreset(const juce::String& presetName) { return presetManager.loadPreset(patternModel, presetName); }
+    SquareBeats::SwitchQuantize getPresetSwitchQuantize() const { return presetSwitchQuantize; }
+    void setPresetSwitchQuantize(SquareBeats::SwitchQuantize quantize) { presetSwitchQuantize = quantize; }
     
     /**
      * Delete a preset by name
@@ -98,12 +111,77 @@ public:
      * Check if a preset exists
      */
     bool presetExists(const juce::String& presetName) { return presetManager.presetExists(presetName); }
+    
+    /**
+     * Get the background preset index (the editor listens to it for list changes)
+     */
+    SquareBeats::PresetIndex& getPresetIndex() { return presetManager.getPresetIndex(); }
+    
+    //==============================================================================
+    // Pattern slots
+    
+    /**
+     * Get the pattern slot bank (the editor reads it to draw the slot buttons)
+     */
+    const SquareBeats::PatternSlots& getPatternSlots() const { return patternSlots; }
+    
+    /**
+     * Store a copy of the current pattern in a slot
+     */
+    void storeSlot(int slot);
+    
+    /**
+     * Empty a slot
+     */
+    void clearSlot(int slot);
+    
+    /**
+     * Launch a slot: while playing it takes over at the next slot launch boundary,
+     * while stopped it is loaded straight away
+     * @return false if the slot is empty or already active
+     */
+    bool launchSlot(int slot);
+    
+    /**
+     * Slot waiting for its launch boundary, or PatternSlots::NO_SLOT
+     */
+    int getQueuedSlot() const { return queuedSlot.load(); }
+    
+    /**
+     * Boundary at which launched slots take over
+     */
+    SquareBeats::SwitchQuantize getSlotLaunchQuantize() const { return slotLaunchQuantize.load(); }
+    void setSlotLaunchQuantize(SquareBeats::SwitchQuantize quantize) { slotLaunchQuantize = quantize; }
+    
+    // Incoming note-ons from this note up launch slots 1 to NUM_SLOTS (C1 = slot 1)
+    static constexpr int SLOT_LAUNCH_BASE_NOTE = 36;
+    
+    //==============================================================================
+    // Live MIDI input
+    
+    /**
+     * What incoming notes outside the slot launch range do
+     */
+    SquareBeats::LiveInputMode getLiveInputMode() const { return liveInputMode.load(); }
+    void setLiveInputMode(SquareBeats::LiveInputMode mode) { liveInputMode = mode; }
+    
+    // In transpose mode this note plays the pattern untransposed (middle C)
+    static constexpr int LIVE_TRANSPOSE_CENTRE_NOTE = 60;
+    
+    /**
+     * Color channel that notes are recorded into in record mode (message thread)
+     */
+    int getMidiRecordColor() const { return midiRecorder.getRecordColor(); }
+    void setMidiRecordColor(int colorId) { midiRecorder.setRecordColor(colorId); }
 
 private:
     //==============================================================================
     // Core components
     SquareBeats::PatternModel patternModel;
     SquareBeats::PlaybackEngine playbackEngine;
+    
+    // The engine plays a copy of patternModel, kept in step by commands (declared after both)
+    SquareBeats::PatternSync patternSync { patternModel, playbackEngine };
     SquareBeats::VisualFeedbackState visualFeedbackState;
     SquareBeats::BeatPulseState beatPulseState;
     SquareBeats::PresetManager presetManager;
@@ -111,5 +189,70 @@ private:
     // Beat tracking for visual pulse
     double lastBeatPosition = -1.0;
     
+    // Last encoded state, reused by getStateInformation() while the edit version is unchanged
+    juce::MemoryBlock cachedState;
+    uint64_t cachedStateVersion = 0;
+    uint64_t cachedSlotsVersion = 0;
+    juce::CriticalSection stateLock;
+    
+    // Quantized preset switching: the engine plays stagedPattern from the boundary
+    // until the live model has been loaded with the same preset and its copy handed back
+    std::unique_ptr<SquareBeats::PatternModel> stagedPattern;
+    juce::String stagedPresetName;
+    juce::MemoryBlock stagedPresetData;
+    SquareBeats::SwitchQuantize presetSwitchQuantize = SquareBeats::SWITCH_NEXT_BAR;
+    
+    // Slot launching works the same way, with the slot's own model standing in for stagedPattern
+    SquareBeats::PatternSlots patternSlots;
+    std::atomic<int> queuedSlot { SquareBeats::PatternSlots::NO_SLOT };
+    std::atomic<SquareBeats::SwitchQuantize> slotLaunchQuantize { SquareBeats::SWITCH_NEXT_BAR };
+    std::atomic<int> midiLaunchedSlot { SquareBeats::PatternSlots::NO_SLOT };  // Last slot note-on, for the timer to launch
+    
+    // Live input: the mode set by the editor, and the one the audio thread last acted on
+    std::atomic<SquareBeats::LiveInputMode> liveInputMode { SquareBeats::LIVE_INPUT_OFF };
+    SquareBeats::LiveInputMode appliedLiveInputMode = SquareBeats::LIVE_INPUT_OFF;
+    
+    // Record mode: the audio thread queues played notes, the timer adds them to patternModel
+    SquareBeats::MidiRecorder midiRecorder { patternModel };
+    
+    // Host-automatable parameters, mirrored to and from patternModel by the timer
+    SquareBeats::AutomationParameters automationParameters { *this };
+    
+    // Engine's dropped note count as of the timer's last report
+    int reportedDroppedNotes = 0;
+    
+    /**
+     * Drop a staged preset that has not been handed back to the live model yet
+     */
+    void withdrawStagedPreset();
+    
+    /**
+     * Cancel a slot launch that is still waiting for its boundary
+     */
+    void withdrawQueuedSlot();
+    
+    /**
+     * Schedule a switch to a slot's model (message thread)
+     */
+    void queueSlotLaunch(int slot);
+    
+    /**
+     * Make a slot the active one: keep the live model's edits in the previously
+     * active slot, then load the slot into the live model (message thread)
+     * @return false if the slot could not be loaded
+     */
+    bool activateSlot(int slot);
+    
+    /**
+     * Keep a model alive until the audio thread can no longer be reading it
+     */
+    void retirePattern(std::unique_ptr<SquareBeats::PatternModel> model);
+    
+    /**
+     * Launch slots played from MIDI, advance in-flight preset switches and slot launches,
+     * and sync recorded notes and parameters with the live model (message thread)
+     */
+    void timerCallback() override;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SquareBeatsAudioProcessor)
 };
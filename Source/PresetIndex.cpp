@@ -0,0 +1,443 @@
+#include "PresetIndex.h"
+#include "PatternModel.h"
+#include "StateManager.h"
+#include <algorithm>
+
+namespace SquareBeats {
+
+//==============================================================================
+PresetIndex::PresetIndex(const juce::File& presetDirectory)
+    : juce::Thread("SquareBeats preset scanner")
+    , directory(presetDirectory)
+    , indexFile(presetDirectory.getChildFile(".presetindex"))
+{
+    startThread();
+}
+
+PresetIndex::~PresetIndex()
+{
+    removeAllChangeListeners();
+    stopThread(4000);
+}
+
+//==============================================================================
+void PresetIndex::rescan()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        scanRequested = true;
+    }
+    notify();
+}
+
+bool PresetIndex::isScanComplete() const
+{
+    const juce::ScopedLock sl(lock);
+    return scanComplete;
+}
+
+std::vector<PresetInfo> PresetIndex::getPresets() const
+{
+    const juce::ScopedLock sl(lock);
+    return presets;
+}
+
+juce::StringArray PresetIndex::getPresetNames() const
+{
+    const juce::ScopedLock sl(lock);
+    
+    juce::StringArray names;
+    names.ensureStorageAllocated(static_cast<int>(presets.size()));
+    for (const auto& preset : presets)
+    {
+        names.add(preset.name);
+    }
+    return names;
+}
+
+bool PresetIndex::getPresetInfo(const juce::String& presetName, PresetInfo& info) const
+{
+    const juce::ScopedLock sl(lock);
+    
+    for (const auto& preset : presets)
+    {
+        if (preset.name == presetName)
+        {
+            info = preset;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PresetIndex::getPreloadedData(const juce::String& presetName, juce::MemoryBlock& data) const
+{
+    const juce::ScopedLock sl(lock);
+    
+    auto it = preloaded.find(presetName);
+    if (it == preloaded.end())
+    {
+        return false;
+    }
+    
+    data = it->second;
+    return true;
+}
+
+void PresetIndex::setCurrentPreset(const juce::String& presetName)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        currentPreset = presetName;
+        preloadRequested = true;
+    }
+    notify();
+}
+
+void PresetIndex::presetSaved(const juce::String& presetName)
+{
+    bool added = false;
+    {
+        const juce::ScopedLock sl(lock);
+        
+        // Drop the stale preloaded copy; the rescan re-reads only this file
+        preloaded.erase(presetName);
+        
+        // List a new preset straight away so the browser can select it;
+        // its metadata is filled in by the rescan
+        auto it = std::find_if(presets.begin(), presets.end(),
+                               [&presetName](const PresetInfo& preset) { return preset.name == presetName; });
+        if (it == presets.end())
+        {
+            PresetInfo info;
+            info.name = presetName;
+            presets.push_back(info);
+            sortPresets(presets);
+            added = true;
+        }
+    }
+    
+    if (added)
+    {
+        sendChangeMessage();
+    }
+    rescan();
+}
+
+void PresetIndex::presetDeleted(const juce::String& presetName)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        preloaded.erase(presetName);
+        presets.erase(std::remove_if(presets.begin(), presets.end(),
+                                     [&presetName](const PresetInfo& preset) { return preset.name == presetName; }),
+                      presets.end());
+    }
+    sendChangeMessage();
+    rescan();
+}
+
+//==============================================================================
+void PresetIndex::run()
+{
+    while (!threadShouldExit())
+    {
+        bool shouldScan = false;
+        bool shouldPreload = false;
+        {
+            const juce::ScopedLock sl(lock);
+            shouldScan = scanRequested;
+            shouldPreload = preloadRequested || scanRequested;
+            scanRequested = false;
+            preloadRequested = false;
+        }
+        
+        if (shouldScan)
+        {
+            scanDirectory();
+        }
+        
+        if (shouldPreload && !threadShouldExit())
+        {
+            preloadNeighbours();
+        }
+        
+        if (!shouldScan && !shouldPreload)
+        {
+            wait(-1);
+        }
+    }
+}
+
+void PresetIndex::scanDirectory()
+{
+    // Start from the last scan, or from the index file on the first one
+    std::vector<PresetInfo> previous;
+    bool firstScan = false;
+    {
+        const juce::ScopedLock sl(lock);
+        previous = presets;
+        firstScan = !scanComplete;
+    }
+    
+    if (firstScan && previous.empty())
+    {
+        previous = readIndexFile();
+        
+        // Show the persisted list straight away; the scan below corrects it
+        if (!previous.empty())
+        {
+            {
+                const juce::ScopedLock sl(lock);
+                presets = previous;
+            }
+            sendChangeMessage();
+        }
+    }
+    
+    std::map<juce::String, const PresetInfo*> previousByName;
+    for (const auto& preset : previous)
+    {
+        previousByName[preset.name] = &preset;
+    }
+    
+    std::vector<PresetInfo> scanned;
+    scanned.reserve(previous.size());
+    juce::StringArray stale;
+    bool changed = previous.empty();
+    
+    for (const auto& entry : juce::RangedDirectoryIterator(directory, false, "*.vstpreset", juce::File::findFiles))
+    {
+        if (threadShouldExit())
+        {
+            return;
+        }
+        
+        const juce::File file = entry.getFile();
+        const juce::String name = file.getFileNameWithoutExtension();
+        const juce::int64 modificationTime = entry.getModificationTime().toMilliseconds();
+        const juce::int64 fileSize = entry.getFileSize();
+        
+        auto it = previousByName.find(name);
+        if (it != previousByName.end())
+        {
+            const PresetInfo& indexed = *it->second;
+            previousByName.erase(it);
+            
+            // Unchanged files keep their metadata without being opened
+            if (indexed.modificationTime == modificationTime && indexed.fileSize == fileSize)
+            {
+                scanned.push_back(indexed);
+                continue;
+            }
+            
+            // Rewritten since it was indexed, so a preloaded copy is out of date
+            stale.add(name);
+        }
+        
+        scanned.push_back(readPresetInfo(file, modificationTime, fileSize));
+        changed = true;
+    }
+    
+    // Anything left over was deleted since the last scan
+    changed = changed || !previousByName.empty();
+    
+    sortPresets(scanned);
+    
+    {
+        const juce::ScopedLock sl(lock);
+        presets = scanned;
+        scanComplete = true;
+        
+        // Preloaded copies of changed files are read again by the preload that follows every scan
+        for (const auto& name : stale)
+        {
+            preloaded.erase(name);
+        }
+    }
+    
+    if (changed)
+    {
+        writeIndexFile(scanned);
+        sendChangeMessage();
+    }
+}
+
+void PresetIndex::preloadNeighbours()
+{
+    // Work out which presets should be in memory
+    juce::StringArray wanted;
+    {
+        const juce::ScopedLock sl(lock);
+        
+        int currentIndex = -1;
+        for (size_t i = 0; i < presets.size(); ++i)
+        {
+            if (presets[i].name == currentPreset)
+            {
+                currentIndex = static_cast<int>(i);
+                break;
+            }
+        }
+        
+        if (currentIndex >= 0)
+        {
+            const int numPresets = static_cast<int>(presets.size());
+            for (int offset = -PRELOAD_NEIGHBOURS; offset <= PRELOAD_NEIGHBOURS; ++offset)
+            {
+                // Wrap around, matching next/previous at either end of the list
+                int index = ((currentIndex + offset) % numPresets + numPresets) % numPresets;
+                wanted.addIfNotAlreadyThere(presets[static_cast<size_t>(index)].name);
+            }
+        }
+        
+        for (auto it = preloaded.begin(); it != preloaded.end();)
+        {
+            it = wanted.contains(it->first) ? std::next(it) : preloaded.erase(it);
+        }
+    }
+    
+    // Read missing files without holding the lock
+    for (const auto& name : wanted)
+    {
+        if (threadShouldExit())
+        {
+            return;
+        }
+        
+        {
+            const juce::ScopedLock sl(lock);
+            if (preloaded.count(name) > 0)
+            {
+                continue;
+            }
+        }
+        
+        juce::MemoryBlock data;
+        if (getPresetFile(name).loadFileAsData(data))
+        {
+            const juce::ScopedLock sl(lock);
+            preloaded[name] = std::move(data);
+        }
+    }
+}
+
+//==============================================================================
+PresetInfo PresetIndex::readPresetInfo(const juce::File& file, juce::int64 modificationTime,
+                                       juce::int64 fileSize)
+{
+    PresetInfo info;
+    info.name = file.getFileNameWithoutExtension();
+    info.modificationTime = modificationTime;
+    info.fileSize = fileSize;
+    
+    juce::MemoryBlock data;
+    if (!file.loadFileAsData(data))
+    {
+        return info;
+    }
+    
+    // Parse with the same loader as the plugin, into a pattern nobody listens to
+    PatternModel scratch;
+    if (StateManager::loadState(scratch, data.getData(), static_cast<int>(data.getSize())))
+    {
+        info.isValid = true;
+        info.numSquares = static_cast<int>(scratch.getSquares().size());
+        info.loopLengthBars = scratch.getLoopLength();
+        info.rootNote = scratch.getScaleConfig().rootNote;
+        info.scaleType = scratch.getScaleConfig().scaleType;
+    }
+    
+    return info;
+}
+
+void PresetIndex::sortPresets(std::vector<PresetInfo>& presetsToSort)
+{
+    std::sort(presetsToSort.begin(), presetsToSort.end(),
+              [](const PresetInfo& a, const PresetInfo& b)
+              {
+                  if (a.isFactory() != b.isFactory())
+                  {
+                      return a.isFactory();
+                  }
+                  return a.name.compareIgnoreCase(b.name) < 0;
+              });
+}
+
+//==============================================================================
+std::vector<PresetInfo> PresetIndex::readIndexFile() const
+{
+    std::vector<PresetInfo> indexed;
+    
+    juce::MemoryBlock data;
+    if (!indexFile.existsAsFile() || !indexFile.loadFileAsData(data) || data.getSize() < 12)
+    {
+        return indexed;
+    }
+    
+    juce::MemoryInputStream stream(data, false);
+    if (static_cast<uint32_t>(stream.readInt()) != INDEX_MAGIC_NUMBER || stream.readInt() != INDEX_VERSION)
+    {
+        // Unknown index files are rebuilt by the scan
+        return indexed;
+    }
+    
+    int numEntries = stream.readInt();
+    if (numEntries < 0 || numEntries > 1000000)
+    {
+        return indexed;
+    }
+    
+    indexed.reserve(static_cast<size_t>(numEntries));
+    for (int i = 0; i < numEntries && !stream.isExhausted(); ++i)
+    {
+        PresetInfo info;
+        info.name = stream.readString();
+        info.modificationTime = stream.readInt64();
+        info.fileSize = stream.readInt64();
+        info.isValid = stream.readBool();
+        info.numSquares = stream.readInt();
+        info.loopLengthBars = stream.readDouble();
+        info.rootNote = static_cast<RootNote>(juce::jlimit(0, 11, stream.readInt()));
+        info.scaleType = static_cast<ScaleType>(juce::jlimit(0, static_cast<int>(NUM_SCALE_TYPES) - 1, stream.readInt()));
+        
+        if (info.name.isNotEmpty())
+        {
+            indexed.push_back(info);
+        }
+    }
+    
+    return indexed;
+}
+
+void PresetIndex::writeIndexFile(const std::vector<PresetInfo>& indexed) const
+{
+    juce::MemoryOutputStream stream;
+    stream.writeInt(static_cast<int>(INDEX_MAGIC_NUMBER));
+    stream.writeInt(INDEX_VERSION);
+    stream.writeInt(static_cast<int>(indexed.size()));
+    
+    for (const auto& info : indexed)
+    {
+        stream.writeString(info.name);
+        stream.writeInt64(info.modificationTime);
+        stream.writeInt64(info.fileSize);
+        stream.writeBool(info.isValid);
+        stream.writeInt(info.numSquares);
+        stream.writeDouble(info.loopLengthBars);
+        stream.writeInt(static_cast<int>(info.rootNote));
+        stream.writeInt(static_cast<int>(info.scaleType));
+    }
+    
+    if (!indexFile.replaceWithData(stream.getData(), stream.getDataSize()))
+    {
+        juce::Logger::writeToLog("PresetIndex: Failed to write index file: " + indexFile.getFullPathName());
+    }
+}
+
+juce::File PresetIndex::getPresetFile(const juce::String& presetName) const
+{
+    return directory.getChildFile(presetName + ".vstpreset");
+}
+
+} // namespace SquareBeats
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "DataStructures.h"
+#include <map>
+#include <vector>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * Metadata for one preset file, as shown in the preset browser
+ */
+struct PresetInfo
+{
+    juce::String name;                  // File name without extension
+    juce::int64 modificationTime = 0;   // Milliseconds since the epoch
+    juce::int64 fileSize = 0;
+    bool isValid = false;               // False if the file could not be parsed
+    int numSquares = 0;
+    double loopLengthBars = 0.0;
+    RootNote rootNote = ROOT_C;
+    ScaleType scaleType = SCALE_MAJOR;
+    
+    /**
+     * Factory presets start with an underscore and sort first
+     */
+    bool isFactory() const { return name.startsWith("_"); }
+};
+
+//==============================================================================
+/**
+ * PresetIndex scans the preset directory on a background thread
+ *
+ * The index keeps metadata for every preset and persists it next to the
+ * presets, so a rescan only reads files whose modification time or size has
+ * changed since the last one. Listeners are sent a change message (on the
+ * message thread) whenever the preset list or its metadata changes.
+ *
+ * The raw data of the current preset's neighbours is kept in memory, so
+ * stepping to the previous or next preset does not touch the disk.
+ *
+ * Run one index per directory: PresetManager shares its index between all
+ * plugin instances in the process.
+ */
+class PresetIndex : public juce::ChangeBroadcaster,
+                    private juce::Thread
+{
+public:
+    explicit PresetIndex(const juce::File& presetDirectory);
+    ~PresetIndex() override;
+    
+    /**
+     * Rescan the preset directory in the background
+     */
+    void rescan();
+    
+    /**
+     * Whether at least one scan has finished since construction
+     */
+    bool isScanComplete() const;
+    
+    /**
+     * Get metadata for all indexed presets, factory presets first, then alphabetical
+     */
+    std::vector<PresetInfo> getPresets() const;
+    
+    /**
+     * Get the names of all indexed presets, in the same order as getPresets()
+     */
+    juce::StringArray getPresetNames() const;
+    
+    /**
+     * Get metadata for one preset
+     * @return false if the preset is not in the index
+     */
+    bool getPresetInfo(const juce::String& presetName, PresetInfo& info) const;
+    
+    /**
+     * Get a preset's file data if it has been preloaded
+     * @return false if the preset is not in memory
+     */
+    bool getPreloadedData(const juce::String& presetName, juce::MemoryBlock& data) const;
+    
+    /**
+     * Set the current preset; its neighbours are then preloaded in the background
+     * With a shared index, this is the preset any instance loaded last.
+     */
+    void setCurrentPreset(const juce::String& presetName);
+    
+    /**
+     * Update the index after a preset file was written
+     */
+    void presetSaved(const juce::String& presetName);
+    
+    /**
+     * Remove a preset from the index after its file was deleted
+     */
+    void presetDeleted(const juce::String& presetName);
+    
+    // Presets either side of the current one kept in memory
+    static constexpr int PRELOAD_NEIGHBOURS = 1;
+
+private:
+    //==============================================================================
+    void run() override;
+    
+    /**
+     * Scan the directory, re-reading only presets that changed since they were indexed
+     */
+    void scanDirectory();
+    
+    /**
+     * Read the current preset's neighbours into the preload cache and drop the rest
+     */
+    void preloadNeighbours();
+    
+    /**
+     * Read a preset file's metadata by loading it into a scratch pattern
+     */
+    static PresetInfo readPresetInfo(const juce::File& file, juce::int64 modificationTime,
+                                     juce::int64 fileSize);
+    
+    /**
+     * Sort presets into browser order (factory first, then case-insensitive by name)
+     */
+    static void sortPresets(std::vector<PresetInfo>& presets);
+    
+    /**
+     * Read and write the persistent index file
+     */
+    std::vector<PresetInfo> readIndexFile() const;
+    void writeIndexFile(const std::vector<PresetInfo>& presets) const;
+    
+    juce::File getPresetFile(const juce::String& presetName) const;
+    
+    //==============================================================================
+    const juce::File directory;
+    const juce::File indexFile;
+    
+    // Guards everything below; held only briefly, never while reading files
+    juce::CriticalSection lock;
+    std::vector<PresetInfo> presets;
+    std::map<juce::String, juce::MemoryBlock> preloaded;
+    juce::String currentPreset;
+    bool scanRequested = true;
+    bool preloadRequested = false;
+    bool scanComplete = false;
+    
+    // Magic number and version of the index file ("SQBI" = SquareBeats index)
+    static constexpr uint32_t INDEX_MAGIC_NUMBER = 0x53514249;
+    static constexpr int INDEX_VERSION = 1;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetIndex)
+};
+
+} // namespace SquareBeats
@@ -5,42 +5,56 @@ namespace SquareBeats {
 
 //==============================================================================
 PresetManager::PresetManager()
+    : presetDirectory(sharedIndex->directory)
 {
+}
+
+PresetManager::SharedIndex::SharedIndex()
+    : directory(findPresetDirectory())
+    , index(directory)  // Starts indexing the directory in the background
+{
+}
+
+juce::File PresetManager::findPresetDirectory()
+{
+    juce::File directory;
+    
     // Determine the standard VST3 preset location based on platform
 #if JUCE_WINDOWS
     // Windows: Documents/VST3 Presets/Touchmachines/SquareBeats/
     auto documentsDir = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory);
-    presetDirectory = documentsDir.getChildFile("VST3 Presets")
-                                   .getChildFile("Touchmachines")
-                                   .getChildFile("SquareBeats");
+    directory = documentsDir.getChildFile("VST3 Presets")
+                             .getChildFile("Touchmachines")
+                             .getChildFile("SquareBeats");
 #elif JUCE_MAC
     // macOS: /Library/Audio/Presets/Touchmachines/SquareBeats/
-    presetDirectory = juce::File("/Library/Audio/Presets")
-                          .getChildFile("Touchmachines")
-                          .getChildFile("SquareBeats");
+    directory = juce::File("/Library/Audio/Presets")
+                    .getChildFile("Touchmachines")
+                    .getChildFile("SquareBeats");
 #elif JUCE_LINUX
     // Linux: ~/.vst3/presets/Touchmachines/SquareBeats/
     auto homeDir = juce::File::getSpecialLocation(juce::File::userHomeDirectory);
-    presetDirectory = homeDir.getChildFile(".vst3")
-                             .getChildFile("presets")
-                             .getChildFile("Touchmachines")
-                             .getChildFile("SquareBeats");
+    directory = homeDir.getChildFile(".vst3")
+                       .getChildFile("presets")
+                       .getChildFile("Touchmachines")
+                       .getChildFile("SquareBeats");
 #else
     // Fallback: use user application data directory
     auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
-    presetDirectory = appDataDir.getChildFile("SquareBeats")
-                                 .getChildFile("Presets");
+    directory = appDataDir.getChildFile("SquareBeats")
+                           .getChildFile("Presets");
 #endif
-    
-    ensurePresetDirectoryExists();
+
+    ensurePresetDirectoryExists(directory);
+    return directory;
 }
 
 //==============================================================================
-void PresetManager::ensurePresetDirectoryExists()
+void PresetManager::ensurePresetDirectoryExists(const juce::File& directory)
 {
-    if (!presetDirectory.exists())
+    if (!directory.exists())
     {
-        auto result = presetDirectory.createDirectory();
+        auto result = directory.createDirectory();
         if (result.failed())
         {
             juce::Logger::writeToLog("PresetManager: Failed to create preset directory: " + 
@@ -58,46 +72,8 @@ juce::File PresetManager::getPresetFile(const juce::String& presetName) const
 //==============================================================================
 juce::StringArray PresetManager::getPresetList() const
 {
-    juce::StringArray presetNames;
-    
-    if (!presetDirectory.exists())
-        return presetNames;
-    
-    // Find all .vstpreset files
-    juce::Array<juce::File> presetFiles;
-    presetDirectory.findChildFiles(presetFiles, 
-                                   juce::File::findFiles, 
-                                   false,  // non-recursive
-                                   "*.vstpreset");
-    
-    // Extract names without extension
-    juce::StringArray factoryPresets;
-    juce::StringArray userPresets;
-    
-    for (const auto& file : presetFiles)
-    {
-        juce::String name = file.getFileNameWithoutExtension();
-        
-        // Separate factory presets (starting with underscore) from user presets
-        if (name.startsWith("_"))
-        {
-            factoryPresets.add(name);
-        }
-        else
-        {
-            userPresets.add(name);
-        }
-    }
-    
-    // Sort each group alphabetically
-    factoryPresets.sort(true);  // case-insensitive
-    userPresets.sort(true);
-    
-    // Add factory presets first, then user presets
-    presetNames.addArray(factoryPresets);
-    presetNames.addArray(userPresets);
-    
-    return presetNames;
+    // Already sorted: factory presets (underscore prefix) first, then alphabetical
+    return sharedIndex->index.getPresetNames();
 }
 
 //==============================================================================
@@ -110,7 +86,7 @@ bool PresetManager::savePreset(const PatternModel& model, const juce::String& pr
     }
     
     // Ensure directory exists
-    ensurePresetDirectoryExists();
+    ensurePresetDirectoryExists(presetDirectory);
     
     // Serialize the pattern model using StateManager
     juce::MemoryBlock stateData;
@@ -124,6 +100,7 @@ bool PresetManager::savePreset(const PatternModel& model, const juce::String& pr
     {
         juce::Logger::writeToLog("PresetManager: Saved preset '" + presetName + "' to " + 
                                 presetFile.getFullPathName());
+        sharedIndex->index.presetSaved(presetName);
         return true;
     }
     else
@@ -135,6 +112,13 @@ bool PresetManager::savePreset(const PatternModel& model, const juce::String& pr
 
 //==============================================================================
 bool PresetManager::loadPreset(PatternModel& model, const juce::String& presetName)
+{
+    juce::MemoryBlock fileData;
+    return readPreset(presetName, fileData) && loadPresetData(model, presetName, fileData);
+}
+
+//==============================================================================
+bool PresetManager::readPreset(const juce::String& presetName, juce::MemoryBlock& data)
 {
     if (presetName.isEmpty())
     {
@@ -142,6 +126,10 @@ bool PresetManager::loadPreset(PatternModel& model, const juce::String& presetNa
         return false;
     }
     
+    // Neighbours of the current preset are usually already in memory
+    if (sharedIndex->index.getPreloadedData(presetName, data))
+        return true;
+    
     auto presetFile = getPresetFile(presetName);
     
     if (!presetFile.existsAsFile())
@@ -152,19 +140,25 @@ bool PresetManager::loadPreset(PatternModel& model, const juce::String& presetNa
     }
     
     // Read the file
-    juce::MemoryBlock fileData;
-    if (!presetFile.loadFileAsData(fileData))
+    if (!presetFile.loadFileAsData(data))
     {
         juce::Logger::writeToLog("PresetManager: Failed to read preset file: " + 
                                 presetFile.getFullPathName());
         return false;
     }
     
+    return true;
+}
+
+//==============================================================================
+bool PresetManager::loadPresetData(PatternModel& model, const juce::String& presetName, const juce::MemoryBlock& data)
+{
     // Deserialize using StateManager
-    if (StateManager::loadState(model, fileData.getData(), static_cast<int>(fileData.getSize())))
+    if (StateManager::loadState(model, data.getData(), static_cast<int>(data.getSize())))
     {
         juce::Logger::writeToLog("PresetManager: Loaded preset '" + presetName + "'");
         model.sendChangeMessage();  // Notify UI of changes
+        sharedIndex->index.setCurrentPreset(presetName);  // Preload its neighbours
         return true;
     }
     else
@@ -195,6 +189,7 @@ bool PresetManager::deletePreset(const juce::String& presetName)
     if (presetFile.deleteFile())
     {
         juce::Logger::writeToLog("PresetManager: Deleted preset '" + presetName + "'");
+        sharedIndex->index.presetDeleted(presetName);
         return true;
     }
     else
@@ -237,18 +232,19 @@ void PresetManager::createInitPreset()
     initModel.setTimeSignature(4, 4);
     
     // Clear all squares (already empty, but be explicit)
-    for (int i = 0; i < 4; ++i)
+    initModel.setNumColorChannels(DEFAULT_COLOR_CHANNELS);
+    for (int i = 0; i < initModel.getNumColorChannels(); ++i)
     {
         initModel.clearColorChannel(i);
     }
     
     // Set default color configs
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < MAX_COLOR_CHANNELS; ++i)
     {
         ColorChannelConfig config = initModel.getColorConfig(i);
         // Keep default values (already set by PatternModel constructor)
-        // Just ensure pitch waveform is zeroed
-        std::fill(config.pitchWaveform.begin(), config.pitchWaveform.end(), 0.0f);
+        // Just ensure pitch waveform is the shared flat one
+        config.pitchWaveform = PitchWaveform::flat(PitchWaveform::DEFAULT_RESOLUTION);
         config.pitchSeqLoopLengthBars = 0;  // Use global
         config.mainLoopLengthBars = 0.0;  // Use global
         initModel.setColorConfig(i, config);
@@ -265,6 +261,7 @@ void PresetManager::createInitPreset()
     scaleSeqConfig.enabled = false;
     scaleSeqConfig.segments.clear();
     scaleSeqConfig.segments.push_back(ScaleSequenceSegment(ROOT_C, SCALE_MAJOR, 4));
+    scaleSeqConfig.rebuildLookup();
     
     // Set default play mode (Forward)
     PlayModeConfig& playModeConfig = initModel.getPlayModeConfig();
@@ -2,6 +2,7 @@
 
 #include <juce_core/juce_core.h>
 #include "PatternModel.h"
+#include "PresetIndex.h"
 
 namespace SquareBeats {
 
@@ -19,6 +20,7 @@ namespace SquareBeats {
  * - List available presets
  * - Delete presets
  * - Factory preset support
+ * - Background preset index with preloading, shared between instances (see PresetIndex)
  */
 class PresetManager {
 public:
@@ -27,7 +29,8 @@ public:
     
     /**
      * Get list of all available preset names (without .vstpreset extension)
-     * Includes both factory and user presets
+     * Includes both factory and user presets. Served from the preset index,
+     * so it never touches the disk; the index broadcasts when the list changes.
      */
     juce::StringArray getPresetList() const;
     
@@ -47,6 +50,23 @@ public:
      */
     bool loadPreset(PatternModel& model, const juce::String& presetName);
     
+    /**
+     * Read a preset's raw data (preloaded copy if there is one, otherwise the file)
+     * @param presetName Name of the preset to read (without extension)
+     * @param data Receives the preset data
+     * @return true if the preset could be read
+     */
+    bool readPreset(const juce::String& presetName, juce::MemoryBlock& data);
+    
+    /**
+     * Load preset data already read with readPreset() into the pattern model
+     * @param model The pattern model to load into
+     * @param presetName Name of the preset the data came from
+     * @param data Preset data
+     * @return true if load succeeded
+     */
+    bool loadPresetData(PatternModel& model, const juce::String& presetName, const juce::MemoryBlock& data);
+    
     /**
      * Delete a preset by name
      * @param presetName Name of the preset to delete (without extension)
@@ -69,13 +89,36 @@ public:
      */
     void createFactoryPresetsIfNeeded();
     
+    /**
+     * Get the background preset index (metadata, change notifications, preloading)
+     */
+    PresetIndex& getPresetIndex() { return sharedIndex->index; }
+
 private:
+    /**
+     * The index of the preset directory, shared by every plugin instance in the
+     * process so only one scanner thread and index writer work on the directory
+     */
+    struct SharedIndex
+    {
+        SharedIndex();
+        
+        const juce::File directory;
+        PresetIndex index;
+    };
+    
+    juce::SharedResourcePointer<SharedIndex> sharedIndex;
     juce::File presetDirectory;
     
+    /**
+     * Get the standard VST3 preset location for this platform, creating it if needed
+     */
+    static juce::File findPresetDirectory();
+    
     /**
      * Ensure the preset directory exists
      */
-    void ensurePresetDirectoryExists();
+    static void ensurePresetDirectoryExists(const juce::File& directory);
     
     /**
      * Get the full file path for a preset name
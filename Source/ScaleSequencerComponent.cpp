@@ -30,19 +30,17 @@ void ScaleSequencerComponent::paint(juce::Graphics& g)
     
     // Title
     g.setColour(juce::Colours::white);
-    g.setFont(AppFont::title());
-    g.drawText("Scale Sequence", bounds.removeFromTop(25.0f), juce::Justification::centred);
+    titleText.draw(g, "Scale Sequence", AppFont::title(*fonts), bounds.removeFromTop(25.0f), juce::Justification::centred);
     
     // Timeline area
-    auto timelineArea = bounds.reduced(10.0f, 5.0f);
-    timelineArea.removeFromRight(40.0f);  // Space for add button
+    auto timelineArea = getTimelineArea();
     
     // Draw segments
     auto& config = patternModel.getScaleSequencer();
     
     if (config.segments.empty()) {
         g.setColour(juce::Colours::grey);
-        g.drawText("No segments - click + to add", timelineArea, juce::Justification::centred);
+        emptyText.draw(g, "No segments - click + to add", AppFont::title(*fonts), timelineArea, juce::Justification::centred);
         return;
     }
     
@@ -52,6 +50,9 @@ void ScaleSequencerComponent::paint(juce::Graphics& g)
     
     float pixelsPerBar = timelineArea.getWidth() / totalBars;
     float currentX = timelineArea.getX();
+    float pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    
+    segmentImages.resize(config.segments.size());
     
     for (size_t i = 0; i < config.segments.size(); ++i) {
         const auto& segment = config.segments[i];
@@ -59,8 +60,15 @@ void ScaleSequencerComponent::paint(juce::Graphics& g)
         
         juce::Rectangle<float> segBounds(currentX, timelineArea.getY(), 
                                           segmentWidth, timelineArea.getHeight());
+        currentX += segmentWidth;
         
-        // Segment background
+        // Segments outside the repainted area (e.g. everywhere but the playhead) are skipped
+        auto imageBounds = segBounds.getSmallestIntegerContainer();
+        if (imageBounds.isEmpty() || !g.clipRegionIntersects(imageBounds)) {
+            continue;
+        }
+        
+        // Segment colour, brightened when hovered or selected
         juce::Colour segColor = getSegmentColor(static_cast<int>(i));
         if (static_cast<int>(i) == hoveredSegment) {
             segColor = segColor.brighter(0.2f);
@@ -69,41 +77,10 @@ void ScaleSequencerComponent::paint(juce::Graphics& g)
             segColor = segColor.brighter(0.3f);
         }
         
-        g.setColour(segColor);
-        g.fillRoundedRectangle(segBounds.reduced(1.0f), 4.0f);
-        
-        // Segment border
-        g.setColour(juce::Colours::white.withAlpha(0.5f));
-        g.drawRoundedRectangle(segBounds.reduced(1.0f), 4.0f, 1.0f);
-        
-        // Mini keyboard visualization (only if segment is wide enough)
-        if (segmentWidth >= 60.0f) {
-            auto intervals = ScaleConfig::getScaleIntervals(segment.scaleType);
-            drawMiniKeyboard(g, segBounds, segment.rootNote, intervals, segColor);
-        }
-        
-        // Segment text
-        g.setColour(juce::Colours::white);
-        g.setFont(AppFont::getFont(11.0f));
-        
-        juce::String segText = juce::String(ScaleConfig::getRootNoteName(segment.rootNote)) + " " +
-                               juce::String(ScaleConfig::getScaleTypeName(segment.scaleType));
-        juce::String barsText = juce::String(segment.lengthBars) + (segment.lengthBars == 1 ? " bar" : " bars");
-        
-        auto textBounds = segBounds.reduced(4.0f);
-        if (segmentWidth > 60) {
-            g.drawText(segText, textBounds.removeFromTop(textBounds.getHeight() * 0.6f), 
-                      juce::Justification::centred, true);
-            g.setFont(AppFont::micro());
-            g.drawText(barsText, textBounds, juce::Justification::centred, true);
-        } else {
-            // Compact display for narrow segments
-            g.setFont(AppFont::micro());
-            g.drawText(ScaleConfig::getRootNoteName(segment.rootNote), textBounds, 
-                      juce::Justification::centred, true);
-        }
-        
-        currentX += segmentWidth;
+        // Drawn from the segment's cached image, rendered again only when the segment changes
+        auto& segmentImage = segmentImages[i];
+        updateSegmentImage(segmentImage, segment, segBounds, segColor, pixelScale);
+        g.drawImage(segmentImage.image, segmentImage.imageBounds.toFloat());
     }
     
     // Draw playback position indicator
@@ -174,17 +151,13 @@ void ScaleSequencerComponent::mouseDrag(const juce::MouseEvent& event)
         if (draggingEdge < static_cast<int>(config.segments.size())) {
             // Calculate new bar length based on drag distance
             int totalBars = config.getTotalLengthBars();
-            auto bounds = getLocalBounds().toFloat();
-            bounds.removeFromTop(25.0f);
-            bounds = bounds.reduced(10.0f, 5.0f);
-            bounds.removeFromRight(40.0f);
-            
-            float pixelsPerBar = bounds.getWidth() / totalBars;
+            float pixelsPerBar = getTimelineArea().getWidth() / totalBars;
             float deltaX = event.position.x - dragStartX;
             int deltaBars = static_cast<int>(std::round(deltaX / pixelsPerBar));
             
             int newBars = juce::jlimit(1, 16, dragStartBars + deltaBars);
             config.segments[draggingEdge].lengthBars = newBars;
+            config.rebuildLookup();
             
             repaint();
         }
@@ -223,6 +196,10 @@ void ScaleSequencerComponent::mouseMove(const juce::MouseEvent& event)
 void ScaleSequencerComponent::setPlaybackPosition(float normalizedPosition)
 {
     if (playbackPosition != normalizedPosition) {
+        // Only the playhead and the flash move; the segments underneath come from their cached images
+        repaint(getPlayheadBounds());
+        if (segmentChangeFlash > 0.0f) repaint(getFlashBounds());
+        
         playbackPosition = normalizedPosition;
         
         // Detect segment changes for flash effect
@@ -243,7 +220,8 @@ void ScaleSequencerComponent::setPlaybackPosition(float normalizedPosition)
         segmentChangeFlash *= 0.85f;
         if (segmentChangeFlash < 0.01f) segmentChangeFlash = 0.0f;
         
-        repaint();
+        repaint(getPlayheadBounds());
+        if (segmentChangeFlash > 0.0f) repaint(getFlashBounds());
     }
 }
 
@@ -272,10 +250,7 @@ juce::Rectangle<float> ScaleSequencerComponent::getSegmentBounds(int index) cons
         return {};
     }
     
-    auto bounds = getLocalBounds().toFloat();
-    bounds.removeFromTop(25.0f);
-    auto timelineArea = bounds.reduced(10.0f, 5.0f);
-    timelineArea.removeFromRight(40.0f);
+    auto timelineArea = getTimelineArea();
     
     int totalBars = config.getTotalLengthBars();
     if (totalBars <= 0) return {};
@@ -292,6 +267,39 @@ juce::Rectangle<float> ScaleSequencerComponent::getSegmentBounds(int index) cons
     return juce::Rectangle<float>(startX, timelineArea.getY(), width, timelineArea.getHeight());
 }
 
+juce::Rectangle<float> ScaleSequencerComponent::getTimelineArea() const
+{
+    auto bounds = getLocalBounds().toFloat();
+    bounds.removeFromTop(25.0f);  // Title
+    auto timelineArea = bounds.reduced(10.0f, 5.0f);
+    timelineArea.removeFromRight(40.0f);  // Space for add button
+    return timelineArea;
+}
+
+juce::Rectangle<int> ScaleSequencerComponent::getPlayheadBounds() const
+{
+    if (playbackPosition < 0.0f || playbackPosition > 1.0f) {
+        return {};
+    }
+    
+    // Glow plus a pixel for antialiasing
+    auto timelineArea = getTimelineArea();
+    float posX = timelineArea.getX() + playbackPosition * timelineArea.getWidth();
+    return juce::Rectangle<float>(posX - 6.0f, timelineArea.getY(), 12.0f, timelineArea.getHeight())
+        .getSmallestIntegerContainer();
+}
+
+juce::Rectangle<int> ScaleSequencerComponent::getFlashBounds() const
+{
+    auto segBounds = getSegmentBounds(lastActiveSegment);
+    if (segBounds.isEmpty()) {
+        return {};
+    }
+    
+    // The flash is drawn 4px outside the segment
+    return segBounds.expanded(5.0f).getSmallestIntegerContainer();
+}
+
 int ScaleSequencerComponent::getSegmentAtPoint(juce::Point<float> point) const
 {
     auto& config = patternModel.getScaleSequencer();
@@ -467,6 +475,7 @@ void ScaleSequencerComponent::onAddSegment()
     newSeg.lengthBars = 2;  // Default to 2 bars
     
     config.segments.push_back(newSeg);
+    config.rebuildLookup();
     
     patternModel.sendChangeMessage();
     repaint();
@@ -480,6 +489,7 @@ void ScaleSequencerComponent::onDeleteSegment(int index)
         // Don't delete the last segment
         if (config.segments.size() > 1) {
             config.segments.erase(config.segments.begin() + index);
+            config.rebuildLookup();
             hideSegmentEditor();
             patternModel.sendChangeMessage();
         }
@@ -502,6 +512,7 @@ void ScaleSequencerComponent::onSegmentChanged(int index)
         if (popupBarsCombo) {
             segment.lengthBars = popupBarsCombo->getSelectedId();
         }
+        config.rebuildLookup();
         
         patternModel.sendChangeMessage();
         repaint();
@@ -527,6 +538,87 @@ juce::Colour ScaleSequencerComponent::getSegmentColor(int index) const
     return colors[index % 8];
 }
 
+//==============================================================================
+void ScaleSequencerComponent::updateSegmentImage(SegmentImage& cached,
+                                                 const ScaleSequenceSegment& segment,
+                                                 juce::Rectangle<float> segBounds,
+                                                 juce::Colour segColor,
+                                                 float pixelScale)
+{
+    if (cached.image.isValid()
+        && cached.bounds == segBounds
+        && cached.rootNote == segment.rootNote
+        && cached.scaleType == segment.scaleType
+        && cached.lengthBars == segment.lengthBars
+        && cached.colour == segColor
+        && cached.pixelScale == pixelScale) {
+        return;
+    }
+    
+    cached.bounds = segBounds;
+    cached.rootNote = segment.rootNote;
+    cached.scaleType = segment.scaleType;
+    cached.lengthBars = segment.lengthBars;
+    cached.colour = segColor;
+    cached.pixelScale = pixelScale;
+    
+    // Rendered at physical resolution, offset so the segment lands on the same subpixel position
+    cached.imageBounds = segBounds.getSmallestIntegerContainer();
+    int imageWidth = juce::jmax(1, juce::roundToInt(cached.imageBounds.getWidth() * pixelScale));
+    int imageHeight = juce::jmax(1, juce::roundToInt(cached.imageBounds.getHeight() * pixelScale));
+    
+    cached.image = juce::Image(juce::Image::ARGB, imageWidth, imageHeight, true);
+    juce::Graphics imageGraphics(cached.image);
+    imageGraphics.addTransform(juce::AffineTransform::translation(static_cast<float>(-cached.imageBounds.getX()),
+                                                                  static_cast<float>(-cached.imageBounds.getY()))
+                                   .scaled(static_cast<float>(imageWidth) / cached.imageBounds.getWidth(),
+                                           static_cast<float>(imageHeight) / cached.imageBounds.getHeight()));
+    
+    drawSegment(imageGraphics, segment, segBounds, segColor);
+}
+
+void ScaleSequencerComponent::drawSegment(juce::Graphics& g,
+                                          const ScaleSequenceSegment& segment,
+                                          juce::Rectangle<float> segBounds,
+                                          juce::Colour segColor)
+{
+    float segmentWidth = segBounds.getWidth();
+    
+    g.setColour(segColor);
+    g.fillRoundedRectangle(segBounds.reduced(1.0f), 4.0f);
+    
+    // Segment border
+    g.setColour(juce::Colours::white.withAlpha(0.5f));
+    g.drawRoundedRectangle(segBounds.reduced(1.0f), 4.0f, 1.0f);
+    
+    // Mini keyboard visualization (only if segment is wide enough)
+    if (segmentWidth >= 60.0f) {
+        auto intervals = ScaleConfig::getScaleIntervals(segment.scaleType);
+        drawMiniKeyboard(g, segBounds, segment.rootNote, intervals, segColor);
+    }
+    
+    // Segment text
+    g.setColour(juce::Colours::white);
+    g.setFont(AppFont::getFont(*fonts, 11.0f));
+    
+    juce::String segText = juce::String(ScaleConfig::getRootNoteName(segment.rootNote)) + " " +
+                           juce::String(ScaleConfig::getScaleTypeName(segment.scaleType));
+    juce::String barsText = juce::String(segment.lengthBars) + (segment.lengthBars == 1 ? " bar" : " bars");
+    
+    auto textBounds = segBounds.reduced(4.0f);
+    if (segmentWidth > 60) {
+        g.drawText(segText, textBounds.removeFromTop(textBounds.getHeight() * 0.6f), 
+                  juce::Justification::centred, true);
+        g.setFont(AppFont::micro(*fonts));
+        g.drawText(barsText, textBounds, juce::Justification::centred, true);
+    } else {
+        // Compact display for narrow segments
+        g.setFont(AppFont::micro(*fonts));
+        g.drawText(ScaleConfig::getRootNoteName(segment.rootNote), textBounds, 
+                  juce::Justification::centred, true);
+    }
+}
+
 //==============================================================================
 // Keyboard layout helper functions
 
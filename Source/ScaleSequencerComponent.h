@@ -3,6 +3,7 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "PatternModel.h"
 #include "VisualFeedback.h"
+#include "AppFont.h"
 
 namespace SquareBeats {
 
@@ -59,6 +60,7 @@ public:
 
 private:
     PatternModel& patternModel;
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
     float playbackPosition = 0.0f;
     int lastActiveSegment = -1;  // For detecting segment changes
     float segmentChangeFlash = 0.0f;  // Flash intensity on segment change
@@ -84,8 +86,28 @@ private:
     
     std::vector<Listener*> listeners;
     
+    // Laid-out text, so repaints do no text layout
+    CachedText titleText;
+    CachedText emptyText;
+    
+    // Each segment rendered once and redrawn as an image until it changes
+    struct SegmentImage {
+        juce::Image image;
+        juce::Rectangle<int> imageBounds;  // Where the image is drawn
+        juce::Rectangle<float> bounds;
+        RootNote rootNote = ROOT_C;
+        ScaleType scaleType = SCALE_MAJOR;
+        int lengthBars = 0;
+        juce::Colour colour;  // Includes the hover/selection highlight
+        float pixelScale = 0.0f;
+    };
+    std::vector<SegmentImage> segmentImages;
+    
     // Helper methods
+    juce::Rectangle<float> getTimelineArea() const;
     juce::Rectangle<float> getSegmentBounds(int index) const;
+    juce::Rectangle<int> getPlayheadBounds() const;
+    juce::Rectangle<int> getFlashBounds() const;  // Segment change flash, around lastActiveSegment
     int getSegmentAtPoint(juce::Point<float> point) const;
     int getEdgeAtPoint(juce::Point<float> point) const;  // Returns segment index if near right edge
     float barsToPixelX(int bars) const;
@@ -99,6 +121,14 @@ private:
     
     juce::Colour getSegmentColor(int index) const;
     
+    /**
+     * Render a segment into its cached image if the segment, its bounds, colour or the display scale changed
+     */
+    void updateSegmentImage(SegmentImage& cached, const ScaleSequenceSegment& segment,
+                            juce::Rectangle<float> segBounds, juce::Colour segColor, float pixelScale);
+    void drawSegment(juce::Graphics& g, const ScaleSequenceSegment& segment,
+                     juce::Rectangle<float> segBounds, juce::Colour segColor);
+    
     // Keyboard layout helper functions
     struct KeyboardLayout {
         juce::Rectangle<float> keyboardBounds;
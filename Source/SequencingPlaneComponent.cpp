@@ -1,4 +1,5 @@
 #include "SequencingPlaneComponent.h"
+#include "MIDIGenerator.h"
 
 namespace SquareBeats {
 
@@ -17,7 +18,7 @@ SequencingPlaneComponent::SequencingPlaneComponent(PatternModel& model)
     , editStartHeight(0.0f)
 {
     // Initialize per-color playback positions
-    for (int i = 0; i < 4; ++i) {
+    for (int i = 0; i < MAX_COLOR_CHANNELS; ++i) {
         colorPlaybackPositions[i] = 0.0f;
     }
     
@@ -69,7 +70,7 @@ void SequencingPlaneComponent::setPlaybackPosition(float normalizedPosition)
 
 void SequencingPlaneComponent::setColorPlaybackPosition(int colorId, float normalizedPosition)
 {
-    if (colorId >= 0 && colorId < 4)
+    if (colorId >= 0 && colorId < MAX_COLOR_CHANNELS)
     {
         if (colorPlaybackPositions[colorId] != normalizedPosition)
         {
@@ -81,7 +82,7 @@ void SequencingPlaneComponent::setColorPlaybackPosition(int colorId, float norma
 
 void SequencingPlaneComponent::setSelectedColorChannel(int colorId)
 {
-    selectedColorChannel = juce::jlimit(0, 3, colorId);
+    selectedColorChannel = juce::jlimit(0, patternModel.getNumColorChannels() - 1, colorId);
 }
 
 //==============================================================================
@@ -145,6 +146,10 @@ void SequencingPlaneComponent::drawSquares(juce::Graphics& g)
     
     for (const auto* square : squares)
     {
+        // Squares on channels not in use are kept but hidden
+        if (square->colorChannelId >= patternModel.getNumColorChannels())
+            continue;
+        
         // Get the color for this square's channel
         const auto& colorConfig = patternModel.getColorConfig(square->colorChannelId);
         
@@ -163,6 +168,26 @@ void SequencingPlaneComponent::drawSquares(juce::Graphics& g)
         // Draw border
         g.setColour(colorConfig.displayColor);
         g.drawRect(pixelRect, 2.0f);
+        
+        // Mark where a ratcheted square repeats
+        if (square->ratchet.count > 1)
+        {
+            const TimeSignature timeSig = patternModel.getTimeSignature();
+            const double loopBars = colorConfig.mainLoopLengthBars > 0.0 ? colorConfig.mainLoopLengthBars
+                                                                         : patternModel.getLoopLength();
+            const float repeatWidth = static_cast<float>(MIDIGenerator::getQuantizeInterval(square->ratchet.rate, timeSig)
+                                                         / (loopBars * timeSig.getBeatsPerBar()))
+                                      * getWidth();
+            
+            g.setColour(colorConfig.displayColor.brighter(0.6f));
+            for (int repeat = 1; repeat < square->ratchet.count; ++repeat)
+            {
+                const float x = pixelRect.getX() + repeat * repeatWidth;
+                if (x >= pixelRect.getRight())
+                    break;
+                g.drawVerticalLine(juce::roundToInt(x), pixelRect.getY() + 2.0f, pixelRect.getBottom() - 2.0f);
+            }
+        }
     }
 }
 
@@ -171,7 +196,7 @@ void SequencingPlaneComponent::drawPlaybackIndicator(juce::Graphics& g)
     auto bounds = getLocalBounds().toFloat();
     
     // Draw per-color playheads
-    for (int colorId = 0; colorId < 4; ++colorId)
+    for (int colorId = 0; colorId < patternModel.getNumColorChannels(); ++colorId)
     {
         float colorPos = colorPlaybackPositions[colorId];
         const auto& colorConfig = patternModel.getColorConfig(colorId);
@@ -339,6 +364,15 @@ void SequencingPlaneComponent::mouseDown(const juce::MouseEvent& event)
         editStartWidth = clickedSquare->width;
         editStartHeight = clickedSquare->height;
         
+        // Alt-click sets how the square repeats
+        if (event.mods.isAltDown() && !event.mods.isPopupMenu())
+        {
+            showRatchetMenu(clickedSquare->uniqueId);
+            selectedSquare = nullptr;
+            currentEditMode = EditMode::None;
+            return;
+        }
+        
         // Right-click deletes the square
         if (event.mods.isPopupMenu())
         {
@@ -365,8 +399,6 @@ void SequencingPlaneComponent::mouseDrag(const juce::MouseEvent& event)
     float normalizedX = juce::jlimit(0.0f, 1.0f, pixelXToNormalized(mousePos.x));
     float normalizedY = juce::jlimit(0.0f, 1.0f, pixelYToNormalized(mousePos.y));
     
-    const float minSize = 0.01f;
-    
     if (currentEditMode == EditMode::Creating)
     {
         // Creating a new square
@@ -375,8 +407,8 @@ void SequencingPlaneComponent::mouseDrag(const juce::MouseEvent& event)
         float right = juce::jmax(dragStartPoint.x, normalizedX);
         float bottom = juce::jmax(dragStartPoint.y, normalizedY);
         
-        float width = juce::jmax(minSize, right - left);
-        float height = juce::jmax(minSize, bottom - top);
+        float width = juce::jmax(MIN_SQUARE_SIZE, right - left);
+        float height = juce::jmax(MIN_SQUARE_SIZE, bottom - top);
         
         if (currentlyCreatingSquare == nullptr)
         {
@@ -409,49 +441,49 @@ void SequencingPlaneComponent::mouseDrag(const juce::MouseEvent& event)
                 newLeft = juce::jlimit(0.0f, 1.0f - editStartWidth, editStartLeft + deltaX);
                 newTop = juce::jlimit(0.0f, 1.0f - editStartHeight, editStartTop + deltaY);
                 break;
-                
+            
             case EditMode::ResizingLeft:
-                newLeft = juce::jlimit(0.0f, editStartLeft + editStartWidth - minSize, editStartLeft + deltaX);
+                newLeft = juce::jlimit(0.0f, editStartLeft + editStartWidth - MIN_SQUARE_SIZE, editStartLeft + deltaX);
                 newWidth = editStartLeft + editStartWidth - newLeft;
                 break;
-                
+            
             case EditMode::ResizingRight:
-                newWidth = juce::jlimit(minSize, 1.0f - editStartLeft, editStartWidth + deltaX);
+                newWidth = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - editStartLeft, editStartWidth + deltaX);
                 break;
-                
+            
             case EditMode::ResizingTop:
-                newTop = juce::jlimit(0.0f, editStartTop + editStartHeight - minSize, editStartTop + deltaY);
+                newTop = juce::jlimit(0.0f, editStartTop + editStartHeight - MIN_SQUARE_SIZE, editStartTop + deltaY);
                 newHeight = editStartTop + editStartHeight - newTop;
                 break;
-                
+            
             case EditMode::ResizingBottom:
-                newHeight = juce::jlimit(minSize, 1.0f - editStartTop, editStartHeight + deltaY);
+                newHeight = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - editStartTop, editStartHeight + deltaY);
                 break;
-                
+            
             case EditMode::ResizingTopLeft:
-                newLeft = juce::jlimit(0.0f, editStartLeft + editStartWidth - minSize, editStartLeft + deltaX);
-                newTop = juce::jlimit(0.0f, editStartTop + editStartHeight - minSize, editStartTop + deltaY);
+                newLeft = juce::jlimit(0.0f, editStartLeft + editStartWidth - MIN_SQUARE_SIZE, editStartLeft + deltaX);
+                newTop = juce::jlimit(0.0f, editStartTop + editStartHeight - MIN_SQUARE_SIZE, editStartTop + deltaY);
                 newWidth = editStartLeft + editStartWidth - newLeft;
                 newHeight = editStartTop + editStartHeight - newTop;
                 break;
-                
+            
             case EditMode::ResizingTopRight:
-                newTop = juce::jlimit(0.0f, editStartTop + editStartHeight - minSize, editStartTop + deltaY);
-                newWidth = juce::jlimit(minSize, 1.0f - editStartLeft, editStartWidth + deltaX);
+                newTop = juce::jlimit(0.0f, editStartTop + editStartHeight - MIN_SQUARE_SIZE, editStartTop + deltaY);
+                newWidth = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - editStartLeft, editStartWidth + deltaX);
                 newHeight = editStartTop + editStartHeight - newTop;
                 break;
-                
+            
             case EditMode::ResizingBottomLeft:
-                newLeft = juce::jlimit(0.0f, editStartLeft + editStartWidth - minSize, editStartLeft + deltaX);
+                newLeft = juce::jlimit(0.0f, editStartLeft + editStartWidth - MIN_SQUARE_SIZE, editStartLeft + deltaX);
                 newWidth = editStartLeft + editStartWidth - newLeft;
-                newHeight = juce::jlimit(minSize, 1.0f - editStartTop, editStartHeight + deltaY);
+                newHeight = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - editStartTop, editStartHeight + deltaY);
                 break;
-                
+            
             case EditMode::ResizingBottomRight:
-                newWidth = juce::jlimit(minSize, 1.0f - editStartLeft, editStartWidth + deltaX);
-                newHeight = juce::jlimit(minSize, 1.0f - editStartTop, editStartHeight + deltaY);
+                newWidth = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - editStartLeft, editStartWidth + deltaX);
+                newHeight = juce::jlimit(MIN_SQUARE_SIZE, 1.0f - editStartTop, editStartHeight + deltaY);
                 break;
-                
+            
             default:
                 break;
         }
@@ -476,9 +508,8 @@ void SequencingPlaneComponent::mouseUp(const juce::MouseEvent& event)
             float normalizedX = juce::jlimit(0.0f, 1.0f, pixelXToNormalized(mousePos.x));
             float normalizedY = juce::jlimit(0.0f, 1.0f, pixelYToNormalized(mousePos.y));
             
-            const float minSize = 0.01f;
             patternModel.createSquare(
-                normalizedX, normalizedY, minSize, minSize, selectedColorChannel
+                normalizedX, normalizedY, MIN_SQUARE_SIZE, MIN_SQUARE_SIZE, selectedColorChannel
             );
             
             repaint();
@@ -530,6 +561,61 @@ bool SequencingPlaneComponent::keyPressed(const juce::KeyPress& key)
     return false;
 }
 
+//==============================================================================
+void SequencingPlaneComponent::showRatchetMenu(uint32_t squareId)
+{
+    const Square* square = patternModel.getSquare(squareId);
+    if (square == nullptr)
+        return;
+    
+    const Ratchet current = square->ratchet;
+    
+    juce::PopupMenu repeatsMenu;
+    for (int count : { 1, 2, 3, 4, 6, 8, 12, 16 })
+        repeatsMenu.addItem(100 + count, count == 1 ? juce::String("Off") : juce::String(count), true, current.count == count);
+    
+    juce::PopupMenu rateMenu;
+    const juce::StringArray rateNames { "1/32", "1/16", "1/8", "1/4" };
+    for (int rate = 0; rate < rateNames.size(); ++rate)
+        rateMenu.addItem(200 + rate, rateNames[rate], true, current.rate == rate);
+    
+    juce::PopupMenu rampMenu;
+    const juce::StringArray rampNames { "Fade Out", "Fade Out Halfway", "Flat", "Rise Halfway", "Rise" };
+    for (int ramp = 0; ramp < rampNames.size(); ++ramp)
+        rampMenu.addItem(300 + ramp, rampNames[ramp], true, current.velocityRamp == (ramp - 2) * 0.5f);
+    
+    juce::PopupMenu menu;
+    menu.addSectionHeader("Ratchet");
+    menu.addSubMenu("Repeats", repeatsMenu);
+    menu.addSubMenu("Rate", rateMenu);
+    menu.addSubMenu("Velocity Ramp", rampMenu);
+    
+    // The menu can outlive the editor, so check the component is still there
+    juce::Component::SafePointer<SequencingPlaneComponent> safeThis(this);
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this),
+                       [safeThis, squareId](int result)
+                       {
+                           if (safeThis == nullptr || result == 0)
+                               return;
+                           
+                           // The square may have been edited or deleted while the menu was open
+                           const Square* square = safeThis->patternModel.getSquare(squareId);
+                           if (square == nullptr)
+                               return;
+                           
+                           Ratchet ratchet = square->ratchet;
+                           if (result >= 300)
+                               ratchet.velocityRamp = (result - 302) * 0.5f;
+                           else if (result >= 200)
+                               ratchet.rate = static_cast<QuantizationValue>(result - 200);
+                           else
+                               ratchet.count = result - 100;
+                           
+                           safeThis->patternModel.setSquareRatchet(squareId, ratchet);
+                           safeThis->repaint();
+                       });
+}
+
 //==============================================================================
 Square* SequencingPlaneComponent::findSquareAt(float normalizedX, float normalizedY)
 {
@@ -540,6 +626,10 @@ Square* SequencingPlaneComponent::findSquareAt(float normalizedX, float normaliz
     {
         Square* square = *it;
         
+        // Hidden squares (channels not in use) cannot be picked
+        if (square->colorChannelId >= patternModel.getNumColorChannels())
+            continue;
+        
         if (normalizedX >= square->leftEdge && 
             normalizedX <= square->leftEdge + square->width &&
             normalizedY >= square->topEdge && 
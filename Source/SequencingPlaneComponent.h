@@ -14,6 +14,7 @@ namespace SquareBeats {
  * - Renders grid lines for visual reference
  * - Renders all squares from the PatternModel
  * - Handles mouse interaction for creating, moving, and resizing squares
+ * - Sets a square's ratchet from a menu (alt-click on the square)
  * - Displays the playback position indicator
  * 
  * All rendering uses normalized coordinates (0.0 to 1.0) which are scaled
@@ -25,7 +26,7 @@ public:
     //==============================================================================
     SequencingPlaneComponent(PatternModel& model);
     ~SequencingPlaneComponent() override;
-
+    
     //==============================================================================
     // Component overrides
     void paint(juce::Graphics& g) override;
@@ -123,7 +124,7 @@ private:
     // Data members
     PatternModel& patternModel;
     float playbackPosition;
-    float colorPlaybackPositions[4];  // Per-color playback positions
+    float colorPlaybackPositions[MAX_COLOR_CHANNELS];  // Per-color playback positions
     int selectedColorChannel;
     
     // Mouse interaction state
@@ -168,6 +169,11 @@ private:
      */
     EditMode determineEditMode(const Square* square, float normalizedX, float normalizedY) const;
     
+    /**
+     * Show the menu of a square's ratchet repeats, rate and velocity ramp
+     */
+    void showRatchetMenu(uint32_t squareId);
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SequencingPlaneComponent)
 };
 
@@ -1,84 +1,239 @@
 #include "StateManager.h"
+#include <map>
+#include <vector>
+#include <cmath>
 
 namespace SquareBeats {
 
 //==============================================================================
-void StateManager::saveState(const PatternModel& model, juce::MemoryBlock& destData)
+void StateManager::saveState(const PatternModel& model, juce::MemoryBlock& destData, bool compressSections)
 {
+    const int numColorChannels = model.getNumColorChannels();
+    const auto& squares = model.getSquares();
+    
+    // Configs are stored for every channel in use or still holding squares
+    int numStoredColors = numColorChannels;
+    for (const Square& square : squares)
+    {
+        numStoredColors = juce::jmax(numStoredColors, square.colorChannelId + 1);
+    }
+    const size_t squaresSize = 4 + squares.size() * QUANTIZED_SQUARE_SIZE;
+    
     juce::MemoryOutputStream stream(destData, false);
+    stream.preallocate(256 + squaresSize + static_cast<size_t>(numStoredColors) * 64);
     
     // Write magic number and version
     stream.writeInt(MAGIC_NUMBER);
     stream.writeInt(VERSION);
     
-    // Write global settings
-    stream.writeDouble(model.getLoopLength());
+    // Each section is encoded into one scratch stream, then copied out
+    juce::MemoryOutputStream section(squaresSize + 256);
     
-    TimeSignature timeSig = model.getTimeSignature();
-    stream.writeInt(timeSig.numerator);
-    stream.writeInt(timeSig.denominator);
+    // Global settings (time signature is always 4/4 and no longer stored)
+    section.writeDouble(model.getLoopLength());
+    section.writeInt(numColorChannels);
+    writeSection(stream, TAG_GLOBAL, section, compressSections);
     
-    // Write squares
-    auto squares = model.getAllSquares();
-    stream.writeInt(static_cast<int>(squares.size()));
+    const std::vector<QuantizedSquare> quantizedSquares = quantizeSquares(squares);
+    writeSquares(section, quantizedSquares);
+    writeSection(stream, TAG_SQUARES, section, compressSections);
+    
+    // Ratchets in a section of their own, which older versions skip
+    writeRatchets(section, quantizedSquares);
+    writeSection(stream, TAG_RATCHETS, section, compressSections);
     
-    for (const Square* square : squares)
+    // Color channel configurations with per-color pitch waveforms
+    section.writeInt(numStoredColors);
+    for (int i = 0; i < numStoredColors; ++i)
     {
-        stream.writeFloat(square->leftEdge);
-        stream.writeFloat(square->width);
-        stream.writeFloat(square->topEdge);
-        stream.writeFloat(square->height);
-        stream.writeInt(square->colorChannelId);
-        stream.writeInt(static_cast<int>(square->uniqueId));
+        writeColorConfig(section, model.getColorConfig(i));
     }
+    writeSection(stream, TAG_COLORS, section, compressSections);
     
-    // Write color channel configurations (4 channels) with per-color pitch waveforms
-    for (int i = 0; i < 4; ++i)
+    // Grooves in a section of their own, which older versions skip
+    section.writeInt(numStoredColors);
+    for (int i = 0; i < numStoredColors; ++i)
     {
-        const ColorChannelConfig& config = model.getColorConfig(i);
-        stream.writeInt(config.midiChannel);
-        stream.writeInt(config.highNote);
-        stream.writeInt(config.lowNote);
-        stream.writeInt(static_cast<int>(config.quantize));
-        stream.writeInt(static_cast<int>(config.displayColor.getARGB()));
-        stream.writeInt(config.pitchSeqLoopLengthBars);
-        stream.writeDouble(config.mainLoopLengthBars);  // Per-color loop length
-        
-        // Write per-color pitch waveform
-        stream.writeInt(static_cast<int>(config.pitchWaveform.size()));
-        for (float value : config.pitchWaveform)
-        {
-            stream.writeFloat(value);
-        }
+        writeGroove(section, model.getColorConfig(i).groove);
     }
+    writeSection(stream, TAG_GROOVES, section, compressSections);
     
-    // Write pitch sequencer global settings (editing mode)
-    const PitchSequencer& pitchSeq = model.getPitchSequencer();
-    stream.writeBool(pitchSeq.editingPitch);
+    // Pitch sequencer global settings (editing mode)
+    section.writeBool(model.getPitchSequencer().editingPitch);
+    writeSection(stream, TAG_PITCH_SEQUENCER, section, compressSections);
     
-    // Write scale configuration (Version 4+)
     const ScaleConfig& scaleConfig = model.getScaleConfig();
-    stream.writeInt(static_cast<int>(scaleConfig.rootNote));
-    stream.writeInt(static_cast<int>(scaleConfig.scaleType));
+    section.writeInt(static_cast<int>(scaleConfig.rootNote));
+    section.writeInt(static_cast<int>(scaleConfig.scaleType));
+    writeSection(stream, TAG_SCALE, section, compressSections);
     
-    // Write scale sequencer configuration (Version 5+)
     const ScaleSequencerConfig& scaleSeqConfig = model.getScaleSequencer();
-    stream.writeBool(scaleSeqConfig.enabled);
-    stream.writeInt(static_cast<int>(scaleSeqConfig.segments.size()));
-    
+    section.writeBool(scaleSeqConfig.enabled);
+    section.writeInt(static_cast<int>(scaleSeqConfig.segments.size()));
     for (const auto& segment : scaleSeqConfig.segments)
     {
-        stream.writeInt(static_cast<int>(segment.rootNote));
-        stream.writeInt(static_cast<int>(segment.scaleType));
-        stream.writeInt(segment.lengthBars);
+        section.writeInt(static_cast<int>(segment.rootNote));
+        section.writeInt(static_cast<int>(segment.scaleType));
+        section.writeInt(segment.lengthBars);
     }
+    writeSection(stream, TAG_SCALE_SEQUENCER, section, compressSections);
     
-    // Write play mode configuration (Version 7+)
-    const PlayModeConfig& playModeConfig = model.getPlayModeConfig();
-    stream.writeInt(static_cast<int>(playModeConfig.mode));
-    stream.writeFloat(playModeConfig.stepJumpSize);
-    stream.writeFloat(playModeConfig.probability);
     // Note: pendulumForward is internal state, not saved (always starts forward)
+    const PlayModeConfig& playModeConfig = model.getPlayModeConfig();
+    section.writeInt(static_cast<int>(playModeConfig.mode));
+    section.writeFloat(playModeConfig.stepJumpSize);
+    section.writeFloat(playModeConfig.probability);
+    writeSection(stream, TAG_PLAY_MODE, section, compressSections);
+}
+
+void StateManager::saveSlots(juce::MemoryBlock& destData, const std::vector<juce::MemoryBlock>& slotStates,
+                             int activeSlot)
+{
+    size_t totalSize = 8;
+    for (const auto& state : slotStates)
+    {
+        totalSize += 4 + state.getSize();
+    }
+    
+    juce::MemoryOutputStream section(totalSize);
+    section.writeInt(activeSlot);
+    section.writeInt(static_cast<int>(slotStates.size()));
+    for (const auto& state : slotStates)
+    {
+        section.writeInt(static_cast<int>(state.getSize()));
+        section.write(state.getData(), state.getSize());
+    }
+    
+    // Slot states are already compressed section by section, so store this one as it is
+    juce::MemoryOutputStream stream(destData, true);
+    writeSection(stream, TAG_SLOTS, section, false);
+}
+
+void StateManager::writeSection(juce::OutputStream& stream, uint32_t tag,
+                                juce::MemoryOutputStream& section, bool compress)
+{
+    const size_t size = section.getDataSize();
+    
+    if (compress && size >= MIN_COMPRESSED_SECTION_SIZE)
+    {
+        juce::MemoryOutputStream compressed(size);
+        {
+            juce::GZIPCompressorOutputStream zipper(compressed);
+            zipper.write(section.getData(), size);
+        }
+        
+        // Keep the compressed form only if it is smaller, counting its size prefix
+        if (compressed.getDataSize() + 4 < size)
+        {
+            stream.writeInt(static_cast<int>(tag));
+            stream.writeByte(static_cast<char>(SECTION_COMPRESSED));
+            stream.writeInt(static_cast<int>(compressed.getDataSize() + 4));
+            stream.writeInt(static_cast<int>(size));
+            stream.write(compressed.getData(), compressed.getDataSize());
+            section.reset();
+            return;
+        }
+    }
+    
+    stream.writeInt(static_cast<int>(tag));
+    stream.writeByte(0);
+    stream.writeInt(static_cast<int>(size));
+    stream.write(section.getData(), size);
+    section.reset();
+}
+
+std::vector<StateManager::QuantizedSquare> StateManager::quantizeSquares(const std::vector<Square>& squares)
+{
+    auto quantize = [](float coordinate)
+    {
+        return juce::roundToInt(juce::jlimit(0.0f, 1.0f, coordinate) * COORDINATE_STEPS);
+    };
+    
+    std::vector<QuantizedSquare> quantized;
+    quantized.reserve(squares.size());
+    for (const Square& square : squares)
+    {
+        quantized.push_back({ quantize(square.leftEdge), quantize(square.width),
+                              quantize(square.topEdge), quantize(square.height),
+                              square.colorChannelId, square.ratchet });
+    }
+    
+    // Sorted by start time, each leftEdge is a small non-negative step from the last
+    std::stable_sort(quantized.begin(), quantized.end(),
+        [](const QuantizedSquare& a, const QuantizedSquare& b) { return a.left < b.left; });
+    return quantized;
+}
+
+void StateManager::writeSquares(juce::OutputStream& stream, const std::vector<QuantizedSquare>& squares)
+{
+    stream.writeInt(static_cast<int>(squares.size()));
+    
+    int previousLeft = 0;
+    for (const QuantizedSquare& square : squares)
+    {
+        stream.writeShort(static_cast<short>(square.left - previousLeft));
+        stream.writeShort(static_cast<short>(square.width));
+        stream.writeShort(static_cast<short>(square.top));
+        stream.writeShort(static_cast<short>(square.height));
+        stream.writeByte(static_cast<char>(square.colorChannelId));
+        previousLeft = square.left;
+    }
+}
+
+void StateManager::writeRatchets(juce::OutputStream& stream, const std::vector<QuantizedSquare>& squares)
+{
+    int numRatchets = 0;
+    for (const QuantizedSquare& square : squares)
+    {
+        if (square.ratchet != Ratchet())
+            ++numRatchets;
+    }
+    
+    stream.writeInt(numRatchets);
+    for (size_t index = 0; index < squares.size(); ++index)
+    {
+        const Ratchet& ratchet = squares[index].ratchet;
+        if (ratchet == Ratchet())
+            continue;
+        
+        stream.writeInt(static_cast<int>(index));
+        stream.writeByte(static_cast<char>(ratchet.count));
+        stream.writeByte(static_cast<char>(ratchet.rate));
+        stream.writeFloat(ratchet.velocityRamp);
+    }
+}
+
+void StateManager::writeColorConfig(juce::OutputStream& stream, const ColorChannelConfig& config)
+{
+    stream.writeInt(config.midiChannel);
+    stream.writeInt(config.highNote);
+    stream.writeInt(config.lowNote);
+    stream.writeInt(static_cast<int>(config.quantize));
+    stream.writeInt(static_cast<int>(config.displayColor.getARGB()));
+    stream.writeInt(config.pitchSeqLoopLengthBars);
+    stream.writeDouble(config.mainLoopLengthBars);  // Per-color loop length
+    stream.writeInt(config.polyphony);
+    stream.writeInt(static_cast<int>(config.stealPolicy));
+    stream.writeInt(config.pitchBendRange);
+    stream.writeInt(config.pitchBendRateHz);
+    
+    // Write per-color pitch waveform as breakpoints (Version 10+), from one snapshot
+    PitchWaveform::EnvelopePtr envelope = config.pitchWaveform.getEnvelope();
+    if (envelope != nullptr)
+    {
+        stream.writeInt(envelope->getResolution());
+        stream.writeInt(static_cast<int>(envelope->getBreakpoints().size()));
+        for (const auto& point : envelope->getBreakpoints())
+        {
+            stream.writeInt(point.index);
+            stream.writeFloat(point.value);
+        }
+    }
+    else
+    {
+        stream.writeInt(0);
+        stream.writeInt(0);
+    }
 }
 
 //==============================================================================
@@ -104,17 +259,22 @@ bool StateManager::loadState(PatternModel& model, const void* data, int sizeInBy
         return false;
     }
     
-    // Validate version (support versions 3 and 4)
+    // Validate version (support versions 3 and later; newer versions are all sectioned)
     uint32_t version = static_cast<uint32_t>(stream.readInt());
-    if (version < 3 || version > VERSION)
+    if (version < 3)
     {
         juce::Logger::writeToLog("StateManager: Unsupported version " + juce::String(version) + 
-                                " (expected 3-" + juce::String(VERSION) + ")");
+                                " (expected 3 or later)");
         return false;
     }
     
     try
     {
+        if (version >= SECTIONED_VERSION)
+        {
+            return loadSections(model, stream);
+        }
+        
         // Check if we have enough data remaining
         if (stream.getNumBytesRemaining() < 16)  // Need 1 double (8 bytes) + 2 ints (8 bytes) for global settings
         {
@@ -138,6 +298,24 @@ bool StateManager::loadState(PatternModel& model, const void* data, int sizeInBy
         model.setLoopLength(loopLength);
         model.setTimeSignature(4, 4);  // Always use 4/4
         
+        // Read color channel count (Version 8+; older states always have 4 channels)
+        int numColorChannels = DEFAULT_COLOR_CHANNELS;
+        if (version >= 8)
+        {
+            if (stream.getNumBytesRemaining() < 4)
+            {
+                juce::Logger::writeToLog("StateManager: Truncated data (not enough for color channel count)");
+                return false;
+            }
+            
+            numColorChannels = stream.readInt();
+            if (numColorChannels < 1 || numColorChannels > MAX_COLOR_CHANNELS)
+            {
+                juce::Logger::writeToLog("StateManager: Invalid color channel count " + juce::String(numColorChannels) + ", clamping");
+                numColorChannels = juce::jlimit(1, MAX_COLOR_CHANNELS, numColorChannels);
+            }
+        }
+        
         // Check if we have enough data for square count
         if (stream.getNumBytesRemaining() < 4)
         {
@@ -155,11 +333,14 @@ bool StateManager::loadState(PatternModel& model, const void* data, int sizeInBy
         }
         
         // Clear existing squares before loading
-        for (int i = 0; i < 4; ++i)
+        for (int i = 0; i < MAX_COLOR_CHANNELS; ++i)
         {
             model.clearColorChannel(i);
         }
+        model.setNumColorChannels(numColorChannels);
         
+        std::vector<Square> loadedSquares;
+        loadedSquares.reserve(static_cast<size_t>(numSquares));
         int squaresLoaded = 0;
         for (int i = 0; i < numSquares; ++i)
         {
@@ -194,91 +375,21 @@ bool StateManager::loadState(PatternModel& model, const void* data, int sizeInBy
                 continue; // Skip this square but continue loading
             }
             
-            // Create square (PatternModel will clamp values to valid ranges)
-            model.createSquare(leftEdge, topEdge, width, height, colorChannelId);
+            // PatternModel will assign the ID and clamp values to valid ranges
+            loadedSquares.emplace_back(leftEdge, topEdge, width, height, colorChannelId, 0);
             squaresLoaded++;
         }
+        model.addSquares(loadedSquares);
         
         // Read color channel configurations with per-color pitch waveforms
-        for (int i = 0; i < 4; ++i)
+        for (int i = 0; i < numColorChannels; ++i)
         {
-            int minBytes = (version >= 6) ? 32 : 24;  // Version 6+ has mainLoopLengthBars (double)
-            if (stream.getNumBytesRemaining() < minBytes)
-            {
-                juce::Logger::writeToLog("StateManager: Truncated data (not enough for color config " + juce::String(i) + ")");
-                break;
-            }
-            
             ColorChannelConfig config;
-            config.midiChannel = stream.readInt();
-            config.highNote = stream.readInt();
-            config.lowNote = stream.readInt();
-            config.quantize = static_cast<QuantizationValue>(stream.readInt());
-            config.displayColor = juce::Colour(static_cast<uint32_t>(stream.readInt()));
-            config.pitchSeqLoopLengthBars = juce::jlimit(0, 64, stream.readInt());  // 0 = use global
-            
-            // Per-color loop length (Version 6+)
-            if (version >= 6)
-            {
-                config.mainLoopLengthBars = stream.readDouble();
-            }
-            else
+            if (!readColorConfig(stream, version, i, config))
             {
-                config.mainLoopLengthBars = 0.0;  // Default to global
-            }
-            
-            // Read per-color pitch waveform
-            if (stream.getNumBytesRemaining() < 4)
-            {
-                juce::Logger::writeToLog("StateManager: Truncated data (not enough for waveform size)");
                 break;
             }
             
-            int waveformSize = stream.readInt();
-            if (waveformSize < 0 || waveformSize > 1000000)
-            {
-                juce::Logger::writeToLog("StateManager: Invalid waveform size: " + juce::String(waveformSize));
-                waveformSize = 0;
-            }
-            
-            if (stream.getNumBytesRemaining() < waveformSize * 4)
-            {
-                juce::Logger::writeToLog("StateManager: Truncated data (not enough for waveform data)");
-                waveformSize = static_cast<int>(stream.getNumBytesRemaining() / 4);
-            }
-            
-            config.pitchWaveform.clear();
-            config.pitchWaveform.reserve(waveformSize);
-            for (int j = 0; j < waveformSize; ++j)
-            {
-                float value = stream.readFloat();
-                if (!std::isnan(value) && !std::isinf(value))
-                {
-                    config.pitchWaveform.push_back(value);
-                }
-                else
-                {
-                    config.pitchWaveform.push_back(0.0f);
-                }
-            }
-            
-            // If waveform is empty, initialize with default size
-            if (config.pitchWaveform.empty())
-            {
-                config.pitchWaveform.resize(256, 0.0f);
-            }
-            
-            // Validate and clamp values
-            config.midiChannel = juce::jlimit(1, 16, config.midiChannel);
-            config.highNote = juce::jlimit(0, 127, config.highNote);
-            config.lowNote = juce::jlimit(0, 127, config.lowNote);
-            
-            // Validate quantization value
-            if (config.quantize < Q_1_32 || config.quantize > Q_1_BAR)
-            {
-                config.quantize = Q_1_16;
-            }
-            
             model.setColorConfig(i, config);
         }
         
@@ -294,84 +405,19 @@ bool StateManager::loadState(PatternModel& model, const void* data, int sizeInBy
         // Read scale configuration (Version 4+)
         if (version >= 4 && stream.getNumBytesRemaining() >= 8)
         {
-            int rootNote = stream.readInt();
-            int scaleType = stream.readInt();
-            
-            ScaleConfig scaleConfig;
-            scaleConfig.rootNote = static_cast<RootNote>(juce::jlimit(0, 11, rootNote));
-            scaleConfig.scaleType = static_cast<ScaleType>(juce::jlimit(0, static_cast<int>(NUM_SCALE_TYPES) - 1, scaleType));
-            model.setScaleConfig(scaleConfig);
+            readScaleConfig(model, stream);
         }
         
         // Read scale sequencer configuration (Version 5+)
         if (version >= 5 && stream.getNumBytesRemaining() >= 5)  // 1 bool + 1 int minimum
         {
-            bool scaleSeqEnabled = stream.readBool();
-            int numSegments = stream.readInt();
-            
-            // Validate segment count
-            if (numSegments < 0 || numSegments > ScaleSequencerConfig::MAX_SEGMENTS)
-            {
-                juce::Logger::writeToLog("StateManager: Invalid scale sequencer segment count: " + juce::String(numSegments));
-                numSegments = juce::jlimit(0, ScaleSequencerConfig::MAX_SEGMENTS, numSegments);
-            }
-            
-            ScaleSequencerConfig scaleSeqConfig;
-            scaleSeqConfig.enabled = scaleSeqEnabled;
-            scaleSeqConfig.segments.clear();
-            
-            for (int i = 0; i < numSegments; ++i)
-            {
-                if (stream.getNumBytesRemaining() < 12)  // 3 ints per segment
-                {
-                    juce::Logger::writeToLog("StateManager: Truncated data while reading scale sequencer segments");
-                    break;
-                }
-                
-                int rootNote = stream.readInt();
-                int scaleType = stream.readInt();
-                int lengthBars = stream.readInt();
-                
-                // Validate and clamp values
-                rootNote = juce::jlimit(0, 11, rootNote);
-                scaleType = juce::jlimit(0, static_cast<int>(NUM_SCALE_TYPES) - 1, scaleType);
-                lengthBars = juce::jlimit(1, 16, lengthBars);
-                
-                ScaleSequenceSegment segment(
-                    static_cast<RootNote>(rootNote),
-                    static_cast<ScaleType>(scaleType),
-                    lengthBars
-                );
-                scaleSeqConfig.segments.push_back(segment);
-            }
-            
-            // Ensure at least one segment exists
-            if (scaleSeqConfig.segments.empty())
-            {
-                scaleSeqConfig.segments.push_back(ScaleSequenceSegment(ROOT_C, SCALE_MAJOR, 4));
-            }
-            
-            // Use mutable getter to assign the loaded config
-            model.getScaleSequencer() = scaleSeqConfig;
+            readScaleSequencer(model, stream);
         }
         
         // Read play mode configuration (Version 7+)
         if (version >= 7 && stream.getNumBytesRemaining() >= 12)  // 1 int + 2 floats
         {
-            int playMode = stream.readInt();
-            float stepJumpSize = stream.readFloat();
-            float probability = stream.readFloat();
-            
-            // Validate and clamp values
-            playMode = juce::jlimit(0, static_cast<int>(NUM_PLAY_MODES) - 1, playMode);
-            stepJumpSize = juce::jlimit(0.0f, 1.0f, stepJumpSize);
-            probability = juce::jlimit(0.0f, 1.0f, probability);
-            
-            PlayModeConfig& playModeConfig = model.getPlayModeConfig();
-            playModeConfig.mode = static_cast<PlayMode>(playMode);
-            playModeConfig.stepJumpSize = stepJumpSize;
-            playModeConfig.probability = probability;
-            playModeConfig.pendulumForward = true;  // Always start forward
+            readPlayMode(model, stream);
         }
         
         return true;
@@ -388,4 +434,628 @@ bool StateManager::loadState(PatternModel& model, const void* data, int sizeInBy
     }
 }
 
+//==============================================================================
+bool StateManager::loadSections(PatternModel& model, juce::MemoryInputStream& stream)
+{
+    // Collect known sections first, so they apply in a fixed order whatever order they were written in
+    std::map<uint32_t, juce::MemoryBlock> sections;
+    while (!stream.isExhausted())
+    {
+        if (stream.getNumBytesRemaining() < SECTION_HEADER_SIZE)
+        {
+            juce::Logger::writeToLog("StateManager: Truncated data (not enough for section header)");
+            break;
+        }
+        
+        uint32_t tag = static_cast<uint32_t>(stream.readInt());
+        int flags = static_cast<uint8_t>(stream.readByte());
+        int storedSize = stream.readInt();
+        
+        if (storedSize < 0 || storedSize > stream.getNumBytesRemaining())
+        {
+            juce::Logger::writeToLog("StateManager: Truncated data (section 0x" +
+                                    juce::String::toHexString(static_cast<int>(tag)) + ")");
+            break;
+        }
+        
+        bool isKnownTag = tag == TAG_GLOBAL || tag == TAG_SQUARES || tag == TAG_COLORS
+                       || tag == TAG_PITCH_SEQUENCER || tag == TAG_SCALE
+                       || tag == TAG_SCALE_SEQUENCER || tag == TAG_PLAY_MODE || tag == TAG_GROOVES
+                       || tag == TAG_RATCHETS;
+        
+        // Sections and encodings from newer versions are skipped, not rejected
+        if (!isKnownTag || (flags & ~SECTION_COMPRESSED) != 0)
+        {
+            stream.skipNextBytes(storedSize);
+            continue;
+        }
+        
+        juce::MemoryBlock payload;
+        if (readSectionPayload(stream, flags, storedSize, payload))
+        {
+            sections[tag] = std::move(payload);
+        }
+    }
+    
+    // Global settings are required; everything else keeps its current value if missing
+    auto global = sections.find(TAG_GLOBAL);
+    if (global == sections.end() || global->second.getSize() < 12)  // 1 double + 1 int
+    {
+        juce::Logger::writeToLog("StateManager: Missing global settings section");
+        return false;
+    }
+    
+    int numColorChannels = DEFAULT_COLOR_CHANNELS;
+    {
+        juce::MemoryInputStream section(global->second, false);
+        double loopLength = section.readDouble();
+        numColorChannels = section.readInt();
+        
+        if (loopLength < 1.0 / 16.0 || loopLength > 64.0)
+        {
+            juce::Logger::writeToLog("StateManager: Invalid loop length " + juce::String(loopLength) + ", using default");
+            loopLength = 2.0;  // Default to 2 bars
+        }
+        
+        if (numColorChannels < 1 || numColorChannels > MAX_COLOR_CHANNELS)
+        {
+            juce::Logger::writeToLog("StateManager: Invalid color channel count " + juce::String(numColorChannels) + ", clamping");
+            numColorChannels = juce::jlimit(1, MAX_COLOR_CHANNELS, numColorChannels);
+        }
+        
+        model.setLoopLength(loopLength);
+        model.setTimeSignature(4, 4);  // Always use 4/4
+        
+        // Clear existing squares before loading; all channels are open while squares load,
+        // so squares kept on channels not in use come back on their own channel
+        for (int i = 0; i < MAX_COLOR_CHANNELS; ++i)
+        {
+            model.clearColorChannel(i);
+        }
+        model.setNumColorChannels(MAX_COLOR_CHANNELS);
+    }
+    
+    auto squares = sections.find(TAG_SQUARES);
+    if (squares != sections.end())
+    {
+        juce::MemoryInputStream section(squares->second, false);
+        readSquares(model, section);
+        
+        auto ratchets = sections.find(TAG_RATCHETS);
+        if (ratchets != sections.end())
+        {
+            juce::MemoryInputStream ratchetSection(ratchets->second, false);
+            readRatchets(model, ratchetSection);
+        }
+    }
+    model.setNumColorChannels(numColorChannels);
+    
+    auto colors = sections.find(TAG_COLORS);
+    if (colors != sections.end() && colors->second.getSize() >= 4)
+    {
+        juce::MemoryInputStream section(colors->second, false);
+        int numConfigs = juce::jlimit(0, MAX_COLOR_CHANNELS, section.readInt());
+        
+        // Colors without a stored groove play straight
+        juce::MemoryBlock groovePayload;
+        auto grooves = sections.find(TAG_GROOVES);
+        if (grooves != sections.end())
+        {
+            groovePayload = grooves->second;
+        }
+        juce::MemoryInputStream grooveSection(groovePayload, false);
+        int numGrooves = grooveSection.getNumBytesRemaining() >= 4 ? grooveSection.readInt() : 0;
+        
+        for (int i = 0; i < numConfigs; ++i)
+        {
+            ColorChannelConfig config;
+            if (!readColorConfig(section, VERSION, i, config))
+            {
+                break;
+            }
+            
+            if (i < numGrooves && !readGroove(grooveSection, config.groove))
+            {
+                numGrooves = i;
+            }
+            
+            model.setColorConfig(i, config);
+        }
+    }
+    
+    auto pitchSequencer = sections.find(TAG_PITCH_SEQUENCER);
+    if (pitchSequencer != sections.end() && pitchSequencer->second.getSize() >= 1)
+    {
+        juce::MemoryInputStream section(pitchSequencer->second, false);
+        model.getPitchSequencer().editingPitch = section.readBool();
+    }
+    
+    auto scale = sections.find(TAG_SCALE);
+    if (scale != sections.end() && scale->second.getSize() >= 8)
+    {
+        juce::MemoryInputStream section(scale->second, false);
+        readScaleConfig(model, section);
+    }
+    
+    auto scaleSequencer = sections.find(TAG_SCALE_SEQUENCER);
+    if (scaleSequencer != sections.end() && scaleSequencer->second.getSize() >= 5)
+    {
+        juce::MemoryInputStream section(scaleSequencer->second, false);
+        readScaleSequencer(model, section);
+    }
+    
+    auto playMode = sections.find(TAG_PLAY_MODE);
+    if (playMode != sections.end() && playMode->second.getSize() >= 12)
+    {
+        juce::MemoryInputStream section(playMode->second, false);
+        readPlayMode(model, section);
+    }
+    
+    return true;
+}
+
+bool StateManager::loadSlots(const void* data, int sizeInBytes, std::vector<juce::MemoryBlock>& slotStates,
+                             int& activeSlot)
+{
+    juce::MemoryBlock payload;
+    if (!findSection(data, sizeInBytes, TAG_SLOTS, payload) || payload.getSize() < 8)  // 2 ints
+    {
+        return false;
+    }
+    
+    juce::MemoryInputStream section(payload, false);
+    int storedActiveSlot = section.readInt();
+    int numSlots = section.readInt();
+    if (numSlots < 0 || numSlots > section.getNumBytesRemaining() / 4)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid slot count " + juce::String(numSlots));
+        return false;
+    }
+    
+    std::vector<juce::MemoryBlock> states;
+    states.reserve(static_cast<size_t>(numSlots));
+    for (int i = 0; i < numSlots; ++i)
+    {
+        int size = section.readInt();
+        if (size < 0 || size > section.getNumBytesRemaining())
+        {
+            juce::Logger::writeToLog("StateManager: Truncated data (slot " + juce::String(i + 1) + ")");
+            return false;
+        }
+        
+        juce::MemoryBlock state(static_cast<size_t>(size));
+        section.read(state.getData(), size);
+        states.push_back(std::move(state));
+    }
+    
+    slotStates = std::move(states);
+    activeSlot = storedActiveSlot;
+    return true;
+}
+
+bool StateManager::findSection(const void* data, int sizeInBytes, uint32_t tag, juce::MemoryBlock& payload)
+{
+    if (data == nullptr || sizeInBytes < 8)
+    {
+        return false;
+    }
+    
+    juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes), false);
+    uint32_t magic = static_cast<uint32_t>(stream.readInt());
+    uint32_t version = static_cast<uint32_t>(stream.readInt());
+    if (magic != MAGIC_NUMBER || version < SECTIONED_VERSION)
+    {
+        return false;
+    }
+    
+    while (stream.getNumBytesRemaining() >= SECTION_HEADER_SIZE)
+    {
+        uint32_t sectionTag = static_cast<uint32_t>(stream.readInt());
+        int flags = static_cast<uint8_t>(stream.readByte());
+        int storedSize = stream.readInt();
+        
+        if (storedSize < 0 || storedSize > stream.getNumBytesRemaining())
+        {
+            return false;
+        }
+        
+        if (sectionTag != tag || (flags & ~SECTION_COMPRESSED) != 0)
+        {
+            stream.skipNextBytes(storedSize);
+            continue;
+        }
+        
+        return readSectionPayload(stream, flags, storedSize, payload);
+    }
+    
+    return false;
+}
+
+bool StateManager::readSectionPayload(juce::MemoryInputStream& stream, int flags, int storedSize,
+                                      juce::MemoryBlock& payload)
+{
+    if ((flags & SECTION_COMPRESSED) == 0)
+    {
+        payload.setSize(static_cast<size_t>(storedSize));
+        stream.read(payload.getData(), storedSize);
+        return true;
+    }
+    
+    if (storedSize < 4)
+    {
+        stream.skipNextBytes(storedSize);
+        juce::Logger::writeToLog("StateManager: Invalid compressed section");
+        return false;
+    }
+    
+    int uncompressedSize = stream.readInt();
+    juce::MemoryBlock compressedData;
+    compressedData.setSize(static_cast<size_t>(storedSize - 4));
+    stream.read(compressedData.getData(), storedSize - 4);
+    
+    // Every section is far smaller than this; a larger size means corrupt data
+    constexpr int maxSectionSize = 64 * 1024 * 1024;
+    if (uncompressedSize < 0 || uncompressedSize > maxSectionSize)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid compressed section size " + juce::String(uncompressedSize));
+        return false;
+    }
+    
+    juce::MemoryInputStream compressedStream(compressedData, false);
+    juce::GZIPDecompressorInputStream decompressor(compressedStream);
+    payload.setSize(static_cast<size_t>(uncompressedSize));
+    if (decompressor.read(payload.getData(), uncompressedSize) != uncompressedSize)
+    {
+        juce::Logger::writeToLog("StateManager: Failed to decompress section");
+        return false;
+    }
+    
+    return true;
+}
+
+void StateManager::readSquares(PatternModel& model, juce::MemoryInputStream& stream)
+{
+    if (stream.getNumBytesRemaining() < 4)
+    {
+        juce::Logger::writeToLog("StateManager: Truncated data (not enough for square count)");
+        return;
+    }
+    
+    int numSquares = stream.readInt();
+    if (numSquares < 0 || numSquares > 100000)
+    {
+        // Sanity check: unreasonable number of squares
+        juce::Logger::writeToLog("StateManager: Invalid number of squares: " + juce::String(numSquares));
+        return;
+    }
+    
+    if (stream.getNumBytesRemaining() < static_cast<juce::int64>(numSquares) * QUANTIZED_SQUARE_SIZE)
+    {
+        int available = static_cast<int>(stream.getNumBytesRemaining() / QUANTIZED_SQUARE_SIZE);
+        juce::Logger::writeToLog("StateManager: Truncated data while reading squares (loading " +
+                                juce::String(available) + " of " + juce::String(numSquares) + ")");
+        numSquares = available;
+    }
+    
+    const float step = 1.0f / COORDINATE_STEPS;
+    std::vector<Square> loadedSquares;
+    loadedSquares.reserve(static_cast<size_t>(numSquares));
+    int left = 0;
+    for (int i = 0; i < numSquares; ++i)
+    {
+        left += static_cast<uint16_t>(stream.readShort());
+        int width = static_cast<uint16_t>(stream.readShort());
+        int top = static_cast<uint16_t>(stream.readShort());
+        int height = static_cast<uint16_t>(stream.readShort());
+        int colorChannelId = static_cast<uint8_t>(stream.readByte());
+        
+        // PatternModel will assign the ID and clamp values to valid ranges
+        loadedSquares.emplace_back(left * step, top * step, width * step, height * step, colorChannelId, 0);
+    }
+    
+    // One edit for the model's listeners however many squares the state holds
+    model.addSquares(loadedSquares);
+}
+
+void StateManager::readRatchets(PatternModel& model, juce::MemoryInputStream& stream)
+{
+    if (stream.getNumBytesRemaining() < 4)
+    {
+        juce::Logger::writeToLog("StateManager: Truncated data (not enough for ratchet count)");
+        return;
+    }
+    
+    // Squares were just read into a cleared model, so they are in their stored order
+    const auto& squares = model.getSquares();
+    int numRatchets = stream.readInt();
+    if (numRatchets < 0 || numRatchets > static_cast<int>(squares.size())
+        || stream.getNumBytesRemaining() < static_cast<juce::int64>(numRatchets) * RATCHET_SIZE)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid number of ratchets: " + juce::String(numRatchets));
+        return;
+    }
+    
+    for (int i = 0; i < numRatchets; ++i)
+    {
+        int index = stream.readInt();
+        Ratchet ratchet;
+        ratchet.count = static_cast<uint8_t>(stream.readByte());
+        int rate = static_cast<uint8_t>(stream.readByte());
+        float velocityRamp = stream.readFloat();
+        
+        if (index < 0 || index >= static_cast<int>(squares.size()) || rate > Q_1_BAR)
+        {
+            juce::Logger::writeToLog("StateManager: Invalid ratchet at index " + juce::String(i));
+            continue;
+        }
+        
+        // The model clamps the count and ramp
+        ratchet.rate = static_cast<QuantizationValue>(rate);
+        ratchet.velocityRamp = std::isfinite(velocityRamp) ? velocityRamp : 0.0f;
+        model.setSquareRatchet(squares[static_cast<size_t>(index)].uniqueId, ratchet);
+    }
+}
+
+bool StateManager::readColorConfig(juce::MemoryInputStream& stream, uint32_t version, int colorId,
+                                   ColorChannelConfig& config)
+{
+    int minBytes = (version >= 11) ? 48 : (version >= 9) ? 40 : (version >= 6) ? 32 : 24;  // Version 6+ has mainLoopLengthBars (double), 9+ polyphony, 11+ pitch-bend
+    if (stream.getNumBytesRemaining() < minBytes)
+    {
+        juce::Logger::writeToLog("StateManager: Truncated data (not enough for color config " + juce::String(colorId) + ")");
+        return false;
+    }
+    
+    config.midiChannel = stream.readInt();
+    config.highNote = stream.readInt();
+    config.lowNote = stream.readInt();
+    config.quantize = static_cast<QuantizationValue>(stream.readInt());
+    config.displayColor = juce::Colour(static_cast<uint32_t>(stream.readInt()));
+    config.pitchSeqLoopLengthBars = juce::jlimit(0, 64, stream.readInt());  // 0 = use global
+    
+    // Per-color loop length (Version 6+)
+    if (version >= 6)
+    {
+        config.mainLoopLengthBars = stream.readDouble();
+    }
+    else
+    {
+        config.mainLoopLengthBars = 0.0;  // Default to global
+    }
+    
+    // Per-color polyphony and steal policy (Version 9+)
+    if (version >= 9)
+    {
+        config.polyphony = juce::jlimit(1, MAX_VOICES_PER_COLOR, stream.readInt());
+        int stealPolicy = stream.readInt();
+        config.stealPolicy = (stealPolicy >= 0 && stealPolicy < NUM_STEAL_POLICIES)
+            ? static_cast<VoiceStealPolicy>(stealPolicy)
+            : STEAL_OLDEST;
+    }
+    
+    // Per-color pitch-bend output (Version 11+)
+    if (version >= 11)
+    {
+        config.pitchBendRange = juce::jlimit(0, MAX_PITCH_BEND_RANGE, stream.readInt());
+        config.pitchBendRateHz = juce::jlimit(MIN_PITCH_BEND_RATE_HZ, MAX_PITCH_BEND_RATE_HZ, stream.readInt());
+    }
+    
+    // Read per-color pitch waveform (breakpoints in Version 10+, dense samples before)
+    if (stream.getNumBytesRemaining() < ((version >= 10) ? 8 : 4))
+    {
+        juce::Logger::writeToLog("StateManager: Truncated data (not enough for waveform size)");
+        return false;
+    }
+    
+    PitchEnvelope envelope = (version >= 10) ? readPitchEnvelope(stream) : readDenseWaveform(stream);
+    
+    // Empty or untouched waveforms share the default flat envelope
+    if (envelope.empty() || (envelope.isFlat() && envelope.getResolution() == PitchWaveform::DEFAULT_RESOLUTION))
+    {
+        config.pitchWaveform = PitchWaveform::flat(PitchWaveform::DEFAULT_RESOLUTION);
+    }
+    else
+    {
+        config.pitchWaveform = std::move(envelope);
+    }
+    
+    // Validate and clamp values
+    config.midiChannel = juce::jlimit(1, 16, config.midiChannel);
+    config.highNote = juce::jlimit(0, 127, config.highNote);
+    config.lowNote = juce::jlimit(0, 127, config.lowNote);
+    
+    // Validate quantization value
+    if (config.quantize < Q_1_32 || config.quantize > Q_1_BAR)
+    {
+        config.quantize = Q_1_16;
+    }
+    
+    return true;
+}
+
+void StateManager::writeGroove(juce::OutputStream& stream, const Groove& groove)
+{
+    stream.writeFloat(groove.getSwing());
+    stream.writeInt(groove.getNumTemplateSteps());
+    for (int i = 0; i < groove.getNumTemplateSteps(); ++i)
+    {
+        stream.writeFloat(groove.getTemplateStep(i).timing);
+        stream.writeInt(groove.getTemplateStep(i).velocity);
+    }
+}
+
+bool StateManager::readGroove(juce::MemoryInputStream& stream, Groove& groove)
+{
+    if (stream.getNumBytesRemaining() < 8)
+    {
+        juce::Logger::writeToLog("StateManager: Truncated data (not enough for groove)");
+        return false;
+    }
+    
+    float swing = stream.readFloat();
+    int numSteps = stream.readInt();
+    if (numSteps < 0 || numSteps > Groove::MAX_STEPS || stream.getNumBytesRemaining() < numSteps * 8)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid groove template length " + juce::String(numSteps));
+        return false;
+    }
+    
+    std::vector<Groove::Step> steps(static_cast<size_t>(numSteps));
+    for (auto& step : steps)
+    {
+        float timing = stream.readFloat();
+        step.timing = std::isfinite(timing) ? timing : 0.0f;
+        step.velocity = stream.readInt();
+    }
+    
+    // The setters clamp what was read
+    groove.setSwing(std::isfinite(swing) ? swing : 0.0f);
+    groove.setTemplate(steps);
+    return true;
+}
+
+void StateManager::readScaleConfig(PatternModel& model, juce::MemoryInputStream& stream)
+{
+    int rootNote = stream.readInt();
+    int scaleType = stream.readInt();
+    
+    ScaleConfig scaleConfig;
+    scaleConfig.rootNote = static_cast<RootNote>(juce::jlimit(0, 11, rootNote));
+    scaleConfig.scaleType = static_cast<ScaleType>(juce::jlimit(0, static_cast<int>(NUM_SCALE_TYPES) - 1, scaleType));
+    model.setScaleConfig(scaleConfig);
+}
+
+void StateManager::readScaleSequencer(PatternModel& model, juce::MemoryInputStream& stream)
+{
+    bool scaleSeqEnabled = stream.readBool();
+    int numSegments = stream.readInt();
+    
+    // Validate segment count
+    if (numSegments < 0 || numSegments > ScaleSequencerConfig::MAX_SEGMENTS)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid scale sequencer segment count: " + juce::String(numSegments));
+        numSegments = juce::jlimit(0, ScaleSequencerConfig::MAX_SEGMENTS, numSegments);
+    }
+    
+    ScaleSequencerConfig scaleSeqConfig;
+    scaleSeqConfig.enabled = scaleSeqEnabled;
+    scaleSeqConfig.segments.clear();
+    
+    for (int i = 0; i < numSegments; ++i)
+    {
+        if (stream.getNumBytesRemaining() < 12)  // 3 ints per segment
+        {
+            juce::Logger::writeToLog("StateManager: Truncated data while reading scale sequencer segments");
+            break;
+        }
+        
+        int rootNote = stream.readInt();
+        int scaleType = stream.readInt();
+        int lengthBars = stream.readInt();
+        
+        // Validate and clamp values
+        rootNote = juce::jlimit(0, 11, rootNote);
+        scaleType = juce::jlimit(0, static_cast<int>(NUM_SCALE_TYPES) - 1, scaleType);
+        lengthBars = juce::jlimit(1, 16, lengthBars);
+        
+        ScaleSequenceSegment segment(
+            static_cast<RootNote>(rootNote),
+            static_cast<ScaleType>(scaleType),
+            lengthBars
+        );
+        scaleSeqConfig.segments.push_back(segment);
+    }
+    
+    // Ensure at least one segment exists
+    if (scaleSeqConfig.segments.empty())
+    {
+        scaleSeqConfig.segments.push_back(ScaleSequenceSegment(ROOT_C, SCALE_MAJOR, 4));
+    }
+    scaleSeqConfig.rebuildLookup();
+    
+    // Use mutable getter to assign the loaded config
+    model.getScaleSequencer() = scaleSeqConfig;
+}
+
+void StateManager::readPlayMode(PatternModel& model, juce::MemoryInputStream& stream)
+{
+    int playMode = stream.readInt();
+    float stepJumpSize = stream.readFloat();
+    float probability = stream.readFloat();
+    
+    // Validate and clamp values
+    playMode = juce::jlimit(0, static_cast<int>(NUM_PLAY_MODES) - 1, playMode);
+    stepJumpSize = juce::jlimit(0.0f, 1.0f, stepJumpSize);
+    probability = juce::jlimit(0.0f, 1.0f, probability);
+    
+    PlayModeConfig& playModeConfig = model.getPlayModeConfig();
+    playModeConfig.mode = static_cast<PlayMode>(playMode);
+    playModeConfig.stepJumpSize = stepJumpSize;
+    playModeConfig.probability = probability;
+    playModeConfig.pendulumForward = true;  // Always start forward
+}
+
+//==============================================================================
+PitchEnvelope StateManager::readPitchEnvelope(juce::MemoryInputStream& stream)
+{
+    int resolution = stream.readInt();
+    int numBreakpoints = stream.readInt();
+    
+    if (resolution < 0 || resolution > PitchEnvelope::MAX_RESOLUTION)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid waveform resolution: " + juce::String(resolution));
+        resolution = 0;
+    }
+    
+    if (numBreakpoints < 0 || numBreakpoints > resolution)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid waveform breakpoint count: " + juce::String(numBreakpoints));
+        numBreakpoints = 0;
+    }
+    
+    if (stream.getNumBytesRemaining() < numBreakpoints * 8)
+    {
+        juce::Logger::writeToLog("StateManager: Truncated data (not enough for waveform breakpoints)");
+        numBreakpoints = static_cast<int>(stream.getNumBytesRemaining() / 8);
+    }
+    
+    // PitchEnvelope clamps indices, sorts and replaces NaN/Inf values
+    PitchEnvelope::Breakpoints breakpoints;
+    breakpoints.reserve(numBreakpoints);
+    for (int j = 0; j < numBreakpoints; ++j)
+    {
+        int index = stream.readInt();
+        float value = stream.readFloat();
+        breakpoints.push_back({ index, value });
+    }
+    
+    return PitchEnvelope(resolution, std::move(breakpoints));
+}
+
+PitchEnvelope StateManager::readDenseWaveform(juce::MemoryInputStream& stream)
+{
+    int waveformSize = stream.readInt();
+    if (waveformSize < 0 || waveformSize > PitchEnvelope::MAX_RESOLUTION)
+    {
+        juce::Logger::writeToLog("StateManager: Invalid waveform size: " + juce::String(waveformSize));
+        waveformSize = 0;
+    }
+    
+    if (stream.getNumBytesRemaining() < waveformSize * 4)
+    {
+        juce::Logger::writeToLog("StateManager: Truncated data (not enough for waveform data)");
+        waveformSize = static_cast<int>(stream.getNumBytesRemaining() / 4);
+    }
+    
+    PitchWaveform::Samples waveform;
+    waveform.reserve(waveformSize);
+    for (int j = 0; j < waveformSize; ++j)
+    {
+        float value = stream.readFloat();
+        waveform.push_back((!std::isnan(value) && !std::isinf(value)) ? value : 0.0f);
+    }
+    
+    return PitchEnvelope::fromSamples(waveform);
+}
+
 } // namespace SquareBeats
@@ -14,10 +14,13 @@ class StateManager {
 public:
     /**
      * Serialize a PatternModel to binary format
+     * Each subsystem is written as a tagged section; sections that shrink
+     * under zlib are stored compressed unless compressSections is false.
      * @param model The pattern model to serialize
      * @param destData Output memory block to write serialized data
+     * @param compressSections Compress sections where that saves space
      */
-    static void saveState(const PatternModel& model, juce::MemoryBlock& destData);
+    static void saveState(const PatternModel& model, juce::MemoryBlock& destData, bool compressSections = true);
     
     /**
      * Deserialize binary data to restore a PatternModel
@@ -28,6 +31,30 @@ public:
      */
     static bool loadState(PatternModel& model, const void* data, int sizeInBytes);
     
+    /**
+     * Append pattern slots to state written by saveState()
+     * The slots go in a section of their own, which loadState() skips.
+     * @param destData State written by saveState(), appended to
+     * @param slotStates Each slot's state as written by saveState() (empty for an empty slot)
+     * @param activeSlot Slot loaded into the pattern model, or -1 for none
+     */
+    static void saveSlots(juce::MemoryBlock& destData, const std::vector<juce::MemoryBlock>& slotStates,
+                          int activeSlot);
+    
+    /**
+     * Read pattern slots appended by saveSlots()
+     * @param data Pointer to serialized data
+     * @param sizeInBytes Size of the serialized data
+     * @param slotStates Receives each slot's state
+     * @param activeSlot Receives the slot loaded into the pattern model, or -1 for none
+     * @return false if the data holds no readable slots
+     */
+    static bool loadSlots(const void* data, int sizeInBytes, std::vector<juce::MemoryBlock>& slotStates,
+                          int& activeSlot);
+    
+    // Square coordinates are stored in steps of 1/COORDINATE_STEPS (Version 12+)
+    static constexpr int COORDINATE_STEPS = 65535;
+
 private:
     // Magic number for file format validation ("SQBE" = SquareBeats)
     static constexpr uint32_t MAGIC_NUMBER = 0x53514245;
@@ -38,7 +65,140 @@ private:
     // Version 5: Scale sequencer configuration (enabled state and segments)
     // Version 6: Per-color main loop length
     // Version 7: Play mode configuration (mode, stepJumpSize, probability)
-    static constexpr uint32_t VERSION = 7;
+    // Version 8: Color channel count (1-16) after the time signature; one config per channel
+    // Version 9: Per-color polyphony and voice steal policy
+    // Version 10: Pitch waveforms as breakpoints (resolution, count, index/value pairs)
+    // Version 11: Per-color pitch-bend range and control rate
+    // Version 12: Tagged sections, 16-bit quantized squares, optionally compressed sections
+    static constexpr uint32_t VERSION = 12;
+    
+    // First sectioned version; later versions keep the layout, so their states load here too
+    static constexpr uint32_t SECTIONED_VERSION = 12;
+    
+    // Section tags (Version 12+), four ASCII characters like MAGIC_NUMBER
+    // Each section is [tag: 4][flags: 1][stored size: 4][payload]; readers skip unknown tags
+    static constexpr uint32_t TAG_GLOBAL = 0x474C4F42;           // "GLOB": loop length, color channel count
+    static constexpr uint32_t TAG_SQUARES = 0x53515253;          // "SQRS": quantized squares
+    static constexpr uint32_t TAG_COLORS = 0x434F4C52;           // "COLR": color configs and pitch waveforms
+    static constexpr uint32_t TAG_PITCH_SEQUENCER = 0x50534551;  // "PSEQ": pitch editing mode
+    static constexpr uint32_t TAG_SCALE = 0x5343414C;            // "SCAL": root note and scale type
+    static constexpr uint32_t TAG_SCALE_SEQUENCER = 0x53534551;  // "SSEQ": scale sequencer
+    static constexpr uint32_t TAG_PLAY_MODE = 0x504C4159;        // "PLAY": play mode
+    static constexpr uint32_t TAG_GROOVES = 0x47524F56;          // "GROV": per-color swing and groove templates
+    static constexpr uint32_t TAG_RATCHETS = 0x52544348;         // "RTCH": ratchets of squares, by position in SQRS
+    static constexpr uint32_t TAG_SLOTS = 0x534C4F54;            // "SLOT": pattern slots (not part of a pattern)
+    
+    // Section flag: payload is zlib data, preceded by its uncompressed size
+    static constexpr int SECTION_COMPRESSED = 1;
+    
+    // Sections smaller than this are never worth compressing
+    static constexpr size_t MIN_COMPRESSED_SECTION_SIZE = 64;
+    
+    static constexpr int SECTION_HEADER_SIZE = 4 + 1 + 4;
+    static constexpr int QUANTIZED_SQUARE_SIZE = 2 + 2 + 2 + 2 + 1;  // Left delta, width, top, height, color
+    static constexpr int RATCHET_SIZE = 4 + 1 + 1 + 4;                // Square index, count, rate, velocity ramp
+    
+    /**
+     * Square with coordinates in 1/COORDINATE_STEPS steps
+     */
+    struct QuantizedSquare
+    {
+        int left;
+        int width;
+        int top;
+        int height;
+        int colorChannelId;
+        Ratchet ratchet;
+    };
+    
+    /**
+     * Append a section holding the scratch stream's data, then clear the scratch stream
+     */
+    static void writeSection(juce::OutputStream& stream, uint32_t tag,
+                             juce::MemoryOutputStream& section, bool compress);
+    
+    /**
+     * Read the next section's payload, decompressing it if needed
+     * @return false if the section is unreadable (it has still been consumed)
+     */
+    static bool readSectionPayload(juce::MemoryInputStream& stream, int flags, int storedSize,
+                                   juce::MemoryBlock& payload);
+    
+    /**
+     * Restore a Version 12+ sectioned state (header already read)
+     */
+    static bool loadSections(PatternModel& model, juce::MemoryInputStream& stream);
+    
+    /**
+     * Find one section of a Version 12+ state and read its payload
+     * @return false if the data is not sectioned or has no readable section with this tag
+     */
+    static bool findSection(const void* data, int sizeInBytes, uint32_t tag, juce::MemoryBlock& payload);
+    
+    /**
+     * Squares as they are stored: quantized and sorted by start time
+     */
+    static std::vector<QuantizedSquare> quantizeSquares(const std::vector<Square>& squares);
+    
+    /**
+     * Write squares with leftEdge as deltas from the previous square
+     */
+    static void writeSquares(juce::OutputStream& stream, const std::vector<QuantizedSquare>& squares);
+    
+    /**
+     * Read squares written by writeSquares()
+     */
+    static void readSquares(PatternModel& model, juce::MemoryInputStream& stream);
+    
+    /**
+     * Write the ratchets of the squares that have one, by their position in the stored squares
+     */
+    static void writeRatchets(juce::OutputStream& stream, const std::vector<QuantizedSquare>& squares);
+    
+    /**
+     * Apply ratchets written by writeRatchets() to the squares just read by readSquares()
+     */
+    static void readRatchets(PatternModel& model, juce::MemoryInputStream& stream);
+    
+    /**
+     * Write a color channel configuration and its pitch waveform (Version 11 layout)
+     */
+    static void writeColorConfig(juce::OutputStream& stream, const ColorChannelConfig& config);
+    
+    /**
+     * Read a color channel configuration written by the given format version
+     * @return false if the data is truncated
+     */
+    static bool readColorConfig(juce::MemoryInputStream& stream, uint32_t version, int colorId,
+                                ColorChannelConfig& config);
+    
+    /**
+     * Write a color's swing and groove template
+     */
+    static void writeGroove(juce::OutputStream& stream, const Groove& groove);
+    
+    /**
+     * Read a groove written by writeGroove()
+     * @return false if the data is truncated
+     */
+    static bool readGroove(juce::MemoryInputStream& stream, Groove& groove);
+    
+    /**
+     * Read scale configuration, scale sequencer and play mode fields (Version 4+, 5+, 7+ layouts)
+     */
+    static void readScaleConfig(PatternModel& model, juce::MemoryInputStream& stream);
+    static void readScaleSequencer(PatternModel& model, juce::MemoryInputStream& stream);
+    static void readPlayMode(PatternModel& model, juce::MemoryInputStream& stream);
+    
+    /**
+     * Read a Version 10+ breakpoint waveform
+     */
+    static PitchEnvelope readPitchEnvelope(juce::MemoryInputStream& stream);
+    
+    /**
+     * Read a pre-Version 10 waveform of evenly spaced samples
+     */
+    static PitchEnvelope readDenseWaveform(juce::MemoryInputStream& stream);
     
     JUCE_DECLARE_NON_COPYABLE(StateManager)
 };
@@ -56,11 +56,12 @@ void testPatternWithSquaresRoundTrip()
     assert(loadedSquares.size() == originalSquares.size());
     assert(loadedSquares.size() == 3);
     
-    // Check first square
-    assert(loadedSquares[0]->leftEdge == originalSquares[0]->leftEdge);
-    assert(loadedSquares[0]->topEdge == originalSquares[0]->topEdge);
-    assert(loadedSquares[0]->width == originalSquares[0]->width);
-    assert(loadedSquares[0]->height == originalSquares[0]->height);
+    // Check first square (coordinates are stored quantized)
+    const float tolerance = 0.5f / StateManager::COORDINATE_STEPS;
+    assert(std::abs(loadedSquares[0]->leftEdge - originalSquares[0]->leftEdge) <= tolerance);
+    assert(std::abs(loadedSquares[0]->topEdge - originalSquares[0]->topEdge) <= tolerance);
+    assert(std::abs(loadedSquares[0]->width - originalSquares[0]->width) <= tolerance);
+    assert(std::abs(loadedSquares[0]->height - originalSquares[0]->height) <= tolerance);
     assert(loadedSquares[0]->colorChannelId == originalSquares[0]->colorChannelId);
     
     std::cout << "✓ Pattern with squares round-trip test passed\n";
@@ -247,10 +248,12 @@ void testComplexPatternRoundTrip()
     // Set up per-color pitch waveform
     ColorChannelConfig config = original.getColorConfig(0);
     config.pitchSeqLoopLengthBars = 16;
+    std::vector<float> waveform;
     for (int i = 0; i < 100; ++i)
     {
-        config.pitchWaveform.push_back(std::sin(i * 0.1f) * 5.0f);
+        waveform.push_back(std::sin(i * 0.1f) * 5.0f);
     }
+    config.pitchWaveform = waveform;
     original.setColorConfig(0, config);
     
     juce::MemoryBlock stateData;
@@ -83,7 +83,7 @@ void TimeSignatureControls::setupComponents()
     titleLabel.setText("Time Signature", juce::dontSendNotification);
     titleLabel.setColour(juce::Label::textColourId, juce::Colours::white);
     titleLabel.setJustificationType(juce::Justification::centred);
-    titleLabel.setFont(AppFont::smallLabel());
+    titleLabel.setFont(AppFont::smallLabel(*fonts));
     addAndMakeVisible(titleLabel);
     
     // Numerator label
@@ -2,6 +2,7 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "PatternModel.h"
+#include "AppFont.h"
 
 namespace SquareBeats {
 
@@ -31,6 +32,7 @@ public:
 
 private:
     PatternModel& patternModel;
+    juce::SharedResourcePointer<AppFont::Cache> fonts;  // Shared with the other components (see AppFont::Cache)
     
     // UI Components
     juce::Label titleLabel;
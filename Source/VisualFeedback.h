@@ -1,6 +1,7 @@
 #pragma once
 
 #include <juce_graphics/juce_graphics.h>
+#include "DataStructures.h"
 #include <array>
 #include <atomic>
 #include <cmath>
@@ -32,14 +33,14 @@ struct GateEvent {
 
 //==============================================================================
 /**
- * Visual feedback state for all 4 color channels
+ * Visual feedback state for all color channels
  * 
  * This class provides thread-safe communication between the audio thread
  * (which generates MIDI events) and the UI thread (which renders visual feedback).
  */
 class VisualFeedbackState {
 public:
-    static constexpr int NUM_COLORS = 4;
+    static constexpr int NUM_COLORS = MAX_COLOR_CHANNELS;
     static constexpr float FLASH_DURATION_MS = 150.0f;  // How long the flash lasts
     static constexpr float GLOW_DURATION_MS = 100.0f;   // How long the active glow pulses
     
@@ -52,7 +53,7 @@ public:
     
     /**
      * Signal that a gate-on event occurred for a color channel
-     * @param colorId Color channel ID (0-3)
+     * @param colorId Color channel ID (0 to NUM_COLORS - 1)
      * @param vel Velocity of the note (0-127)
      * @param squareId UniqueId of the square being triggered (-1 for unknown)
      */
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "DataStructures.h"
+#include <array>
+#include <cstdlib>
+
+namespace SquareBeats {
+
+//==============================================================================
+/**
+ * Fixed-capacity voice pool for one color channel
+ *
+ * All MAX_VOICES_PER_COLOR slots are allocated with the pool. Sounding voices
+ * form a doubly linked list ordered by start time (oldest first) and unused
+ * slots form a free list, so starting and stopping a voice is O(1) and never
+ * allocates. A per-note index finds the voice sounding a given pitch in O(1).
+ * Picking a voice to steal scans at most voiceLimit voices.
+ */
+class VoicePool {
+public:
+    static constexpr int NO_VOICE = -1;
+
+    struct Voice {
+        int midiNote = 0;        // MIDI note number being played
+        int velocity = 0;        // Note-on velocity (for lowest-velocity stealing)
+        double endTime = 0.0;    // When to send note-off (in beats, wrapped to the color's loop)
+        int prev = NO_VOICE;     // Next older sounding voice
+        int next = NO_VOICE;     // Next newer sounding voice, or next free slot
+    };
+
+    VoicePool() { reset(); }
+
+    //==============================================================================
+    /**
+     * Forget every voice (no note-offs are produced) and rebuild the free list
+     */
+    void reset() {
+        for (int i = 0; i < MAX_VOICES_PER_COLOR; ++i) {
+            voices[i] = Voice();
+            voices[i].next = (i + 1 < MAX_VOICES_PER_COLOR) ? i + 1 : NO_VOICE;
+        }
+        voiceByNote.fill(NO_VOICE);
+        freeHead = 0;
+        oldest = NO_VOICE;
+        newest = NO_VOICE;
+        numActive = 0;
+    }
+
+    /**
+     * Set how many voices may sound at once (clamped to 1..MAX_VOICES_PER_COLOR)
+     * Voices already sounding beyond a lowered limit are left to the caller to release.
+     */
+    void setVoiceLimit(int limit) { voiceLimit = juce::jlimit(1, MAX_VOICES_PER_COLOR, limit); }
+    int getVoiceLimit() const { return voiceLimit; }
+
+    int getNumActive() const { return numActive; }
+    bool isEmpty() const { return numActive == 0; }
+    bool isFull() const { return numActive >= voiceLimit; }
+    bool isOverLimit() const { return numActive > voiceLimit; }
+
+    /**
+     * Oldest sounding voice, or NO_VOICE. Follow Voice::next to walk towards newer voices.
+     */
+    int getOldest() const { return oldest; }
+    const Voice& getVoice(int slot) const { return voices[slot]; }
+
+    /**
+     * Slot of the voice currently sounding a note, or NO_VOICE
+     */
+    int findVoiceForNote(int midiNote) const {
+        if (midiNote < 0 || midiNote > 127) {
+            return NO_VOICE;
+        }
+        return voiceByNote[midiNote];
+    }
+
+    //==============================================================================
+    /**
+     * Start a voice in a free slot
+     * The pool must not be full and the note must not already be sounding.
+     * @return Slot of the new voice
+     */
+    int startVoice(int midiNote, int velocity, double endTime) {
+        jassert(!isFull() && freeHead != NO_VOICE);
+        jassert(findVoiceForNote(midiNote) == NO_VOICE);
+
+        int slot = freeHead;
+        Voice& voice = voices[slot];
+        freeHead = voice.next;
+
+        voice.midiNote = juce::jlimit(0, 127, midiNote);
+        voice.velocity = velocity;
+        voice.endTime = endTime;
+        voice.prev = newest;
+        voice.next = NO_VOICE;
+
+        if (newest != NO_VOICE) {
+            voices[newest].next = slot;
+        } else {
+            oldest = slot;
+        }
+        newest = slot;
+
+        voiceByNote[voice.midiNote] = slot;
+        ++numActive;
+        return slot;
+    }
+
+    /**
+     * Return a sounding voice's slot to the free list
+     */
+    void stopVoice(int slot) {
+        jassert(slot >= 0 && slot < MAX_VOICES_PER_COLOR);
+        Voice& voice = voices[slot];
+
+        if (voice.prev != NO_VOICE) {
+            voices[voice.prev].next = voice.next;
+        } else {
+            oldest = voice.next;
+        }
+        if (voice.next != NO_VOICE) {
+            voices[voice.next].prev = voice.prev;
+        } else {
+            newest = voice.prev;
+        }
+
+        voiceByNote[voice.midiNote] = NO_VOICE;
+        voice.prev = NO_VOICE;
+        voice.next = freeHead;
+        freeHead = slot;
+        --numActive;
+    }
+
+    /**
+     * Choose the sounding voice to give up for a new note
+     * @param policy Steal policy of the color channel
+     * @param midiNote Note about to start (for STEAL_SAME_PITCH)
+     * @return Slot to steal, or NO_VOICE if nothing is sounding
+     */
+    int chooseVoiceToSteal(VoiceStealPolicy policy, int midiNote) const {
+        if (policy == STEAL_LOWEST_VELOCITY) {
+            int best = oldest;
+            for (int slot = oldest; slot != NO_VOICE; slot = voices[slot].next) {
+                if (voices[slot].velocity < voices[best].velocity) {
+                    best = slot;
+                }
+            }
+            return best;
+        }
+
+        if (policy == STEAL_SAME_PITCH) {
+            int best = oldest;
+            int bestDistance = 128;
+            for (int slot = oldest; slot != NO_VOICE; slot = voices[slot].next) {
+                int distance = std::abs(voices[slot].midiNote - midiNote);
+                if (distance < bestDistance) {
+                    best = slot;
+                    bestDistance = distance;
+                }
+            }
+            return best;
+        }
+
+        return oldest;
+    }
+
+private:
+    std::array<Voice, MAX_VOICES_PER_COLOR> voices;
+    std::array<int, 128> voiceByNote;   // Slot sounding each MIDI note, or NO_VOICE
+    int freeHead = 0;
+    int oldest = NO_VOICE;
+    int newest = NO_VOICE;
+    int numActive = 0;
+    int voiceLimit = 1;
+};
+
+} // namespace SquareBeats
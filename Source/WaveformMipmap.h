@@ -0,0 +1,121 @@
+#pragma once
+
+#include "DataStructures.h"
+#include <vector>
+
+namespace SquareBeats {
+
+/**
+ * Min/max pyramid over a pitch envelope's grid samples, for drawing.
+ *
+ * Level 0 holds every grid sample; each level above halves the count, keeping
+ * the minimum and maximum of the two entries below it. getRange() answers
+ * "lowest and highest value between two grid points" by combining O(log n)
+ * entries, so a waveform can be drawn one pixel column at a time at a cost
+ * set by the pixel width rather than the resolution.
+ *
+ * A mipmap is built once per envelope; envelopes are immutable, so it stays
+ * valid until the waveform is replaced.
+ */
+class WaveformMipmap
+{
+public:
+    struct Range
+    {
+        float min;
+        float max;
+    };
+
+    WaveformMipmap() = default;
+
+    explicit WaveformMipmap(const PitchEnvelope& envelope)
+    {
+        std::vector<float> samples = envelope.toSamples();
+        if (samples.empty())
+        {
+            return;
+        }
+
+        std::vector<Range> level;
+        level.reserve(samples.size());
+        for (float value : samples)
+        {
+            level.push_back({ value, value });
+        }
+        levels.push_back(std::move(level));
+
+        while (levels.back().size() > 1)
+        {
+            const std::vector<Range>& below = levels.back();
+            std::vector<Range> above;
+            above.reserve((below.size() + 1) / 2);
+            for (size_t i = 0; i < below.size(); i += 2)
+            {
+                Range range = below[i];
+                if (i + 1 < below.size())
+                {
+                    range.min = juce::jmin(range.min, below[i + 1].min);
+                    range.max = juce::jmax(range.max, below[i + 1].max);
+                }
+                above.push_back(range);
+            }
+            levels.push_back(std::move(above));
+        }
+    }
+
+    int getNumSamples() const
+    {
+        return levels.empty() ? 0 : static_cast<int>(levels.front().size());
+    }
+
+    /**
+     * Lowest and highest grid value from startIndex to endIndex inclusive
+     * Indices are clamped to the grid; an empty mipmap returns { 0, 0 }.
+     */
+    Range getRange(int startIndex, int endIndex) const
+    {
+        if (levels.empty())
+        {
+            return { 0.0f, 0.0f };
+        }
+
+        int last = getNumSamples() - 1;
+        startIndex = juce::jlimit(0, last, startIndex);
+        endIndex = juce::jlimit(startIndex, last, endIndex);
+
+        Range result = levels.front()[static_cast<size_t>(startIndex)];
+
+        // Walk up the pyramid, taking the unpaired entry at each end of [start, end)
+        int start = startIndex;
+        int end = endIndex + 1;
+        for (size_t levelIndex = 0; start < end && levelIndex < levels.size(); ++levelIndex)
+        {
+            const std::vector<Range>& level = levels[levelIndex];
+            if (start & 1)
+            {
+                include(result, level[static_cast<size_t>(start)]);
+                ++start;
+            }
+            if (end & 1)
+            {
+                --end;
+                include(result, level[static_cast<size_t>(end)]);
+            }
+            start >>= 1;
+            end >>= 1;
+        }
+
+        return result;
+    }
+
+private:
+    std::vector<std::vector<Range>> levels;
+
+    static void include(Range& range, const Range& other)
+    {
+        range.min = juce::jmin(range.min, other.min);
+        range.max = juce::jmax(range.max, other.max);
+    }
+};
+
+} // namespace SquareBeats